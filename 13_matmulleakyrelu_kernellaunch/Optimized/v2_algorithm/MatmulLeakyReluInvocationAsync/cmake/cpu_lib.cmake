@@ -7,6 +7,8 @@ add_library(ascendc_kernels_${RUN_MODE} SHARED ${KERNEL_FILES})
 target_link_libraries(ascendc_kernels_${RUN_MODE} PUBLIC tikicpulib::${SOC_VERSION})
 target_compile_definitions(ascendc_kernels_${RUN_MODE} PRIVATE
     $<$<BOOL:$<IN_LIST:${SOC_VERSION},${CUSTOM_ASCEND310P_LIST}>>:CUSTOM_ASCEND310P>
+    $<$<BOOL:${KERNEL_TRACE}>:KERNEL_TRACE>
 )
+target_include_directories(ascendc_kernels_${RUN_MODE} PRIVATE ${KERNEL_TRACE_INCLUDE_DIR})
 target_compile_options(ascendc_kernels_${RUN_MODE} PRIVATE -g -O0 -std=c++17)
 install(TARGETS ascendc_kernels_${RUN_MODE} DESTINATION ${CMAKE_INSTALL_LIBDIR})
@@ -14,4 +14,9 @@ ascendc_compile_definitions(ascendc_kernels_${RUN_MODE} PRIVATE
     $<$<BOOL:$<IN_LIST:${SOC_VERSION},${CUSTOM_ASCEND310P_LIST}>>:CUSTOM_ASCEND310P>
     HAVE_WORKSPACE
     HAVE_TILING
+    $<$<BOOL:${KERNEL_TRACE}>:KERNEL_TRACE>
+)
+
+ascendc_include_directories(ascendc_kernels_${RUN_MODE} PRIVATE
+    ${KERNEL_TRACE_INCLUDE_DIR}
 )
@@ -10,6 +10,7 @@
 #ifndef DATA_UTILS_H
 #define DATA_UTILS_H
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -61,7 +62,7 @@ typedef enum {
  * @param [out] fileSize: file size
  * @return read result
  */
-bool ReadFile(const std::string &filePath, size_t &fileSize, void *buffer, size_t bufferSize)
+inline bool ReadFile(const std::string &filePath, size_t &fileSize, void *buffer, size_t bufferSize)
 {
     struct stat sBuf;
     int fileStatus = stat(filePath.data(), &sBuf);
@@ -107,7 +108,7 @@ bool ReadFile(const std::string &filePath, size_t &fileSize, void *buffer, size_
  * @param [in] size: size to write
  * @return write result
  */
-bool WriteFile(const std::string &filePath, const void *buffer, size_t size)
+inline bool WriteFile(const std::string &filePath, const void *buffer, size_t size)
 {
     if (buffer == nullptr) {
         ERROR_LOG("Write file failed. buffer is nullptr");
@@ -130,6 +131,87 @@ bool WriteFile(const std::string &filePath, const void *buffer, size_t size)
     return true;
 }
 
+/**
+ * @brief Map a whole file read only, so callers use the page cache pages in place instead of copying them
+ * @param [in] filePath: file path
+ * @param [out] fileSize: file size
+ * @return mapped address, nullptr on failure; release with UnmapFile
+ */
+inline void *MapFileRead(const std::string &filePath, size_t &fileSize)
+{
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        ERROR_LOG("Open file failed. path = %s", filePath.c_str());
+        return nullptr;
+    }
+    struct stat sBuf;
+    if (fstat(fd, &sBuf) == -1 || S_ISREG(sBuf.st_mode) == 0 || sBuf.st_size == 0) {
+        ERROR_LOG("%s is not a non-empty file", filePath.c_str());
+        (void)close(fd);
+        return nullptr;
+    }
+    size_t size = static_cast<size_t>(sBuf.st_size);
+    // MAP_POPULATE faults every page in up front so the first touch inside a kernel does not pay for it.
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    (void)close(fd);
+    if (addr == MAP_FAILED) {
+        ERROR_LOG("mmap failed. path = %s", filePath.c_str());
+        return nullptr;
+    }
+    // Hints only: huge pages apply where the kernel supports THP for the backing file system.
+    (void)madvise(addr, size, MADV_HUGEPAGE);
+    (void)madvise(addr, size, MADV_SEQUENTIAL);
+    fileSize = size;
+    return addr;
+}
+
+/**
+ * @brief Create (or truncate) a file of size bytes and map it shared and writable, so data stored through the
+ *        mapping is the file content and no WriteFile copy is needed; shared mappings stay shared across fork
+ * @param [in] filePath: file path
+ * @param [in] size: file size
+ * @return mapped address, nullptr on failure; release with UnmapFile
+ */
+inline void *MapFileWrite(const std::string &filePath, size_t size)
+{
+    int fd = open(filePath.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWRITE);
+    if (fd < 0) {
+        ERROR_LOG("Open file failed. path = %s", filePath.c_str());
+        return nullptr;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ERROR_LOG("Resize file failed. path = %s", filePath.c_str());
+        (void)close(fd);
+        return nullptr;
+    }
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    (void)close(fd);
+    if (addr == MAP_FAILED) {
+        ERROR_LOG("mmap failed. path = %s", filePath.c_str());
+        return nullptr;
+    }
+    (void)madvise(addr, size, MADV_HUGEPAGE);
+    return addr;
+}
+
+/**
+ * @brief Release a mapping from MapFileRead or MapFileWrite
+ * @param [in] sync: flush a written mapping to the file before unmapping
+ * @return unmap result
+ */
+inline bool UnmapFile(void *addr, size_t size, bool sync)
+{
+    if (addr == nullptr) {
+        return true;
+    }
+    bool ok = !sync || msync(addr, size, MS_SYNC) == 0;
+    ok = munmap(addr, size) == 0 && ok;
+    if (!ok) {
+        ERROR_LOG("Unmap file failed.");
+    }
+    return ok;
+}
+
 template <typename T> void DoPrintData(const T *data, size_t count, size_t elementsPerRow)
 {
     assert(elementsPerRow != 0);
@@ -141,7 +223,7 @@ template <typename T> void DoPrintData(const T *data, size_t count, size_t eleme
     }
 }
 
-void DoPrintHalfData(const aclFloat16 *data, size_t count, size_t elementsPerRow)
+inline void DoPrintHalfData(const aclFloat16 *data, size_t count, size_t elementsPerRow)
 {
     assert(elementsPerRow != 0);
     for (size_t i = 0; i < count; ++i) {
@@ -152,7 +234,7 @@ void DoPrintHalfData(const aclFloat16 *data, size_t count, size_t elementsPerRow
     }
 }
 
-void PrintData(const void *data, size_t count, printDataType dataType, size_t elementsPerRow = 16)
+inline void PrintData(const void *data, size_t count, printDataType dataType, size_t elementsPerRow = 16)
 {
     if (data == nullptr) {
         ERROR_LOG("Print data failed. data is nullptr");
@@ -0,0 +1,579 @@
+/**
+ * @file host_reference_gemm.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "host_reference_gemm.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REF_GEMM_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define REF_GEMM_NEON 1
+#endif
+
+#include "bench_stats.h"
+#include "data_utils.h"
+
+namespace {
+
+constexpr uint32_t K_BLOCK = 256;   // K slice kept hot while a row group walks a B panel
+constexpr uint32_t N_PANEL = 256;   // B panel of K_BLOCK x N_PANEL fp32 = 256 KiB, L2 resident
+constexpr uint32_t ROW_CHUNK = 32;  // rows of C handed to a thread at a time
+constexpr size_t CONVERT_CHUNK = 1U << 16;
+
+using ConvertFn = void (*)(const uint16_t *, float *, size_t);
+using BlockFn = void (*)(const float *, size_t, const float *, size_t, float *, size_t, uint32_t, uint32_t, uint32_t);
+
+float HalfToFloat(uint16_t h)
+{
+    uint32_t sign = static_cast<uint32_t>(h & 0x8000U) << 16;
+    uint32_t exp = (h >> 10) & 0x1FU;
+    uint32_t mant = h & 0x3FFU;
+    uint32_t bits;
+    if (exp == 0U) {
+        if (mant == 0U) {
+            bits = sign;
+        } else {
+            // Subnormal half: normalize into the fp32 exponent range.
+            exp = 127U - 15U + 1U;
+            while ((mant & 0x400U) == 0U) {
+                mant <<= 1;
+                --exp;
+            }
+            bits = sign | (exp << 23) | ((mant & 0x3FFU) << 13);
+        }
+    } else if (exp == 0x1FU) {
+        bits = sign | 0x7F800000U | (mant << 13);
+    } else {
+        bits = sign | ((exp + 112U) << 23) | (mant << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+  * @brief  fp16 bits of a small positive integer, exact for 1..2048.
+  */
+uint16_t SmallIntToHalf(uint32_t value)
+{
+    uint32_t exponent = 0;
+    while ((value >> (exponent + 1U)) != 0U) {
+        ++exponent;
+    }
+    const uint32_t mantissa = (value - (1U << exponent)) << (10U - exponent);
+    return static_cast<uint16_t>(((exponent + 15U) << 10) | mantissa);
+}
+
+void ConvertScalar(const uint16_t *src, float *dst, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = HalfToFloat(src[i]);
+    }
+}
+
+/**
+  * @brief  c[rows, cols] += a[rows, kLen] * b[kLen, cols], leading dimensions in elements.
+  */
+void BlockScalar(const float *a, size_t lda, const float *b, size_t ldb, float *c, size_t ldc, uint32_t rows,
+                 uint32_t cols, uint32_t kLen)
+{
+    for (uint32_t i = 0; i < rows; ++i) {
+        float *cRow = c + i * ldc;
+        for (uint32_t k = 0; k < kLen; ++k) {
+            const float av = a[i * lda + k];
+            const float *bRow = b + k * ldb;
+            for (uint32_t j = 0; j < cols; ++j) {
+                cRow[j] += av * bRow[j];
+            }
+        }
+    }
+}
+
+#ifdef REF_GEMM_X86
+__attribute__((target("avx2,fma,f16c"))) void ConvertAvx2(const uint16_t *src, float *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8U <= count; i += 8U) {
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+    }
+    ConvertScalar(src + i, dst + i, count - i);
+}
+
+/**
+  * @brief  4 x 16 register tile: 8 accumulators, 2 B loads and 4 broadcasts per k.
+  */
+__attribute__((target("avx2,fma"))) void BlockAvx2(const float *a, size_t lda, const float *b, size_t ldb, float *c,
+                                                    size_t ldc, uint32_t rows, uint32_t cols, uint32_t kLen)
+{
+    uint32_t i = 0;
+    for (; i + 4U <= rows; i += 4U) {
+        const float *a0 = a + i * lda;
+        const float *a1 = a0 + lda;
+        const float *a2 = a1 + lda;
+        const float *a3 = a2 + lda;
+        float *c0 = c + i * ldc;
+        float *c1 = c0 + ldc;
+        float *c2 = c1 + ldc;
+        float *c3 = c2 + ldc;
+        uint32_t j = 0;
+        for (; j + 16U <= cols; j += 16U) {
+            __m256 acc00 = _mm256_loadu_ps(c0 + j);
+            __m256 acc01 = _mm256_loadu_ps(c0 + j + 8);
+            __m256 acc10 = _mm256_loadu_ps(c1 + j);
+            __m256 acc11 = _mm256_loadu_ps(c1 + j + 8);
+            __m256 acc20 = _mm256_loadu_ps(c2 + j);
+            __m256 acc21 = _mm256_loadu_ps(c2 + j + 8);
+            __m256 acc30 = _mm256_loadu_ps(c3 + j);
+            __m256 acc31 = _mm256_loadu_ps(c3 + j + 8);
+            for (uint32_t k = 0; k < kLen; ++k) {
+                const float *bk = b + k * ldb + j;
+                const __m256 b0 = _mm256_loadu_ps(bk);
+                const __m256 b1 = _mm256_loadu_ps(bk + 8);
+                __m256 av = _mm256_broadcast_ss(a0 + k);
+                acc00 = _mm256_fmadd_ps(av, b0, acc00);
+                acc01 = _mm256_fmadd_ps(av, b1, acc01);
+                av = _mm256_broadcast_ss(a1 + k);
+                acc10 = _mm256_fmadd_ps(av, b0, acc10);
+                acc11 = _mm256_fmadd_ps(av, b1, acc11);
+                av = _mm256_broadcast_ss(a2 + k);
+                acc20 = _mm256_fmadd_ps(av, b0, acc20);
+                acc21 = _mm256_fmadd_ps(av, b1, acc21);
+                av = _mm256_broadcast_ss(a3 + k);
+                acc30 = _mm256_fmadd_ps(av, b0, acc30);
+                acc31 = _mm256_fmadd_ps(av, b1, acc31);
+            }
+            _mm256_storeu_ps(c0 + j, acc00);
+            _mm256_storeu_ps(c0 + j + 8, acc01);
+            _mm256_storeu_ps(c1 + j, acc10);
+            _mm256_storeu_ps(c1 + j + 8, acc11);
+            _mm256_storeu_ps(c2 + j, acc20);
+            _mm256_storeu_ps(c2 + j + 8, acc21);
+            _mm256_storeu_ps(c3 + j, acc30);
+            _mm256_storeu_ps(c3 + j + 8, acc31);
+        }
+        if (j < cols) {
+            BlockScalar(a0, lda, b + j, ldb, c0 + j, ldc, 4U, cols - j, kLen);
+        }
+    }
+    if (i < rows) {
+        BlockScalar(a + i * lda, lda, b, ldb, c + i * ldc, ldc, rows - i, cols, kLen);
+    }
+}
+
+/**
+  * @brief  4 x 32 register tile, the AVX-512 counterpart of BlockAvx2.
+  */
+__attribute__((target("avx512f"))) void BlockAvx512(const float *a, size_t lda, const float *b, size_t ldb, float *c,
+                                                     size_t ldc, uint32_t rows, uint32_t cols, uint32_t kLen)
+{
+    uint32_t i = 0;
+    for (; i + 4U <= rows; i += 4U) {
+        const float *a0 = a + i * lda;
+        const float *a1 = a0 + lda;
+        const float *a2 = a1 + lda;
+        const float *a3 = a2 + lda;
+        float *c0 = c + i * ldc;
+        float *c1 = c0 + ldc;
+        float *c2 = c1 + ldc;
+        float *c3 = c2 + ldc;
+        uint32_t j = 0;
+        for (; j + 32U <= cols; j += 32U) {
+            __m512 acc00 = _mm512_loadu_ps(c0 + j);
+            __m512 acc01 = _mm512_loadu_ps(c0 + j + 16);
+            __m512 acc10 = _mm512_loadu_ps(c1 + j);
+            __m512 acc11 = _mm512_loadu_ps(c1 + j + 16);
+            __m512 acc20 = _mm512_loadu_ps(c2 + j);
+            __m512 acc21 = _mm512_loadu_ps(c2 + j + 16);
+            __m512 acc30 = _mm512_loadu_ps(c3 + j);
+            __m512 acc31 = _mm512_loadu_ps(c3 + j + 16);
+            for (uint32_t k = 0; k < kLen; ++k) {
+                const float *bk = b + k * ldb + j;
+                const __m512 b0 = _mm512_loadu_ps(bk);
+                const __m512 b1 = _mm512_loadu_ps(bk + 16);
+                __m512 av = _mm512_set1_ps(a0[k]);
+                acc00 = _mm512_fmadd_ps(av, b0, acc00);
+                acc01 = _mm512_fmadd_ps(av, b1, acc01);
+                av = _mm512_set1_ps(a1[k]);
+                acc10 = _mm512_fmadd_ps(av, b0, acc10);
+                acc11 = _mm512_fmadd_ps(av, b1, acc11);
+                av = _mm512_set1_ps(a2[k]);
+                acc20 = _mm512_fmadd_ps(av, b0, acc20);
+                acc21 = _mm512_fmadd_ps(av, b1, acc21);
+                av = _mm512_set1_ps(a3[k]);
+                acc30 = _mm512_fmadd_ps(av, b0, acc30);
+                acc31 = _mm512_fmadd_ps(av, b1, acc31);
+            }
+            _mm512_storeu_ps(c0 + j, acc00);
+            _mm512_storeu_ps(c0 + j + 16, acc01);
+            _mm512_storeu_ps(c1 + j, acc10);
+            _mm512_storeu_ps(c1 + j + 16, acc11);
+            _mm512_storeu_ps(c2 + j, acc20);
+            _mm512_storeu_ps(c2 + j + 16, acc21);
+            _mm512_storeu_ps(c3 + j, acc30);
+            _mm512_storeu_ps(c3 + j + 16, acc31);
+        }
+        if (j < cols) {
+            BlockScalar(a0, lda, b + j, ldb, c0 + j, ldc, 4U, cols - j, kLen);
+        }
+    }
+    if (i < rows) {
+        BlockScalar(a + i * lda, lda, b, ldb, c + i * ldc, ldc, rows - i, cols, kLen);
+    }
+}
+#endif
+
+#ifdef REF_GEMM_NEON
+void ConvertNeon(const uint16_t *src, float *dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4U <= count; i += 4U) {
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+    }
+    ConvertScalar(src + i, dst + i, count - i);
+}
+
+/**
+  * @brief  4 x 16 register tile: 16 accumulators, 4 B loads and 4 scalar FMAs per k, half of the 32 vector
+  *         registers.
+  */
+void BlockNeon(const float *a, size_t lda, const float *b, size_t ldb, float *c, size_t ldc, uint32_t rows,
+               uint32_t cols, uint32_t kLen)
+{
+    constexpr uint32_t TILE_ROWS = 4U;
+    constexpr uint32_t TILE_VECS = 4U;
+    uint32_t i = 0;
+    for (; i + TILE_ROWS <= rows; i += TILE_ROWS) {
+        uint32_t j = 0;
+        for (; j + TILE_VECS * 4U <= cols; j += TILE_VECS * 4U) {
+            float32x4_t acc[TILE_ROWS][TILE_VECS];
+            for (uint32_t r = 0; r < TILE_ROWS; ++r) {
+                for (uint32_t v = 0; v < TILE_VECS; ++v) {
+                    acc[r][v] = vld1q_f32(c + (i + r) * ldc + j + v * 4U);
+                }
+            }
+            for (uint32_t k = 0; k < kLen; ++k) {
+                const float *bk = b + k * ldb + j;
+                float32x4_t bv[TILE_VECS];
+                for (uint32_t v = 0; v < TILE_VECS; ++v) {
+                    bv[v] = vld1q_f32(bk + v * 4U);
+                }
+                for (uint32_t r = 0; r < TILE_ROWS; ++r) {
+                    const float av = a[(i + r) * lda + k];
+                    for (uint32_t v = 0; v < TILE_VECS; ++v) {
+                        acc[r][v] = vfmaq_n_f32(acc[r][v], bv[v], av);
+                    }
+                }
+            }
+            for (uint32_t r = 0; r < TILE_ROWS; ++r) {
+                for (uint32_t v = 0; v < TILE_VECS; ++v) {
+                    vst1q_f32(c + (i + r) * ldc + j + v * 4U, acc[r][v]);
+                }
+            }
+        }
+        if (j < cols) {
+            BlockScalar(a + i * lda, lda, b + j, ldb, c + i * ldc + j, ldc, TILE_ROWS, cols - j, kLen);
+        }
+    }
+    if (i < rows) {
+        BlockScalar(a + i * lda, lda, b, ldb, c + i * ldc, ldc, rows - i, cols, kLen);
+    }
+}
+#endif
+
+RefGemmIsa DetectIsa()
+{
+    RefGemmIsa isa = RefGemmIsa::SCALAR;
+#ifdef REF_GEMM_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+        isa = RefGemmIsa::AVX2;
+        if (__builtin_cpu_supports("avx512f")) {
+            isa = RefGemmIsa::AVX512;
+        }
+    }
+#elif defined(REF_GEMM_NEON)
+    isa = RefGemmIsa::NEON;
+#endif
+    const char *forced = std::getenv("MATMUL_REF_ISA");
+    if (forced != nullptr) {
+        if (std::strcmp(forced, "scalar") == 0) {
+            isa = RefGemmIsa::SCALAR;
+        } else if (std::strcmp(forced, "avx2") == 0 && isa == RefGemmIsa::AVX512) {
+            isa = RefGemmIsa::AVX2;
+        }
+    }
+    return isa;
+}
+
+void GetKernels(RefGemmIsa isa, ConvertFn &convert, BlockFn &block)
+{
+    convert = ConvertScalar;
+    block = BlockScalar;
+#ifdef REF_GEMM_X86
+    if (isa == RefGemmIsa::AVX2) {
+        convert = ConvertAvx2;
+        block = BlockAvx2;
+    } else if (isa == RefGemmIsa::AVX512) {
+        convert = ConvertAvx2; // conversion is bandwidth bound, F16C is enough
+        block = BlockAvx512;
+    }
+#elif defined(REF_GEMM_NEON)
+    if (isa == RefGemmIsa::NEON) {
+        convert = ConvertNeon;
+        block = BlockNeon;
+    }
+#else
+    (void)isa;
+#endif
+}
+
+uint32_t ResolveThreads(uint32_t threadNum)
+{
+    if (threadNum == 0U) {
+        const char *value = std::getenv("MATMUL_REF_THREADS");
+        threadNum = value == nullptr ? 0U : static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+    }
+    if (threadNum == 0U) {
+        threadNum = std::max(1U, std::thread::hardware_concurrency());
+    }
+    return threadNum;
+}
+
+/**
+  * @brief  Run fn(0) ... fn(count - 1) on threadNum threads, the caller included.
+  */
+void ParallelFor(uint32_t threadNum, size_t count, const std::function<void(size_t)> &fn)
+{
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t index = next.fetch_add(1); index < count; index = next.fetch_add(1)) {
+            fn(index);
+        }
+    };
+    const size_t helpers = std::min<size_t>(threadNum, count) - (count > 0U ? 1U : 0U);
+    std::vector<std::thread> threads;
+    threads.reserve(helpers);
+    for (size_t t = 0; t < helpers; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void ParallelConvert(uint32_t threadNum, ConvertFn convert, const uint16_t *src, float *dst, size_t count)
+{
+    ParallelFor(threadNum, (count + CONVERT_CHUNK - 1U) / CONVERT_CHUNK, [&](size_t chunk) {
+        const size_t begin = chunk * CONVERT_CHUNK;
+        convert(src + begin, dst + begin, std::min(CONVERT_CHUNK, count - begin));
+    });
+}
+
+uint64_t Checksum(const void *data, size_t size, uint64_t hash)
+{
+    // FNV-1a over 8-byte words, bytes for the tail.
+    constexpr uint64_t PRIME = 1099511628211ULL;
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * PRIME;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * PRIME;
+    }
+    return hash;
+}
+
+struct GoldenCacheHeader {
+    char magic[8];
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t seed;
+    uint64_t inputChecksum;
+};
+
+constexpr char GOLDEN_CACHE_MAGIC[8] = {'M', 'L', 'R', 'G', 'O', 'L', 'D', '1'};
+
+bool ReadCachedGolden(const std::string &path, const GoldenCacheHeader &expect, std::vector<float> &golden)
+{
+    std::ifstream in(path, std::ios::binary);
+    GoldenCacheHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+        return false;
+    }
+    if (std::memcmp(&header, &expect, sizeof(header)) != 0) {
+        return false;
+    }
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(golden.data()),
+                                     static_cast<std::streamsize>(golden.size() * sizeof(float))));
+}
+
+void WriteCachedGolden(const std::string &dir, const std::string &path, const GoldenCacheHeader &header,
+                       const std::vector<float> &golden)
+{
+    (void)mkdir(dir.c_str(), 0755);
+    // Written aside and renamed, so a concurrent run never reads half a golden.
+    const std::string tmpPath = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(golden.data()),
+                  static_cast<std::streamsize>(golden.size() * sizeof(float)));
+        if (!out) {
+            WARN_LOG("golden cache write failed. path = %s", tmpPath.c_str());
+            (void)std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        (void)std::remove(tmpPath.c_str());
+    }
+}
+
+} // namespace
+
+RefGemmIsa GetRefGemmIsa()
+{
+    static const RefGemmIsa isa = DetectIsa();
+    return isa;
+}
+
+const char *RefGemmIsaName(RefGemmIsa isa)
+{
+    switch (isa) {
+        case RefGemmIsa::AVX512:
+            return "avx512";
+        case RefGemmIsa::AVX2:
+            return "avx2";
+        case RefGemmIsa::NEON:
+            return "neon";
+        default:
+            return "scalar";
+    }
+}
+
+void ReferenceMatmulLeakyRelu(const uint16_t *a, const uint16_t *b, const float *bias, float *c, uint32_t M,
+                              uint32_t N, uint32_t K, float alpha, uint32_t threadNum)
+{
+    ConvertFn convert;
+    BlockFn block;
+    GetKernels(GetRefGemmIsa(), convert, block);
+    threadNum = ResolveThreads(threadNum);
+
+    std::vector<float> aF32(static_cast<size_t>(M) * K);
+    std::vector<float> bF32(static_cast<size_t>(K) * N);
+    ParallelConvert(threadNum, convert, a, aF32.data(), aF32.size());
+    ParallelConvert(threadNum, convert, b, bF32.data(), bF32.size());
+
+    const uint32_t chunks = (M + ROW_CHUNK - 1U) / ROW_CHUNK;
+    ParallelFor(threadNum, chunks, [&](size_t chunk) {
+        const uint32_t row0 = static_cast<uint32_t>(chunk) * ROW_CHUNK;
+        const uint32_t rows = std::min(ROW_CHUNK, M - row0);
+        float *cRows = c + static_cast<size_t>(row0) * N;
+        std::fill(cRows, cRows + static_cast<size_t>(rows) * N, 0.0f);
+        for (uint32_t k0 = 0; k0 < K; k0 += K_BLOCK) {
+            const uint32_t kLen = std::min(K_BLOCK, K - k0);
+            for (uint32_t j0 = 0; j0 < N; j0 += N_PANEL) {
+                block(aF32.data() + static_cast<size_t>(row0) * K + k0, K,
+                      bF32.data() + static_cast<size_t>(k0) * N + j0, N, cRows + j0, N, rows,
+                      std::min(N_PANEL, N - j0), kLen);
+            }
+        }
+        // Bias after the full sum, in the order of the numpy golden.
+        for (uint32_t i = 0; i < rows; ++i) {
+            float *cRow = cRows + static_cast<size_t>(i) * N;
+            for (uint32_t j = 0; j < N; ++j) {
+                const float value = cRow[j] + bias[j];
+                cRow[j] = value >= 0.0f ? value : value * alpha;
+            }
+        }
+    });
+}
+
+void FillSmallIntInputs(uint32_t seed, uint16_t *half, size_t count, float *values, size_t valueCount)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> dist(1U, 9U);
+    for (size_t i = 0; i < count; ++i) {
+        half[i] = SmallIntToHalf(dist(rng));
+    }
+    for (size_t i = 0; i < valueCount; ++i) {
+        values[i] = static_cast<float>(dist(rng));
+    }
+}
+
+bool WriteHostGolden(uint32_t M, uint32_t N, uint32_t K, uint32_t seed, const char *goldenPath)
+{
+    const size_t aSize = static_cast<size_t>(M) * K * sizeof(uint16_t);
+    const size_t bSize = static_cast<size_t>(K) * N * sizeof(uint16_t);
+    const size_t biasSize = static_cast<size_t>(N) * sizeof(float);
+    size_t aMapped = 0;
+    size_t bMapped = 0;
+    size_t biasMapped = 0;
+    void *a = MapFileRead("./input/x1_gm.bin", aMapped);
+    void *b = MapFileRead("./input/x2_gm.bin", bMapped);
+    void *bias = MapFileRead("./input/bias.bin", biasMapped);
+    bool ok = a != nullptr && b != nullptr && bias != nullptr && aMapped >= aSize && bMapped >= bSize &&
+              biasMapped >= biasSize;
+    if (!ok) {
+        ERROR_LOG("host golden needs inputs of at least %zu/%zu/%zu bytes", aSize, bSize, biasSize);
+    }
+
+    std::vector<float> golden(ok ? static_cast<size_t>(M) * N : 0U);
+    if (ok) {
+        GoldenCacheHeader header;
+        std::memcpy(header.magic, GOLDEN_CACHE_MAGIC, sizeof(header.magic));
+        header.M = M;
+        header.N = N;
+        header.K = K;
+        header.seed = seed;
+        constexpr uint64_t FNV_OFFSET = 14695981039346656037ULL;
+        header.inputChecksum = Checksum(bias, biasSize, Checksum(b, bSize, Checksum(a, aSize, FNV_OFFSET)));
+        const char *dirEnv = std::getenv("MATMUL_GOLDEN_CACHE_DIR");
+        const std::string dir = dirEnv == nullptr ? "./golden_cache" : dirEnv;
+        const std::string path = dir + "/golden_" + std::to_string(M) + "_" + std::to_string(N) + "_" +
+                                 std::to_string(K) + "_" + std::to_string(seed) + ".bin";
+        if (ReadCachedGolden(path, header, golden)) {
+            std::printf("[GOLDEN] cache hit %s\n", path.c_str());
+        } else {
+            const double begin = HostNowUs();
+            ReferenceMatmulLeakyRelu(static_cast<const uint16_t *>(a), static_cast<const uint16_t *>(b),
+                                     static_cast<const float *>(bias), golden.data(), M, N, K, 0.001f);
+            const double us = HostNowUs() - begin;
+            std::printf("[GOLDEN] host reference isa=%s threads=%u M=%u N=%u K=%u ms=%.3f gflops=%.1f\n",
+                        RefGemmIsaName(GetRefGemmIsa()), ResolveThreads(0U), M, N, K, us / 1000.0,
+                        2.0 * M * N * K / (us * 1e3));
+            WriteCachedGolden(dir, path, header, golden);
+        }
+        ok = WriteFile(goldenPath, golden.data(), golden.size() * sizeof(float));
+    }
+    (void)UnmapFile(a, aMapped, false);
+    (void)UnmapFile(b, bMapped, false);
+    (void)UnmapFile(bias, biasMapped, false);
+    return ok;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file host_reference_gemm.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef HOST_REFERENCE_GEMM_H
+#define HOST_REFERENCE_GEMM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+  * @brief  Instruction set of the host reference GEMM. Picked once from cpuid on x86, AArch64 hosts always have
+  *         NEON. MATMUL_REF_ISA=scalar|avx2|avx512 forces a lower one (a level the host lacks is ignored).
+  */
+enum class RefGemmIsa : uint32_t {
+    SCALAR = 0,
+    AVX2 = 1,   // AVX2 + FMA + F16C
+    AVX512 = 2, // AVX-512F, fp16 conversion through F16C
+    NEON = 3,   // AArch64 Advanced SIMD, fp16 conversion through FCVTL
+};
+
+RefGemmIsa GetRefGemmIsa();
+
+const char *RefGemmIsaName(RefGemmIsa isa);
+
+/**
+  * @brief  c[M, N] = LeakyRelu(fp32(a[M, K]) * fp32(b[K, N]) + bias[N], alpha), the same math as the numpy golden
+  *         of scripts/gen_data.py. a and b hold fp16 bits, c is fp32, all row major. Rows of C are spread over
+  *         threadNum host threads (0: MATMUL_REF_THREADS, default all hardware threads).
+  */
+void ReferenceMatmulLeakyRelu(const uint16_t *a, const uint16_t *b, const float *bias, float *c, uint32_t M,
+                              uint32_t N, uint32_t K, float alpha, uint32_t threadNum = 0);
+
+/**
+  * @brief  Integers 1..9 drawn from seed, the value range of scripts/gen_data.py: count fp16 values into half, then
+  *         valueCount fp32 values into values. Products summed over K stay exact in fp32.
+  */
+void FillSmallIntInputs(uint32_t seed, uint16_t *half, size_t count, float *values = nullptr, size_t valueCount = 0);
+
+/**
+  * @brief  Compute the golden of ./input/{x1_gm,x2_gm,bias}.bin into goldenPath with ReferenceMatmulLeakyRelu.
+  *         Results are cached in MATMUL_GOLDEN_CACHE_DIR (default ./golden_cache) under (M, N, K, seed); a
+  *         cached golden is reused only when the checksum of the inputs it was computed from still matches.
+  * @return false when the inputs are missing or too short, or the golden cannot be written.
+  */
+bool WriteHostGolden(uint32_t M, uint32_t N, uint32_t K, uint32_t seed, const char *goldenPath);
+
+#endif // HOST_REFERENCE_GEMM_H
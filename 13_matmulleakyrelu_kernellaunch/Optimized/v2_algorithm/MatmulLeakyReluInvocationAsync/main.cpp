@@ -10,12 +10,31 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <vector>
 
+#include "bench_stats.h"
 #include "data_utils.h"
+#include "env_config.h"
+#include "host_reference_gemm.h"
+#include "host_timeline.h"
+#include "kernel_trace_decoder.h"
 #include "kernel_tiling/kernel_tiling.h"
+#include "launch_mem_account.h"
+#include "matmul_pipeline.h"
+#include "matmul_service.h"
+#include "matmul_shape_bucket.h"
+#include "matmul_sweep.h"
+#include "result_verifier.h"
+#include "stream_loader.h"
 #include "tiling/platform/platform_ascendc.h"
 #ifndef ASCENDC_CPU_DEBUG
 #include "acl/acl.h"
+#include "acl_mem_pool.h"
 #include "aclrtlaunch_matmul_leakyrelu_custom.h"
 #else
 #include "tikicpulib.h"
@@ -24,42 +43,157 @@ extern "C" void matmul_leakyrelu_custom(uint8_t *, uint8_t *, uint8_t *, uint8_t
 
 extern bool GenerateTiling(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
                            uint32_t preferredCoreNum);
+extern uint32_t GenerateTilingBatch(const char *socVersion, const uint32_t *shapes, uint32_t count, uint8_t *tilingBufs,
+                                    size_t tilingStride, uint32_t preferredCoreNum, bool *ok);
 
 namespace {
 
-uint32_t GetEnvU32(const char *name, uint32_t defaultValue)
+/**
+  * @brief  Tile every shape of MATMUL_TILING_PRELOAD ("M,N,K;M,N,K;...") in one parallel batch so later
+  *         GenerateTiling calls for them are tiling cache hits.
+  */
+void PreloadTilings(const char *socVersion, uint32_t preferredCoreNum)
 {
-    const char *value = std::getenv(name);
-    if (value == nullptr) {
-        return defaultValue;
+    const char *spec = std::getenv("MATMUL_TILING_PRELOAD");
+    if (spec == nullptr) {
+        return;
     }
-    char *end = nullptr;
-    unsigned long parsed = std::strtoul(value, &end, 10);
-    if (end == value || *end != '\0' || parsed == 0UL) {
-        return defaultValue;
+    std::vector<uint32_t> shapes;
+    std::stringstream all(spec);
+    std::string item;
+    while (std::getline(all, item, ';')) {
+        uint32_t m = 0;
+        uint32_t n = 0;
+        uint32_t k = 0;
+        char sep1 = 0;
+        char sep2 = 0;
+        std::stringstream one(item);
+        if ((one >> m >> sep1 >> n >> sep2 >> k) && sep1 == ',' && sep2 == ',' && m > 0U && n > 0U && k > 0U) {
+            shapes.insert(shapes.end(), {MatmulShapeBuckets::Global().Bucket(m), n, k});
+        }
     }
-    return static_cast<uint32_t>(parsed);
+    const uint32_t count = static_cast<uint32_t>(shapes.size() / 3U);
+    std::vector<uint8_t> tilings(static_cast<size_t>(count) * sizeof(TCubeTiling));
+    const uint32_t generated =
+        GenerateTilingBatch(socVersion, shapes.data(), count, tilings.data(), sizeof(TCubeTiling), preferredCoreNum, nullptr);
+    std::printf("[INFO] preloaded tiling for %u/%u shapes\n", generated, count);
 }
 
-uint32_t ResolvePreferredCoreNum(const platform_ascendc::PlatformAscendC *platform, uint32_t m, uint32_t n)
+const char *GetKernelTraceFile()
 {
-    const uint32_t forced = GetEnvU32("MATMUL_FORCE_CORE_NUM", 0U);
-    if (forced > 0U) {
-        return forced;
+    const char *path = std::getenv("KERNEL_TRACE_FILE");
+    return path == nullptr ? "./output/kernel_trace.json" : path;
+}
+
+#ifdef ASCENDC_CPU_DEBUG
+/**
+  * @brief  MATMUL_MMAP_IO=on hands the kernel the mapped input files and a mapped output file instead of
+  *         GmAlloc buffers filled by ReadFile and drained by WriteFile.
+  */
+bool UseMmapIo()
+{
+    const char *value = std::getenv("MATMUL_MMAP_IO");
+    return value != nullptr && std::strcmp(value, "on") == 0;
+}
+
+/**
+  * @brief  A CPU mode input tensor: mappedSize is the mapping length, 0 for a GmAlloc buffer. nullptr when the
+  *         file is missing or shorter than size.
+  */
+uint8_t *LoadCpuInput(const char *path, size_t size, bool mmapIo, size_t &mappedSize)
+{
+    mappedSize = 0;
+    if (mmapIo) {
+        size_t fileSize = 0;
+        void *mapped = MapFileRead(path, fileSize);
+        if (mapped != nullptr && fileSize >= size) {
+            mappedSize = fileSize;
+            return static_cast<uint8_t *>(mapped);
+        }
+        (void)UnmapFile(mapped, fileSize, false);
+        std::printf("[WARN] %s cannot be mapped as %zu bytes, fall back to GmAlloc\n", path, size);
+    }
+    uint8_t *buffer = (uint8_t *)AscendC::GmAlloc(size);
+    size_t readSize = 0;
+    if (!ReadFile(path, readSize, buffer, size) || readSize != size) {
+        AscendC::GmFree((void *)buffer);
+        return nullptr;
+    }
+    return buffer;
+}
+
+void ReleaseCpuTensor(uint8_t *tensor, size_t mappedSize, bool sync)
+{
+    if (mappedSize > 0) {
+        (void)UnmapFile(tensor, mappedSize, sync);
+    } else {
+        AscendC::GmFree((void *)tensor);
     }
+}
+#endif
 
-    const uint32_t maxAiv = std::max<uint32_t>(1U, platform->GetCoreNumAiv());
-    const uint32_t tileM = (m + 255U) / 256U;
-    const uint32_t tileN = (n + 127U) / 128U;
-    const uint64_t tileCount = static_cast<uint64_t>(tileM) * static_cast<uint64_t>(tileN);
-    if (tileCount == 0U) {
-        return 1U;
+/**
+  * @brief  In-process benchmark: MATMUL_BENCH_ITERS timed launches after MATMUL_BENCH_WARMUP untimed ones,
+  *         0 iterations (default) runs the kernel once as before.
+  */
+struct BenchConfig {
+    uint32_t warmup;
+    uint32_t iterations;
+    const char *jsonPath;
+};
+
+BenchConfig GetBenchConfig()
+{
+    // No warmup is a valid request here.
+    BenchConfig config = {GetEnvU32("MATMUL_BENCH_WARMUP", 3U, true), GetEnvU32("MATMUL_BENCH_ITERS", 0U),
+                          std::getenv("MATMUL_BENCH_JSON")};
+    if (config.jsonPath == nullptr) {
+        config.jsonPath = "./output/bench.json";
     }
+    return config;
+}
 
-    const uint32_t conservative = std::max<uint32_t>(1U, maxAiv / 2U);
-    const uint32_t adaptive = static_cast<uint32_t>(std::min<uint64_t>(tileCount, conservative));
-    const uint32_t adaptiveMaxCore = GetEnvU32("MATMUL_ADAPTIVE_MAX_CORE", 4U);
-    return std::max<uint32_t>(1U, std::min<uint32_t>(adaptive, adaptiveMaxCore));
+/**
+  * @brief  Print the kernel-only and end-to-end (H2D + launch + sync + D2H) latency distributions and
+  *         write them as JSON, together with the device memory footprint of the launch.
+  */
+void ReportBench(const BenchConfig &config, const TCubeTiling &tiling, uint32_t M, uint32_t N, uint32_t K,
+                 uint32_t blockDim, const LaunchMemFootprint &mem, const std::vector<double> &kernelUs,
+                 const std::vector<double> &e2eUs)
+{
+    const LatencyStats kernel = SummarizeLatency(kernelUs);
+    const LatencyStats e2e = SummarizeLatency(e2eUs);
+    const double flops = 2.0 * M * N * K;
+    const double tflops = kernel.mean > 0.0 ? flops / (kernel.mean * 1e6) : 0.0;
+    std::printf("[BENCH] kernel_us mean=%.3f p50=%.3f p90=%.3f p99=%.3f stddev=%.3f tflops=%.3f\n", kernel.mean,
+                kernel.p50, kernel.p90, kernel.p99, kernel.stddev, tflops);
+    std::printf("[BENCH] e2e_us mean=%.3f p50=%.3f p90=%.3f p99=%.3f stddev=%.3f\n", e2e.mean, e2e.p50, e2e.p90, e2e.p99,
+                e2e.stddev);
+    std::printf("[BENCH] device_mem_mib=%.2f workspace_mib=%.2f\n", LaunchMemMiB(mem.Total()),
+                LaunchMemMiB(mem.Workspace()));
+
+    std::ofstream out(config.jsonPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::printf("[ERROR] Open file failed. path = %s\n", config.jsonPath);
+        return;
+    }
+#ifdef ASCENDC_CPU_DEBUG
+    const char *mode = "cpu";
+#else
+    const char *mode = "device";
+#endif
+    out << "{\"op\":\"matmul_leakyrelu_custom\",\"soc\":\"" << SOC_VERSION << "\",\"mode\":\"" << mode << "\",\"M\":" << M
+        << ",\"N\":" << N << ",\"K\":" << K << ",\"tiling_m\":" << tiling.M << ",\"used_core_num\":" << tiling.usedCoreNum
+        << ",\"block_dim\":" << blockDim << ",\"base_m\":" << tiling.baseM << ",\"base_n\":" << tiling.baseN
+        << ",\"warmup\":" << config.warmup << ",\"iterations\":" << config.iterations << ",\"tflops\":" << tflops
+        << ",\n\"kernel_us\":";
+    WriteLatencyJson(out, kernel);
+    out << ",\n\"e2e_us\":";
+    WriteLatencyJson(out, e2e);
+    out << ",\n\"device_mem_bytes\":";
+    WriteLaunchMemJson(out, mem);
+    out << "}\n";
+    std::printf("[BENCH] json=%s\n", config.jsonPath);
 }
 
 } // namespace
@@ -75,24 +209,58 @@ int32_t main(int32_t argc, char *argv[])
     const uint32_t M = GetEnvU32("MATMUL_M", 1024U);
     const uint32_t N = GetEnvU32("MATMUL_N", 640U);
     const uint32_t K = GetEnvU32("MATMUL_K", 256U);
+    // Tiling is built for the M bucket and shared by every M in it, the kernel masks rows past M.
+    uint32_t bucketM = MatmulShapeBuckets::Global().Bucket(M);
 
     size_t aFileSize = static_cast<size_t>(M) * K * sizeof(int16_t);
     size_t bFileSize = static_cast<size_t>(K) * N * sizeof(int16_t);
     size_t cFileSize = static_cast<size_t>(M) * N * sizeof(float);
     size_t biasFileSize = static_cast<size_t>(N) * sizeof(float);
-    size_t tilingFileSize = sizeof(TCubeTiling);
-    size_t userWorkspaceSize = static_cast<size_t>(M) * N * sizeof(float);
+    size_t tilingFileSize = sizeof(MatmulLeakyLaunchTiling);
     size_t systemWorkspaceSize = static_cast<size_t>(ascendcPlatform->GetLibApiWorkSpaceSize());
-    size_t workspaceSize = userWorkspaceSize + systemWorkspaceSize;
+#ifdef KERNEL_TRACE
+    size_t traceSize = KERNEL_TRACE_BYTES; // placed after the user workspace
+#else
+    size_t traceSize = 0;
+#endif
 
-    uint8_t *tilingBuf = static_cast<uint8_t *>(malloc(tilingFileSize));
-    const uint32_t preferredCoreNum = ResolvePreferredCoreNum(ascendcPlatform, M, N);
-    if (!GenerateTiling(socVersion, tilingBuf, M, N, K, preferredCoreNum)) {
+    uint8_t *tilingBuf = static_cast<uint8_t *>(calloc(1, tilingFileSize));
+    // 0 lets the tiling cost model pick the core count.
+    const uint32_t preferredCoreNum = GetEnvU32("MATMUL_FORCE_CORE_NUM", 0U);
+    const BenchConfig bench = GetBenchConfig();
+    PreloadTilings(socVersion, preferredCoreNum);
+    const MatmulServiceConfig service = GetMatmulServiceConfig();
+    if (service.socketPath != nullptr) {
+        // Daemon mode: every request brings its own shape, MATMUL_M/N/K and the input files are not used.
+        free(tilingBuf);
+        return RunMatmulService(service, preferredCoreNum);
+    }
+    const MatmulSweepConfig sweep = GetMatmulSweepConfig();
+    if (sweep.specPath != nullptr) {
+        // Sweep mode: the shapes come from the spec and the inputs are generated in process.
+        free(tilingBuf);
+        return RunMatmulSweep(sweep, preferredCoreNum);
+    }
+    HostTimeline &timeline = HostTimeline::Instance();
+    const double tilingBegin = timeline.NowUs();
+    bool tilingOk = GenerateTiling(socVersion, tilingBuf, bucketM, N, K, preferredCoreNum);
+    if (!tilingOk && bucketM != M) {
+        std::printf("[WARN] no tiling for bucket M=%u, fall back to exact M=%u\n", bucketM, M);
+        bucketM = M;
+        tilingOk = GenerateTiling(socVersion, tilingBuf, bucketM, N, K, preferredCoreNum);
+    }
+    timeline.AddSpan("tiling", "host", tilingBegin, timeline.NowUs());
+    if (!tilingOk) {
         std::fprintf(stderr, "[ERROR] GenerateTiling failed. Abort run.\n");
         free(tilingBuf);
         return -1;
     }
-    auto *tilingMeta = reinterpret_cast<TCubeTiling *>(tilingBuf);
+    auto *launchTiling = reinterpret_cast<MatmulLeakyLaunchTiling *>(tilingBuf);
+    launchTiling->validM = M;
+    auto *tilingMeta = &launchTiling->cube;
+    // The kernel lays out its workspace and trace region by the bucket M.
+    size_t userWorkspaceSize = static_cast<size_t>(bucketM) * N * sizeof(float);
+    size_t workspaceSize = userWorkspaceSize + systemWorkspaceSize + traceSize;
     if (tilingMeta->M == 0U || tilingMeta->N == 0U || tilingMeta->Ka == 0U || tilingMeta->Kb == 0U || tilingMeta->usedCoreNum == 0U ||
         tilingMeta->baseM == 0U || tilingMeta->baseN == 0U || tilingMeta->singleCoreM == 0U || tilingMeta->singleCoreN == 0U) {
         std::fprintf(stderr, "[ERROR] Invalid tiling generated (zero field detected). Abort run.\n");
@@ -116,97 +284,344 @@ int32_t main(int32_t argc, char *argv[])
     const uint32_t blockDim = (tilingMeta->usedCoreNum + 1U) / 2U;
 #endif
 
-    std::printf("[INFO] tiling: M=%u N=%u K=%u key? usedCore=%u baseM=%u baseN=%u singleCoreM=%u singleCoreN=%u blockDim=%u\n",
-                tilingMeta->M, tilingMeta->N, tilingMeta->Ka, tilingMeta->usedCoreNum, tilingMeta->baseM, tilingMeta->baseN,
+    std::printf("[INFO] tiling: validM=%u M=%u N=%u K=%u usedCore=%u baseM=%u baseN=%u singleCoreM=%u singleCoreN=%u blockDim=%u\n",
+                M, tilingMeta->M, tilingMeta->N, tilingMeta->Ka, tilingMeta->usedCoreNum, tilingMeta->baseM, tilingMeta->baseN,
                 tilingMeta->singleCoreM, tilingMeta->singleCoreN, blockDim);
+    // Launch tiling as the kernel reads it, replayed offline by tiling_emulator matmul-blob.
+    const char *tilingDump = std::getenv("MATMUL_TILING_DUMP");
+    if (tilingDump != nullptr && tilingDump[0] != '\0') {
+        WriteFile(tilingDump, tilingBuf, tilingFileSize);
+    }
+    LaunchMemFootprint launchMem;
+    launchMem.input = aFileSize + bFileSize + biasFileSize;
+    launchMem.output = cFileSize;
+    launchMem.userWorkspace = userWorkspaceSize;
+    launchMem.systemWorkspace = systemWorkspaceSize;
+    launchMem.tiling = tilingFileSize;
+    launchMem.trace = traceSize;
+    LaunchMemAccount::Instance().Record("matmul_leakyrelu_custom", launchMem);
+    PrintLaunchMem("matmul_leakyrelu_custom", launchMem);
 
 #ifdef ASCENDC_CPU_DEBUG
-    uint8_t *a = (uint8_t *)AscendC::GmAlloc(aFileSize);
-    uint8_t *b = (uint8_t *)AscendC::GmAlloc(bFileSize);
-    uint8_t *bias = (uint8_t *)AscendC::GmAlloc(biasFileSize);
-    uint8_t *c = (uint8_t *)AscendC::GmAlloc(cFileSize);
+    const bool mmapIo = UseMmapIo();
+    size_t aMapped = 0;
+    size_t bMapped = 0;
+    size_t biasMapped = 0;
+    size_t cMapped = 0;
+    const double readBegin = timeline.NowUs();
+    uint8_t *a = LoadCpuInput("./input/x1_gm.bin", aFileSize, mmapIo, aMapped);
+    uint8_t *b = LoadCpuInput("./input/x2_gm.bin", bFileSize, mmapIo, bMapped);
+    uint8_t *bias = LoadCpuInput("./input/bias.bin", biasFileSize, mmapIo, biasMapped);
+    timeline.AddSpan("read", "io", readBegin, timeline.NowUs());
+    // A missing or short input file ends the run, as on the device path, instead of running on GmAlloc garbage.
+    if (a == nullptr || b == nullptr || bias == nullptr) {
+        if (a != nullptr) {
+            ReleaseCpuTensor(a, aMapped, false);
+        }
+        if (b != nullptr) {
+            ReleaseCpuTensor(b, bMapped, false);
+        }
+        if (bias != nullptr) {
+            ReleaseCpuTensor(bias, biasMapped, false);
+        }
+        free(tilingBuf);
+        return -1;
+    }
+    // The kernel stores straight into the page cache of output.bin; the mapping is shared, so stores made by
+    // the per-core processes of the cpu model land there as well.
+    uint8_t *c = mmapIo ? static_cast<uint8_t *>(MapFileWrite("./output/output.bin", cFileSize)) : nullptr;
+    if (c != nullptr) {
+        cMapped = cFileSize;
+    } else {
+        c = (uint8_t *)AscendC::GmAlloc(cFileSize);
+    }
     uint8_t *tiling = (uint8_t *)AscendC::GmAlloc(tilingFileSize);
     uint8_t *workspace = (uint8_t *)AscendC::GmAlloc(workspaceSize);
 
-    ReadFile("./input/x1_gm.bin", aFileSize, a, aFileSize);
-    ReadFile("./input/x2_gm.bin", bFileSize, b, bFileSize);
-    ReadFile("./input/bias.bin", biasFileSize, bias, biasFileSize);
     memcpy_s(tiling, tilingFileSize, tilingBuf, tilingFileSize);
+    if (traceSize > 0) {
+        std::memset(workspace + userWorkspaceSize, 0, traceSize);
+    }
+    const size_t kernelSpan = timeline.DeviceBegin("matmul_leakyrelu_custom", nullptr);
     ICPU_RUN_KF(matmul_leakyrelu_custom, blockDim, a, b, bias, c, workspace, tiling);
+    timeline.DeviceEnd(kernelSpan, nullptr);
+    timeline.ResolveDevice();
+    if (traceSize > 0) {
+        (void)DumpKernelTrace(workspace + userWorkspaceSize, traceSize, GetKernelTraceFile(), "matmul_leakyrelu_custom");
+    }
 
-    WriteFile("./output/output.bin", c, cFileSize);
-    AscendC::GmFree((void *)a);
-    AscendC::GmFree((void *)b);
-    AscendC::GmFree((void *)bias);
-    AscendC::GmFree((void *)c);
+    if (bench.iterations > 0U) {
+        HostTimelineSpan span("bench", "host");
+        // Host copies stand in for the device side: end-to-end restages the inputs and fetches the output.
+        std::vector<uint8_t> aHost(a, a + aFileSize);
+        std::vector<uint8_t> bHost(b, b + bFileSize);
+        std::vector<uint8_t> biasHost(bias, bias + biasFileSize);
+        std::vector<uint8_t> cHost(cFileSize);
+        std::vector<double> kernelUs;
+        std::vector<double> e2eUs;
+        for (uint32_t i = 0; i < bench.warmup + bench.iterations; ++i) {
+            const double begin = HostNowUs();
+            // Mapped inputs are read only and already in place, only GmAlloc ones are restaged.
+            if (aMapped == 0) {
+                std::memcpy(a, aHost.data(), aFileSize);
+            }
+            if (bMapped == 0) {
+                std::memcpy(b, bHost.data(), bFileSize);
+            }
+            if (biasMapped == 0) {
+                std::memcpy(bias, biasHost.data(), biasFileSize);
+            }
+            std::memcpy(tiling, tilingBuf, tilingFileSize);
+            const double kernelBegin = HostNowUs();
+            ICPU_RUN_KF(matmul_leakyrelu_custom, blockDim, a, b, bias, c, workspace, tiling);
+            const double kernelEnd = HostNowUs();
+            std::memcpy(cHost.data(), c, cFileSize);
+            const double end = HostNowUs();
+            if (i >= bench.warmup) {
+                kernelUs.push_back(kernelEnd - kernelBegin);
+                e2eUs.push_back(end - begin);
+            }
+        }
+        ReportBench(bench, *tilingMeta, M, N, K, blockDim, launchMem, kernelUs, e2eUs);
+    }
+
+    if (cMapped == 0) {
+        HostTimelineSpan span("write", "io");
+        WriteFile("./output/output.bin", c, cFileSize);
+    }
+    if (GetMatmulPipelineConfig().requests > 0U) {
+        std::printf("[WARN] pipelined mode needs device streams, ignored in cpu mode\n");
+    }
+    if (GetStreamLoadConfig().chunkBytes > 0U) {
+        std::printf("[WARN] chunked loading uploads to device memory, ignored in cpu mode\n");
+    }
+
+    ReleaseCpuTensor(a, aMapped, false);
+    ReleaseCpuTensor(b, bMapped, false);
+    ReleaseCpuTensor(bias, biasMapped, false);
+    ReleaseCpuTensor(c, cMapped, true);
     AscendC::GmFree((void *)tiling);
     AscendC::GmFree((void *)workspace);
 #else
+    const double initBegin = timeline.NowUs();
     CHECK_ACL(aclInit(nullptr));
     int32_t deviceId = 0;
     CHECK_ACL(aclrtSetDevice(deviceId));
     aclrtStream stream = nullptr;
     CHECK_ACL(aclrtCreateStream(&stream));
+    timeline.AddSpan("acl_init", "host", initBegin, timeline.NowUs());
+    auto &pool = AclMemPool::Instance();
+    const MatmulPipelineConfig pipeline = GetMatmulPipelineConfig();
+    const StreamLoadConfig streamLoad = GetStreamLoadConfig();
+    // Without bench or pipeline runs the host copies of A/B are never read again, so chunked loading skips them.
+    const bool keepHostInputs = streamLoad.chunkBytes == 0U || bench.iterations > 0U || pipeline.requests > 0U;
+    // A missing or short input file ends the run: release what is allocated so far and tear the device down.
+    auto abortLoad = [&](std::initializer_list<uint8_t *> buffers) {
+        for (uint8_t *buffer : buffers) {
+            CHECK_ACL(pool.Free(buffer));
+        }
+        CHECK_ACL(aclrtDestroyStream(stream));
+        CHECK_ACL(aclrtResetDevice(deviceId));
+        CHECK_ACL(aclFinalize());
+        free(tilingBuf);
+        return -1;
+    };
 
-    uint8_t *inputAHost;
+    uint8_t *inputAHost = nullptr;
     uint8_t *inputADevice;
-    CHECK_ACL(aclrtMallocHost((void **)(&inputAHost), aFileSize));
-    CHECK_ACL(aclrtMalloc((void **)&inputADevice, aFileSize, ACL_MEM_MALLOC_HUGE_FIRST));
-    ReadFile("./input/x1_gm.bin", aFileSize, inputAHost, aFileSize);
-    CHECK_ACL(aclrtMemcpy(inputADevice, aFileSize, inputAHost, aFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+    if (keepHostInputs) {
+        CHECK_ACL(pool.Malloc((void **)&inputAHost, aFileSize, AclMemKind::HOST));
+    }
+    CHECK_ACL(pool.Malloc((void **)&inputADevice, aFileSize, AclMemKind::DEVICE));
+    if (streamLoad.chunkBytes > 0U) {
+        HostTimelineSpan span("stream_load", "io");
+        StreamLoadStats loadStats;
+        if (!StreamFileToDevice("./input/x1_gm.bin", inputADevice, aFileSize, stream, streamLoad, inputAHost,
+                                &loadStats)) {
+            return abortLoad({inputAHost, inputADevice});
+        }
+        ReportStreamLoad("./input/x1_gm.bin", streamLoad, loadStats);
+    } else {
+        const double readBegin = timeline.NowUs();
+        if (!ReadFile("./input/x1_gm.bin", aFileSize, inputAHost, aFileSize)) {
+            return abortLoad({inputAHost, inputADevice});
+        }
+        const double h2dBegin = timeline.NowUs();
+        CHECK_ACL(aclrtMemcpy(inputADevice, aFileSize, inputAHost, aFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+        timeline.AddSpan("read", "io", readBegin, h2dBegin);
+        timeline.AddSpan("h2d", "copy", h2dBegin, timeline.NowUs());
+    }
 
-    uint8_t *inputBHost;
+    uint8_t *inputBHost = nullptr;
     uint8_t *inputBDevice;
-    CHECK_ACL(aclrtMallocHost((void **)(&inputBHost), bFileSize));
-    CHECK_ACL(aclrtMalloc((void **)&inputBDevice, bFileSize, ACL_MEM_MALLOC_HUGE_FIRST));
-    ReadFile("./input/x2_gm.bin", bFileSize, inputBHost, bFileSize);
-    CHECK_ACL(aclrtMemcpy(inputBDevice, bFileSize, inputBHost, bFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+    if (keepHostInputs) {
+        CHECK_ACL(pool.Malloc((void **)&inputBHost, bFileSize, AclMemKind::HOST));
+    }
+    CHECK_ACL(pool.Malloc((void **)&inputBDevice, bFileSize, AclMemKind::DEVICE));
+    if (streamLoad.chunkBytes > 0U) {
+        HostTimelineSpan span("stream_load", "io");
+        StreamLoadStats loadStats;
+        if (!StreamFileToDevice("./input/x2_gm.bin", inputBDevice, bFileSize, stream, streamLoad, inputBHost,
+                                &loadStats)) {
+            return abortLoad({inputAHost, inputADevice, inputBHost, inputBDevice});
+        }
+        ReportStreamLoad("./input/x2_gm.bin", streamLoad, loadStats);
+    } else {
+        const double readBegin = timeline.NowUs();
+        if (!ReadFile("./input/x2_gm.bin", bFileSize, inputBHost, bFileSize)) {
+            return abortLoad({inputAHost, inputADevice, inputBHost, inputBDevice});
+        }
+        const double h2dBegin = timeline.NowUs();
+        CHECK_ACL(aclrtMemcpy(inputBDevice, bFileSize, inputBHost, bFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+        timeline.AddSpan("read", "io", readBegin, h2dBegin);
+        timeline.AddSpan("h2d", "copy", h2dBegin, timeline.NowUs());
+    }
 
     uint8_t *outputCHost;
     uint8_t *outputCDevice;
-    CHECK_ACL(aclrtMallocHost((void **)(&outputCHost), cFileSize));
-    CHECK_ACL(aclrtMalloc((void **)&outputCDevice, cFileSize, ACL_MEM_MALLOC_HUGE_FIRST));
+    CHECK_ACL(pool.Malloc((void **)&outputCHost, cFileSize, AclMemKind::HOST));
+    CHECK_ACL(pool.Malloc((void **)&outputCDevice, cFileSize, AclMemKind::DEVICE));
 
     uint8_t *inputBiasHost;
     uint8_t *inputBiasDevice;
-    CHECK_ACL(aclrtMallocHost((void **)(&inputBiasHost), biasFileSize));
-    CHECK_ACL(aclrtMalloc((void **)&inputBiasDevice, biasFileSize, ACL_MEM_MALLOC_HUGE_FIRST));
-    ReadFile("./input/bias.bin", biasFileSize, inputBiasHost, biasFileSize);
+    CHECK_ACL(pool.Malloc((void **)&inputBiasHost, biasFileSize, AclMemKind::HOST));
+    CHECK_ACL(pool.Malloc((void **)&inputBiasDevice, biasFileSize, AclMemKind::DEVICE));
+    const double readBegin = timeline.NowUs();
+    if (!ReadFile("./input/bias.bin", biasFileSize, inputBiasHost, biasFileSize)) {
+        return abortLoad({inputAHost, inputADevice, inputBHost, inputBDevice, outputCHost, outputCDevice,
+                          inputBiasHost, inputBiasDevice});
+    }
+    const double h2dBegin = timeline.NowUs();
     CHECK_ACL(aclrtMemcpy(inputBiasDevice, biasFileSize, inputBiasHost, biasFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+    timeline.AddSpan("read", "io", readBegin, h2dBegin);
+    timeline.AddSpan("h2d", "copy", h2dBegin, timeline.NowUs());
 
     uint8_t *tilingHost;
     uint8_t *tilingDevice;
-    CHECK_ACL(aclrtMallocHost((void **)(&tilingHost), tilingFileSize));
-    CHECK_ACL(aclrtMalloc((void **)&tilingDevice, tilingFileSize, ACL_MEM_MALLOC_HUGE_FIRST));
+    CHECK_ACL(pool.Malloc((void **)&tilingHost, tilingFileSize, AclMemKind::HOST));
+    CHECK_ACL(pool.Malloc((void **)&tilingDevice, tilingFileSize, AclMemKind::DEVICE));
     CHECK_ACL(aclrtMemcpy(tilingHost, tilingFileSize, tilingBuf, tilingFileSize, ACL_MEMCPY_HOST_TO_HOST));
-    CHECK_ACL(aclrtMemcpy(tilingDevice, tilingFileSize, tilingHost, tilingFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+    {
+        HostTimelineSpan span("h2d_tiling", "copy");
+        CHECK_ACL(aclrtMemcpy(tilingDevice, tilingFileSize, tilingHost, tilingFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+    }
 
     uint8_t *workspaceDevice;
-    CHECK_ACL(aclrtMalloc((void **)&workspaceDevice, workspaceSize, ACL_MEM_MALLOC_HUGE_FIRST));
+    CHECK_ACL(pool.Malloc((void **)&workspaceDevice, workspaceSize, AclMemKind::DEVICE));
+    // The kernel sees the workspace after the system part, so the trace region starts at sys + user.
+    uint8_t *traceDevice = workspaceDevice + systemWorkspaceSize + userWorkspaceSize;
+    if (traceSize > 0) {
+        CHECK_ACL(aclrtMemset(traceDevice, traceSize, 0, traceSize));
+    }
 
+    const double launchBegin = timeline.NowUs();
+    const size_t kernelSpan = timeline.DeviceBegin("matmul_leakyrelu_custom", stream);
     ACLRT_LAUNCH_KERNEL(matmul_leakyrelu_custom)
     (blockDim, stream, inputADevice, inputBDevice, inputBiasDevice, outputCDevice, workspaceDevice, tilingDevice);
-
+    timeline.DeviceEnd(kernelSpan, stream);
+    const double syncBegin = timeline.NowUs();
     CHECK_ACL(aclrtSynchronizeStream(stream));
+    timeline.AddSpan("launch", "host", launchBegin, syncBegin);
+    timeline.AddSpan("sync", "host", syncBegin, timeline.NowUs());
+    timeline.ResolveDevice();
+    if (traceSize > 0) {
+        std::vector<uint8_t> traceHost(traceSize);
+        CHECK_ACL(aclrtMemcpy(traceHost.data(), traceSize, traceDevice, traceSize, ACL_MEMCPY_DEVICE_TO_HOST));
+        (void)DumpKernelTrace(traceHost.data(), traceSize, GetKernelTraceFile(), "matmul_leakyrelu_custom");
+    }
 
-    CHECK_ACL(aclrtFree(inputADevice));
-    CHECK_ACL(aclrtFreeHost(inputAHost));
-    CHECK_ACL(aclrtFree(inputBDevice));
-    CHECK_ACL(aclrtFreeHost(inputBHost));
+    if (bench.iterations > 0U) {
+        HostTimelineSpan span("bench", "host");
+        aclrtEvent kernelStart = nullptr;
+        aclrtEvent kernelEnd = nullptr;
+        CHECK_ACL(aclrtCreateEvent(&kernelStart));
+        CHECK_ACL(aclrtCreateEvent(&kernelEnd));
+        std::vector<double> kernelUs;
+        std::vector<double> e2eUs;
+        for (uint32_t i = 0; i < bench.warmup + bench.iterations; ++i) {
+            const double begin = HostNowUs();
+            CHECK_ACL(aclrtMemcpy(inputADevice, aFileSize, inputAHost, aFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+            CHECK_ACL(aclrtMemcpy(inputBDevice, bFileSize, inputBHost, bFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+            CHECK_ACL(aclrtMemcpy(inputBiasDevice, biasFileSize, inputBiasHost, biasFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+            CHECK_ACL(aclrtMemcpy(tilingDevice, tilingFileSize, tilingHost, tilingFileSize, ACL_MEMCPY_HOST_TO_DEVICE));
+            CHECK_ACL(aclrtRecordEvent(kernelStart, stream));
+            ACLRT_LAUNCH_KERNEL(matmul_leakyrelu_custom)
+            (blockDim, stream, inputADevice, inputBDevice, inputBiasDevice, outputCDevice, workspaceDevice, tilingDevice);
+            CHECK_ACL(aclrtRecordEvent(kernelEnd, stream));
+            CHECK_ACL(aclrtSynchronizeStream(stream));
+            CHECK_ACL(aclrtMemcpy(outputCHost, cFileSize, outputCDevice, cFileSize, ACL_MEMCPY_DEVICE_TO_HOST));
+            const double end = HostNowUs();
+            if (i >= bench.warmup) {
+                float ms = 0.0f;
+                CHECK_ACL(aclrtEventElapsedTime(&ms, kernelStart, kernelEnd));
+                kernelUs.push_back(static_cast<double>(ms) * 1000.0);
+                e2eUs.push_back(end - begin);
+            }
+        }
+        CHECK_ACL(aclrtDestroyEvent(kernelStart));
+        CHECK_ACL(aclrtDestroyEvent(kernelEnd));
+        ReportBench(bench, *tilingMeta, M, N, K, blockDim, launchMem, kernelUs, e2eUs);
+    }
+
+    const double d2hBegin = timeline.NowUs();
     CHECK_ACL(aclrtMemcpy(outputCHost, cFileSize, outputCDevice, cFileSize, ACL_MEMCPY_DEVICE_TO_HOST));
+    const double writeBegin = timeline.NowUs();
     WriteFile("./output/output.bin", outputCHost, cFileSize);
-    CHECK_ACL(aclrtFree(outputCDevice));
-    CHECK_ACL(aclrtFreeHost(outputCHost));
-    CHECK_ACL(aclrtFree(inputBiasDevice));
-    CHECK_ACL(aclrtFreeHost(inputBiasHost));
-    CHECK_ACL(aclrtFree(tilingDevice));
-    CHECK_ACL(aclrtFreeHost(tilingHost));
-    CHECK_ACL(aclrtFree(workspaceDevice));
+    timeline.AddSpan("d2h", "copy", d2hBegin, writeBegin);
+    timeline.AddSpan("write", "io", writeBegin, timeline.NowUs());
+
+    if (pipeline.requests > 0U) {
+        HostTimelineSpan span("pipeline", "host");
+        const MatmulPipelineShape shape = {M, N, K, blockDim, aFileSize, bFileSize, biasFileSize, cFileSize,
+                                           workspaceSize, tilingDevice};
+        std::vector<uint8_t> pipelineOutput(cFileSize);
+        RunMatmulPipeline(pipeline, shape, inputAHost, inputBHost, inputBiasHost, pipelineOutput.data());
+        const bool same = std::memcmp(pipelineOutput.data(), outputCHost, cFileSize) == 0;
+        std::printf("[PIPELINE] request 0 output %s the single launch\n", same ? "matches" : "DIFFERS from");
+    }
+
+    CHECK_ACL(pool.Free(inputADevice));
+    CHECK_ACL(pool.Free(inputAHost));
+    CHECK_ACL(pool.Free(inputBDevice));
+    CHECK_ACL(pool.Free(inputBHost));
+    CHECK_ACL(pool.Free(outputCDevice));
+    CHECK_ACL(pool.Free(outputCHost));
+    CHECK_ACL(pool.Free(inputBiasDevice));
+    CHECK_ACL(pool.Free(inputBiasHost));
+    CHECK_ACL(pool.Free(tilingDevice));
+    CHECK_ACL(pool.Free(tilingHost));
+    CHECK_ACL(pool.Free(workspaceDevice));
+    pool.Report();
+    pool.Trim();
 
     CHECK_ACL(aclrtDestroyStream(stream));
     CHECK_ACL(aclrtResetDevice(deviceId));
     CHECK_ACL(aclFinalize());
 #endif
+
+    // MATMUL_HOST_GOLDEN=on: gen_data.py only writes the inputs and the golden comes from the host reference.
+    const char *hostGolden = std::getenv("MATMUL_HOST_GOLDEN");
+    if (hostGolden != nullptr && std::strcmp(hostGolden, "on") == 0) {
+        const char *seedEnv = std::getenv("MATMUL_SEED"); // same default as gen_data.py, 0 is a valid seed
+        const uint32_t seed = seedEnv == nullptr ? 2026U : static_cast<uint32_t>(std::strtoul(seedEnv, nullptr, 10));
+        HostTimelineSpan span("host_golden", "host");
+        if (!WriteHostGolden(M, N, K, seed, "./output/golden.bin")) {
+            free(tilingBuf);
+            return -1;
+        }
+    }
+    const VerifyConfig verify = GetVerifyConfig();
+    if (verify.enabled) {
+        HostTimelineSpan span("verify", "host");
+        const VerifyLayout layout = {M, N, static_cast<uint32_t>(tilingMeta->M),
+                                     static_cast<uint32_t>(tilingMeta->singleCoreM),
+                                     static_cast<uint32_t>(tilingMeta->singleCoreN),
+                                     static_cast<uint32_t>(tilingMeta->baseM), static_cast<uint32_t>(tilingMeta->baseN)};
+        if (!VerifyOutputFiles("./output/output.bin", "./output/golden.bin", layout, verify)) {
+            free(tilingBuf);
+            return 1;
+        }
+    }
     free(tilingBuf);
     return 0;
 }
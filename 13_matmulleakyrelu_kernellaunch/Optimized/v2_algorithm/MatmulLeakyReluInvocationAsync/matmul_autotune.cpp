@@ -0,0 +1,340 @@
+/**
+ * @file matmul_autotune.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "data_utils.h"
+#include "env_config.h"
+#include "host_reference_gemm.h"
+#include "kernel_trace.h"
+#include "kernel_tiling/kernel_tiling.h"
+#include "matmul_cost_model.h"
+#include "matmul_shape_bucket.h"
+#include "matmul_tuning_db.h"
+#include "tiling/platform/platform_ascendc.h"
+#include "acl/acl.h"
+#include "acl_mem_pool.h"
+#include "aclrtlaunch_matmul_leakyrelu_custom.h"
+
+extern bool GenerateTilingWithConfig(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
+                                     const MatmulTuneConfig &config);
+
+namespace {
+
+double GetEnvDouble(const char *name, double defaultValue)
+{
+    const char *value = std::getenv(name);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    char *end = nullptr;
+    double parsed = std::strtod(value, &end);
+    return (end == value || *end != '\0') ? defaultValue : parsed;
+}
+
+struct TuneShape {
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+};
+
+/**
+  * @brief  Parse MATMUL_TUNE_SHAPES, e.g. "1024,640,256;2048,2048,2048".
+  */
+std::vector<TuneShape> ParseShapes(const char *spec)
+{
+    std::vector<TuneShape> shapes;
+    std::stringstream all(spec);
+    std::string item;
+    while (std::getline(all, item, ';')) {
+        TuneShape shape = {0U, 0U, 0U};
+        char sep1 = 0;
+        char sep2 = 0;
+        std::stringstream one(item);
+        if ((one >> shape.M >> sep1 >> shape.N >> sep2 >> shape.K) && sep1 == ',' && sep2 == ',' && shape.M > 0U &&
+            shape.N > 0U && shape.K > 0U) {
+            shapes.push_back(shape);
+        }
+    }
+    return shapes;
+}
+
+/**
+  * @brief  The legal tiling space in model order: top cost-model (base, core) plans first, each expanded with
+  *         step, L1 depth and traversal. The plain plan (step 1, GetTiling depth, FIRSTM) leads each group.
+  */
+std::vector<MatmulTuneConfig> EnumerateConfigs(const std::vector<MatmulPlan> &plans, uint32_t topPlans)
+{
+    static const uint32_t steps[] = {1U, 2U};
+    static const uint32_t depths[] = {0U, 1U, 2U};
+    static const uint32_t traverses[] = {0U, 1U};
+    std::vector<MatmulTuneConfig> configs;
+    for (size_t i = 0; i < plans.size() && i < topPlans; ++i) {
+        for (uint32_t traverse : traverses) {
+            for (uint32_t depth : depths) {
+                for (uint32_t stepM : steps) {
+                    for (uint32_t stepN : steps) {
+                        MatmulTuneConfig config;
+                        config.baseM = plans[i].baseM;
+                        config.baseN = plans[i].baseN;
+                        config.coreNum = plans[i].coreNum;
+                        config.stepM = stepM;
+                        config.stepN = stepN;
+                        config.depthScale = depth;
+                        config.traverse = traverse;
+                        configs.push_back(config);
+                    }
+                }
+            }
+        }
+    }
+    return configs;
+}
+
+bool SameOutput(const std::vector<float> &out, const std::vector<float> &ref)
+{
+    size_t bad = 0;
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (std::fabs(out[i] - ref[i]) > 1e-3f * std::max(1.0f, std::fabs(ref[i]))) {
+            ++bad;
+        }
+    }
+    return static_cast<double>(bad) <= 1e-4 * static_cast<double>(out.size());
+}
+
+class ShapeTuner {
+public:
+    ShapeTuner(aclrtStream stream, const platform_ascendc::PlatformAscendC *platform, const TuneShape &shape)
+        : stream_(stream), shape_(shape), bucketM_(MatmulShapeBuckets::Global().Bucket(shape.M))
+    {
+        aSize_ = static_cast<size_t>(shape.M) * shape.K * sizeof(aclFloat16);
+        bSize_ = static_cast<size_t>(shape.K) * shape.N * sizeof(aclFloat16);
+        biasSize_ = static_cast<size_t>(shape.N) * sizeof(float);
+        cSize_ = static_cast<size_t>(shape.M) * shape.N * sizeof(float);
+        // The kernel lays out its workspace by the bucket M, A and C stay at the exact M as in main.cpp.
+        workspaceSize_ = static_cast<size_t>(bucketM_) * shape.N * sizeof(float) +
+                         static_cast<size_t>(platform->GetLibApiWorkSpaceSize());
+#ifdef KERNEL_TRACE
+        workspaceSize_ += KERNEL_TRACE_BYTES;
+#endif
+        CHECK_ACL(AclMemPool::Instance().Malloc((void **)&a_, aSize_, AclMemKind::DEVICE));
+        CHECK_ACL(AclMemPool::Instance().Malloc((void **)&b_, bSize_, AclMemKind::DEVICE));
+        CHECK_ACL(AclMemPool::Instance().Malloc((void **)&bias_, biasSize_, AclMemKind::DEVICE));
+        CHECK_ACL(AclMemPool::Instance().Malloc((void **)&c_, cSize_, AclMemKind::DEVICE));
+        CHECK_ACL(AclMemPool::Instance().Malloc((void **)&workspace_, workspaceSize_, AclMemKind::DEVICE));
+        CHECK_ACL(AclMemPool::Instance().Malloc((void **)&tiling_, sizeof(MatmulLeakyLaunchTiling), AclMemKind::DEVICE));
+        CHECK_ACL(aclrtCreateEvent(&start_));
+        CHECK_ACL(aclrtCreateEvent(&end_));
+
+        // Small integers keep fp16 exact and the sums over K exact in fp32, so every config must reproduce the
+        // host golden up to accumulation order. Checking each config against the golden, not against the first
+        // config timed, keeps a wrong first config from passing every config that repeats its error.
+        const uint32_t seed = shape.M * 131U + shape.N * 31U + shape.K;
+        std::vector<uint16_t> a(aSize_ / sizeof(uint16_t));
+        std::vector<uint16_t> b(bSize_ / sizeof(uint16_t));
+        std::vector<float> bias(shape.N);
+        FillSmallIntInputs(seed, a.data(), a.size());
+        FillSmallIntInputs(seed + 1U, b.data(), b.size(), bias.data(), bias.size());
+        golden_.resize(cSize_ / sizeof(float));
+        ReferenceMatmulLeakyRelu(a.data(), b.data(), bias.data(), golden_.data(), shape.M, shape.N, shape.K, 0.001f);
+        CHECK_ACL(aclrtMemcpy(a_, aSize_, a.data(), aSize_, ACL_MEMCPY_HOST_TO_DEVICE));
+        CHECK_ACL(aclrtMemcpy(b_, bSize_, b.data(), bSize_, ACL_MEMCPY_HOST_TO_DEVICE));
+        CHECK_ACL(aclrtMemcpy(bias_, biasSize_, bias.data(), biasSize_, ACL_MEMCPY_HOST_TO_DEVICE));
+    }
+
+    ~ShapeTuner()
+    {
+        CHECK_ACL(aclrtDestroyEvent(start_));
+        CHECK_ACL(aclrtDestroyEvent(end_));
+        CHECK_ACL(AclMemPool::Instance().Free(a_));
+        CHECK_ACL(AclMemPool::Instance().Free(b_));
+        CHECK_ACL(AclMemPool::Instance().Free(bias_));
+        CHECK_ACL(AclMemPool::Instance().Free(c_));
+        CHECK_ACL(AclMemPool::Instance().Free(workspace_));
+        CHECK_ACL(AclMemPool::Instance().Free(tiling_));
+    }
+
+    /**
+      * @brief  Upload the tiling of a config.
+      * @retval usedCoreNum, 0 if GetTiling or the kernel constraints reject the config.
+      */
+    uint32_t Prepare(const char *socVersion, const MatmulTuneConfig &config)
+    {
+        MatmulLeakyLaunchTiling launch = {};
+        TCubeTiling &tiling = launch.cube;
+        if (!GenerateTilingWithConfig(socVersion, reinterpret_cast<uint8_t *>(&tiling), bucketM_, shape_.N, shape_.K,
+                                      config)) {
+            return 0U;
+        }
+        launch.validM = shape_.M;
+#ifdef CUSTOM_ASCEND310P
+        blockDim_ = tiling.usedCoreNum;
+#else
+        if (tiling.usedCoreNum < 2) {
+            return 0U;
+        }
+        blockDim_ = (tiling.usedCoreNum + 1U) / 2U;
+#endif
+        CHECK_ACL(aclrtMemcpy(tiling_, sizeof(launch), &launch, sizeof(launch), ACL_MEMCPY_HOST_TO_DEVICE));
+        return tiling.usedCoreNum;
+    }
+
+    /**
+      * @brief  Device time of one launch, measured with stream events.
+      */
+    float LaunchUs()
+    {
+        CHECK_ACL(aclrtRecordEvent(start_, stream_));
+        ACLRT_LAUNCH_KERNEL(matmul_leakyrelu_custom)(blockDim_, stream_, a_, b_, bias_, c_, workspace_, tiling_);
+        CHECK_ACL(aclrtRecordEvent(end_, stream_));
+        CHECK_ACL(aclrtSynchronizeEvent(end_));
+        float ms = 0.0f;
+        CHECK_ACL(aclrtEventElapsedTime(&ms, start_, end_));
+        return ms * 1000.0f;
+    }
+
+    /**
+      * @brief  Whether the output of the last launch matches the host golden of the shape.
+      */
+    bool MatchesGolden()
+    {
+        std::vector<float> out(cSize_ / sizeof(float));
+        CHECK_ACL(aclrtMemcpy(out.data(), cSize_, c_, cSize_, ACL_MEMCPY_DEVICE_TO_HOST));
+        return SameOutput(out, golden_);
+    }
+
+private:
+    aclrtStream stream_;
+    TuneShape shape_;
+    uint32_t bucketM_;
+    size_t aSize_ = 0;
+    size_t bSize_ = 0;
+    size_t biasSize_ = 0;
+    size_t cSize_ = 0;
+    size_t workspaceSize_ = 0;
+    uint8_t *a_ = nullptr;
+    uint8_t *b_ = nullptr;
+    uint8_t *bias_ = nullptr;
+    uint8_t *c_ = nullptr;
+    uint8_t *workspace_ = nullptr;
+    uint8_t *tiling_ = nullptr;
+    aclrtEvent start_ = nullptr;
+    aclrtEvent end_ = nullptr;
+    uint32_t blockDim_ = 1U;
+    std::vector<float> golden_;
+};
+
+} // namespace
+
+int32_t main(int32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    const char *socVersion = SOC_VERSION;
+    auto ascendcPlatform = platform_ascendc::PlatformAscendCManager::GetInstance(socVersion);
+    const char *shapeSpec = std::getenv("MATMUL_TUNE_SHAPES");
+    const std::vector<TuneShape> shapes = ParseShapes(shapeSpec == nullptr ? "1024,640,256" : shapeSpec);
+    const uint32_t warmup = GetEnvU32("MATMUL_TUNE_WARMUP", 3U, true);
+    const uint32_t repeat = std::max<uint32_t>(1U, GetEnvU32("MATMUL_TUNE_REPEAT", 10U));
+    const uint32_t topPlans = std::max<uint32_t>(1U, GetEnvU32("MATMUL_TUNE_TOP_PLANS", 8U));
+    const uint32_t patience = GetEnvU32("MATMUL_TUNE_PATIENCE", 32U, true);
+    const double pruneRatio = GetEnvDouble("MATMUL_TUNE_PRUNE_RATIO", 1.3);
+    const char *dbEnv = std::getenv("MATMUL_TUNING_DB");
+    const std::string dbPath = dbEnv == nullptr ? "./matmul_tuning.db" : dbEnv;
+
+    MatmulTuningDb db(dbPath);
+    const MatmulCostPlatform costPlatform = MakeMatmulCostPlatform(*ascendcPlatform);
+
+    CHECK_ACL(aclInit(nullptr));
+    int32_t deviceId = 0;
+    CHECK_ACL(aclrtSetDevice(deviceId));
+    aclrtStream stream = nullptr;
+    CHECK_ACL(aclrtCreateStream(&stream));
+
+    for (const auto &shape : shapes) {
+        // GenerateTiling looks the DB up with the bucket M, so tune and store that tiling, timed at the real M.
+        const uint32_t bucketM = MatmulShapeBuckets::Global().Bucket(shape.M);
+        const std::vector<MatmulPlan> plans =
+            RankMatmulPlans(costPlatform, {bucketM, shape.N, shape.K, static_cast<uint32_t>(sizeof(aclFloat16))},
+                            costPlatform.aivCoreNum);
+        const std::vector<MatmulTuneConfig> configs = EnumerateConfigs(plans, topPlans);
+        ShapeTuner tuner(stream, ascendcPlatform, shape);
+
+        MatmulTuneConfig best;
+        float bestUs = 0.0f;
+        uint32_t tried = 0U;
+        uint32_t sinceImprove = 0U;
+        for (const auto &config : configs) {
+            if (bestUs > 0.0f && patience > 0U && sinceImprove >= patience) {
+                break; // the model order puts likely winners first, stop once they stop improving.
+            }
+            if (tuner.Prepare(socVersion, config) == 0U) {
+                continue;
+            }
+            ++tried;
+            ++sinceImprove;
+            for (uint32_t i = 0; i < warmup; ++i) {
+                (void)tuner.LaunchUs();
+            }
+            float minUs = tuner.LaunchUs();
+            for (uint32_t i = 1; i < repeat; ++i) {
+                // Early stop: a config clearly slower than the best after a few runs will not catch up.
+                if (bestUs > 0.0f && i >= 3U && minUs > bestUs * pruneRatio) {
+                    break;
+                }
+                minUs = std::min(minUs, tuner.LaunchUs());
+            }
+            if (!tuner.MatchesGolden()) {
+                std::printf("[WARN] M=%u N=%u K=%u core=%u base=%dx%d step=%ux%u depth=%u traverse=%u mismatches, skipped\n",
+                            shape.M, shape.N, shape.K, config.coreNum, config.baseM, config.baseN, config.stepM,
+                            config.stepN, config.depthScale, config.traverse);
+                continue;
+            }
+            if (bestUs == 0.0f || minUs < bestUs * 0.99f) {
+                best = config;
+                bestUs = minUs;
+                sinceImprove = 0U;
+            }
+        }
+
+        if (bestUs == 0.0f) {
+            std::printf("[ERROR] M=%u N=%u K=%u: no legal config\n", shape.M, shape.N, shape.K);
+            continue;
+        }
+        std::printf("[TUNE] M=%u (bucket %u) N=%u K=%u best core=%u base=%dx%d step=%ux%u depth=%u traverse=%u "
+                    "time=%.2fus (%u/%zu configs timed)\n",
+                    shape.M, bucketM, shape.N, shape.K, best.coreNum, best.baseM, best.baseN, best.stepM, best.stepN,
+                    best.depthScale, best.traverse, bestUs, tried, configs.size());
+        const MatmulTuneKey key = {MatmulTuneSocName(costPlatform.is310p), costPlatform.aivCoreNum, bucketM, shape.N,
+                                   shape.K, static_cast<uint32_t>(sizeof(aclFloat16))};
+        db.Upsert({key, best, static_cast<double>(bestUs)});
+    }
+
+    // Buffers of each ShapeTuner went back to the pool and were reused by the next shape.
+    AclMemPool::Instance().Report();
+    AclMemPool::Instance().Trim();
+    CHECK_ACL(aclrtDestroyStream(stream));
+    CHECK_ACL(aclrtResetDevice(deviceId));
+    CHECK_ACL(aclFinalize());
+
+    if (!db.Save(dbPath)) {
+        std::fprintf(stderr, "[ERROR] write tuning db %s failed\n", dbPath.c_str());
+        return -1;
+    }
+    std::printf("[INFO] tuning db %s: %zu entries\n", dbPath.c_str(), db.Size());
+    return 0;
+}
@@ -0,0 +1,213 @@
+/**
+ * @file matmul_client.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include <sys/mman.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_stats.h"
+#include "host_reference_gemm.h"
+#include "matmul_service.h"
+#include "result_verifier.h"
+
+namespace {
+
+constexpr uint64_t CLIENT_TENSOR_ALIGN = 4096U;
+
+uint32_t ParseU32(const char *value)
+{
+    return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+}
+
+uint64_t AlignUp(uint64_t value)
+{
+    return (value + CLIENT_TENSOR_ALIGN - 1U) / CLIENT_TENSOR_ALIGN * CLIENT_TENSOR_ALIGN;
+}
+
+int32_t Connect(const char *path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    const int32_t fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+        return fd;
+    }
+    std::fprintf(stderr, "[ERROR] cannot connect to %s: %s\n", path, std::strerror(errno));
+    if (fd >= 0) {
+        (void)close(fd);
+    }
+    return -1;
+}
+
+bool Call(int32_t fd, MatmulServiceRequest request, MatmulServiceReply &reply, int32_t passFd = -1)
+{
+    request.magic = MATMUL_SERVICE_MAGIC;
+    if (!MatmulServiceSend(fd, &request, sizeof(request), passFd) ||
+        !MatmulServiceRecv(fd, &reply, sizeof(reply)) || reply.magic != MATMUL_SERVICE_MAGIC) {
+        std::fprintf(stderr, "[ERROR] service connection lost\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+  * @brief  One connection: attach a memfd holding A/B/bias/C, fill the inputs like scripts/gen_data.py (integers
+  *         1..9), send requests GEMMs and check C of the last one against the host reference with the
+  *         MATMUL_VERIFY_* tolerances. B and bias come from the same seed on every connection and are tagged with
+  *         weight id 1, so the service may batch the connections; A differs per connection.
+  */
+int32_t RunGemm(int32_t fd, uint32_t M, uint32_t N, uint32_t K, uint32_t requests, uint32_t connection)
+{
+    MatmulServiceRequest request = {};
+    request.op = static_cast<uint32_t>(MatmulServiceOp::GEMM);
+    request.M = M;
+    request.N = N;
+    request.K = K;
+    request.weightId = 1U;
+    request.aOffset = 0;
+    request.bOffset = AlignUp(request.aOffset + static_cast<uint64_t>(M) * K * sizeof(uint16_t));
+    request.biasOffset = AlignUp(request.bOffset + static_cast<uint64_t>(K) * N * sizeof(uint16_t));
+    request.cOffset = AlignUp(request.biasOffset + static_cast<uint64_t>(N) * sizeof(float));
+    const uint64_t shmSize = AlignUp(request.cOffset + static_cast<uint64_t>(M) * N * sizeof(float));
+
+    const int32_t shmFd = memfd_create("matmul_client", MFD_CLOEXEC);
+    void *mapped = MAP_FAILED;
+    if (shmFd >= 0 && ftruncate(shmFd, static_cast<off_t>(shmSize)) == 0) {
+        mapped = mmap(nullptr, shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    }
+    if (mapped == MAP_FAILED) {
+        std::fprintf(stderr, "[ERROR] cannot create %llu bytes of shared memory\n",
+                     static_cast<unsigned long long>(shmSize));
+        return 1;
+    }
+    uint8_t *shm = static_cast<uint8_t *>(mapped);
+    auto *a = reinterpret_cast<uint16_t *>(shm + request.aOffset);
+    auto *b = reinterpret_cast<uint16_t *>(shm + request.bOffset);
+    auto *bias = reinterpret_cast<float *>(shm + request.biasOffset);
+    auto *c = reinterpret_cast<float *>(shm + request.cOffset);
+    FillSmallIntInputs(2027U + connection, a, static_cast<size_t>(M) * K);
+    FillSmallIntInputs(2026U, b, static_cast<size_t>(K) * N, bias, N);
+
+    MatmulServiceRequest attach = {};
+    attach.op = static_cast<uint32_t>(MatmulServiceOp::ATTACH);
+    attach.shmSize = shmSize;
+    MatmulServiceReply reply = {};
+    int32_t status = 1;
+    if (Call(fd, attach, reply, shmFd) && reply.status == 0) {
+        std::vector<double> roundTripUs;
+        std::vector<double> kernelUs;
+        uint64_t batchSizes = 0;
+        status = 0;
+        for (uint32_t i = 0; i < requests && status == 0; ++i) {
+            const double begin = HostNowUs();
+            if (!Call(fd, request, reply)) {
+                status = 1;
+            } else if (reply.status != 0) {
+                std::fprintf(stderr, "[ERROR] request %u failed with status %d\n", i, reply.status);
+                status = 1;
+            } else {
+                roundTripUs.push_back(HostNowUs() - begin);
+                kernelUs.push_back(reply.kernelUs);
+                batchSizes += reply.batchSize;
+            }
+        }
+        const LatencyStats rtt = SummarizeLatency(roundTripUs);
+        const LatencyStats kernel = SummarizeLatency(kernelUs);
+        std::printf("[CLIENT] connection=%u M=%u N=%u K=%u requests=%zu rtt_us mean=%.3f p50=%.3f p99=%.3f "
+                    "kernel_us mean=%.3f mean_batch=%.2f blockDim=%u\n",
+                    connection, M, N, K, rtt.count, rtt.mean, rtt.p50, rtt.p99, kernel.mean,
+                    rtt.count > 0U ? static_cast<double>(batchSizes) / rtt.count : 0.0, reply.blockDim);
+        if (status == 0) {
+            std::vector<float> golden(static_cast<size_t>(M) * N);
+            ReferenceMatmulLeakyRelu(a, b, bias, golden.data(), M, N, K, 0.001f);
+            VerifyConfig config = GetVerifyConfig();
+            const std::string jsonPath = connection == 0U ? "./output/client_verify.json" :
+                "./output/client_verify_" + std::to_string(connection) + ".json";
+            if (std::getenv("MATMUL_VERIFY_JSON") == nullptr) {
+                config.jsonPath = jsonPath.c_str();
+            }
+            const VerifyLayout layout = {M, N, M, M, N, M, N};
+            const VerifyResult result = VerifyOutput(c, golden.data(), golden.size(), layout, config);
+            ReportVerify(result, config);
+            status = result.pass ? 0 : 1;
+        }
+    } else {
+        std::fprintf(stderr, "[ERROR] attach failed with status %d\n", reply.status);
+    }
+    (void)munmap(mapped, shmSize);
+    (void)close(shmFd);
+    return status;
+}
+
+} // namespace
+
+/**
+  * @brief  Local client of the MATMUL_SERVICE daemon, see matmul_service.h.
+  */
+int32_t main(int32_t argc, char *argv[])
+{
+    if (argc < 3) {
+        std::fprintf(stderr,
+                     "usage: %s <socket> gemm <M> <N> <K> [requests] [connections]\n"
+                     "       %s <socket> stats\n"
+                     "       %s <socket> shutdown\n",
+                     argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    const std::string command = argv[2];
+    if (command == "gemm" && argc >= 6) {
+        // Every connection runs on its own thread, so their requests reach the service concurrently.
+        const uint32_t connections = argc > 7 ? std::max(ParseU32(argv[7]), 1U) : 1U;
+        std::vector<int32_t> statuses(connections, 1);
+        std::vector<std::thread> threads;
+        const double begin = HostNowUs();
+        for (uint32_t i = 0; i < connections; ++i) {
+            threads.emplace_back([&, i]() {
+                const int32_t connFd = Connect(argv[1]);
+                if (connFd >= 0) {
+                    statuses[i] = RunGemm(connFd, ParseU32(argv[3]), ParseU32(argv[4]), ParseU32(argv[5]),
+                                          argc > 6 ? ParseU32(argv[6]) : 10U, i);
+                    (void)close(connFd);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        const double wallUs = HostNowUs() - begin;
+        const uint32_t requests = (argc > 6 ? ParseU32(argv[6]) : 10U) * connections;
+        std::printf("[CLIENT] connections=%u requests=%u wall_ms=%.3f requests_per_s=%.1f\n", connections, requests,
+                    wallUs / 1000.0, requests / (wallUs * 1e-6));
+        return std::count(statuses.begin(), statuses.end(), 0) == static_cast<int32_t>(connections) ? 0 : 1;
+    }
+    const int32_t fd = Connect(argv[1]);
+    if (fd < 0) {
+        return 1;
+    }
+    int32_t status = 1;
+    if (command == "stats" || command == "shutdown") {
+        MatmulServiceRequest request = {};
+        request.op = static_cast<uint32_t>(command == "stats" ? MatmulServiceOp::STATS : MatmulServiceOp::SHUTDOWN);
+        MatmulServiceReply reply = {};
+        if (Call(fd, request, reply)) {
+            std::printf("[CLIENT] service has served %llu requests\n", static_cast<unsigned long long>(reply.served));
+            status = 0;
+        }
+    } else {
+        std::fprintf(stderr, "[ERROR] unknown command or missing arguments: %s\n", command.c_str());
+    }
+    (void)close(fd);
+    return status;
+}
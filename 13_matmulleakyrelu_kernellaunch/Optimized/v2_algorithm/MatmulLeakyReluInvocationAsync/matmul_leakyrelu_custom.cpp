@@ -9,6 +9,7 @@
  */
 #include "kernel_operator.h"
 #include "lib/matmul_intf.h"
+#include "kernel_tracer.h"
 
 using namespace matmul;
 
@@ -38,12 +39,12 @@ template <typename aType, typename bType, typename cType, typename biasType> cla
 public:
     __aicore__ inline MatmulLeakyKernel(){};
     __aicore__ inline void Init(GM_ADDR a, GM_ADDR b, GM_ADDR bias, GM_ADDR c, GM_ADDR workspace,
-                                const TCubeTiling &tiling, AscendC::TPipe *pipe);
+                                const TCubeTiling &tiling, uint32_t validM, AscendC::TPipe *pipe);
     __aicore__ inline void Process();
 
     __aicore__ inline void MatmulCompute();
     __aicore__ inline void LeakyReluCompute(uint32_t count);
-    __aicore__ inline void CopyOut(uint32_t count);
+    __aicore__ inline void CopyOut(uint32_t count, uint32_t rows);
     __aicore__ inline void CalcOffset(int32_t blockIdx, const TCubeTiling &tiling, int32_t &offsetA, int32_t &offsetB,
                                       int32_t &offsetC, int32_t &offsetBias);
 
@@ -62,6 +63,10 @@ public:
     AscendC::TQue<AscendC::TPosition::VECOUT, 1> reluOutQueue;
     uint32_t splitRowNums = 0;
     uint32_t splitRowSize = 0;
+    uint32_t coreValidM = 0; // rows of this core's singleCoreM block below validM
+    uint32_t mTiles = 0;
+    uint32_t roundM = 0;
+    KernelTracer tracer;
 };
 
 /**
@@ -72,14 +77,18 @@ public:
   * @param  c: C matrix gm addr.
   * @param  workspace: Temporary gm space addr required by matmul calc.
   * @param  tiling: matmul tiling data.
+  * @param  validM: Rows of C to produce, tiling.M is the shape bucket. Rows past validM are masked.
   * @param  pipe: Global memory and sync management TPipe object.
   * @retval None
   */
 template <typename aType, typename bType, typename cType, typename biasType>
 __aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::Init(GM_ADDR a, GM_ADDR b, GM_ADDR bias,
                                                                               GM_ADDR c, GM_ADDR workspace,
-                                                                              const TCubeTiling &tiling, AscendC::TPipe *pipe)
+                                                                              const TCubeTiling &tiling, uint32_t validM,
+                                                                              AscendC::TPipe *pipe)
 {
+    // Trace region follows the M*N user workspace, see main.cpp.
+    tracer.Init(workspace + static_cast<uint64_t>(tiling.M) * tiling.N * sizeof(cType));
     this->tiling = tiling;
     splitRowNums = 4;
     splitRowSize = tiling.baseM / splitRowNums;
@@ -95,6 +104,11 @@ __aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::Init(GM
     bGlobal = bGlobal[offsetB];
     cGlobal = cGlobal[offsetC];
     biasGlobal = biasGlobal[offsetBias];
+    const uint32_t rowStart = GetBlockIdx() % Ceiling(tiling.M, tiling.singleCoreM) * tiling.singleCoreM;
+    const uint32_t rowEnd = (validM == 0 || validM > tiling.M) ? tiling.M : validM;
+    coreValidM = rowStart >= rowEnd ? 0 : (rowEnd - rowStart < tiling.singleCoreM ? rowEnd - rowStart : tiling.singleCoreM);
+    mTiles = Ceiling(coreValidM, tiling.baseM);
+    roundM = mTiles * splitRowNums;
     workspaceGlobal = workspaceGlobal[GetBlockIdx() * tiling.singleCoreM * tiling.singleCoreN];
     pipe->InitBuffer(reluInQueue, 1, tiling.baseM * tiling.baseN * sizeof(cType)); // Init relu input queue.
     pipe->InitBuffer(reluOutQueue, 1, splitRowSize * tiling.baseN * sizeof(cType)); // Init relu output queue.
@@ -111,17 +125,38 @@ __aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::Process
     matmulObj.SetTensorA(aGlobal);
     matmulObj.SetTensorB(bGlobal);
     matmulObj.SetBias(biasGlobal);
+    if (coreValidM == 0) { // whole block lies in the masked tail of the bucket
+        matmulObj.End();
+        tracer.Flush();
+        return;
+    }
+    if (coreValidM < tiling.singleCoreM) {
+        matmulObj.SetTail(coreValidM, tiling.singleCoreN, tiling.Ka);
+    }
+    const uint32_t roundN = tiling.singleCoreN / tiling.baseN;
+    int64_t start = tracer.Begin();
     matmulObj.template Iterate<false>(); // Sync is set false means async, this scene will run while(Iterate).
-    for (int i = 0; i < tiling.singleCoreM * tiling.singleCoreN / (tiling.baseM * tiling.baseN); ++i) {
+    tracer.End(TRACE_PHASE_ITERATE, 0, start);
+    for (int i = 0; i < mTiles * roundN; ++i) {
+        start = tracer.Begin();
         MatmulCompute(); // Get matmul compute result.
         reluInLocal = reluInQueue.DeQue<cType>(); // wait matmul compute result finish.
-        for (int j = 0; j < splitRowNums; ++j) {
+        tracer.End(TRACE_PHASE_GET_TENSOR_C, i, start);
+        const uint32_t mIdx = (tiling.iterateOrder == 1) ? i / roundN : i % mTiles;
+        const uint32_t tileRows = coreValidM - mIdx * tiling.baseM;
+        for (int j = 0; j < splitRowNums && j * splitRowSize < tileRows; ++j) {
+            const uint32_t rows = tileRows - j * splitRowSize;
+            start = tracer.Begin();
             LeakyReluCompute(j); // Compute leakyRelu.
-            CopyOut(i * splitRowNums + j); // Copy leakyRelu out result to GM.
+            tracer.End(TRACE_PHASE_COMPUTE, i * splitRowNums + j, start);
+            start = tracer.Begin();
+            CopyOut(i * splitRowNums + j, rows < splitRowSize ? rows : splitRowSize); // Copy leakyRelu out result to GM.
+            tracer.End(TRACE_PHASE_COPY_OUT, i * splitRowNums + j, start);
         }
         reluInQueue.FreeTensor(reluInLocal);
     }
     matmulObj.End();
+    tracer.Flush();
 }
 
 template <typename aType, typename bType, typename cType, typename biasType>
@@ -143,16 +178,21 @@ __aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::LeakyRe
 /**
   * @brief  Copy leakyRelu out result to GM.
   * @param  count: Iterate count.
+  * @param  rows: Valid rows of this split, less than splitRowSize only at the masked tail.
   * @retval None
   */
 template <typename aType, typename bType, typename cType, typename biasType>
-__aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::CopyOut(uint32_t count)
+__aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::CopyOut(uint32_t count, uint32_t rows)
 {
     auto reluOutLocal = reluOutQueue.DeQue<cType>(); // wait relu compute result finish.
-    const uint32_t roundM = tiling.singleCoreM / splitRowSize;
     const uint32_t roundN = tiling.singleCoreN / tiling.baseN;
     uint32_t startOffset = (count % roundM * splitRowSize * tiling.N + count / roundM * tiling.baseN);
-    AscendC::DataCopyParams copyParam = {(uint16_t)splitRowSize, (uint16_t)(tiling.baseN * sizeof(cType) / AscendC::DEFAULT_C0_SIZE), 0,
+    if (tiling.iterateOrder == 1) { // FIRSTN: Iterate walks the N tiles of one M row first.
+        const uint32_t tile = count / splitRowNums;
+        const uint32_t row = tile / roundN * splitRowNums + count % splitRowNums;
+        startOffset = row * splitRowSize * tiling.N + tile % roundN * tiling.baseN;
+    }
+    AscendC::DataCopyParams copyParam = {(uint16_t)rows, (uint16_t)(tiling.baseN * sizeof(cType) / AscendC::DEFAULT_C0_SIZE), 0,
                                 (uint16_t)((tiling.N - tiling.baseN) * sizeof(cType) / AscendC::DEFAULT_C0_SIZE)};
     DataCopy(cGlobal[startOffset], reluOutLocal, copyParam);
     reluOutQueue.FreeTensor(reluOutLocal);
@@ -200,9 +240,11 @@ extern "C" __global__ __aicore__ void matmul_leakyrelu_custom(GM_ADDR a, GM_ADDR
     AscendC::TPipe pipe;
     TCubeTiling tiling;
     CopyTiling(&tiling, tilingGm);
+    // validM follows TCubeTiling, see MatmulLeakyLaunchTiling in matmul_shape_bucket.h.
+    const uint32_t validM = *(reinterpret_cast<__gm__ uint32_t *>(tilingGm) + sizeof(TCubeTiling) / sizeof(uint32_t));
 
     MatmulLeakyKernel<half, half, float, float> matmulLeakyKernel;
-    matmulLeakyKernel.Init(a, b, bias, c, workspace, tiling, &pipe);
+    matmulLeakyKernel.Init(a, b, bias, c, workspace, tiling, validM, &pipe);
     REGIST_MATMUL_OBJ(&pipe, GetSysWorkSpacePtr(), matmulLeakyKernel.matmulObj, &matmulLeakyKernel.tiling);
     matmulLeakyKernel.Process();
 }
@@ -11,47 +11,36 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "env_config.h"
 #include "kernel_tiling/kernel_tiling.h"
+#include "matmul_cost_model.h"
+#include "matmul_memory_plan.h"
+#include "matmul_tuning_db.h"
 #include "tiling/tiling_api.h"
 #include "tiling/platform/platform_ascendc.h"
+#include "tiling_cache.h"
+#include "tiling_thread_pool.h"
+#ifdef MATMUL_TILING_TABLE_ENABLE
+#include "matmul_tiling_table_data.h"
+
+static_assert(MATMUL_TILING_TABLE_BYTES == sizeof(TCubeTiling), "tiling table was generated for another TCubeTiling");
+static_assert(IsMatmulTilingTableSorted(MATMUL_TILING_TABLE), "tiling table must be sorted by key");
+#endif
 
 using namespace matmul_tiling;
 using namespace std;
 
 namespace {
 
-inline uint32_t CeilDiv(uint32_t a, uint32_t b)
-{
-    return (a + b - 1U) / b;
-}
-
-struct SplitConfig {
-    int32_t baseM;
-    int32_t baseN;
-};
-
-uint32_t GetEnvU32(const char *name, uint32_t defaultValue)
-{
-    const char *value = std::getenv(name);
-    if (value == nullptr) {
-        return defaultValue;
-    }
-    char *end = nullptr;
-    unsigned long parsed = std::strtoul(value, &end, 10);
-    if (end == value || *end != '\0') {
-        return defaultValue;
-    }
-    return static_cast<uint32_t>(parsed);
-}
-
 bool TryGenerateOnce(const platform_ascendc::PlatformAscendC *platform, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
-                     uint32_t usedCoreNum, int32_t baseM, int32_t baseN)
+                     const MatmulTuneConfig &config)
 {
     TPosition leftPosition = TPosition::GM;
     CubeFormat leftFormat = CubeFormat::ND;
@@ -74,7 +63,7 @@ bool TryGenerateOnce(const platform_ascendc::PlatformAscendC *platform, uint8_t
 
     optiling::TCubeTiling tilingData;
     MultiCoreMatmulTiling tilingApi(*platform);
-    tilingApi.SetDim(usedCoreNum);
+    tilingApi.SetDim(config.coreNum);
     tilingApi.SetAType(leftPosition, leftFormat, leftDtype, isTransA);
     tilingApi.SetBType(rightPosition, rightFormat, rightDtype, isTransB);
     tilingApi.SetCType(resultPosition, resultFormat, resultDtype);
@@ -82,16 +71,33 @@ bool TryGenerateOnce(const platform_ascendc::PlatformAscendC *platform, uint8_t
     tilingApi.SetOrgShape(M, N, K);
     tilingApi.SetShape(M, N, K);
     tilingApi.SetBias(isBias);
-    tilingApi.SetTraverse(MatrixTraverse::FIRSTM);
-    tilingApi.SetFixSplit(baseM, baseN, -1);
-    tilingApi.SetBufferSpace(-1, -1, -1);
+    tilingApi.SetTraverse(config.traverse == 1U ? MatrixTraverse::FIRSTN : MatrixTraverse::FIRSTM);
+    tilingApi.SetFixSplit(config.baseM, config.baseN, -1);
+    // The kernel keeps reluInQueue/reluOutQueue (splitRowNums = 4) in UB next to the matmul API buffers.
+    const MatmulCoreMemory coreMem = MakeMatmulCoreMemory(*platform);
+    const uint64_t kernelUbBytes =
+        LeakyReluKernelUbBytes(static_cast<uint32_t>(config.baseM), static_cast<uint32_t>(config.baseN), 4U);
+    if (!SetMatmulBufferBudget(tilingApi, coreMem, kernelUbBytes)) {
+        return false;
+    }
 
     const int64_t res = tilingApi.GetTiling(tilingData);
     if (res == -1) {
         return false;
     }
-    tilingData.set_stepM(1);
-    tilingData.set_stepN(1);
+    if (!ApplyMatmulTuneConfig(tilingData, config, coreMem.l1, static_cast<uint32_t>(sizeof(uint16_t)))) {
+        return false;
+    }
+    const char *overflow = nullptr;
+    if (!MatmulMemoryFits(MatmulTilingMemoryUse(tilingData, static_cast<uint32_t>(sizeof(uint16_t)), isBias, kernelUbBytes),
+                          coreMem, &overflow)) {
+        // One write per line, candidates are evaluated on several threads.
+        std::ostringstream line;
+        line << "reject tiling baseM=" << config.baseM << " baseN=" << config.baseN << " core=" << config.coreNum << ": "
+             << overflow << " overflow\n";
+        std::cout << line.str() << std::flush;
+        return false;
+    }
     tilingData.SaveToBuffer(tilingBuf, tilingData.GetDataSize());
 
     // Kernel pipeline assumes per-core region is composed of full baseM x baseN tiles.
@@ -104,128 +110,177 @@ bool TryGenerateOnce(const platform_ascendc::PlatformAscendC *platform, uint8_t
     return true;
 }
 
+MatmulTuneKey MakeTuneKey(const platform_ascendc::PlatformAscendC *platform, uint32_t M, uint32_t N, uint32_t K)
+{
+    const bool is310p = (platform->GetSocVersion() == platform_ascendc::SocVersion::ASCEND310P);
+    return {MatmulTuneSocName(is310p), std::max<uint32_t>(1U, platform->GetCoreNumAiv()), M, N, K,
+            static_cast<uint32_t>(sizeof(uint16_t))};
+}
+
 } // namespace
 
 /**
-  * @brief  Generate matmul tiling.
+  * @brief  Build the tiling of one explicit config, used by matmul_autotune to time each candidate.
   * @param  socVersion: Platform socversion.
   * @param  tilingBuf data buffer.
   */
-bool GenerateTiling(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K, uint32_t preferredCoreNum)
+bool GenerateTilingWithConfig(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
+                              const MatmulTuneConfig &config)
 {
-    uint32_t tilingKey = 0U;
-    if (M == 512U && N == 128U && K == 512U) {
-        tilingKey = 1U;
-    } else if (M == 2048U && N == 2048U && K == 2048U) {
-        tilingKey = 2U; // S1
-    } else if (M == 4096U && N == 1024U && K == 4096U) {
-        tilingKey = 3U; // S2
-    } else if (M == 1024U && N == 512U && K == 1024U) {
-        tilingKey = 4U; // S3
-    }
-
-    const int32_t baseM = (M >= 4096U) ? 128 : 256;
-    const int32_t baseN = (N >= 2048U || (N % 256U == 0U && N >= 1024U)) ? 256 : 128;
-    const uint32_t forceBaseM = GetEnvU32("MATMUL_FORCE_BASE_M", 0U);
-    const uint32_t forceBaseN = GetEnvU32("MATMUL_FORCE_BASE_N", 0U);
+    auto ascendcPlatform = platform_ascendc::PlatformAscendCManager::GetInstance(socVersion);
+    return TryGenerateOnce(ascendcPlatform, tilingBuf, M, N, K, config);
+}
 
+/**
+  * @brief  Use the tuned config from MATMUL_TUNING_DB when there is one, otherwise try the cost-model plans
+  *         cheapest first and keep the first one GetTiling accepts. Plans are evaluated on the tiling thread
+  *         pool one window of Concurrency() plans at a time; the lowest accepted index of the first window
+  *         with a hit wins, so the result equals the sequential search.
+  * @param  socVersion: Platform socversion.
+  * @param  tilingBuf data buffer.
+  * @param  preferredCoreNum: Core count cap, 0 lets the model choose up to the platform AIV count.
+  * @param  forceBaseM, forceBaseN: When both are non-zero that split is tried first; either skips the tuning DB.
+  */
+static bool SearchTiling(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
+                         uint32_t preferredCoreNum, uint32_t forceBaseM, uint32_t forceBaseN)
+{
     auto ascendcPlatform = platform_ascendc::PlatformAscendCManager::GetInstance(socVersion);
-    const uint32_t maxCoreNum = std::max<uint32_t>(1U, ascendcPlatform->GetCoreNumAiv());
-    const uint32_t preferredCap = std::min<uint32_t>(maxCoreNum, preferredCoreNum == 0U ? maxCoreNum : preferredCoreNum);
-
-    // Keep a deterministic split search order. For small-N cases (e.g. N=128), try tighter M split first.
-    std::vector<SplitConfig> splitCandidates = {
-        {baseM, baseN},
-        {128, 128},
-        {256, 128},
-        {64, 128},
-        {128, 64},
-    };
-    if (tilingKey == 1U) {
-        splitCandidates = {
-            {128, 128},
-            {256, 128},
-            {64, 128},
-            {128, 64},
-            {baseM, baseN},
-        };
-    } else if (tilingKey == 2U) {
-        splitCandidates = {
-            {128, 256},
-            {256, 256},
-            {256, 128},
-            {128, 128},
-            {64, 128},
-        };
-    } else if (tilingKey == 3U) {
-        splitCandidates = {
-            {128, 128},
-            {256, 128},
-            {128, 256},
-            {64, 128},
-            {128, 64},
-        };
-    } else if (tilingKey == 4U) {
-        splitCandidates = {
-            {256, 128},
-            {128, 128},
-            {128, 64},
-            {64, 128},
-            {baseM, baseN},
-        };
+    const bool forcedBase = forceBaseM > 0U || forceBaseN > 0U;
+    const MatmulTuneEntry *tuned =
+        forcedBase ? nullptr : MatmulTuningDb::Global().Find(MakeTuneKey(ascendcPlatform, M, N, K));
+    if (tuned != nullptr && (preferredCoreNum == 0U || tuned->config.coreNum <= preferredCoreNum) &&
+        TryGenerateOnce(ascendcPlatform, tilingBuf, M, N, K, tuned->config)) {
+        std::ostringstream line;
+        line << "select tuned tiling core=" << tuned->config.coreNum << " baseM=" << tuned->config.baseM
+             << " baseN=" << tuned->config.baseN << " stepM=" << tuned->config.stepM << " stepN=" << tuned->config.stepN
+             << " traverse=" << tuned->config.traverse << " time_us=" << tuned->timeUs << "\n";
+        std::cout << line.str() << std::flush;
+        return true;
     }
 
-    if (forceBaseM > 0U && forceBaseN > 0U) {
-        splitCandidates.insert(splitCandidates.begin(), {static_cast<int32_t>(forceBaseM), static_cast<int32_t>(forceBaseN)});
-    }
+    const MatmulCostPlatform costPlatform = MakeMatmulCostPlatform(*ascendcPlatform);
+    const uint32_t maxCoreNum = preferredCoreNum == 0U ? costPlatform.aivCoreNum : preferredCoreNum;
+    const MatmulCostShape shape = {M, N, K, static_cast<uint32_t>(sizeof(uint16_t))};
+    const std::vector<MatmulPlan> plans = RankMatmulPlans(costPlatform, shape, maxCoreNum, forceBaseM, forceBaseN);
 
-    // Deduplicate candidate list while preserving order to keep tuning logs deterministic.
-    std::vector<SplitConfig> uniqCandidates;
-    uniqCandidates.reserve(splitCandidates.size());
-    for (const auto &c : splitCandidates) {
-        bool seen = false;
-        for (const auto &u : uniqCandidates) {
-            if (u.baseM == c.baseM && u.baseN == c.baseN) {
-                seen = true;
-                break;
-            }
-        }
-        if (!seen) {
-            uniqCandidates.push_back(c);
-        }
-    }
-    splitCandidates.swap(uniqCandidates);
-
-    // Prefer multi-core plans. Single-core is kept as a last-resort fallback.
-    for (const auto &split : splitCandidates) {
-        const uint64_t tileCount = static_cast<uint64_t>(CeilDiv(M, static_cast<uint32_t>(split.baseM))) *
-                                   static_cast<uint64_t>(CeilDiv(N, static_cast<uint32_t>(split.baseN)));
-        if (tileCount == 0U) {
-            continue;
-        }
-        uint32_t startCoreNum = std::min<uint32_t>(preferredCap, static_cast<uint32_t>(tileCount));
-        if (startCoreNum >= 2U) {
-            for (uint32_t core = startCoreNum; core >= 2U; --core) {
-                if (core > 2U && (core & 1U) != 0U) {
-                    continue; // Keep even core plan to match blockDim mapping on 910B.
-                }
-                if (TryGenerateOnce(ascendcPlatform, tilingBuf, M, N, K, core, split.baseM, split.baseN)) {
-                    std::cout << "select tiling key=" << tilingKey << " core=" << core << " baseM=" << split.baseM
-                              << " baseN=" << split.baseN << std::endl;
-                    return true;
-                }
+    auto &pool = TilingThreadPool::Instance();
+    const size_t window = pool.Concurrency();
+    std::vector<uint8_t> windowBufs(window * sizeof(TCubeTiling));
+    std::vector<char> accepted(window);
+    for (size_t first = 0; first < plans.size(); first += window) {
+        const size_t count = std::min(window, plans.size() - first);
+        pool.ParallelFor(count, [&](size_t i) {
+            const MatmulPlan &plan = plans[first + i];
+            MatmulTuneConfig config;
+            config.baseM = plan.baseM;
+            config.baseN = plan.baseN;
+            config.coreNum = plan.coreNum;
+            accepted[i] = TryGenerateOnce(ascendcPlatform, windowBufs.data() + i * sizeof(TCubeTiling), M, N, K, config) ? 1 : 0;
+        });
+        for (size_t i = 0; i < count; ++i) {
+            if (accepted[i] == 0) {
+                continue;
             }
+            const MatmulPlan &plan = plans[first + i];
+            std::memcpy(tilingBuf, windowBufs.data() + i * sizeof(TCubeTiling), sizeof(TCubeTiling));
+            std::ostringstream line;
+            line << "select tiling core=" << plan.coreNum << " baseM=" << plan.baseM << " baseN=" << plan.baseN
+                 << " est_cycles=" << static_cast<uint64_t>(plan.cycles) << " (" << plans.size() << " plans) M=" << M
+                 << " N=" << N << " K=" << K << "\n";
+            std::cout << line.str() << std::flush;
+            return true;
         }
     }
 
-    for (const auto &split : splitCandidates) {
-        if (TryGenerateOnce(ascendcPlatform, tilingBuf, M, N, K, 1U, split.baseM, split.baseN)) {
-            std::cout << "select tiling key=" << tilingKey << " core=1 baseM=" << split.baseM
-                      << " baseN=" << split.baseN << std::endl;
+    std::ostringstream line;
+    line << "gen tiling failed for shape M=" << M << ", N=" << N << ", K=" << K << "\n";
+    std::cout << line.str() << std::flush;
+    return false;
+}
+
+/**
+  * @brief  GenerateTiling with explicit base sizes instead of MATMUL_FORCE_BASE_M/N, so callers such as the sweep
+  *         can vary them per case without touching the environment the tiling threads read.
+  * @param  forceBaseM, forceBaseN: Split tried first when both are non-zero, see RankMatmulPlans.
+  */
+bool GenerateTilingWithBase(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
+                            uint32_t preferredCoreNum, uint32_t forceBaseM, uint32_t forceBaseN)
+{
+    // Forced base sizes and tuning DB entries override the search, never cache them.
+    auto ascendcPlatform = platform_ascendc::PlatformAscendCManager::GetInstance(socVersion);
+    const bool forced = forceBaseM > 0U || forceBaseN > 0U ||
+                        MatmulTuningDb::Global().Find(MakeTuneKey(ascendcPlatform, M, N, K)) != nullptr;
+#ifdef MATMUL_TILING_TABLE_ENABLE
+    // The table holds the model-chosen tiling (no core cap) of the SoC it was built for.
+    if (!forced && preferredCoreNum == 0U && std::strcmp(socVersion, MATMUL_TILING_TABLE_SOC) == 0) {
+        const int32_t index = FindMatmulTilingEntry(MATMUL_TILING_TABLE, {M, N, K, static_cast<uint32_t>(sizeof(uint16_t))});
+        if (index >= 0) {
+            std::memcpy(tilingBuf, MATMUL_TILING_TABLE[index].words, sizeof(TCubeTiling));
+            std::ostringstream line;
+            line << "tiling table hit M=" << M << " N=" << N << " K=" << K << "\n";
+            std::cout << line.str() << std::flush;
             return true;
         }
     }
+#endif
+    const TilingCacheKey key = {socVersion, M, N, K, static_cast<uint32_t>(DataType::DT_FLOAT16),
+                                static_cast<uint32_t>(DataType::DT_FLOAT16), preferredCoreNum};
+    auto &cache = TilingCache::Instance();
+    if (!forced && cache.Lookup(key, tilingBuf, sizeof(TCubeTiling))) {
+        std::ostringstream line;
+        line << "tiling cache hit M=" << M << " N=" << N << " K=" << K << " core=" << preferredCoreNum << "\n";
+        std::cout << line.str() << std::flush;
+        return true;
+    }
+    if (!SearchTiling(socVersion, tilingBuf, M, N, K, preferredCoreNum, forceBaseM, forceBaseN)) {
+        return false;
+    }
+    if (!forced) {
+        (void)cache.Store(key, tilingBuf, sizeof(TCubeTiling));
+    }
+    return true;
+}
 
-    std::cout << "gen tiling failed for shape M=" << M << ", N=" << N << ", K=" << K << std::endl;
-    return false;
+/**
+  * @brief  Generate matmul tiling, served from the build-time tiling table or the on-disk tiling cache when the
+  *         same key was searched before. MATMUL_FORCE_BASE_M/N restrict the base sizes.
+  * @param  socVersion: Platform socversion.
+  * @param  tilingBuf data buffer.
+  */
+bool GenerateTiling(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K, uint32_t preferredCoreNum)
+{
+    return GenerateTilingWithBase(socVersion, tilingBuf, M, N, K, preferredCoreNum,
+                                  GetEnvU32("MATMUL_FORCE_BASE_M", 0U), GetEnvU32("MATMUL_FORCE_BASE_N", 0U));
+}
+
+/**
+  * @brief  Tile a list of shapes at once (e.g. every layer at model load). Shapes run in parallel on the tiling
+  *         thread pool, each one goes through GenerateTiling (cache, tuning DB, parallel plan search).
+  * @param  shapes: count (M, N, K) triples.
+  * @param  tilingBufs: count buffers of tilingStride bytes, shape i writes its TCubeTiling at i * tilingStride.
+  * @param  ok: Optional, ok[i] tells whether shape i got a tiling.
+  * @retval Number of shapes that got a tiling.
+  */
+uint32_t GenerateTilingBatch(const char *socVersion, const uint32_t *shapes, uint32_t count, uint8_t *tilingBufs,
+                             size_t tilingStride, uint32_t preferredCoreNum, bool *ok)
+{
+    // Create the platform, cache and DB singletons before the workers race for them.
+    auto ascendcPlatform = platform_ascendc::PlatformAscendCManager::GetInstance(socVersion);
+    (void)ascendcPlatform;
+    (void)TilingCache::Instance();
+    (void)MatmulTuningDb::Global();
+
+    std::vector<char> done(count);
+    TilingThreadPool::Instance().ParallelFor(count, [&](size_t i) {
+        const uint32_t *shape = shapes + i * 3U;
+        done[i] = GenerateTiling(socVersion, tilingBufs + i * tilingStride, shape[0], shape[1], shape[2], preferredCoreNum) ? 1 : 0;
+    });
+    uint32_t generated = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (ok != nullptr) {
+            ok[i] = done[i] != 0;
+        }
+        generated += done[i] != 0 ? 1U : 0U;
+    }
+    return generated;
 }
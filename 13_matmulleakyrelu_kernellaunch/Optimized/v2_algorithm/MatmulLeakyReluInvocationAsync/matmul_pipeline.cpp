@@ -0,0 +1,176 @@
+/**
+ * @file matmul_pipeline.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "matmul_pipeline.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "bench_stats.h"
+#include "env_config.h"
+#ifndef ASCENDC_CPU_DEBUG
+#include "acl/acl.h"
+#include "acl_mem_pool.h"
+#include "aclrtlaunch_matmul_leakyrelu_custom.h"
+#include "data_utils.h"
+#endif
+
+MatmulPipelineConfig GetMatmulPipelineConfig()
+{
+    MatmulPipelineConfig config = {GetEnvU32("MATMUL_PIPELINE_REQUESTS", 0U), GetEnvU32("MATMUL_PIPELINE_STREAMS", 2U),
+                                   std::getenv("MATMUL_PIPELINE_JSON")};
+    if (config.jsonPath == nullptr) {
+        config.jsonPath = "./output/pipeline.json";
+    }
+    return config;
+}
+
+#ifndef ASCENDC_CPU_DEBUG
+namespace {
+
+constexpr uint32_t STAGING_SETS = 2U;
+
+struct PipelineStaging {
+    uint8_t *a = nullptr;
+    uint8_t *b = nullptr;
+    uint8_t *bias = nullptr;
+    uint8_t *c = nullptr;
+    aclrtEvent submitted = nullptr;
+    aclrtEvent done = nullptr;
+    int64_t request = -1; // in flight while >= 0
+};
+
+struct PipelineStream {
+    aclrtStream stream = nullptr;
+    uint8_t *a = nullptr;
+    uint8_t *b = nullptr;
+    uint8_t *bias = nullptr;
+    uint8_t *c = nullptr;
+    uint8_t *workspace = nullptr;
+    PipelineStaging staging[STAGING_SETS];
+};
+
+void WritePipelineJson(const MatmulPipelineConfig &config, const MatmulPipelineShape &shape, double wallUs,
+                       double tflops, double gbps, const LatencyStats &latency)
+{
+    std::ofstream out(config.jsonPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::printf("[ERROR] Open file failed. path = %s\n", config.jsonPath);
+        return;
+    }
+    out << "{\"op\":\"matmul_leakyrelu_custom\",\"soc\":\"" << SOC_VERSION << "\",\"M\":" << shape.M << ",\"N\":" << shape.N
+        << ",\"K\":" << shape.K << ",\"block_dim\":" << shape.blockDim << ",\"requests\":" << config.requests
+        << ",\"streams\":" << config.streams << ",\"wall_us\":" << wallUs
+        << ",\"requests_per_s\":" << config.requests / (wallUs * 1e-6) << ",\"tflops\":" << tflops
+        << ",\"copy_gbps\":" << gbps << ",\n\"latency_us\":";
+    WriteLatencyJson(out, latency);
+    out << "}\n";
+}
+
+} // namespace
+
+void RunMatmulPipeline(const MatmulPipelineConfig &config, const MatmulPipelineShape &shape, const uint8_t *a,
+                       const uint8_t *b, const uint8_t *bias, uint8_t *firstOutput)
+{
+    auto &pool = AclMemPool::Instance();
+    std::vector<PipelineStream> streams(config.streams);
+    for (auto &s : streams) {
+        CHECK_ACL(aclrtCreateStream(&s.stream));
+        CHECK_ACL(pool.Malloc((void **)&s.a, shape.aSize, AclMemKind::DEVICE));
+        CHECK_ACL(pool.Malloc((void **)&s.b, shape.bSize, AclMemKind::DEVICE));
+        CHECK_ACL(pool.Malloc((void **)&s.bias, shape.biasSize, AclMemKind::DEVICE));
+        CHECK_ACL(pool.Malloc((void **)&s.c, shape.cSize, AclMemKind::DEVICE));
+        CHECK_ACL(pool.Malloc((void **)&s.workspace, shape.workspaceSize, AclMemKind::DEVICE));
+        for (auto &staging : s.staging) {
+            CHECK_ACL(pool.Malloc((void **)&staging.a, shape.aSize, AclMemKind::HOST));
+            CHECK_ACL(pool.Malloc((void **)&staging.b, shape.bSize, AclMemKind::HOST));
+            CHECK_ACL(pool.Malloc((void **)&staging.bias, shape.biasSize, AclMemKind::HOST));
+            CHECK_ACL(pool.Malloc((void **)&staging.c, shape.cSize, AclMemKind::HOST));
+            CHECK_ACL(aclrtCreateEvent(&staging.submitted));
+            CHECK_ACL(aclrtCreateEvent(&staging.done));
+        }
+    }
+
+    std::vector<double> latencyUs;
+    latencyUs.reserve(config.requests);
+    // Waits for the request that last used a staging set and hands its result over.
+    auto retire = [&](PipelineStaging &staging) {
+        if (staging.request < 0) {
+            return;
+        }
+        CHECK_ACL(aclrtSynchronizeEvent(staging.done));
+        // Stream events bracket H2D..D2H on the device, the host fill and the retire order do not count.
+        float ms = 0.0f;
+        CHECK_ACL(aclrtEventElapsedTime(&ms, staging.submitted, staging.done));
+        latencyUs.push_back(static_cast<double>(ms) * 1000.0);
+        if (staging.request == 0) {
+            std::memcpy(firstOutput, staging.c, shape.cSize);
+        }
+        staging.request = -1;
+    };
+
+    const double begin = HostNowUs();
+    for (uint32_t i = 0; i < config.requests; ++i) {
+        PipelineStream &s = streams[i % config.streams];
+        PipelineStaging &staging = s.staging[(i / config.streams) % STAGING_SETS];
+        retire(staging);
+        // Producing the request: the host writes its inputs into pinned memory the DMA engine can read.
+        std::memcpy(staging.a, a, shape.aSize);
+        std::memcpy(staging.b, b, shape.bSize);
+        std::memcpy(staging.bias, bias, shape.biasSize);
+        CHECK_ACL(aclrtRecordEvent(staging.submitted, s.stream));
+        CHECK_ACL(aclrtMemcpyAsync(s.a, shape.aSize, staging.a, shape.aSize, ACL_MEMCPY_HOST_TO_DEVICE, s.stream));
+        CHECK_ACL(aclrtMemcpyAsync(s.b, shape.bSize, staging.b, shape.bSize, ACL_MEMCPY_HOST_TO_DEVICE, s.stream));
+        CHECK_ACL(aclrtMemcpyAsync(s.bias, shape.biasSize, staging.bias, shape.biasSize, ACL_MEMCPY_HOST_TO_DEVICE,
+                                   s.stream));
+        ACLRT_LAUNCH_KERNEL(matmul_leakyrelu_custom)
+        (shape.blockDim, s.stream, s.a, s.b, s.bias, s.c, s.workspace, shape.tilingDevice);
+        CHECK_ACL(aclrtMemcpyAsync(staging.c, shape.cSize, s.c, shape.cSize, ACL_MEMCPY_DEVICE_TO_HOST, s.stream));
+        CHECK_ACL(aclrtRecordEvent(staging.done, s.stream));
+        staging.request = static_cast<int64_t>(i);
+    }
+    for (auto &s : streams) {
+        for (auto &staging : s.staging) {
+            retire(staging);
+        }
+    }
+    const double wallUs = HostNowUs() - begin;
+
+    const LatencyStats latency = SummarizeLatency(latencyUs);
+    const double flops = 2.0 * shape.M * shape.N * shape.K * config.requests;
+    const double copyBytes = static_cast<double>(shape.aSize + shape.bSize + shape.biasSize + shape.cSize) * config.requests;
+    const double tflops = flops / (wallUs * 1e6);
+    const double gbps = copyBytes / (wallUs * 1e3);
+    std::printf("[PIPELINE] requests=%u streams=%u wall_ms=%.3f requests_per_s=%.1f tflops=%.3f copy_gbps=%.2f\n",
+                config.requests, config.streams, wallUs / 1000.0, config.requests / (wallUs * 1e-6), tflops, gbps);
+    std::printf("[PIPELINE] latency_us mean=%.3f p50=%.3f p90=%.3f p99=%.3f\n", latency.mean, latency.p50, latency.p90,
+                latency.p99);
+    WritePipelineJson(config, shape, wallUs, tflops, gbps, latency);
+
+    for (auto &s : streams) {
+        for (auto &staging : s.staging) {
+            CHECK_ACL(aclrtDestroyEvent(staging.submitted));
+            CHECK_ACL(aclrtDestroyEvent(staging.done));
+            CHECK_ACL(pool.Free(staging.a));
+            CHECK_ACL(pool.Free(staging.b));
+            CHECK_ACL(pool.Free(staging.bias));
+            CHECK_ACL(pool.Free(staging.c));
+        }
+        CHECK_ACL(pool.Free(s.a));
+        CHECK_ACL(pool.Free(s.b));
+        CHECK_ACL(pool.Free(s.bias));
+        CHECK_ACL(pool.Free(s.c));
+        CHECK_ACL(pool.Free(s.workspace));
+        CHECK_ACL(aclrtDestroyStream(s.stream));
+    }
+}
+#endif
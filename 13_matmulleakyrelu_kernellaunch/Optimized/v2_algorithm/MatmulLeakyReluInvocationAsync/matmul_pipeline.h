@@ -0,0 +1,57 @@
+/**
+ * @file matmul_pipeline.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_PIPELINE_H
+#define MATMUL_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+  * @brief  Pipelined mode: MATMUL_PIPELINE_REQUESTS independent requests of the current shape spread
+  *         round-robin over MATMUL_PIPELINE_STREAMS streams (default 2), 0 requests (default) disables it.
+  */
+struct MatmulPipelineConfig {
+    uint32_t requests;
+    uint32_t streams;
+    const char *jsonPath;
+};
+
+MatmulPipelineConfig GetMatmulPipelineConfig();
+
+/**
+  * @brief  Sizes and launch arguments shared by every request. The tiling buffer is read only and stays
+  *         shared, every stream gets its own A/B/bias/C and workspace.
+  */
+struct MatmulPipelineShape {
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t blockDim;
+    size_t aSize;
+    size_t bSize;
+    size_t biasSize;
+    size_t cSize;
+    size_t workspaceSize;
+    uint8_t *tilingDevice;
+};
+
+/**
+  * @brief  Run config.requests requests with async H2D / launch / D2H so the upload of request i+1 and the
+  *         download of request i-1 overlap the kernel of request i. Every stream owns two pinned staging
+  *         sets used alternately, so the host fills the inputs of a request while the previous request of
+  *         the same stream is still in flight. Throughput and per-request latency (stream events recorded
+  *         before the H2D and after the D2H) are printed and written to config.jsonPath.
+  * @param  a, b, bias: host source of every request's inputs.
+  * @param  firstOutput: receives the C of request 0, cSize bytes, for comparison with the single launch.
+  */
+void RunMatmulPipeline(const MatmulPipelineConfig &config, const MatmulPipelineShape &shape, const uint8_t *a,
+                       const uint8_t *b, const uint8_t *bias, uint8_t *firstOutput);
+
+#endif // MATMUL_PIPELINE_H
@@ -0,0 +1,840 @@
+/**
+ * @file matmul_service.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "matmul_service.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "bench_stats.h"
+#include "data_utils.h"
+#include "env_config.h"
+#include "host_reference_gemm.h"
+#include "kernel_trace.h"
+#include "kernel_tiling/kernel_tiling.h"
+#include "launch_mem_account.h"
+#include "matmul_shape_bucket.h"
+#include "tiling/platform/platform_ascendc.h"
+#ifndef ASCENDC_CPU_DEBUG
+#include "acl/acl.h"
+#include "acl_mem_pool.h"
+#include "aclrtlaunch_matmul_leakyrelu_custom.h"
+#else
+#include "tikicpulib.h"
+extern "C" void matmul_leakyrelu_custom(uint8_t *, uint8_t *, uint8_t *, uint8_t *, uint8_t *, uint8_t *);
+#endif
+
+extern bool GenerateTiling(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
+                           uint32_t preferredCoreNum);
+
+MatmulServiceConfig GetMatmulServiceConfig()
+{
+    const char *backend = std::getenv("MATMUL_SERVICE_BACKEND");
+    MatmulServiceConfig config = {std::getenv("MATMUL_SERVICE"),
+                                  backend != nullptr && std::strcmp(backend, "reference") == 0,
+                                  std::getenv("MATMUL_SERVICE_JSON"),
+                                  GetEnvU32("MATMUL_SERVICE_BATCH_US", 0U),
+                                  GetEnvU32("MATMUL_SERVICE_BATCH_MAX", 32U),
+                                  GetEnvU32("MATMUL_SERVICE_BATCH_MAX_M", 8192U),
+                                  GetEnvU32("MATMUL_SERVICE_TILING_CAP", 64U)};
+    if (config.socketPath != nullptr && config.socketPath[0] == '\0') {
+        config.socketPath = nullptr;
+    }
+    if (config.jsonPath == nullptr) {
+        config.jsonPath = "./output/service.json";
+    }
+    return config;
+}
+
+namespace {
+
+constexpr uint64_t SERVICE_TENSOR_ALIGN = 32U;
+constexpr int32_t SERVICE_LISTEN_BACKLOG = 16;
+
+volatile sig_atomic_t g_stopService = 0;
+
+void StopService(int32_t)
+{
+    g_stopService = 1;
+}
+
+/**
+  * @brief  One GEMM with its tensors resolved inside the attached memory of the client.
+  */
+struct ServiceGemm {
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    const uint8_t *a;
+    const uint8_t *b;
+    const uint8_t *bias;
+    uint8_t *c;
+};
+
+struct ServiceRun {
+    MatmulServiceStatus status = MatmulServiceStatus::OK;
+    uint32_t blockDim = 0;
+    bool tilingHit = false;
+    double kernelUs = 0.0;
+};
+
+/**
+  * @brief  A backend runs a batch of GEMMs that share N, K, B and bias as one GEMM with the A of the parts stacked
+  *         along M; part i owns the rows of A and C after those of parts 0..i-1.
+  */
+class ServiceBackend {
+public:
+    virtual ~ServiceBackend() = default;
+    virtual const char *Name() const = 0;
+    virtual ServiceRun Run(const std::vector<ServiceGemm> &parts) = 0;
+};
+
+/**
+  * @brief  Host reference GEMM, for checking clients and the protocol on machines without a device.
+  */
+class ReferenceBackend : public ServiceBackend {
+public:
+    const char *Name() const override
+    {
+        return "reference";
+    }
+
+    ServiceRun Run(const std::vector<ServiceGemm> &parts) override
+    {
+        ServiceRun run;
+        run.tilingHit = true; // nothing to warm up
+        const double begin = HostNowUs();
+        // Rows are independent, so the parts are computed in place instead of stacked.
+        for (const auto &gemm : parts) {
+            ReferenceMatmulLeakyRelu(reinterpret_cast<const uint16_t *>(gemm.a),
+                                     reinterpret_cast<const uint16_t *>(gemm.b),
+                                     reinterpret_cast<const float *>(gemm.bias), reinterpret_cast<float *>(gemm.c),
+                                     gemm.M, gemm.N, gemm.K, 0.001f);
+        }
+        run.kernelUs = HostNowUs() - begin;
+        return run;
+    }
+};
+
+/**
+  * @brief  The kernel, launched the way main.cpp launches it. Everything that does not depend on the request data
+  *         is built once: the device and stream at start-up, the tiling (host and device copy) on the first
+  *         request of an (M bucket, N, K), and the A/B/bias/C/workspace buffers, which only ever grow.
+  */
+class KernelBackend : public ServiceBackend {
+public:
+    KernelBackend(uint32_t preferredCoreNum, uint32_t tilingCap)
+        : preferredCoreNum_(preferredCoreNum), tilingCap_(tilingCap)
+    {
+        auto platform = platform_ascendc::PlatformAscendCManager::GetInstance(SOC_VERSION);
+        systemWorkspaceSize_ = static_cast<size_t>(platform->GetLibApiWorkSpaceSize());
+#ifdef KERNEL_TRACE
+        traceSize_ = KERNEL_TRACE_BYTES; // placed after the user workspace, as in main.cpp
+#endif
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(aclInit(nullptr));
+        CHECK_ACL(aclrtSetDevice(deviceId_));
+        CHECK_ACL(aclrtCreateStream(&stream_));
+        CHECK_ACL(aclrtCreateEvent(&kernelStart_));
+        CHECK_ACL(aclrtCreateEvent(&kernelEnd_));
+#endif
+    }
+
+    ~KernelBackend() override
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        auto &pool = AclMemPool::Instance();
+        for (auto &entry : tilings_) {
+            FreeTiling(entry.second);
+        }
+        for (auto *buffer : {&a_, &b_, &bias_, &c_, &workspace_}) {
+            CHECK_ACL(pool.Free(buffer->data));
+        }
+        pool.Report();
+        pool.Trim();
+        CHECK_ACL(aclrtDestroyEvent(kernelStart_));
+        CHECK_ACL(aclrtDestroyEvent(kernelEnd_));
+        CHECK_ACL(aclrtDestroyStream(stream_));
+        CHECK_ACL(aclrtResetDevice(deviceId_));
+        CHECK_ACL(aclFinalize());
+#else
+        for (auto &entry : tilings_) {
+            FreeTiling(entry.second);
+        }
+        for (auto *buffer : {&a_, &b_, &bias_, &c_, &workspace_}) {
+            if (buffer->data != nullptr) {
+                AscendC::GmFree((void *)buffer->data);
+            }
+        }
+#endif
+    }
+
+    const char *Name() const override
+    {
+        return "kernel";
+    }
+
+    ServiceRun Run(const std::vector<ServiceGemm> &parts) override
+    {
+        ServiceRun run;
+        const ServiceGemm &head = parts.front();
+        uint32_t M = 0;
+        for (const auto &gemm : parts) {
+            M += gemm.M;
+        }
+        const ServiceTiling *tiling = FindTiling(M, head.N, head.K, run.tilingHit);
+        if (tiling == nullptr) {
+            run.status = MatmulServiceStatus::NO_TILING;
+            return run;
+        }
+        run.blockDim = tiling->blockDim;
+        const size_t aRowSize = static_cast<size_t>(head.K) * sizeof(int16_t);
+        const size_t cRowSize = static_cast<size_t>(head.N) * sizeof(float);
+        const size_t bSize = static_cast<size_t>(head.K) * head.N * sizeof(int16_t);
+        const size_t biasSize = static_cast<size_t>(head.N) * sizeof(float);
+        Reserve(a_, aRowSize * M);
+        Reserve(b_, bSize);
+        Reserve(bias_, biasSize);
+        Reserve(c_, cRowSize * M);
+        LaunchMemFootprint mem;
+        mem.input = aRowSize * M + bSize + biasSize;
+        mem.output = cRowSize * M;
+        mem.userWorkspace = tiling->userWorkspaceSize;
+        mem.systemWorkspace = systemWorkspaceSize_;
+        mem.tiling = sizeof(MatmulLeakyLaunchTiling);
+        mem.trace = traceSize_;
+        Reserve(workspace_, mem.Workspace());
+        LaunchMemAccount::Instance().Record("matmul_leakyrelu_custom", mem);
+#ifndef ASCENDC_CPU_DEBUG
+        size_t row = 0;
+        for (const auto &gemm : parts) {
+            CHECK_ACL(aclrtMemcpy(a_.data + row * aRowSize, aRowSize * gemm.M, gemm.a, aRowSize * gemm.M,
+                                  ACL_MEMCPY_HOST_TO_DEVICE));
+            row += gemm.M;
+        }
+        CHECK_ACL(aclrtMemcpy(b_.data, bSize, head.b, bSize, ACL_MEMCPY_HOST_TO_DEVICE));
+        CHECK_ACL(aclrtMemcpy(bias_.data, biasSize, head.bias, biasSize, ACL_MEMCPY_HOST_TO_DEVICE));
+        CHECK_ACL(aclrtRecordEvent(kernelStart_, stream_));
+        ACLRT_LAUNCH_KERNEL(matmul_leakyrelu_custom)
+        (tiling->blockDim, stream_, a_.data, b_.data, bias_.data, c_.data, workspace_.data, tiling->device);
+        CHECK_ACL(aclrtRecordEvent(kernelEnd_, stream_));
+        CHECK_ACL(aclrtSynchronizeStream(stream_));
+        row = 0;
+        for (const auto &gemm : parts) {
+            CHECK_ACL(aclrtMemcpy(gemm.c, cRowSize * gemm.M, c_.data + row * cRowSize, cRowSize * gemm.M,
+                                  ACL_MEMCPY_DEVICE_TO_HOST));
+            row += gemm.M;
+        }
+        float ms = 0.0f;
+        CHECK_ACL(aclrtEventElapsedTime(&ms, kernelStart_, kernelEnd_));
+        run.kernelUs = static_cast<double>(ms) * 1000.0;
+#else
+        // The cpu model only accepts GmAlloc memory, so the tensors are staged through the warm buffers.
+        size_t row = 0;
+        for (const auto &gemm : parts) {
+            std::memcpy(a_.data + row * aRowSize, gemm.a, aRowSize * gemm.M);
+            row += gemm.M;
+        }
+        std::memcpy(b_.data, head.b, bSize);
+        std::memcpy(bias_.data, head.bias, biasSize);
+        const double begin = HostNowUs();
+        ICPU_RUN_KF(matmul_leakyrelu_custom, tiling->blockDim, a_.data, b_.data, bias_.data, c_.data, workspace_.data,
+                    tiling->device);
+        run.kernelUs = HostNowUs() - begin;
+        row = 0;
+        for (const auto &gemm : parts) {
+            std::memcpy(gemm.c, c_.data + row * cRowSize, cRowSize * gemm.M);
+            row += gemm.M;
+        }
+#endif
+        return run;
+    }
+
+private:
+    struct ServiceTiling {
+        uint32_t blockDim;
+        size_t userWorkspaceSize; // bucket M x N fp32, the trace region follows it
+        uint8_t *device; // MatmulLeakyLaunchTiling, GmAlloc memory in cpu mode
+        uint32_t validM; // validM currently in the device copy
+        uint64_t lastUse;
+    };
+
+    struct ServiceBuffer {
+        uint8_t *data = nullptr;
+        size_t size = 0;
+    };
+
+    /**
+      * @brief  Tiling of the M bucket as main.cpp builds it (with the same checks), shared by every M of the
+      *         bucket: validM is rewritten on the device copy when the launch M changes. A bucket whose tiling
+      *         falls back to the exact M is kept under that M only. Past tilingCap_ entries the least recently
+      *         used one is freed.
+      */
+    const ServiceTiling *FindTiling(uint32_t M, uint32_t N, uint32_t K, bool &hit)
+    {
+        const uint32_t bucketM = MatmulShapeBuckets::Global().Bucket(M);
+        auto it = tilings_.find(std::make_tuple(bucketM, N, K));
+        if (it == tilings_.end() && bucketM != M) {
+            it = tilings_.find(std::make_tuple(M, N, K));
+        }
+        hit = it != tilings_.end();
+        if (!hit) {
+            it = WarmTiling(M, bucketM, N, K);
+            if (it == tilings_.end()) {
+                return nullptr;
+            }
+        }
+        ServiceTiling &tiling = it->second;
+        tiling.lastUse = ++useClock_;
+        if (tiling.validM != M) {
+            constexpr size_t validMOffset = offsetof(MatmulLeakyLaunchTiling, validM);
+#ifndef ASCENDC_CPU_DEBUG
+            CHECK_ACL(aclrtMemcpy(tiling.device + validMOffset, sizeof(M), &M, sizeof(M), ACL_MEMCPY_HOST_TO_DEVICE));
+#else
+            std::memcpy(tiling.device + validMOffset, &M, sizeof(M));
+#endif
+            tiling.validM = M;
+        }
+        return &tiling;
+    }
+
+    using TilingMap = std::map<std::tuple<uint32_t, uint32_t, uint32_t>, ServiceTiling>;
+
+    TilingMap::iterator WarmTiling(uint32_t M, uint32_t bucketM, uint32_t N, uint32_t K)
+    {
+        MatmulLeakyLaunchTiling launch = {};
+        bool ok = GenerateTiling(SOC_VERSION, reinterpret_cast<uint8_t *>(&launch), bucketM, N, K, preferredCoreNum_);
+        if (!ok && bucketM != M) {
+            bucketM = M;
+            ok = GenerateTiling(SOC_VERSION, reinterpret_cast<uint8_t *>(&launch), bucketM, N, K, preferredCoreNum_);
+        }
+        const TCubeTiling &cube = launch.cube;
+        if (!ok || cube.M == 0 || cube.N == 0 || cube.Ka == 0 || cube.Kb == 0 || cube.usedCoreNum == 0 ||
+            cube.baseM == 0 || cube.baseN == 0 || cube.singleCoreM == 0 || cube.singleCoreN == 0) {
+            std::printf("[SERVICE] no valid tiling for M=%u N=%u K=%u\n", M, N, K);
+            return tilings_.end();
+        }
+#ifdef CUSTOM_ASCEND310P
+        const uint32_t blockDim = cube.usedCoreNum;
+#else
+        if (cube.usedCoreNum < 2) {
+            std::printf("[SERVICE] single-core tiling for M=%u N=%u K=%u is unsupported on 910B\n", M, N, K);
+            return tilings_.end();
+        }
+        const uint32_t blockDim = (cube.usedCoreNum + 1U) / 2U;
+#endif
+        launch.validM = M;
+        ServiceTiling tiling = {blockDim, static_cast<size_t>(bucketM) * N * sizeof(float), nullptr, M, 0U};
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(AclMemPool::Instance().Malloc((void **)&tiling.device, sizeof(launch), AclMemKind::DEVICE));
+        CHECK_ACL(aclrtMemcpy(tiling.device, sizeof(launch), &launch, sizeof(launch), ACL_MEMCPY_HOST_TO_DEVICE));
+#else
+        tiling.device = (uint8_t *)AscendC::GmAlloc(sizeof(launch));
+        std::memcpy(tiling.device, &launch, sizeof(launch));
+#endif
+        std::printf("[SERVICE] warm M=%u N=%u K=%u bucketM=%u usedCore=%d baseM=%d baseN=%d blockDim=%u\n", M, N, K,
+                    bucketM, cube.usedCoreNum, cube.baseM, cube.baseN, blockDim);
+        if (tilings_.size() >= tilingCap_) {
+            EvictTiling();
+        }
+        return tilings_.emplace(std::make_tuple(bucketM, N, K), tiling).first;
+    }
+
+    void EvictTiling()
+    {
+        auto victim = std::min_element(tilings_.begin(), tilings_.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.second.lastUse < rhs.second.lastUse;
+        });
+        FreeTiling(victim->second);
+        tilings_.erase(victim);
+    }
+
+    static void FreeTiling(const ServiceTiling &tiling)
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(AclMemPool::Instance().Free(tiling.device));
+#else
+        AscendC::GmFree((void *)tiling.device);
+#endif
+    }
+
+    void Reserve(ServiceBuffer &buffer, size_t size)
+    {
+        if (buffer.size >= size) {
+            return;
+        }
+#ifndef ASCENDC_CPU_DEBUG
+        auto &pool = AclMemPool::Instance();
+        CHECK_ACL(pool.Free(buffer.data));
+        CHECK_ACL(pool.Malloc((void **)&buffer.data, size, AclMemKind::DEVICE));
+#else
+        if (buffer.data != nullptr) {
+            AscendC::GmFree((void *)buffer.data);
+        }
+        buffer.data = (uint8_t *)AscendC::GmAlloc(size);
+#endif
+        buffer.size = size;
+    }
+
+    uint32_t preferredCoreNum_;
+    size_t systemWorkspaceSize_ = 0;
+    size_t traceSize_ = 0;
+    uint32_t tilingCap_;
+    uint64_t useClock_ = 0;
+    TilingMap tilings_;
+    ServiceBuffer a_;
+    ServiceBuffer b_;
+    ServiceBuffer bias_;
+    ServiceBuffer c_;
+    ServiceBuffer workspace_;
+#ifndef ASCENDC_CPU_DEBUG
+    int32_t deviceId_ = 0;
+    aclrtStream stream_ = nullptr;
+    aclrtEvent kernelStart_ = nullptr;
+    aclrtEvent kernelEnd_ = nullptr;
+#endif
+};
+
+/**
+  * @brief  A connected client and the memory it attached. A client whose GEMM waits for its batch is not polled
+  *         until the reply is sent, so its memory stays mapped and its replies stay in order.
+  */
+struct ServiceClient {
+    int32_t fd = -1;
+    uint8_t *shm = nullptr;
+    size_t shmSize = 0;
+    bool waiting = false;
+};
+
+void DetachClient(ServiceClient &client)
+{
+    if (client.shm != nullptr) {
+        (void)munmap(client.shm, client.shmSize);
+    }
+    client.shm = nullptr;
+    client.shmSize = 0;
+}
+
+/**
+  * @brief  True when [offset, offset + size) lies inside the attached memory and offset is aligned.
+  */
+bool TensorInRange(const ServiceClient &client, uint64_t offset, uint64_t size)
+{
+    return offset % SERVICE_TENSOR_ALIGN == 0U && offset <= client.shmSize && size <= client.shmSize - offset;
+}
+
+MatmulServiceStatus ResolveGemm(const ServiceClient &client, const MatmulServiceRequest &request, ServiceGemm &gemm)
+{
+    if (client.shm == nullptr) {
+        return MatmulServiceStatus::NO_SHM;
+    }
+    if (request.M == 0U || request.N == 0U || request.K == 0U) {
+        return MatmulServiceStatus::BAD_REQUEST;
+    }
+    const uint64_t aSize = static_cast<uint64_t>(request.M) * request.K * sizeof(int16_t);
+    const uint64_t bSize = static_cast<uint64_t>(request.K) * request.N * sizeof(int16_t);
+    const uint64_t biasSize = static_cast<uint64_t>(request.N) * sizeof(float);
+    const uint64_t cSize = static_cast<uint64_t>(request.M) * request.N * sizeof(float);
+    if (!TensorInRange(client, request.aOffset, aSize) || !TensorInRange(client, request.bOffset, bSize) ||
+        !TensorInRange(client, request.biasOffset, biasSize) || !TensorInRange(client, request.cOffset, cSize)) {
+        return MatmulServiceStatus::OUT_OF_RANGE;
+    }
+    gemm = {request.M, request.N, request.K, client.shm + request.aOffset, client.shm + request.bOffset,
+            client.shm + request.biasOffset, client.shm + request.cOffset};
+    return MatmulServiceStatus::OK;
+}
+
+/**
+  * @brief  A resolved GEMM on its way to a launch.
+  */
+struct PendingGemm {
+    int32_t fd;
+    uint32_t weightId;
+    ServiceGemm gemm;
+    double receivedUs;
+};
+
+/**
+  * @brief  GEMMs can share a launch when N and K match and B and bias are the same memory, or both requests carry
+  *         the same nonzero weight id.
+  */
+bool CanBatch(const PendingGemm &lhs, const PendingGemm &rhs)
+{
+    if (lhs.gemm.N != rhs.gemm.N || lhs.gemm.K != rhs.gemm.K) {
+        return false;
+    }
+    if (lhs.weightId != 0U && lhs.weightId == rhs.weightId) {
+        return true;
+    }
+    return lhs.gemm.b == rhs.gemm.b && lhs.gemm.bias == rhs.gemm.bias;
+}
+
+struct ServiceStats {
+    uint64_t served = 0;
+    uint64_t errors = 0;
+    uint64_t tilingMisses = 0;
+    uint64_t launches = 0;
+    uint64_t launchedRequests = 0;
+    uint64_t batchedRequests = 0; // requests that shared their launch with others
+    size_t maxBatch = 0;
+    double firstUs = 0.0; // first GEMM received
+    double lastUs = 0.0;  // last GEMM answered
+    std::vector<double> serviceUs;
+    std::vector<double> queueUs;
+    std::vector<double> kernelUs;
+};
+
+/**
+  * @brief  Launch batch as one stacked GEMM and answer every request in it.
+  */
+void LaunchBatch(ServiceBackend &backend, const std::vector<PendingGemm> &batch, ServiceStats &stats)
+{
+    std::vector<ServiceGemm> parts;
+    uint32_t M = 0;
+    for (const auto &item : batch) {
+        parts.push_back(item.gemm);
+        M += item.gemm.M;
+    }
+    const double launchUs = HostNowUs();
+    const ServiceRun run = backend.Run(parts);
+    const bool ok = run.status == MatmulServiceStatus::OK;
+    stats.launches += 1U;
+    stats.launchedRequests += batch.size();
+    stats.batchedRequests += batch.size() > 1U ? batch.size() : 0U;
+    stats.maxBatch = std::max(stats.maxBatch, batch.size());
+    if (ok) {
+        stats.kernelUs.push_back(run.kernelUs);
+        stats.tilingMisses += run.tilingHit ? 0U : 1U;
+    }
+    for (const auto &item : batch) {
+        MatmulServiceReply reply = {};
+        reply.magic = MATMUL_SERVICE_MAGIC;
+        reply.status = static_cast<int32_t>(run.status);
+        reply.blockDim = run.blockDim;
+        reply.tilingHit = run.tilingHit ? 1U : 0U;
+        reply.batchSize = static_cast<uint32_t>(batch.size());
+        reply.batchM = M;
+        reply.kernelUs = run.kernelUs;
+        stats.served += ok ? 1U : 0U;
+        stats.errors += ok ? 0U : 1U;
+        reply.served = stats.served;
+        reply.serviceUs = HostNowUs() - item.receivedUs;
+        if (ok) {
+            stats.serviceUs.push_back(reply.serviceUs);
+            stats.queueUs.push_back(launchUs - item.receivedUs);
+        }
+        if (!MatmulServiceSend(item.fd, &reply, sizeof(reply))) {
+            (void)shutdown(item.fd, SHUT_RDWR); // seen as a hang-up by the next poll
+        }
+    }
+    stats.lastUs = HostNowUs();
+}
+
+/**
+  * @brief  GEMMs held back for batching. Everything pending is launched once the oldest request has waited
+  *         batchUs, or earlier when batchMaxRequests requests or batchMaxM rows are pending or every connected client
+  *         is waiting. Each launch takes the oldest pending request and every later one it can batch with, up to
+  *         batchMaxM rows.
+  */
+class ServiceBatcher {
+public:
+    explicit ServiceBatcher(const MatmulServiceConfig &config)
+        : windowUs_(config.batchUs), maxRequests_(config.batchMaxRequests), maxM_(config.batchMaxM)
+    {
+    }
+
+    bool Empty() const
+    {
+        return pending_.empty();
+    }
+
+    void Add(const PendingGemm &item)
+    {
+        pending_.push_back(item);
+        rows_ += item.gemm.M;
+    }
+
+    /**
+      * @brief  Microseconds until the window of the oldest request closes, 0 when it has.
+      */
+    double WaitUs(double nowUs) const
+    {
+        return pending_.empty() ? 0.0 : std::max(0.0, pending_.front().receivedUs + windowUs_ - nowUs);
+    }
+
+    bool Due(double nowUs) const
+    {
+        return !pending_.empty() && (WaitUs(nowUs) <= 0.0 || pending_.size() >= maxRequests_ || rows_ >= maxM_);
+    }
+
+    void Flush(ServiceBackend &backend, ServiceStats &stats, std::map<int32_t, ServiceClient> &clients)
+    {
+        while (!pending_.empty()) {
+            std::vector<PendingGemm> batch(1, pending_.front());
+            std::vector<PendingGemm> rest;
+            uint64_t rows = batch.front().gemm.M;
+            for (size_t i = 1; i < pending_.size(); ++i) {
+                const PendingGemm &item = pending_[i];
+                if (CanBatch(batch.front(), item) && rows + item.gemm.M <= maxM_) {
+                    batch.push_back(item);
+                    rows += item.gemm.M;
+                } else {
+                    rest.push_back(item);
+                }
+            }
+            LaunchBatch(backend, batch, stats);
+            for (const auto &item : batch) {
+                auto it = clients.find(item.fd);
+                if (it != clients.end()) {
+                    it->second.waiting = false;
+                }
+            }
+            pending_.swap(rest);
+        }
+        rows_ = 0;
+    }
+
+private:
+    double windowUs_;
+    size_t maxRequests_;
+    uint64_t maxM_;
+    uint64_t rows_ = 0;
+    std::vector<PendingGemm> pending_;
+};
+
+/**
+  * @brief  Handle one request of client. A GEMM is launched at once, or handed to batcher when batching is on.
+  *         Returns false when the connection is to be closed.
+  */
+bool ServeClient(ServiceBackend &backend, ServiceBatcher *batcher, ServiceClient &client, ServiceStats &stats,
+                 bool &shutdown)
+{
+    MatmulServiceRequest request = {};
+    int32_t passedFd = -1;
+    if (!MatmulServiceRecv(client.fd, &request, sizeof(request), &passedFd)) {
+        return false;
+    }
+    const double begin = HostNowUs();
+    MatmulServiceStatus status = MatmulServiceStatus::OK;
+    PendingGemm item = {client.fd, request.weightId, {}, begin};
+    if (request.magic != MATMUL_SERVICE_MAGIC) {
+        status = MatmulServiceStatus::BAD_REQUEST;
+    } else if (request.op == static_cast<uint32_t>(MatmulServiceOp::ATTACH)) {
+        DetachClient(client);
+        // A mapping past the end of the file still succeeds, but touching it raises SIGBUS in the daemon, so the
+        // claimed size must be backed by the fd.
+        struct stat st = {};
+        const bool backed = passedFd >= 0 && request.shmSize > 0U && fstat(passedFd, &st) == 0 &&
+                            st.st_size >= 0 && static_cast<uint64_t>(st.st_size) >= request.shmSize;
+        void *mapped = !backed ? MAP_FAILED :
+            mmap(nullptr, request.shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, passedFd, 0);
+        if (mapped == MAP_FAILED) {
+            status = MatmulServiceStatus::ATTACH_FAILED;
+        } else {
+            client.shm = static_cast<uint8_t *>(mapped);
+            client.shmSize = request.shmSize;
+        }
+    } else if (request.op == static_cast<uint32_t>(MatmulServiceOp::GEMM)) {
+        status = ResolveGemm(client, request, item.gemm);
+    } else if (request.op == static_cast<uint32_t>(MatmulServiceOp::SHUTDOWN)) {
+        shutdown = true;
+    } else if (request.op != static_cast<uint32_t>(MatmulServiceOp::STATS)) {
+        status = MatmulServiceStatus::BAD_REQUEST;
+    }
+    if (passedFd >= 0) {
+        (void)close(passedFd); // the mapping keeps the memory alive
+    }
+    const bool gemm = request.op == static_cast<uint32_t>(MatmulServiceOp::GEMM);
+    if (gemm && status == MatmulServiceStatus::OK) {
+        stats.firstUs = stats.firstUs > 0.0 ? stats.firstUs : begin;
+        if (batcher != nullptr) {
+            batcher->Add(item);
+            client.waiting = true;
+        } else {
+            LaunchBatch(backend, {item}, stats);
+        }
+        return true;
+    }
+    stats.errors += gemm ? 1U : 0U;
+    MatmulServiceReply reply = {};
+    reply.magic = MATMUL_SERVICE_MAGIC;
+    reply.status = static_cast<int32_t>(status);
+    reply.served = stats.served;
+    reply.serviceUs = HostNowUs() - begin;
+    return MatmulServiceSend(client.fd, &reply, sizeof(reply));
+}
+
+int32_t ListenService(const char *path)
+{
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(addr.sun_path)) {
+        std::fprintf(stderr, "[ERROR] service socket path too long: %s\n", path);
+        return -1;
+    }
+    std::strcpy(addr.sun_path, path);
+    const int32_t fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    (void)unlink(path); // a stale socket of a killed service
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(fd, SERVICE_LISTEN_BACKLOG) != 0) {
+        std::fprintf(stderr, "[ERROR] cannot listen on %s: %s\n", path, std::strerror(errno));
+        (void)close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void ReportService(const MatmulServiceConfig &config, const ServiceBackend &backend, const ServiceStats &stats)
+{
+    const LatencyStats service = SummarizeLatency(stats.serviceUs);
+    const LatencyStats queue = SummarizeLatency(stats.queueUs);
+    const LatencyStats kernel = SummarizeLatency(stats.kernelUs);
+    const double wallUs = stats.lastUs - stats.firstUs;
+    const double requestsPerS = wallUs > 0.0 ? stats.served / (wallUs * 1e-6) : 0.0;
+    const double meanBatch = stats.launches > 0U ? static_cast<double>(stats.launchedRequests) / stats.launches : 0.0;
+    std::printf("[SERVICE] backend=%s requests=%llu errors=%llu warm_shapes_built=%llu\n", backend.Name(),
+                static_cast<unsigned long long>(stats.served), static_cast<unsigned long long>(stats.errors),
+                static_cast<unsigned long long>(stats.tilingMisses));
+    std::printf("[SERVICE] batch_us=%u launches=%llu mean_batch=%.2f max_batch=%zu batched_requests=%llu "
+                "requests_per_s=%.1f\n",
+                config.batchUs, static_cast<unsigned long long>(stats.launches), meanBatch, stats.maxBatch,
+                static_cast<unsigned long long>(stats.batchedRequests), requestsPerS);
+    std::printf("[SERVICE] service_us mean=%.3f p50=%.3f p90=%.3f p99=%.3f\n", service.mean, service.p50, service.p90,
+                service.p99);
+    std::printf("[SERVICE] queue_us mean=%.3f p50=%.3f p90=%.3f p99=%.3f\n", queue.mean, queue.p50, queue.p90,
+                queue.p99);
+    std::printf("[SERVICE] kernel_us mean=%.3f p50=%.3f p90=%.3f p99=%.3f\n", kernel.mean, kernel.p50, kernel.p90,
+                kernel.p99);
+    LaunchMemAccount::Instance().Report();
+    std::ofstream out(config.jsonPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::printf("[ERROR] Open file failed. path = %s\n", config.jsonPath);
+        return;
+    }
+    out << "{\"op\":\"matmul_leakyrelu_custom\",\"soc\":\"" << SOC_VERSION << "\",\"backend\":\"" << backend.Name()
+        << "\",\"requests\":" << stats.served << ",\"errors\":" << stats.errors
+        << ",\"warm_shapes_built\":" << stats.tilingMisses << ",\"batch_us\":" << config.batchUs
+        << ",\"launches\":" << stats.launches << ",\"mean_batch\":" << meanBatch << ",\"max_batch\":" << stats.maxBatch
+        << ",\"batched_requests\":" << stats.batchedRequests << ",\"requests_per_s\":" << requestsPerS
+        << ",\n\"service_us\":";
+    WriteLatencyJson(out, service);
+    out << ",\n\"queue_us\":";
+    WriteLatencyJson(out, queue);
+    out << ",\n\"kernel_us\":";
+    WriteLatencyJson(out, kernel);
+    out << ",\n\"device_mem_bytes\":";
+    LaunchMemAccount::Instance().WriteJson(out);
+    out << "}\n";
+}
+
+} // namespace
+
+int32_t RunMatmulService(const MatmulServiceConfig &config, uint32_t preferredCoreNum)
+{
+    const int32_t listenFd = ListenService(config.socketPath);
+    if (listenFd < 0) {
+        return 1;
+    }
+    struct sigaction action = {};
+    action.sa_handler = StopService; // no SA_RESTART, so poll returns on the signal
+    (void)sigaction(SIGINT, &action, nullptr);
+    (void)sigaction(SIGTERM, &action, nullptr);
+
+    std::unique_ptr<ServiceBackend> backend;
+    if (config.reference) {
+        backend.reset(new ReferenceBackend());
+    } else {
+        backend.reset(new KernelBackend(preferredCoreNum, config.tilingCap));
+    }
+    std::unique_ptr<ServiceBatcher> batcher;
+    if (config.batchUs > 0U) {
+        batcher.reset(new ServiceBatcher(config));
+    }
+    std::printf("[SERVICE] listening on %s, backend=%s, batch_us=%u batch_max=%u batch_max_m=%u\n", config.socketPath,
+                backend->Name(), config.batchUs, config.batchMaxRequests, config.batchMaxM);
+    std::fflush(stdout);
+
+    ServiceStats stats;
+    std::map<int32_t, ServiceClient> clients;
+    bool shutdown = false;
+    while (!shutdown && g_stopService == 0) {
+        std::vector<pollfd> fds(1, pollfd{listenFd, POLLIN, 0});
+        for (const auto &entry : clients) {
+            if (!entry.second.waiting) {
+                fds.push_back(pollfd{entry.first, POLLIN, 0});
+            }
+        }
+        // Sleep no longer than the batch window that is open.
+        timespec wait = {};
+        timespec *timeout = nullptr;
+        if (batcher != nullptr && !batcher->Empty()) {
+            const double waitUs = batcher->WaitUs(HostNowUs());
+            wait.tv_sec = static_cast<time_t>(waitUs / 1e6);
+            wait.tv_nsec = static_cast<long>((waitUs - static_cast<double>(wait.tv_sec) * 1e6) * 1e3);
+            timeout = &wait;
+        }
+        if (ppoll(fds.data(), fds.size(), timeout, nullptr) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::fprintf(stderr, "[ERROR] service poll failed: %s\n", std::strerror(errno));
+            break;
+        }
+        for (size_t i = 1; i < fds.size() && !shutdown; ++i) {
+            auto it = clients.find(fds[i].fd);
+            const bool ready = (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+            if (ready && !ServeClient(*backend, batcher.get(), it->second, stats, shutdown)) {
+                DetachClient(it->second);
+                (void)close(it->first);
+                clients.erase(it);
+            }
+        }
+        // Once every client waits for its batch no request can join it any more, so it need not wait out the window.
+        const bool allWaiting = std::all_of(clients.begin(), clients.end(),
+                                            [](const std::pair<const int32_t, ServiceClient> &entry) {
+                                                return entry.second.waiting;
+                                            });
+        if (batcher != nullptr && !batcher->Empty() && (allWaiting || batcher->Due(HostNowUs()))) {
+            batcher->Flush(*backend, stats, clients);
+        }
+        if ((fds[0].revents & POLLIN) != 0) {
+            const int32_t fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                clients[fd] = ServiceClient{fd, nullptr, 0, false};
+            }
+        }
+    }
+    if (batcher != nullptr) {
+        batcher->Flush(*backend, stats, clients);
+    }
+
+    for (auto &entry : clients) {
+        DetachClient(entry.second);
+        (void)close(entry.first);
+    }
+    (void)close(listenFd);
+    (void)unlink(config.socketPath);
+    ReportService(config, *backend, stats);
+    return 0;
+}
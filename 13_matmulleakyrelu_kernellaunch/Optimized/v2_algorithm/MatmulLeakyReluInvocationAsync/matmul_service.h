@@ -0,0 +1,174 @@
+/**
+ * @file matmul_service.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_SERVICE_H
+#define MATMUL_SERVICE_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+  * @brief  Service mode: MATMUL_SERVICE=<socket path> turns the executable into a daemon that keeps the device,
+  *         the stream, the tilings and the buffers of every shape it has seen, and serves GEMM requests from local
+  *         clients until MatmulServiceOp::SHUTDOWN, SIGINT or SIGTERM. MATMUL_SERVICE_BACKEND=reference computes
+  *         the requests with the host reference GEMM instead of the kernel.
+  *
+  *         Batching: with MATMUL_SERVICE_BATCH_US > 0 a GEMM waits up to that long for others with the same N, K,
+  *         B and bias, and they are launched as one GEMM with their A stacked along M, so small concurrent
+  *         requests share one full-chip tiling instead of each getting a launch with a few cores.
+  */
+struct MatmulServiceConfig {
+    const char *socketPath;
+    bool reference;
+    const char *jsonPath;      // MATMUL_SERVICE_JSON, default ./output/service.json, written at shutdown
+    uint32_t batchUs;          // MATMUL_SERVICE_BATCH_US, default 0: every GEMM is launched on its own
+    uint32_t batchMaxRequests; // MATMUL_SERVICE_BATCH_MAX, launch early once this many are pending, default 32
+    uint32_t batchMaxM;        // MATMUL_SERVICE_BATCH_MAX_M, rows of one stacked launch, default 8192
+    uint32_t tilingCap;        // MATMUL_SERVICE_TILING_CAP, device tilings kept (LRU), default 64
+};
+
+MatmulServiceConfig GetMatmulServiceConfig();
+
+/**
+  * @brief  Serve until shutdown. Returns the exit status of the process.
+  */
+int32_t RunMatmulService(const MatmulServiceConfig &config, uint32_t preferredCoreNum);
+
+/**
+  * @brief  Wire protocol. Tensors never cross the socket: a client passes a memfd once with ATTACH (SCM_RIGHTS),
+  *         the service maps it shared, and every GEMM names A [M, K] fp16, B [K, N] fp16, bias [N] fp32 and
+  *         C [M, N] fp32 by their byte offsets in it (32-byte aligned). Requests of one connection are answered
+  *         in order, requests of all connections run one at a time on the service stream.
+  */
+constexpr uint32_t MATMUL_SERVICE_MAGIC = 0x4D4C5253U;
+
+enum class MatmulServiceOp : uint32_t {
+    ATTACH = 1,
+    GEMM = 2,
+    STATS = 3,
+    SHUTDOWN = 4,
+};
+
+enum class MatmulServiceStatus : int32_t {
+    OK = 0,
+    BAD_REQUEST = 1,
+    NO_SHM = 2,        // GEMM before ATTACH
+    OUT_OF_RANGE = 3,  // a tensor reaches past the attached memory or is misaligned
+    NO_TILING = 4,
+    ATTACH_FAILED = 5, // no descriptor, smaller than shmSize, or it cannot be mapped
+};
+
+struct MatmulServiceRequest {
+    uint32_t magic;
+    uint32_t op;
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t weightId; // GEMM: requests with the same nonzero id promise the same B and bias, so they can batch
+    uint64_t aOffset;
+    uint64_t bOffset;
+    uint64_t biasOffset;
+    uint64_t cOffset;
+    uint64_t shmSize; // ATTACH: bytes of the memfd to map
+};
+
+struct MatmulServiceReply {
+    uint32_t magic;
+    int32_t status;
+    uint32_t blockDim;
+    uint32_t tilingHit; // the shape was already warm
+    uint32_t batchSize; // GEMMs that shared the launch
+    uint32_t batchM;    // M of the stacked launch
+    double kernelUs;
+    double serviceUs; // request received to reply sent, including the wait for a batch
+    uint64_t served;  // GEMM requests served by the process so far
+};
+
+/**
+  * @brief  Send or receive exactly size bytes on a stream socket, optionally with one file descriptor attached.
+  *         Shared by the service and the client.
+  */
+inline bool MatmulServiceSend(int32_t fd, const void *data, size_t size, int32_t passFd = -1)
+{
+    iovec iov = {const_cast<void *>(data), size};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int32_t))] = {};
+    if (passFd >= 0) {
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int32_t));
+        std::memcpy(CMSG_DATA(cmsg), &passFd, sizeof(int32_t));
+    }
+    while (iov.iov_len > 0) {
+        const ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        iov.iov_base = static_cast<char *>(iov.iov_base) + sent;
+        iov.iov_len -= static_cast<size_t>(sent);
+        msg.msg_control = nullptr; // the descriptor goes with the first byte only
+        msg.msg_controllen = 0;
+    }
+    return true;
+}
+
+/**
+  * @brief  passedFd (when not null) receives a descriptor sent along, or -1. Returns false on EOF or error.
+  */
+inline bool MatmulServiceRecv(int32_t fd, void *data, size_t size, int32_t *passedFd = nullptr)
+{
+    if (passedFd != nullptr) {
+        *passedFd = -1;
+    }
+    iovec iov = {data, size};
+    while (iov.iov_len > 0) {
+        msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int32_t))] = {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        const ssize_t received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                int32_t fdIn = -1;
+                std::memcpy(&fdIn, CMSG_DATA(cmsg), sizeof(int32_t));
+                if (passedFd != nullptr && *passedFd < 0) {
+                    *passedFd = fdIn;
+                } else {
+                    (void)close(fdIn);
+                }
+            }
+        }
+        iov.iov_base = static_cast<char *>(iov.iov_base) + received;
+        iov.iov_len -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+#endif // MATMUL_SERVICE_H
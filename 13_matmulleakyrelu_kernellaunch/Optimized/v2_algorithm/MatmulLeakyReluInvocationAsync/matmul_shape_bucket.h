@@ -0,0 +1,86 @@
+/**
+ * @file matmul_shape_bucket.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_SHAPE_BUCKET_H
+#define MATMUL_SHAPE_BUCKET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "kernel_tiling/kernel_tiling.h"
+
+/**
+  * @brief  Tiling block handed to matmul_leakyrelu_custom. The kernel reads validM right after TCubeTiling:
+  *         cube.M is the bucket the tiling was built for, rows in [validM, cube.M) are masked (never read or
+  *         written). validM == 0 means cube.M.
+  */
+struct MatmulLeakyLaunchTiling {
+    TCubeTiling cube;
+    uint32_t validM;
+    uint32_t reserved;
+};
+
+/**
+  * @brief  Maps a runtime M onto the smallest bucket >= M so tiling search, tiling cache and tuning DB entries
+  *         are shared by a range of M. Opt-in through MATMUL_M_BUCKETS: unset or "off" keeps the exact M,
+  *         "auto" takes 4 steps per power of two from 16 to 65536 (at most 25% masked rows), otherwise an
+  *         explicit list such as "256,384,512".
+  */
+class MatmulShapeBuckets {
+public:
+    static const MatmulShapeBuckets &Global()
+    {
+        static const MatmulShapeBuckets buckets(std::getenv("MATMUL_M_BUCKETS"));
+        return buckets;
+    }
+
+    explicit MatmulShapeBuckets(const char *spec)
+    {
+        if (spec == nullptr || std::strcmp(spec, "off") == 0) {
+            return;
+        }
+        if (std::strcmp(spec, "auto") == 0) {
+            for (uint32_t pow2 = 16U; pow2 <= 65536U; pow2 *= 2U) {
+                for (uint32_t quarter = 4U; quarter < 8U; ++quarter) {
+                    buckets_.push_back(pow2 * quarter / 4U);
+                }
+            }
+        } else {
+            std::stringstream all(spec);
+            std::string item;
+            while (std::getline(all, item, ',')) {
+                const unsigned long value = std::strtoul(item.c_str(), nullptr, 10);
+                if (value > 0UL) {
+                    buckets_.push_back(static_cast<uint32_t>(value));
+                }
+            }
+        }
+        std::sort(buckets_.begin(), buckets_.end());
+        buckets_.erase(std::unique(buckets_.begin(), buckets_.end()), buckets_.end());
+    }
+
+    /**
+      * @retval The bucket for M, or M itself when bucketing is off or M is above the largest bucket.
+      */
+    uint32_t Bucket(uint32_t M) const
+    {
+        auto it = std::lower_bound(buckets_.begin(), buckets_.end(), M);
+        return it == buckets_.end() ? M : *it;
+    }
+
+private:
+    std::vector<uint32_t> buckets_;
+};
+
+#endif // MATMUL_SHAPE_BUCKET_H
@@ -0,0 +1,509 @@
+/**
+ * @file matmul_sweep.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "matmul_sweep.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "bench_stats.h"
+#include "data_utils.h"
+#include "env_config.h"
+#include "host_reference_gemm.h"
+#include "kernel_trace.h"
+#include "kernel_tiling/kernel_tiling.h"
+#include "launch_mem_account.h"
+#include "matmul_shape_bucket.h"
+#include "result_verifier.h"
+#include "tiling/platform/platform_ascendc.h"
+#ifndef ASCENDC_CPU_DEBUG
+#include "acl/acl.h"
+#include "acl_mem_pool.h"
+#include "aclrtlaunch_matmul_leakyrelu_custom.h"
+#else
+#include "tikicpulib.h"
+extern "C" void matmul_leakyrelu_custom(uint8_t *, uint8_t *, uint8_t *, uint8_t *, uint8_t *, uint8_t *);
+#endif
+
+extern bool GenerateTilingWithBase(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
+                                   uint32_t preferredCoreNum, uint32_t forceBaseM, uint32_t forceBaseN);
+
+namespace {
+
+/**
+  * @brief  Comma separated unsigned integers, at most maxFields of them.
+  */
+bool ParseFields(const std::string &text, std::vector<uint32_t> &fields, size_t maxFields)
+{
+    fields.clear();
+    std::istringstream in(text);
+    std::string field;
+    while (std::getline(in, field, ',')) {
+        const size_t begin = field.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || !std::isdigit(static_cast<unsigned char>(field[begin]))) {
+            return false;
+        }
+        char *end = nullptr;
+        const unsigned long value = std::strtoul(field.c_str() + begin, &end, 10);
+        if (std::strspn(end, " \t\r") != std::strlen(end)) {
+            return false;
+        }
+        fields.push_back(static_cast<uint32_t>(value));
+    }
+    return !fields.empty() && fields.size() <= maxFields;
+}
+
+} // namespace
+
+MatmulSweepConfig GetMatmulSweepConfig()
+{
+    // 0 is a valid warmup and a valid seed.
+    MatmulSweepConfig config = {std::getenv("MATMUL_SWEEP"), std::getenv("MATMUL_SWEEP_CSV"),
+                                GetEnvU32("MATMUL_BENCH_WARMUP", 3U, true), GetEnvU32("MATMUL_BENCH_ITERS", 10U), true,
+                                GetEnvU32("MATMUL_SEED", 2026U, true)};
+    if (config.specPath != nullptr && config.specPath[0] == '\0') {
+        config.specPath = nullptr;
+    }
+    if (config.csvPath == nullptr) {
+        config.csvPath = "./output/sweep.csv";
+    }
+    const char *verify = std::getenv("MATMUL_SWEEP_VERIFY");
+    config.verify = verify == nullptr || std::strcmp(verify, "off") != 0;
+    return config;
+}
+
+MatmulSweepSpec LoadMatmulSweepSpec(const std::string &path, bool &ok, std::string &error)
+{
+    MatmulSweepSpec spec;
+    std::ifstream in(path);
+    ok = in.is_open();
+    if (!ok) {
+        error = "cannot open " + path;
+        return spec;
+    }
+    std::string line;
+    uint32_t lineNo = 0;
+    while (ok && std::getline(in, line)) {
+        ++lineNo;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+        const size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) {
+            continue;
+        }
+        std::string keyword = "shape";
+        std::string rest = line.substr(begin);
+        if (std::isalpha(static_cast<unsigned char>(rest[0]))) {
+            const size_t space = rest.find_first_of(" \t");
+            keyword = rest.substr(0, space);
+            rest = space == std::string::npos ? std::string() : rest.substr(space);
+        }
+        std::vector<uint32_t> fields;
+        if (keyword == "shape") {
+            ok = ParseFields(rest, fields, 3U) && fields.size() == 3U && fields[0] > 0U && fields[1] > 0U &&
+                 fields[2] > 0U;
+            if (ok) {
+                spec.shapes.push_back({fields[0], fields[1], fields[2]});
+            }
+        } else if (keyword == "config") {
+            ok = ParseFields(rest, fields, 3U);
+            fields.resize(3U, 0U);
+            if (ok) {
+                spec.configs.push_back({fields[0], fields[1], fields[2]});
+            }
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            error = path + ":" + std::to_string(lineNo) + ": cannot parse \"" + line + "\"";
+        }
+    }
+    if (ok && spec.shapes.empty()) {
+        ok = false;
+        error = path + ": no shapes";
+    }
+    if (ok && spec.configs.empty()) {
+        spec.configs.push_back({0U, 0U, 0U});
+    }
+    return spec;
+}
+
+namespace {
+
+/**
+  * @brief  One line of the results table. core/baseM/baseN are the overrides of the spec, the tiling fields what
+  *         the tiling made of them.
+  */
+struct SweepRow {
+    MatmulSweepShape shape = {};
+    MatmulSweepOverride request = {};
+    bool tilingOk = false;
+    uint32_t bucketM = 0;
+    uint32_t usedCoreNum = 0;
+    uint32_t blockDim = 0;
+    uint32_t baseM = 0;
+    uint32_t baseN = 0;
+    LaunchMemFootprint mem;
+    LatencyStats kernel;
+    double tflops = 0.0;
+    bool verified = false;
+    double errorRatio = 0.0;
+    bool pass = false;
+};
+
+const char *SweepResult(const SweepRow &row)
+{
+    if (!row.tilingOk) {
+        return "no_tiling";
+    }
+    if (!row.verified) {
+        return "unverified";
+    }
+    return row.pass ? "pass" : "fail";
+}
+
+/**
+  * @brief  Device side of the sweep: one device, stream and event pair for the whole process, and A/B/bias/C/
+  *         workspace/tiling buffers from AclMemPool that only ever grow, so a shape no larger than the ones before
+  *         it allocates nothing.
+  */
+class SweepRunner {
+public:
+    SweepRunner(const MatmulSweepConfig &config, uint32_t preferredCoreNum)
+        : config_(config), preferredCoreNum_(preferredCoreNum), verify_(GetVerifyConfig())
+    {
+        auto platform = platform_ascendc::PlatformAscendCManager::GetInstance(SOC_VERSION);
+        systemWorkspaceSize_ = static_cast<size_t>(platform->GetLibApiWorkSpaceSize());
+#ifdef KERNEL_TRACE
+        traceSize_ = KERNEL_TRACE_BYTES; // placed after the user workspace, as in main.cpp
+#endif
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(aclInit(nullptr));
+        CHECK_ACL(aclrtSetDevice(deviceId_));
+        CHECK_ACL(aclrtCreateStream(&stream_));
+        CHECK_ACL(aclrtCreateEvent(&kernelStart_));
+        CHECK_ACL(aclrtCreateEvent(&kernelEnd_));
+#endif
+    }
+
+    ~SweepRunner()
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        auto &pool = AclMemPool::Instance();
+        for (auto *buffer : {&a_, &b_, &bias_, &c_, &workspace_, &tiling_}) {
+            CHECK_ACL(pool.Free(buffer->data));
+        }
+        pool.Report();
+        pool.Trim();
+        CHECK_ACL(aclrtDestroyEvent(kernelStart_));
+        CHECK_ACL(aclrtDestroyEvent(kernelEnd_));
+        CHECK_ACL(aclrtDestroyStream(stream_));
+        CHECK_ACL(aclrtResetDevice(deviceId_));
+        CHECK_ACL(aclFinalize());
+#else
+        for (auto *buffer : {&a_, &b_, &bias_, &c_, &workspace_, &tiling_}) {
+            if (buffer->data != nullptr) {
+                AscendC::GmFree((void *)buffer->data);
+            }
+        }
+#endif
+    }
+
+    /**
+      * @brief  Generate and upload the inputs of shape and compute its golden once, then run every config.
+      */
+    void RunShape(const MatmulSweepShape &shape, const std::vector<MatmulSweepOverride> &configs,
+                  std::vector<SweepRow> &rows)
+    {
+        const size_t aCount = static_cast<size_t>(shape.M) * shape.K;
+        const size_t bCount = static_cast<size_t>(shape.K) * shape.N;
+        std::vector<uint16_t> a(aCount);
+        std::vector<uint16_t> b(bCount);
+        std::vector<float> bias(shape.N);
+        FillSmallIntInputs(config_.seed, a.data(), aCount);
+        FillSmallIntInputs(config_.seed + 1U, b.data(), bCount, bias.data(), bias.size());
+        std::vector<float> golden;
+        if (config_.verify) {
+            golden.resize(static_cast<size_t>(shape.M) * shape.N);
+            const double begin = HostNowUs();
+            ReferenceMatmulLeakyRelu(a.data(), b.data(), bias.data(), golden.data(), shape.M, shape.N, shape.K,
+                                     0.001f);
+            std::printf("[SWEEP] golden M=%u N=%u K=%u ms=%.3f\n", shape.M, shape.N, shape.K,
+                        (HostNowUs() - begin) / 1000.0);
+        }
+        Reserve(a_, aCount * sizeof(uint16_t));
+        Reserve(b_, bCount * sizeof(uint16_t));
+        Reserve(bias_, bias.size() * sizeof(float));
+        Reserve(c_, static_cast<size_t>(shape.M) * shape.N * sizeof(float));
+        Upload(a_, a.data(), aCount * sizeof(uint16_t));
+        Upload(b_, b.data(), bCount * sizeof(uint16_t));
+        Upload(bias_, bias.data(), bias.size() * sizeof(float));
+        std::vector<float> output(golden.size());
+        for (const auto &request : configs) {
+            rows.push_back(RunCase(shape, request, golden, output));
+        }
+    }
+
+private:
+    struct SweepBuffer {
+        uint8_t *data = nullptr;
+        size_t size = 0;
+    };
+
+    /**
+      * @brief  Tiling of the M bucket as main.cpp builds it (with the same checks and the same fallback to the
+      *         exact M), then warmup + iterations launches on the resident inputs.
+      */
+    SweepRow RunCase(const MatmulSweepShape &shape, const MatmulSweepOverride &request,
+                     const std::vector<float> &golden, std::vector<float> &output)
+    {
+        SweepRow row;
+        row.shape = shape;
+        row.request = request;
+        const uint32_t M = shape.M;
+        const uint32_t N = shape.N;
+        const uint32_t K = shape.K;
+        const uint32_t coreNum = request.coreNum > 0U ? request.coreNum : preferredCoreNum_;
+        // A 0 field keeps the MATMUL_FORCE_BASE_M/N the process started with.
+        const uint32_t baseM = request.baseM > 0U ? request.baseM : envBaseM_;
+        const uint32_t baseN = request.baseN > 0U ? request.baseN : envBaseN_;
+        MatmulLeakyLaunchTiling launch = {};
+        uint32_t bucketM = MatmulShapeBuckets::Global().Bucket(M);
+        bool ok = GenerateTilingWithBase(SOC_VERSION, reinterpret_cast<uint8_t *>(&launch), bucketM, N, K, coreNum,
+                                         baseM, baseN);
+        if (!ok && bucketM != M) {
+            bucketM = M;
+            ok = GenerateTilingWithBase(SOC_VERSION, reinterpret_cast<uint8_t *>(&launch), bucketM, N, K, coreNum,
+                                        baseM, baseN);
+        }
+        const TCubeTiling &cube = launch.cube;
+        if (!ok || cube.M == 0 || cube.N == 0 || cube.Ka == 0 || cube.Kb == 0 || cube.usedCoreNum == 0 ||
+            cube.baseM == 0 || cube.baseN == 0 || cube.singleCoreM == 0 || cube.singleCoreN == 0) {
+            std::printf("[SWEEP] no valid tiling for M=%u N=%u K=%u core=%u baseM=%u baseN=%u\n", M, N, K,
+                        request.coreNum, request.baseM, request.baseN);
+            return row;
+        }
+#ifdef CUSTOM_ASCEND310P
+        const uint32_t blockDim = cube.usedCoreNum;
+#else
+        if (cube.usedCoreNum < 2) {
+            std::printf("[SWEEP] single-core tiling for M=%u N=%u K=%u is unsupported on 910B\n", M, N, K);
+            return row;
+        }
+        const uint32_t blockDim = (cube.usedCoreNum + 1U) / 2U;
+#endif
+        launch.validM = M;
+        row.tilingOk = true;
+        row.bucketM = bucketM;
+        row.usedCoreNum = static_cast<uint32_t>(cube.usedCoreNum);
+        row.blockDim = blockDim;
+        row.baseM = static_cast<uint32_t>(cube.baseM);
+        row.baseN = static_cast<uint32_t>(cube.baseN);
+
+        const size_t cSize = static_cast<size_t>(M) * N * sizeof(float);
+        row.mem.input = (static_cast<size_t>(M) * K + static_cast<size_t>(K) * N) * sizeof(uint16_t) +
+                        static_cast<size_t>(N) * sizeof(float);
+        row.mem.output = cSize;
+        row.mem.userWorkspace = static_cast<size_t>(bucketM) * N * sizeof(float);
+        row.mem.systemWorkspace = systemWorkspaceSize_;
+        row.mem.tiling = sizeof(launch);
+        row.mem.trace = traceSize_;
+        LaunchMemAccount::Instance().Record("matmul_leakyrelu_custom", row.mem);
+        Reserve(workspace_, row.mem.Workspace());
+        Reserve(tiling_, sizeof(launch));
+        Upload(tiling_, &launch, sizeof(launch));
+        // C of the previous case must not pass for this one.
+        ClearOutput(cSize);
+        std::vector<double> kernelUs;
+        for (uint32_t i = 0; i < config_.warmup + config_.iterations; ++i) {
+            const double us = Launch(blockDim);
+            if (i >= config_.warmup) {
+                kernelUs.push_back(us);
+            }
+        }
+        row.kernel = SummarizeLatency(kernelUs);
+        row.tflops = row.kernel.mean > 0.0 ? 2.0 * M * N * K / (row.kernel.mean * 1e6) : 0.0;
+        if (!golden.empty()) {
+            Download(output.data(), c_, cSize);
+            const VerifyLayout layout = {M, N, bucketM, static_cast<uint32_t>(cube.singleCoreM),
+                                         static_cast<uint32_t>(cube.singleCoreN), row.baseM, row.baseN};
+            const VerifyResult result = VerifyOutput(output.data(), golden.data(), golden.size(), layout, verify_);
+            row.verified = true;
+            row.errorRatio = result.checked > 0U ? static_cast<double>(result.mismatches) / result.checked : 0.0;
+            row.pass = result.pass;
+        }
+        std::printf("[SWEEP] M=%u N=%u K=%u core=%u baseM=%u baseN=%u -> bucketM=%u usedCore=%u blockDim=%u "
+                    "baseM=%u baseN=%u kernel_us mean=%.3f p50=%.3f tflops=%.3f mem_mib=%.2f %s\n",
+                    M, N, K, request.coreNum, request.baseM, request.baseN, bucketM, row.usedCoreNum, blockDim,
+                    row.baseM, row.baseN, row.kernel.mean, row.kernel.p50, row.tflops, LaunchMemMiB(row.mem.Total()),
+                    SweepResult(row));
+        std::fflush(stdout);
+        return row;
+    }
+
+    double Launch(uint32_t blockDim)
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(aclrtRecordEvent(kernelStart_, stream_));
+        ACLRT_LAUNCH_KERNEL(matmul_leakyrelu_custom)
+        (blockDim, stream_, a_.data, b_.data, bias_.data, c_.data, workspace_.data, tiling_.data);
+        CHECK_ACL(aclrtRecordEvent(kernelEnd_, stream_));
+        CHECK_ACL(aclrtSynchronizeStream(stream_));
+        float ms = 0.0f;
+        CHECK_ACL(aclrtEventElapsedTime(&ms, kernelStart_, kernelEnd_));
+        return static_cast<double>(ms) * 1000.0;
+#else
+        const double begin = HostNowUs();
+        ICPU_RUN_KF(matmul_leakyrelu_custom, blockDim, a_.data, b_.data, bias_.data, c_.data, workspace_.data,
+                    tiling_.data);
+        return HostNowUs() - begin;
+#endif
+    }
+
+    void Reserve(SweepBuffer &buffer, size_t size)
+    {
+        if (buffer.size >= size) {
+            return;
+        }
+#ifndef ASCENDC_CPU_DEBUG
+        auto &pool = AclMemPool::Instance();
+        CHECK_ACL(pool.Free(buffer.data));
+        CHECK_ACL(pool.Malloc((void **)&buffer.data, size, AclMemKind::DEVICE));
+#else
+        if (buffer.data != nullptr) {
+            AscendC::GmFree((void *)buffer.data);
+        }
+        buffer.data = (uint8_t *)AscendC::GmAlloc(size);
+#endif
+        buffer.size = size;
+    }
+
+    void Upload(SweepBuffer &buffer, const void *host, size_t size)
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(aclrtMemcpy(buffer.data, buffer.size, host, size, ACL_MEMCPY_HOST_TO_DEVICE));
+#else
+        std::memcpy(buffer.data, host, size);
+#endif
+    }
+
+    void Download(void *host, const SweepBuffer &buffer, size_t size)
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(aclrtMemcpy(host, size, buffer.data, size, ACL_MEMCPY_DEVICE_TO_HOST));
+#else
+        std::memcpy(host, buffer.data, size);
+#endif
+    }
+
+    void ClearOutput(size_t size)
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        CHECK_ACL(aclrtMemset(c_.data, c_.size, 0, size));
+#else
+        std::memset(c_.data, 0, size);
+#endif
+    }
+
+    MatmulSweepConfig config_;
+    uint32_t preferredCoreNum_;
+    VerifyConfig verify_;
+    uint32_t envBaseM_ = GetEnvU32("MATMUL_FORCE_BASE_M", 0U);
+    uint32_t envBaseN_ = GetEnvU32("MATMUL_FORCE_BASE_N", 0U);
+    size_t systemWorkspaceSize_ = 0;
+    size_t traceSize_ = 0;
+    SweepBuffer a_;
+    SweepBuffer b_;
+    SweepBuffer bias_;
+    SweepBuffer c_;
+    SweepBuffer workspace_;
+    SweepBuffer tiling_; // MatmulLeakyLaunchTiling of the current case
+#ifndef ASCENDC_CPU_DEBUG
+    int32_t deviceId_ = 0;
+    aclrtStream stream_ = nullptr;
+    aclrtEvent kernelStart_ = nullptr;
+    aclrtEvent kernelEnd_ = nullptr;
+#endif
+};
+
+/**
+  * @brief  Print the results table and write it as CSV, one row per case in spec order.
+  */
+void ReportSweep(const MatmulSweepConfig &config, const std::vector<SweepRow> &rows, double wallUs)
+{
+    std::printf("[SWEEP] %6s %6s %6s %5s %6s %6s | %7s %5s %5s %6s %6s | %10s %10s %10s %8s %9s %s\n", "M", "N",
+                "K", "core", "base_m", "base_n", "bucket", "used", "block", "base_m", "base_n", "mean_us", "p50_us",
+                "p90_us", "tflops", "err_ratio", "result");
+    for (const auto &row : rows) {
+        std::printf("[SWEEP] %6u %6u %6u %5u %6u %6u | %7u %5u %5u %6u %6u | %10.3f %10.3f %10.3f %8.3f %9.2e %s\n",
+                    row.shape.M, row.shape.N, row.shape.K, row.request.coreNum, row.request.baseM, row.request.baseN,
+                    row.bucketM, row.usedCoreNum, row.blockDim, row.baseM, row.baseN, row.kernel.mean, row.kernel.p50,
+                    row.kernel.p90, row.tflops, row.errorRatio, SweepResult(row));
+    }
+    const size_t failed = static_cast<size_t>(std::count_if(rows.begin(), rows.end(), [](const SweepRow &row) {
+        return !row.tilingOk || (row.verified && !row.pass);
+    }));
+    std::printf("[SWEEP] cases=%zu failed=%zu warmup=%u iterations=%u wall_ms=%.3f\n", rows.size(), failed,
+                config.warmup, config.iterations, wallUs / 1000.0);
+    LaunchMemAccount::Instance().Report();
+
+    std::ofstream out(config.csvPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::printf("[ERROR] Open file failed. path = %s\n", config.csvPath);
+        return;
+    }
+    out << "M,N,K,core,base_m,base_n,bucket_m,used_core_num,block_dim,tiling_base_m,tiling_base_n,mean_us,p50_us,"
+           "p90_us,p99_us,stddev_us,tflops,input_bytes,output_bytes,user_ws_bytes,sys_ws_bytes,tiling_bytes,"
+           "trace_bytes,total_bytes,error_ratio,result\n";
+    for (const auto &row : rows) {
+        out << row.shape.M << ',' << row.shape.N << ',' << row.shape.K << ',' << row.request.coreNum << ','
+            << row.request.baseM << ',' << row.request.baseN << ',' << row.bucketM << ',' << row.usedCoreNum << ','
+            << row.blockDim << ',' << row.baseM << ',' << row.baseN << ',' << row.kernel.mean << ',' << row.kernel.p50
+            << ',' << row.kernel.p90 << ',' << row.kernel.p99 << ',' << row.kernel.stddev << ',' << row.tflops << ','
+            << row.mem.input << ',' << row.mem.output << ',' << row.mem.userWorkspace << ',' << row.mem.systemWorkspace
+            << ',' << row.mem.tiling << ',' << row.mem.trace << ',' << row.mem.Total() << ',' << row.errorRatio << ','
+            << SweepResult(row) << '\n';
+    }
+    std::printf("[SWEEP] csv=%s\n", config.csvPath);
+}
+
+} // namespace
+
+int32_t RunMatmulSweep(const MatmulSweepConfig &config, uint32_t preferredCoreNum)
+{
+    bool ok = false;
+    std::string error;
+    const MatmulSweepSpec spec = LoadMatmulSweepSpec(config.specPath, ok, error);
+    if (!ok) {
+        std::fprintf(stderr, "[ERROR] sweep spec: %s\n", error.c_str());
+        return 1;
+    }
+    std::printf("[SWEEP] %zu shapes x %zu configs from %s\n", spec.shapes.size(), spec.configs.size(),
+                config.specPath);
+    std::vector<SweepRow> rows;
+    const double begin = HostNowUs();
+    {
+        SweepRunner runner(config, preferredCoreNum);
+        for (const auto &shape : spec.shapes) {
+            runner.RunShape(shape, spec.configs, rows);
+        }
+    }
+    ReportSweep(config, rows, HostNowUs() - begin);
+    const bool allOk = std::all_of(rows.begin(), rows.end(), [](const SweepRow &row) {
+        return row.tilingOk && (!row.verified || row.pass);
+    });
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file matmul_sweep.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_SWEEP_H
+#define MATMUL_SWEEP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+  * @brief  Sweep mode: MATMUL_SWEEP=<spec file> runs every case of the spec back to back in one process, on one
+  *         device context and stream, and prints one results table instead of one run.sh call per case. Inputs
+  *         are generated in process (integers 1..9 like scripts/gen_data.py) and uploaded once per shape, the
+  *         golden is computed once per shape with the host reference GEMM and shared by all its configs.
+  *
+  *         Every case gets MATMUL_BENCH_WARMUP untimed and MATMUL_BENCH_ITERS (default 10 here) timed launches
+  *         and is verified with the MATMUL_VERIFY_* tolerances unless MATMUL_SWEEP_VERIFY=off.
+  */
+struct MatmulSweepConfig {
+    const char *specPath;
+    const char *csvPath; // MATMUL_SWEEP_CSV, default ./output/sweep.csv
+    uint32_t warmup;
+    uint32_t iterations;
+    bool verify;
+    uint32_t seed; // MATMUL_SEED, default 2026 like gen_data.py: A is drawn from seed, B and bias from seed + 1
+};
+
+MatmulSweepConfig GetMatmulSweepConfig();
+
+/**
+  * @brief  Spec file, '#' starts a comment:
+  *           shape M,N,K             (the keyword may be left out)
+  *           config core,baseM,baseN (any suffix may be left out)
+  *         Every shape runs with every config. A 0 field keeps what the process would use without the sweep:
+  *         MATMUL_FORCE_CORE_NUM / MATMUL_FORCE_BASE_M / MATMUL_FORCE_BASE_N, or the choice of the tiling. No
+  *         config line means one config of all zeros.
+  */
+struct MatmulSweepShape {
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+};
+
+struct MatmulSweepOverride {
+    uint32_t coreNum;
+    uint32_t baseM;
+    uint32_t baseN;
+};
+
+struct MatmulSweepSpec {
+    std::vector<MatmulSweepShape> shapes;
+    std::vector<MatmulSweepOverride> configs;
+};
+
+/**
+  * @brief  ok is false when the file cannot be read or a line does not parse; error then names the line.
+  */
+MatmulSweepSpec LoadMatmulSweepSpec(const std::string &path, bool &ok, std::string &error);
+
+/**
+  * @brief  Run the sweep. Returns the exit status of the process: 0 when every case got a tiling and passed.
+  */
+int32_t RunMatmulSweep(const MatmulSweepConfig &config, uint32_t preferredCoreNum);
+
+#endif // MATMUL_SWEEP_H
@@ -0,0 +1,110 @@
+/**
+ * @file matmul_tiling_gen.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kernel_tiling/kernel_tiling.h"
+#include "matmul_shape_bucket.h"
+#include "matmul_tiling_table.h"
+
+extern uint32_t GenerateTilingBatch(const char *socVersion, const uint32_t *shapes, uint32_t count, uint8_t *tilingBufs,
+                                    size_t tilingStride, uint32_t preferredCoreNum, bool *ok);
+
+namespace {
+
+constexpr size_t TILING_WORDS = (sizeof(TCubeTiling) + sizeof(uint32_t) - 1U) / sizeof(uint32_t);
+
+bool WriteTable(const std::string &path, const std::string &manifest, const std::vector<MatmulTilingTableKey> &keys,
+                const std::vector<uint32_t> &words)
+{
+    std::ofstream out(path, std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+    out << "// Generated by matmul_tiling_gen from " << manifest << ", do not edit.\n"
+        << "#ifndef MATMUL_TILING_TABLE_DATA_H\n#define MATMUL_TILING_TABLE_DATA_H\n\n"
+        << "#include <cstdint>\n\n#include \"matmul_tiling_table.h\"\n\n"
+        << "constexpr char MATMUL_TILING_TABLE_SOC[] = \"" << SOC_VERSION << "\";\n"
+        << "constexpr uint32_t MATMUL_TILING_TABLE_BYTES = " << sizeof(TCubeTiling) << "U;\n\n"
+        << "struct MatmulTilingBlobEntry {\n    MatmulTilingTableKey key;\n    uint32_t words[" << TILING_WORDS
+        << "];\n};\n\n"
+        << "constexpr MatmulTilingBlobEntry MATMUL_TILING_TABLE[] = {\n";
+    char word[16];
+    for (size_t i = 0; i < keys.size(); ++i) {
+        out << "    {{" << keys[i].M << "U, " << keys[i].N << "U, " << keys[i].K << "U, " << keys[i].abElemSize << "U}, {";
+        for (size_t w = 0; w < TILING_WORDS; ++w) {
+            std::snprintf(word, sizeof(word), "0x%08XU", words[i * TILING_WORDS + w]);
+            out << (w == 0U ? "" : ", ") << word;
+        }
+        out << "}},\n";
+    }
+    out << "};\n\n#endif // MATMUL_TILING_TABLE_DATA_H\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+/**
+  * @brief  Build-time tiling table generator: matmul_tiling_gen <manifest> <output header>.
+  *         M is mapped onto its bucket as main.cpp does, fp32 lines are skipped (this sample is fp16 only).
+  */
+int32_t main(int32_t argc, char *argv[])
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <shape manifest> <output header>\n", argv[0]);
+        return 1;
+    }
+    bool ok = false;
+    std::vector<MatmulTilingTableKey> keys = LoadMatmulShapeManifest(argv[1], ok);
+    if (!ok) {
+        std::fprintf(stderr, "[ERROR] cannot parse shape manifest %s\n", argv[1]);
+        return 1;
+    }
+    keys.erase(std::remove_if(keys.begin(), keys.end(), [](const MatmulTilingTableKey &key) { return key.abElemSize != 2U; }),
+               keys.end());
+    for (auto &key : keys) {
+        key.M = MatmulShapeBuckets::Global().Bucket(key.M);
+    }
+    std::sort(keys.begin(), keys.end(), MatmulTilingKeyLess);
+    keys.erase(std::unique(keys.begin(), keys.end(), MatmulTilingKeyEqual), keys.end());
+    if (keys.empty()) {
+        std::fprintf(stderr, "[ERROR] no fp16 shape in %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<uint32_t> shapes;
+    for (const auto &key : keys) {
+        shapes.insert(shapes.end(), {key.M, key.N, key.K});
+    }
+    const uint32_t count = static_cast<uint32_t>(keys.size());
+    std::vector<uint32_t> words(static_cast<size_t>(count) * TILING_WORDS, 0U);
+    std::unique_ptr<bool[]> shapeOk(new bool[count]);
+    const uint32_t done = GenerateTilingBatch(SOC_VERSION, shapes.data(), count, reinterpret_cast<uint8_t *>(words.data()),
+                                              TILING_WORDS * sizeof(uint32_t), 0U, shapeOk.get());
+    if (done != count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!shapeOk[i]) {
+                std::fprintf(stderr, "[ERROR] no tiling for M=%u N=%u K=%u\n", keys[i].M, keys[i].N, keys[i].K);
+            }
+        }
+        return 1;
+    }
+    if (!WriteTable(argv[2], argv[1], keys, words)) {
+        std::fprintf(stderr, "[ERROR] cannot write %s\n", argv[2]);
+        return 1;
+    }
+    std::printf("[INFO] tiling table with %u shapes written to %s\n", count, argv[2]);
+    return 0;
+}
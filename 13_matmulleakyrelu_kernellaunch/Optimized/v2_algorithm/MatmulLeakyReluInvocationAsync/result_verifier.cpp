@@ -0,0 +1,412 @@
+/**
+ * @file result_verifier.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "result_verifier.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define VERIFY_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define VERIFY_NEON 1
+#endif
+
+#include "data_utils.h"
+#include "host_reference_gemm.h"
+
+namespace {
+
+constexpr size_t VERIFY_CHUNK = 1U << 16; // elements per pass; also bounds the int32 SIMD bucket counters
+constexpr int32_t ULP_THRESHOLDS[VERIFY_ULP_BUCKETS - 1U] = {0, 1, 3, 15, 255, 65535};
+
+/**
+  * @brief  Running statistics of one chunk. Buckets are accumulated as "ULP distance > threshold" counts.
+  */
+struct ChunkStats {
+    uint64_t mismatches = 0;
+    float maxAbs = 0.0f;
+    float maxRel = 0.0f;
+    uint64_t above[VERIFY_ULP_BUCKETS - 1U] = {};
+};
+
+using ChunkFn = void (*)(const float *, const float *, size_t, float, float, ChunkStats &);
+
+// Monotonic integer image of a float: adjacent floats differ by 1, -0 and +0 coincide.
+int32_t OrderedBits(float value)
+{
+    int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? static_cast<int32_t>(static_cast<uint32_t>(INT32_MIN) - static_cast<uint32_t>(bits)) : bits;
+}
+
+int32_t UlpDistance(float a, float b)
+{
+    if (std::isnan(a) || std::isnan(b)) {
+        return INT32_MAX;
+    }
+    const int64_t diff = static_cast<int64_t>(OrderedBits(a)) - OrderedBits(b);
+    return static_cast<int32_t>(std::min<int64_t>(diff < 0 ? -diff : diff, INT32_MAX));
+}
+
+bool IsClose(float out, float gold, float atol, float rtol)
+{
+    if (out == gold || (std::isnan(out) && std::isnan(gold))) {
+        return true;
+    }
+    return std::fabs(out - gold) <= atol + rtol * std::fabs(gold);
+}
+
+void ChunkScalar(const float *out, const float *gold, size_t count, float atol, float rtol, ChunkStats &stats)
+{
+    for (size_t i = 0; i < count; ++i) {
+        const float absErr = std::fabs(out[i] - gold[i]);
+        if (!std::isnan(absErr)) {
+            stats.maxAbs = std::max(stats.maxAbs, absErr);
+            if (gold[i] != 0.0f) {
+                stats.maxRel = std::max(stats.maxRel, absErr / std::fabs(gold[i]));
+            }
+        }
+        stats.mismatches += IsClose(out[i], gold[i], atol, rtol) ? 0U : 1U;
+        const int32_t ulp = UlpDistance(out[i], gold[i]);
+        for (uint32_t t = 0; t < VERIFY_ULP_BUCKETS - 1U; ++t) {
+            stats.above[t] += ulp > ULP_THRESHOLDS[t] ? 1U : 0U;
+        }
+    }
+}
+
+#ifdef VERIFY_X86
+/**
+  * @brief  8 elements per step; the same math as ChunkScalar with compare masks instead of branches.
+  */
+__attribute__((target("avx2"))) void ChunkAvx2(const float *out, const float *gold, size_t count, float atol,
+                                                float rtol, ChunkStats &stats)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(INT32_MAX));
+    const __m256 atolV = _mm256_set1_ps(atol);
+    const __m256 rtolV = _mm256_set1_ps(rtol);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256i intMax = _mm256_set1_epi32(INT32_MAX);
+    const __m256i intMin = _mm256_set1_epi32(INT32_MIN);
+    const __m256 allOnes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    __m256 maxAbs = zero;
+    __m256 maxRel = zero;
+    __m256i mismatches = _mm256_setzero_si256();
+    __m256i above[VERIFY_ULP_BUCKETS - 1U];
+    for (auto &acc : above) {
+        acc = _mm256_setzero_si256();
+    }
+    size_t i = 0;
+    for (; i + 8U <= count; i += 8U) {
+        const __m256 o = _mm256_loadu_ps(out + i);
+        const __m256 g = _mm256_loadu_ps(gold + i);
+        const __m256 absG = _mm256_and_ps(g, absMask);
+        const __m256 absErr = _mm256_and_ps(_mm256_sub_ps(o, g), absMask);
+        // max(x, acc) keeps acc when x is NaN.
+        maxAbs = _mm256_max_ps(absErr, maxAbs);
+        const __m256 rel = _mm256_div_ps(absErr, absG);
+        maxRel = _mm256_max_ps(_mm256_and_ps(rel, _mm256_cmp_ps(g, zero, _CMP_NEQ_OQ)), maxRel);
+
+        const __m256 tol = _mm256_add_ps(atolV, _mm256_mul_ps(rtolV, absG));
+        const __m256 bothNan = _mm256_and_ps(_mm256_cmp_ps(o, o, _CMP_UNORD_Q), _mm256_cmp_ps(g, g, _CMP_UNORD_Q));
+        const __m256 close = _mm256_or_ps(
+            _mm256_or_ps(_mm256_cmp_ps(absErr, tol, _CMP_LE_OQ), _mm256_cmp_ps(o, g, _CMP_EQ_OQ)), bothNan);
+        // All-ones lanes are -1: subtracting the "not close" mask counts mismatches.
+        mismatches = _mm256_sub_epi32(mismatches, _mm256_castps_si256(_mm256_xor_ps(close, allOnes)));
+
+        const __m256i ob = _mm256_castps_si256(o);
+        const __m256i gb = _mm256_castps_si256(g);
+        const __m256i oo = _mm256_blendv_epi8(ob, _mm256_sub_epi32(intMin, ob), _mm256_srai_epi32(ob, 31));
+        const __m256i og = _mm256_blendv_epi8(gb, _mm256_sub_epi32(intMin, gb), _mm256_srai_epi32(gb, 31));
+        // Same sign: |a - b| cannot overflow. Opposite signs: |a| + |b| fits in 32 unsigned bits, then clamp.
+        const __m256i sameSignDiff = _mm256_abs_epi32(_mm256_sub_epi32(oo, og));
+        const __m256i crossDiff =
+            _mm256_min_epu32(_mm256_add_epi32(_mm256_abs_epi32(oo), _mm256_abs_epi32(og)), intMax);
+        __m256i ulp = _mm256_blendv_epi8(sameSignDiff, crossDiff, _mm256_srai_epi32(_mm256_xor_si256(oo, og), 31));
+        const __m256 anyNan = _mm256_cmp_ps(o, g, _CMP_UNORD_Q);
+        ulp = _mm256_blendv_epi8(ulp, intMax, _mm256_castps_si256(anyNan));
+        for (uint32_t t = 0; t < VERIFY_ULP_BUCKETS - 1U; ++t) {
+            above[t] = _mm256_sub_epi32(above[t], _mm256_cmpgt_epi32(ulp, _mm256_set1_epi32(ULP_THRESHOLDS[t])));
+        }
+    }
+
+    alignas(32) float lanesF[2][8];
+    alignas(32) int32_t lanesI[VERIFY_ULP_BUCKETS][8];
+    _mm256_store_ps(lanesF[0], maxAbs);
+    _mm256_store_ps(lanesF[1], maxRel);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanesI[0]), mismatches);
+    for (uint32_t t = 0; t < VERIFY_ULP_BUCKETS - 1U; ++t) {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lanesI[t + 1U]), above[t]);
+    }
+    for (uint32_t lane = 0; lane < 8U; ++lane) {
+        stats.maxAbs = std::max(stats.maxAbs, lanesF[0][lane]);
+        stats.maxRel = std::max(stats.maxRel, lanesF[1][lane]);
+        stats.mismatches += static_cast<uint32_t>(lanesI[0][lane]);
+        for (uint32_t t = 0; t < VERIFY_ULP_BUCKETS - 1U; ++t) {
+            stats.above[t] += static_cast<uint32_t>(lanesI[t + 1U][lane]);
+        }
+    }
+    ChunkScalar(out + i, gold + i, count - i, atol, rtol, stats);
+}
+#endif
+
+#ifdef VERIFY_NEON
+/**
+  * @brief  4 elements per step, the NEON counterpart of ChunkAvx2.
+  */
+void ChunkNeon(const float *out, const float *gold, size_t count, float atol, float rtol, ChunkStats &stats)
+{
+    const float32x4_t atolV = vdupq_n_f32(atol);
+    const float32x4_t rtolV = vdupq_n_f32(rtol);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const int32x4_t intMin = vdupq_n_s32(INT32_MIN);
+    const uint32x4_t intMax = vdupq_n_u32(INT32_MAX);
+    float32x4_t maxAbs = zero;
+    float32x4_t maxRel = zero;
+    uint32x4_t mismatches = vdupq_n_u32(0U);
+    uint32x4_t above[VERIFY_ULP_BUCKETS - 1U];
+    for (auto &acc : above) {
+        acc = vdupq_n_u32(0U);
+    }
+    size_t i = 0;
+    for (; i + 4U <= count; i += 4U) {
+        const float32x4_t o = vld1q_f32(out + i);
+        const float32x4_t g = vld1q_f32(gold + i);
+        const float32x4_t absG = vabsq_f32(g);
+        const float32x4_t absErr = vabdq_f32(o, g);
+        // maxnm(x, acc) keeps acc when x is NaN.
+        maxAbs = vmaxnmq_f32(absErr, maxAbs);
+        const float32x4_t rel = vdivq_f32(absErr, absG);
+        maxRel = vmaxnmq_f32(vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(rel), vceqq_f32(g, zero))),
+                             maxRel);
+
+        const float32x4_t tol = vaddq_f32(atolV, vmulq_f32(rtolV, absG));
+        const uint32x4_t oOrdered = vceqq_f32(o, o);
+        const uint32x4_t gOrdered = vceqq_f32(g, g);
+        const uint32x4_t bothNan = vmvnq_u32(vorrq_u32(oOrdered, gOrdered));
+        const uint32x4_t close = vorrq_u32(vorrq_u32(vcleq_f32(absErr, tol), vceqq_f32(o, g)), bothNan);
+        mismatches = vaddq_u32(mismatches, vshrq_n_u32(vmvnq_u32(close), 31));
+
+        const int32x4_t ob = vreinterpretq_s32_f32(o);
+        const int32x4_t gb = vreinterpretq_s32_f32(g);
+        const int32x4_t oo = vbslq_s32(vreinterpretq_u32_s32(vshrq_n_s32(ob, 31)), vsubq_s32(intMin, ob), ob);
+        const int32x4_t og = vbslq_s32(vreinterpretq_u32_s32(vshrq_n_s32(gb, 31)), vsubq_s32(intMin, gb), gb);
+        // Same sign: |a - b| cannot overflow. Opposite signs: |a| + |b| fits in 32 unsigned bits, then clamp.
+        const uint32x4_t sameSignDiff = vreinterpretq_u32_s32(vabsq_s32(vsubq_s32(oo, og)));
+        const uint32x4_t crossDiff = vminq_u32(
+            vaddq_u32(vreinterpretq_u32_s32(vabsq_s32(oo)), vreinterpretq_u32_s32(vabsq_s32(og))), intMax);
+        uint32x4_t ulp = vbslq_u32(vreinterpretq_u32_s32(vshrq_n_s32(veorq_s32(oo, og), 31)), crossDiff,
+                                   sameSignDiff);
+        ulp = vbslq_u32(vandq_u32(oOrdered, gOrdered), ulp, intMax);
+        for (uint32_t t = 0; t < VERIFY_ULP_BUCKETS - 1U; ++t) {
+            const uint32x4_t hit = vcgtq_s32(vreinterpretq_s32_u32(ulp), vdupq_n_s32(ULP_THRESHOLDS[t]));
+            above[t] = vaddq_u32(above[t], vshrq_n_u32(hit, 31));
+        }
+    }
+
+    stats.maxAbs = std::max(stats.maxAbs, vmaxnmvq_f32(maxAbs));
+    stats.maxRel = std::max(stats.maxRel, vmaxnmvq_f32(maxRel));
+    stats.mismatches += vaddvq_u32(mismatches);
+    for (uint32_t t = 0; t < VERIFY_ULP_BUCKETS - 1U; ++t) {
+        stats.above[t] += vaddvq_u32(above[t]);
+    }
+    ChunkScalar(out + i, gold + i, count - i, atol, rtol, stats);
+}
+#endif
+
+ChunkFn SelectChunkFn()
+{
+#ifdef VERIFY_X86
+    if (GetRefGemmIsa() != RefGemmIsa::SCALAR) {
+        return ChunkAvx2;
+    }
+#elif defined(VERIFY_NEON)
+    if (GetRefGemmIsa() != RefGemmIsa::SCALAR) {
+        return ChunkNeon;
+    }
+#endif
+    return ChunkScalar;
+}
+
+double GetEnvDouble(const char *name, double defaultValue)
+{
+    const char *value = std::getenv(name);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    char *end = nullptr;
+    double parsed = std::strtod(value, &end);
+    return (end == value || *end != '\0') ? defaultValue : parsed;
+}
+
+VerifyMismatch Locate(uint64_t index, const float *output, const float *golden, const VerifyLayout &layout)
+{
+    VerifyMismatch mismatch;
+    mismatch.index = index;
+    mismatch.row = static_cast<uint32_t>(index / layout.N);
+    mismatch.col = static_cast<uint32_t>(index % layout.N);
+    const uint32_t mBlocks = (layout.tilingM + layout.singleCoreM - 1U) / layout.singleCoreM;
+    mismatch.block = mismatch.col / layout.singleCoreN * mBlocks + mismatch.row / layout.singleCoreM;
+    mismatch.tileM = mismatch.row % layout.singleCoreM / layout.baseM;
+    mismatch.tileN = mismatch.col % layout.singleCoreN / layout.baseN;
+    mismatch.expected = golden[index];
+    mismatch.actual = output[index];
+    return mismatch;
+}
+
+void WriteJsonFloat(std::ostream &out, double value)
+{
+    // JSON has no NaN/Inf literals.
+    if (std::isfinite(value)) {
+        out << value;
+    } else {
+        out << "null";
+    }
+}
+
+} // namespace
+
+VerifyConfig GetVerifyConfig()
+{
+    VerifyConfig config;
+    const char *enabled = std::getenv("MATMUL_VERIFY");
+    config.enabled = enabled != nullptr && std::strcmp(enabled, "on") == 0;
+    config.rtol = GetEnvDouble("MATMUL_VERIFY_RTOL", 1e-6);
+    config.atol = GetEnvDouble("MATMUL_VERIFY_ATOL", 1e-9);
+    config.errorTol = GetEnvDouble("MATMUL_VERIFY_ERROR_TOL", 1e-4);
+    config.firstK = static_cast<uint32_t>(GetEnvDouble("MATMUL_VERIFY_FIRST_K", 16.0));
+    config.budget = static_cast<uint64_t>(GetEnvDouble("MATMUL_VERIFY_BUDGET", 0.0));
+    config.jsonPath = std::getenv("MATMUL_VERIFY_JSON");
+    if (config.jsonPath == nullptr) {
+        config.jsonPath = "./output/verify.json";
+    }
+    return config;
+}
+
+VerifyResult VerifyOutput(const float *output, const float *golden, size_t count, const VerifyLayout &layout,
+                          const VerifyConfig &config)
+{
+    VerifyResult result;
+    result.total = count;
+    const uint64_t allowed = static_cast<uint64_t>(config.errorTol * static_cast<double>(count));
+    const uint64_t budget = config.budget == 0U ? allowed : config.budget;
+    const float atol = static_cast<float>(config.atol);
+    const float rtol = static_cast<float>(config.rtol);
+    const ChunkFn chunkFn = SelectChunkFn();
+
+    ChunkStats stats;
+    for (size_t begin = 0; begin < count; begin += VERIFY_CHUNK) {
+        const size_t len = std::min(VERIFY_CHUNK, count - begin);
+        const uint64_t before = stats.mismatches;
+        chunkFn(output + begin, golden + begin, len, atol, rtol, stats);
+        result.checked += len;
+        // Coordinates only for the first k, found by a scalar rescan of the chunks that contain them.
+        const bool wanted = stats.mismatches > before && result.first.size() < config.firstK;
+        for (size_t i = begin; wanted && result.first.size() < config.firstK && i < begin + len; ++i) {
+            if (!IsClose(output[i], golden[i], atol, rtol)) {
+                result.first.push_back(Locate(i, output, golden, layout));
+            }
+        }
+        if (stats.mismatches > budget) {
+            result.earlyExit = result.checked < count;
+            break;
+        }
+    }
+
+    result.mismatches = stats.mismatches;
+    result.maxAbsError = stats.maxAbs;
+    result.maxRelError = stats.maxRel;
+    result.ulpHistogram[0] = result.checked - stats.above[0];
+    for (uint32_t t = 1; t < VERIFY_ULP_BUCKETS - 1U; ++t) {
+        result.ulpHistogram[t] = stats.above[t - 1U] - stats.above[t];
+    }
+    result.ulpHistogram[VERIFY_ULP_BUCKETS - 1U] = stats.above[VERIFY_ULP_BUCKETS - 2U];
+    result.pass = !result.earlyExit && result.mismatches <= allowed;
+    return result;
+}
+
+void ReportVerify(const VerifyResult &result, const VerifyConfig &config)
+{
+    static const char *bucketNames[VERIFY_ULP_BUCKETS] = {"0", "1", "2-3", "4-15", "16-255", "256-65535", ">65535"};
+    const double errorRatio = result.total == 0U ? 0.0 : static_cast<double>(result.mismatches) / result.total;
+    for (const auto &m : result.first) {
+        std::printf("[VERIFY] mismatch index=%llu row=%u col=%u block=%u tile=(%u,%u) expected=%.9f actual=%.9f\n",
+                    static_cast<unsigned long long>(m.index), m.row, m.col, m.block, m.tileM, m.tileN, m.expected,
+                    m.actual);
+    }
+    std::printf("[VERIFY] checked=%llu/%llu mismatches=%llu max_abs=%g max_rel=%g early_exit=%d\n",
+                static_cast<unsigned long long>(result.checked), static_cast<unsigned long long>(result.total),
+                static_cast<unsigned long long>(result.mismatches), result.maxAbsError, result.maxRelError,
+                result.earlyExit ? 1 : 0);
+    std::printf("[VERIFY] ulp");
+    for (uint32_t b = 0; b < VERIFY_ULP_BUCKETS; ++b) {
+        std::printf(" %s:%llu", bucketNames[b], static_cast<unsigned long long>(result.ulpHistogram[b]));
+    }
+    std::printf("\n");
+    std::printf("error ratio: %.4f, tolerance: %.4f\n", errorRatio, config.errorTol);
+    std::printf("%s\n", result.pass ? "test pass" : "[ERROR] result error");
+
+    std::ofstream out(config.jsonPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        ERROR_LOG("Open file failed. path = %s", config.jsonPath);
+        return;
+    }
+    out << "{\"pass\":" << (result.pass ? "true" : "false")
+        << ",\"early_exit\":" << (result.earlyExit ? "true" : "false") << ",\"total\":" << result.total
+        << ",\"checked\":" << result.checked << ",\"mismatches\":" << result.mismatches
+        << ",\"error_ratio\":" << errorRatio << ",\"error_tol\":" << config.errorTol << ",\"rtol\":" << config.rtol
+        << ",\"atol\":" << config.atol << ",\"max_abs_error\":";
+    WriteJsonFloat(out, result.maxAbsError);
+    out << ",\"max_rel_error\":";
+    WriteJsonFloat(out, result.maxRelError);
+    out << ",\n\"ulp_histogram\":{";
+    for (uint32_t b = 0; b < VERIFY_ULP_BUCKETS; ++b) {
+        out << (b == 0U ? "" : ",") << "\"" << bucketNames[b] << "\":" << result.ulpHistogram[b];
+    }
+    out << "},\n\"first_mismatches\":[";
+    for (size_t i = 0; i < result.first.size(); ++i) {
+        const auto &m = result.first[i];
+        out << (i == 0U ? "" : ",") << "\n{\"index\":" << m.index << ",\"row\":" << m.row << ",\"col\":" << m.col
+            << ",\"block\":" << m.block << ",\"tile_m\":" << m.tileM << ",\"tile_n\":" << m.tileN << ",\"expected\":";
+        WriteJsonFloat(out, m.expected);
+        out << ",\"actual\":";
+        WriteJsonFloat(out, m.actual);
+        out << "}";
+    }
+    out << "]}\n";
+}
+
+bool VerifyOutputFiles(const char *outputPath, const char *goldenPath, const VerifyLayout &layout,
+                       const VerifyConfig &config)
+{
+    const size_t bytes = static_cast<size_t>(layout.M) * layout.N * sizeof(float);
+    size_t outputSize = 0;
+    size_t goldenSize = 0;
+    void *output = MapFileRead(outputPath, outputSize);
+    void *golden = MapFileRead(goldenPath, goldenSize);
+    bool pass = false;
+    if (output == nullptr || golden == nullptr || outputSize < bytes || goldenSize < bytes) {
+        ERROR_LOG("verify needs %zu bytes of %s and %s", bytes, outputPath, goldenPath);
+    } else {
+        const VerifyResult result = VerifyOutput(static_cast<const float *>(output), static_cast<const float *>(golden),
+                                                 bytes / sizeof(float), layout, config);
+        ReportVerify(result, config);
+        pass = result.pass;
+    }
+    (void)UnmapFile(output, outputSize, false);
+    (void)UnmapFile(golden, goldenSize, false);
+    return pass;
+}
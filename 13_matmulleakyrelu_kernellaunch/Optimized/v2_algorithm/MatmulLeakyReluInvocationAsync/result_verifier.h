@@ -0,0 +1,93 @@
+/**
+ * @file result_verifier.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef RESULT_VERIFIER_H
+#define RESULT_VERIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+  * @brief  In-process verification of output.bin against golden.bin, enabled by MATMUL_VERIFY=on. Tolerances
+  *         default to those of scripts/verify_result.py: element i matches when
+  *         |out - golden| <= atol + rtol * |golden| (NaN matches NaN), the run passes when at most errorTol of
+  *         the elements mismatch. Verification stops once more than budget elements mismatched, because the
+  *         run can no longer pass.
+  */
+struct VerifyConfig {
+    bool enabled;
+    double rtol;     // MATMUL_VERIFY_RTOL, default 1e-6
+    double atol;     // MATMUL_VERIFY_ATOL, default 1e-9
+    double errorTol; // MATMUL_VERIFY_ERROR_TOL, default 1e-4
+    uint32_t firstK; // MATMUL_VERIFY_FIRST_K mismatches recorded with coordinates, default 16
+    uint64_t budget; // MATMUL_VERIFY_BUDGET, default (0): the most mismatches errorTol still allows
+    const char *jsonPath; // MATMUL_VERIFY_JSON, default ./output/verify.json
+};
+
+VerifyConfig GetVerifyConfig();
+
+/**
+  * @brief  How C was split by the kernel, used to name the block and base tile that wrote a mismatch. Block
+  *         index follows CalcOffset of the kernel: blocks run down M first.
+  */
+struct VerifyLayout {
+    uint32_t M;
+    uint32_t N;
+    uint32_t tilingM; // M the tiling was built for (the bucket M)
+    uint32_t singleCoreM;
+    uint32_t singleCoreN;
+    uint32_t baseM;
+    uint32_t baseN;
+};
+
+struct VerifyMismatch {
+    uint64_t index;
+    uint32_t row;
+    uint32_t col;
+    uint32_t block;
+    uint32_t tileM; // base tile inside the block
+    uint32_t tileN;
+    float expected;
+    float actual;
+};
+
+/**
+  * @brief  ULP distance buckets: 0, 1, 2-3, 4-15, 16-255, 256-65535, larger (sign change or NaN included).
+  */
+constexpr uint32_t VERIFY_ULP_BUCKETS = 7U;
+
+struct VerifyResult {
+    uint64_t total = 0;
+    uint64_t checked = 0; // < total after an early exit
+    uint64_t mismatches = 0;
+    double maxAbsError = 0.0;
+    double maxRelError = 0.0;
+    uint64_t ulpHistogram[VERIFY_ULP_BUCKETS] = {};
+    std::vector<VerifyMismatch> first;
+    bool earlyExit = false;
+    bool pass = false;
+};
+
+VerifyResult VerifyOutput(const float *output, const float *golden, size_t count, const VerifyLayout &layout,
+                          const VerifyConfig &config);
+
+/**
+  * @brief  Print the result (including the "error ratio" / "test pass" lines of verify_result.py, so log parsers
+  *         keep working) and write it as JSON to config.jsonPath.
+  */
+void ReportVerify(const VerifyResult &result, const VerifyConfig &config);
+
+/**
+  * @brief  Map outputPath and goldenPath, verify, report. Returns result.pass, false when a file is unreadable.
+  */
+bool VerifyOutputFiles(const char *outputPath, const char *goldenPath, const VerifyLayout &layout,
+                       const VerifyConfig &config);
+
+#endif // RESULT_VERIFIER_H
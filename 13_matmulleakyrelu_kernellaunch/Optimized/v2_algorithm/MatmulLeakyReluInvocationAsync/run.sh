@@ -20,9 +20,24 @@ CLEAN_BUILD=1
 KERNEL_MSPROF=0
 MSPROF_REPEAT=1
 MSPROF_OUTPUT_DIR=""
+KERNEL_TRACE=OFF
+TILING_MANIFEST=""
+BENCH_ITERS=0
+BENCH_WARMUP=3
+PIPELINE_REQUESTS=0
+PIPELINE_STREAMS=2
+STREAM_CHUNK_MB=0
+STREAM_DEPTH=4
+MMAP_IO=off
+HOST_GOLDEN=off
+VERIFY=off
+SERVICE_REQUESTS=0
+SERVICE_CONNECTIONS=1
+SERVICE_BATCH_US=0
+SWEEP=""
 
 SHORT=r:,v:,i:,b:,p:,d:,m:,n:,k:,t:,c:,M:,N:,Q:,O:,B,R,P
-LONG=run-mode:,soc-version:,install-path:,build-type:,install-prefix:,build-dir:,m:,n:,k:,repeat:,force-core:,force-base-m:,force-base-n:,msprof-repeat:,msprof-output:,build-only,run-only,kernel-msprof,no-clean
+LONG=run-mode:,soc-version:,install-path:,build-type:,install-prefix:,build-dir:,m:,n:,k:,repeat:,force-core:,force-base-m:,force-base-n:,msprof-repeat:,msprof-output:,tiling-manifest:,bench-iters:,bench-warmup:,pipeline-requests:,pipeline-streams:,stream-chunk-mb:,stream-depth:,service-requests:,service-connections:,service-batch-us:,sweep:,build-only,run-only,kernel-msprof,kernel-trace,mmap-io,host-golden,verify,no-clean
 OPTS=$(getopt -a --options $SHORT --longoptions $LONG -- "$@")
 eval set -- "$OPTS"
 # Default to 910B3 as the optimization target platform.
@@ -102,6 +117,66 @@ while :; do
         KERNEL_MSPROF=1
         shift 1
         ;;
+    --mmap-io)
+        MMAP_IO=on
+        shift 1
+        ;;
+    --host-golden)
+        HOST_GOLDEN=on
+        shift 1
+        ;;
+    --verify)
+        VERIFY=on
+        shift 1
+        ;;
+    --kernel-trace)
+        KERNEL_TRACE=ON
+        shift 1
+        ;;
+    --tiling-manifest)
+        TILING_MANIFEST="$(realpath "$2")"
+        shift 2
+        ;;
+    --bench-iters)
+        BENCH_ITERS="$2"
+        shift 2
+        ;;
+    --bench-warmup)
+        BENCH_WARMUP="$2"
+        shift 2
+        ;;
+    --pipeline-requests)
+        PIPELINE_REQUESTS="$2"
+        shift 2
+        ;;
+    --pipeline-streams)
+        PIPELINE_STREAMS="$2"
+        shift 2
+        ;;
+    --stream-chunk-mb)
+        STREAM_CHUNK_MB="$2"
+        shift 2
+        ;;
+    --stream-depth)
+        STREAM_DEPTH="$2"
+        shift 2
+        ;;
+    --service-requests)
+        SERVICE_REQUESTS="$2"
+        shift 2
+        ;;
+    --service-connections)
+        SERVICE_CONNECTIONS="$2"
+        shift 2
+        ;;
+    --service-batch-us)
+        SERVICE_BATCH_US="$2"
+        shift 2
+        ;;
+    --sweep)
+        SWEEP="$(realpath "$2")"
+        shift 2
+        ;;
     --no-clean)
         CLEAN_BUILD=0
         shift 1
@@ -158,9 +233,34 @@ export MATMUL_FORCE_CORE_NUM=${FORCE_CORE}
 export MATMUL_FORCE_BASE_M=${FORCE_BASE_M}
 export MATMUL_FORCE_BASE_N=${FORCE_BASE_N}
 export REPEAT
+export MATMUL_BENCH_ITERS=${BENCH_ITERS}
+export MATMUL_BENCH_WARMUP=${BENCH_WARMUP}
+export MATMUL_PIPELINE_REQUESTS=${PIPELINE_REQUESTS}
+export MATMUL_PIPELINE_STREAMS=${PIPELINE_STREAMS}
+export MATMUL_STREAM_CHUNK_MB=${STREAM_CHUNK_MB}
+export MATMUL_STREAM_DEPTH=${STREAM_DEPTH}
+export MATMUL_MMAP_IO=${MMAP_IO}
+export MATMUL_HOST_GOLDEN=${HOST_GOLDEN}
+export MATMUL_VERIFY=${VERIFY}
+export MATMUL_SERVICE_BATCH_US=${SERVICE_BATCH_US}
 echo "[INFO]: Current compile soc version is ${SOC_VERSION}"
 echo "[INFO]: Shape M=${MATMUL_M}, N=${MATMUL_N}, K=${MATMUL_K}, repeat=${REPEAT}, force_core=${FORCE_CORE}"
 echo "[INFO]: force_base_m=${FORCE_BASE_M}, force_base_n=${FORCE_BASE_N}"
+if [[ "${BENCH_ITERS}" -gt 0 ]]; then
+    echo "[INFO]: In-process benchmark, warmup=${BENCH_WARMUP}, iterations=${BENCH_ITERS}"
+fi
+if [[ "${PIPELINE_REQUESTS}" -gt 0 ]]; then
+    echo "[INFO]: Pipelined mode, requests=${PIPELINE_REQUESTS}, streams=${PIPELINE_STREAMS}"
+fi
+if [[ "${STREAM_CHUNK_MB}" -gt 0 ]]; then
+    echo "[INFO]: Chunked input loading, chunk=${STREAM_CHUNK_MB}MiB, depth=${STREAM_DEPTH}"
+fi
+if [[ "${SERVICE_REQUESTS}" -gt 0 ]]; then
+    echo "[INFO]: Service mode, requests=${SERVICE_REQUESTS}, connections=${SERVICE_CONNECTIONS}, batch_us=${SERVICE_BATCH_US}"
+fi
+if [[ -n "${SWEEP}" ]]; then
+    echo "[INFO]: Sweep mode, spec=${SWEEP}"
+fi
 echo "[INFO]: Build dir=${BUILD_DIR}, install dir=${INSTALL_PREFIX}"
 if [[ "${KERNEL_MSPROF}" -eq 1 ]]; then
     echo "[INFO]: Kernel msprof enabled, msprof_repeat=${MSPROF_REPEAT}, msprof_output=${MSPROF_OUTPUT_DIR:-auto}"
@@ -185,7 +285,9 @@ if [[ "${RUN_ONLY}" -ne 1 ]]; then
         -DSOC_VERSION=${SOC_VERSION} \
         -DCMAKE_BUILD_TYPE=${BUILD_TYPE} \
         -DCMAKE_INSTALL_PREFIX=${INSTALL_PREFIX} \
-        -DASCEND_CANN_PACKAGE_PATH=${_ASCEND_INSTALL_PATH}
+        -DASCEND_CANN_PACKAGE_PATH=${_ASCEND_INSTALL_PATH} \
+        -DKERNEL_TRACE=${KERNEL_TRACE} \
+        -DMATMUL_TILING_MANIFEST="${TILING_MANIFEST}"
     cmake --build "${BUILD_DIR}" -j
     cmake --install "${BUILD_DIR}"
 fi
@@ -206,7 +308,10 @@ fi
 cp "${BIN_PATH}" ./
 rm -rf input output
 mkdir -p input output
-python3 scripts/gen_data.py
+# --sweep generates the inputs of every shape inside the binary.
+if [[ -z "${SWEEP}" ]]; then
+    python3 scripts/gen_data.py
+fi
 (
     export LD_LIBRARY_PATH=${LIB_PATH_1}:${LIB_PATH_2}:${_ASCEND_INSTALL_PATH}/lib64:$LD_LIBRARY_PATH
     if [[ "${RUN_WITH_TOOLCHAIN:-0}" -eq 1 ]]; then
@@ -217,6 +322,28 @@ python3 scripts/gen_data.py
         elif [ "${RUN_MODE}" = "cpu" ]; then
             ./ascendc_kernels_bbit
         fi
+    elif [[ -n "${SWEEP}" ]]; then
+        # Every case of the spec in one process, results in output/sweep.csv.
+        MATMUL_SWEEP="${SWEEP}" ./ascendc_kernels_bbit
+    elif [[ "${BENCH_ITERS}" -gt 0 || "${PIPELINE_REQUESTS}" -gt 0 ]]; then
+        # Timing happens inside the binary, see output/bench.json and output/pipeline.json.
+        ./ascendc_kernels_bbit
+    elif [[ "${SERVICE_REQUESTS}" -gt 0 ]]; then
+        # One warm service process, the requests come from matmul_client, which also verifies the result.
+        SERVICE_SOCKET="${CURRENT_DIR}/output/matmul_service.sock"
+        MATMUL_SERVICE="${SERVICE_SOCKET}" ./ascendc_kernels_bbit &
+        SERVICE_PID=$!
+        WAIT=0
+        while [[ ! -S "${SERVICE_SOCKET}" && "${WAIT}" -lt 300 ]]; do
+            sleep 0.1
+            WAIT=$((WAIT + 1))
+        done
+        CLIENT_STATUS=0
+        "${INSTALL_PREFIX}/bin/matmul_client" "${SERVICE_SOCKET}" gemm ${MATMUL_M} ${MATMUL_N} ${MATMUL_K} \
+            ${SERVICE_REQUESTS} ${SERVICE_CONNECTIONS} || CLIENT_STATUS=$?
+        "${INSTALL_PREFIX}/bin/matmul_client" "${SERVICE_SOCKET}" shutdown || kill ${SERVICE_PID}
+        wait ${SERVICE_PID}
+        exit ${CLIENT_STATUS}
     else
         python3 - << 'PY'
 import math
@@ -284,5 +411,13 @@ PY
 if [ "${RUN_MODE}" = "sim" ]; then
     rm -f *.log *.dump *.vcd *.toml *_log
 fi
+# --service-requests: matmul_client verified the result itself and output.bin is not written.
+# --sweep: every case was verified in process.
+if [[ "${SERVICE_REQUESTS}" -gt 0 || -n "${SWEEP}" ]]; then
+    exit 0
+fi
 md5sum output/*.bin
-python3 scripts/verify_result.py output/output.bin output/golden.bin
+# --verify: the binary already compared output.bin with golden.bin and printed the same result lines.
+if [[ "${VERIFY}" != "on" ]]; then
+    python3 scripts/verify_result.py output/output.bin output/golden.bin
+fi
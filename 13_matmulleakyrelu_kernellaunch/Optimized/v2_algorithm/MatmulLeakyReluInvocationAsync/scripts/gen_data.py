@@ -29,15 +29,19 @@ def gen_golden_data_simple():
     input_b = rng.integers(1, 10, [k, n], dtype=np.int32).astype(np.float16)
     input_bias = rng.integers(1, 10, [n], dtype=np.int32).astype(np.float32)
 
-    alpha = 0.001
-    golden = (np.matmul(input_a.astype(np.float32), input_b.astype(np.float32)) + input_bias).astype(np.float32)
-    golden = np.where(golden >= 0, golden, golden * alpha)
-
     os.system("mkdir -p input")
     os.system("mkdir -p output")
     input_a.tofile("./input/x1_gm.bin")
     input_b.tofile("./input/x2_gm.bin")
     input_bias.tofile("./input/bias.bin")
+
+    # MATMUL_HOST_GOLDEN=on: the executable writes golden.bin with its C++ reference GEMM.
+    if os.getenv("MATMUL_HOST_GOLDEN", "off") == "on":
+        return
+
+    alpha = 0.001
+    golden = (np.matmul(input_a.astype(np.float32), input_b.astype(np.float32)) + input_bias).astype(np.float32)
+    golden = np.where(golden >= 0, golden, golden * alpha)
     golden.tofile("./output/golden.bin")
 
 
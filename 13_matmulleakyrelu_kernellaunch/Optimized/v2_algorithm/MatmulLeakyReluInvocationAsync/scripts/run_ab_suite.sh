@@ -14,7 +14,6 @@ RUN_MODE="${RUN_MODE:-npu}"
 SOC_VERSION="${SOC_VERSION:-Ascend910B3}"
 BUILD_DIR="${BUILD_DIR:-/tmp/matmul_v2_ab_build}"
 INSTALL_PREFIX="${INSTALL_PREFIX:-/tmp/matmul_v2_ab_out}"
-MATMUL_ADAPTIVE_MAX_CORE="${MATMUL_ADAPTIVE_MAX_CORE:-4}"
 DO_BUILD="${DO_BUILD:-1}"
 
 S3_REPEAT="${S3_REPEAT:-5}"
@@ -54,8 +53,7 @@ run_case() {
     local log_file="${LOG_DIR}/${tag}.log"
 
     echo "[INFO] ${shape} group=${group} core=${force_core} repeat=${repeat}"
-    MATMUL_ADAPTIVE_MAX_CORE="${MATMUL_ADAPTIVE_MAX_CORE}" \
-        bash run.sh -r "${RUN_MODE}" -v "${SOC_VERSION}" \
+    bash run.sh -r "${RUN_MODE}" -v "${SOC_VERSION}" \
         -d "${BUILD_DIR}" -p "${INSTALL_PREFIX}" \
         --m "${m}" --n "${n}" --k "${k}" \
         --repeat "${repeat}" --force-core "${force_core}" --run-only \
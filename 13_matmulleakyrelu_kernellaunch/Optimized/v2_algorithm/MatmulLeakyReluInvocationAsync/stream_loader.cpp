@@ -0,0 +1,252 @@
+/**
+ * @file stream_loader.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "stream_loader.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "env_config.h"
+
+#ifndef ASCENDC_CPU_DEBUG
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "acl_mem_pool.h"
+#include "bench_stats.h"
+#include "data_utils.h"
+#endif
+
+StreamLoadConfig GetStreamLoadConfig()
+{
+    StreamLoadConfig config = {static_cast<size_t>(GetEnvU32("MATMUL_STREAM_CHUNK_MB", 0U)) << 20,
+                               GetEnvU32("MATMUL_STREAM_DEPTH", 4U)};
+    if (config.depth < 2U) {
+        config.depth = 2U;
+    }
+    return config;
+}
+
+#ifndef ASCENDC_CPU_DEBUG
+namespace {
+
+struct ChunkSlot {
+    uint8_t *host = nullptr;
+    size_t offset = 0;
+    size_t bytes = 0;
+    aclrtEvent copyStart = nullptr;
+    aclrtEvent copyEnd = nullptr;
+};
+
+/**
+ * @brief Hand-off between the reader thread and the uploader: slots cycle free -> ready (filled by the reader)
+ *        -> in flight (copy issued) -> free (copy event completed).
+ */
+class ChunkRing {
+public:
+    explicit ChunkRing(uint32_t depth)
+    {
+        for (uint32_t i = 0; i < depth; ++i) {
+            free_.push_back(i);
+        }
+    }
+
+    bool AcquireFree(uint32_t &slot)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !free_.empty() || aborted_; });
+        if (aborted_) {
+            return false;
+        }
+        slot = free_.front();
+        free_.pop_front();
+        return true;
+    }
+
+    void Release(uint32_t slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(slot);
+        cv_.notify_all();
+    }
+
+    void PushReady(uint32_t slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(slot);
+        cv_.notify_all();
+    }
+
+    // Non-blocking: the uploader retires in-flight copies instead of sleeping when nothing is ready.
+    bool TryPopReady(uint32_t &slot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ready_.empty()) {
+            return false;
+        }
+        slot = ready_.front();
+        ready_.pop_front();
+        return true;
+    }
+
+    bool WaitReady(uint32_t &slot)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !ready_.empty() || finished_ || aborted_; });
+        if (ready_.empty()) {
+            return false;
+        }
+        slot = ready_.front();
+        ready_.pop_front();
+        return true;
+    }
+
+    void Finish(bool ok)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        aborted_ = aborted_ || !ok;
+        cv_.notify_all();
+    }
+
+    bool Aborted()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return aborted_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<uint32_t> free_;
+    std::deque<uint32_t> ready_;
+    bool finished_ = false;
+    bool aborted_ = false;
+};
+
+} // namespace
+
+bool StreamFileToDevice(const std::string &filePath, void *device, size_t size, aclrtStream stream,
+                        const StreamLoadConfig &config, uint8_t *hostMirror, StreamLoadStats *stats)
+{
+    const double begin = HostNowUs();
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        ERROR_LOG("Open file failed. path = %s", filePath.c_str());
+        return false;
+    }
+    if (static_cast<size_t>(file.tellg()) < size) {
+        ERROR_LOG("file %s is shorter than %zu bytes", filePath.c_str(), size);
+        return false;
+    }
+    file.seekg(0, std::ios::beg);
+
+    const size_t chunkBytes = config.chunkBytes == 0U ? size : config.chunkBytes;
+    auto &pool = AclMemPool::Instance();
+    std::vector<ChunkSlot> slots(config.depth);
+    for (auto &slot : slots) {
+        if (hostMirror == nullptr) {
+            CHECK_ACL(pool.Malloc((void **)&slot.host, chunkBytes, AclMemKind::HOST));
+        }
+        CHECK_ACL(aclrtCreateEvent(&slot.copyStart));
+        CHECK_ACL(aclrtCreateEvent(&slot.copyEnd));
+    }
+
+    ChunkRing ring(config.depth);
+    double readUs = 0.0;
+    std::thread reader([&] {
+        for (size_t offset = 0; offset < size; offset += chunkBytes) {
+            uint32_t index = 0;
+            if (!ring.AcquireFree(index)) {
+                return;
+            }
+            ChunkSlot &slot = slots[index];
+            slot.offset = offset;
+            slot.bytes = std::min(chunkBytes, size - offset);
+            uint8_t *target = hostMirror == nullptr ? slot.host : hostMirror + offset;
+            const double readBegin = HostNowUs();
+            file.read(reinterpret_cast<char *>(target), static_cast<std::streamsize>(slot.bytes));
+            readUs += HostNowUs() - readBegin;
+            if (!file) {
+                ERROR_LOG("read %s failed at offset %zu", filePath.c_str(), offset);
+                ring.Finish(false);
+                return;
+            }
+            ring.PushReady(index);
+        }
+        ring.Finish(true);
+    });
+
+    StreamLoadStats local;
+    std::deque<uint32_t> inFlight;
+    auto retire = [&]() {
+        ChunkSlot &slot = slots[inFlight.front()];
+        CHECK_ACL(aclrtSynchronizeEvent(slot.copyEnd));
+        float ms = 0.0f;
+        CHECK_ACL(aclrtEventElapsedTime(&ms, slot.copyStart, slot.copyEnd));
+        local.h2dUs += static_cast<double>(ms) * 1000.0;
+        ring.Release(inFlight.front());
+        inFlight.pop_front();
+    };
+    while (true) {
+        uint32_t index = 0;
+        if (!ring.TryPopReady(index)) {
+            // Nothing to upload yet: free a slot for the reader if one is busy, otherwise block.
+            if (!inFlight.empty()) {
+                retire();
+                continue;
+            }
+            if (!ring.WaitReady(index)) {
+                break;
+            }
+        }
+        ChunkSlot &slot = slots[index];
+        const uint8_t *source = hostMirror == nullptr ? slot.host : hostMirror + slot.offset;
+        CHECK_ACL(aclrtRecordEvent(slot.copyStart, stream));
+        CHECK_ACL(aclrtMemcpyAsync(static_cast<uint8_t *>(device) + slot.offset, slot.bytes, source, slot.bytes,
+                                   ACL_MEMCPY_HOST_TO_DEVICE, stream));
+        CHECK_ACL(aclrtRecordEvent(slot.copyEnd, stream));
+        inFlight.push_back(index);
+        local.bytes += slot.bytes;
+        ++local.chunks;
+    }
+    while (!inFlight.empty()) {
+        retire();
+    }
+    reader.join();
+    local.readUs = readUs;
+    local.wallUs = HostNowUs() - begin;
+
+    for (auto &slot : slots) {
+        CHECK_ACL(aclrtDestroyEvent(slot.copyStart));
+        CHECK_ACL(aclrtDestroyEvent(slot.copyEnd));
+        CHECK_ACL(pool.Free(slot.host));
+    }
+    if (stats != nullptr) {
+        *stats = local;
+    }
+    return !ring.Aborted() && local.bytes == size;
+}
+
+void ReportStreamLoad(const std::string &filePath, const StreamLoadConfig &config, const StreamLoadStats &stats)
+{
+    // bytes / us = MB/s, / 1e3 for GB/s.
+    auto gbps = [&stats](double us) { return us > 0.0 ? stats.bytes / us / 1e3 : 0.0; };
+    std::printf("[LOADER] %s bytes=%zu chunks=%u chunk_mb=%zu depth=%u read_gbps=%.2f h2d_gbps=%.2f wall_gbps=%.2f "
+                "overlap=%.2f\n",
+                filePath.c_str(), stats.bytes, stats.chunks, config.chunkBytes >> 20, config.depth, gbps(stats.readUs),
+                gbps(stats.h2dUs), gbps(stats.wallUs),
+                stats.wallUs > 0.0 ? (stats.readUs + stats.h2dUs) / stats.wallUs : 0.0);
+}
+#endif
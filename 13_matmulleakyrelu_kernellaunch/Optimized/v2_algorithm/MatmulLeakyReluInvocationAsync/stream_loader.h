@@ -0,0 +1,57 @@
+/**
+ * @file stream_loader.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef STREAM_LOADER_H
+#define STREAM_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+  * @brief  Chunked input loading: MATMUL_STREAM_CHUNK_MB (0, the default, keeps ReadFile + one aclrtMemcpy)
+  *         and MATMUL_STREAM_DEPTH pinned chunk buffers in the ring (default 4, at least 2).
+  */
+struct StreamLoadConfig {
+    size_t chunkBytes;
+    uint32_t depth;
+};
+
+StreamLoadConfig GetStreamLoadConfig();
+
+struct StreamLoadStats {
+    size_t bytes = 0;
+    uint32_t chunks = 0;
+    double readUs = 0.0; // reader thread busy in file reads
+    double h2dUs = 0.0;  // sum of per-chunk copy times measured by device events
+    double wallUs = 0.0; // open to last chunk on the device
+};
+
+#ifndef ASCENDC_CPU_DEBUG
+#include "acl/acl.h"
+
+/**
+  * @brief  Upload size bytes of filePath to device memory without staging the whole file on the host. A reader
+  *         thread reads chunkBytes pieces into a ring of depth pinned buffers while the calling thread issues
+  *         one aclrtMemcpyAsync per chunk on stream, so disk read and DMA overlap. A ring buffer is reused
+  *         only after the event recorded behind its copy completed. Returns after the last chunk landed.
+  * @param  hostMirror: optional pinned buffer of size bytes that also keeps the file contents; chunks are
+  *         then read straight into it and the ring is not allocated.
+  * @return false when the file is missing or shorter than size.
+  */
+bool StreamFileToDevice(const std::string &filePath, void *device, size_t size, aclrtStream stream,
+                        const StreamLoadConfig &config, uint8_t *hostMirror, StreamLoadStats *stats);
+
+/**
+  * @brief  Print the per-stage throughput of one load as a [LOADER] line.
+  */
+void ReportStreamLoad(const std::string &filePath, const StreamLoadConfig &config, const StreamLoadStats &stats);
+#endif
+
+#endif // STREAM_LOADER_H
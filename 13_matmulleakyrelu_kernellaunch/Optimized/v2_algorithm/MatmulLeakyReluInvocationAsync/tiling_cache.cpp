@@ -0,0 +1,277 @@
+/**
+ * @file tiling_cache.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "tiling_cache.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "kernel_tiling/kernel_tiling.h"
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x434C544DU; // "MTLC"
+constexpr uint32_t CACHE_FORMAT_VERSION = 1U;
+constexpr uint32_t CACHE_SLOT_COUNT = 4096U; // power of two
+constexpr uint32_t CACHE_MAX_PROBE = 16U;
+constexpr uint32_t CACHE_MAX_PAYLOAD = 512U;
+constexpr uint32_t CACHE_SOC_LEN = 32U;
+constexpr uint32_t SLOT_EMPTY = 0U;
+constexpr uint32_t SLOT_VALID = 1U;
+
+struct FileHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint32_t codeVersion;
+    uint32_t payloadSize;
+    uint32_t slotCount;
+    uint32_t reserved[3];
+};
+
+class FileLock {
+public:
+    explicit FileLock(int fd) : fd_(fd)
+    {
+        (void)flock(fd_, LOCK_EX);
+    }
+    ~FileLock()
+    {
+        (void)flock(fd_, LOCK_UN);
+    }
+
+private:
+    int fd_;
+};
+
+std::string DefaultCachePath()
+{
+    const char *home = std::getenv("HOME");
+    if (home == nullptr) {
+        return "";
+    }
+    const std::string dir = std::string(home) + "/.cache";
+    (void)mkdir(dir.c_str(), 0755);
+    return dir + "/matmul_tiling.cache";
+}
+
+} // namespace
+
+struct TilingCache::Slot {
+    uint32_t state;
+    uint32_t reserved;
+    uint64_t hash;
+    char soc[CACHE_SOC_LEN];
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t aDtype;
+    uint32_t bDtype;
+    uint32_t preferredCoreNum;
+    uint8_t payload[CACHE_MAX_PAYLOAD];
+};
+
+TilingCache &TilingCache::Instance()
+{
+    static TilingCache cache([]() {
+        const char *path = std::getenv("MATMUL_TILING_CACHE");
+        if (path == nullptr) {
+            return DefaultCachePath();
+        }
+        return std::strcmp(path, "off") == 0 ? std::string() : std::string(path);
+    }(), static_cast<uint32_t>(sizeof(TCubeTiling)));
+    return cache;
+}
+
+/**
+  * @brief  Versions are part of the file name (<path>.f<format>.c<code>.p<payload>), so processes built from
+  *         different tiling code never share a table. A file that is missing, truncated or carries a foreign
+  *         header is replaced by a freshly initialized one through rename(): processes that still map the old
+  *         file keep reading an unchanged table, the live mapping is never rewritten.
+  */
+TilingCache::TilingCache(const std::string &path, uint32_t payloadSize) : payloadSize_(payloadSize)
+{
+    if (path.empty() || payloadSize > CACHE_MAX_PAYLOAD) {
+        return;
+    }
+    const std::string file = path + ".f" + std::to_string(CACHE_FORMAT_VERSION) + ".c" +
+                             std::to_string(TILING_CODE_VERSION) + ".p" + std::to_string(payloadSize);
+    mapSize_ = sizeof(FileHeader) + static_cast<size_t>(CACHE_SLOT_COUNT) * sizeof(Slot);
+    if (!MapExisting(file)) {
+        MapFresh(file);
+    }
+}
+
+bool TilingCache::HeaderValid(const uint8_t *base) const
+{
+    const auto *header = reinterpret_cast<const FileHeader *>(base);
+    return __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == CACHE_MAGIC &&
+           header->formatVersion == CACHE_FORMAT_VERSION && header->codeVersion == TILING_CODE_VERSION &&
+           header->payloadSize == payloadSize_ && header->slotCount == CACHE_SLOT_COUNT;
+}
+
+bool TilingCache::MapExisting(const std::string &file)
+{
+    const int fd = open(file.c_str(), O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void *addr = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) == mapSize_) {
+        addr = mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (addr == MAP_FAILED || !HeaderValid(static_cast<uint8_t *>(addr))) {
+        if (addr != MAP_FAILED) {
+            (void)munmap(addr, mapSize_);
+        }
+        (void)close(fd);
+        return false;
+    }
+    fd_ = fd;
+    base_ = static_cast<uint8_t *>(addr);
+    return true;
+}
+
+void TilingCache::MapFresh(const std::string &file)
+{
+    // Build the whole table in a private file first; rename() publishes it atomically.
+    const std::string tmp = file + ".tmp." + std::to_string(getpid());
+    const int fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "[WARN] tiling cache disabled, open " << tmp << " failed" << std::endl;
+        return;
+    }
+    void *addr = ftruncate(fd, mapSize_) == 0 ? mmap(nullptr, mapSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) :
+                                                MAP_FAILED;
+    if (addr == MAP_FAILED) {
+        std::cerr << "[WARN] tiling cache disabled, create " << tmp << " failed" << std::endl;
+        (void)close(fd);
+        (void)unlink(tmp.c_str());
+        return;
+    }
+    auto *header = static_cast<FileHeader *>(addr);
+    header->formatVersion = CACHE_FORMAT_VERSION;
+    header->codeVersion = TILING_CODE_VERSION;
+    header->payloadSize = payloadSize_;
+    header->slotCount = CACHE_SLOT_COUNT;
+    header->magic = CACHE_MAGIC;
+    if (rename(tmp.c_str(), file.c_str()) != 0) {
+        std::cerr << "[WARN] tiling cache disabled, publish " << file << " failed" << std::endl;
+        (void)munmap(addr, mapSize_);
+        (void)close(fd);
+        (void)unlink(tmp.c_str());
+        return;
+    }
+    // Two processes racing here each publish an empty table; the loser keeps an unlinked copy for its lifetime.
+    fd_ = fd;
+    base_ = static_cast<uint8_t *>(addr);
+}
+
+TilingCache::~TilingCache()
+{
+    if (base_ != nullptr) {
+        (void)munmap(base_, mapSize_);
+    }
+    if (fd_ >= 0) {
+        (void)close(fd_);
+    }
+}
+
+uint64_t TilingCache::Hash(const TilingCacheKey &key) const
+{
+    uint64_t hash = 1469598103934665603ULL; // FNV-1a
+    auto mix = [&hash](const void *data, size_t size) {
+        const auto *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    mix(key.socVersion, std::strlen(key.socVersion));
+    const uint32_t fields[] = {key.M, key.N, key.K, key.aDtype, key.bDtype, key.preferredCoreNum, TILING_CODE_VERSION};
+    mix(fields, sizeof(fields));
+    return hash;
+}
+
+bool TilingCache::Matches(const Slot &slot, uint64_t hash, const TilingCacheKey &key) const
+{
+    return slot.hash == hash && slot.M == key.M && slot.N == key.N && slot.K == key.K && slot.aDtype == key.aDtype &&
+           slot.bDtype == key.bDtype && slot.preferredCoreNum == key.preferredCoreNum &&
+           std::strncmp(slot.soc, key.socVersion, CACHE_SOC_LEN) == 0;
+}
+
+TilingCache::Slot *TilingCache::SlotAt(uint32_t index) const
+{
+    return reinterpret_cast<Slot *>(base_ + sizeof(FileHeader)) + (index & (CACHE_SLOT_COUNT - 1U));
+}
+
+/**
+  * @brief  Copy the cached tiling for key into payload.
+  * @retval true on hit.
+  */
+bool TilingCache::Lookup(const TilingCacheKey &key, uint8_t *payload, uint32_t payloadSize) const
+{
+    if (base_ == nullptr || payloadSize != payloadSize_ || std::strlen(key.socVersion) >= CACHE_SOC_LEN) {
+        return false;
+    }
+    const uint64_t hash = Hash(key);
+    for (uint32_t probe = 0; probe < CACHE_MAX_PROBE; ++probe) {
+        const Slot *slot = SlotAt(static_cast<uint32_t>(hash) + probe);
+        if (__atomic_load_n(&slot->state, __ATOMIC_ACQUIRE) == SLOT_EMPTY) {
+            return false;
+        }
+        if (Matches(*slot, hash, key)) {
+            std::memcpy(payload, slot->payload, payloadSize);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+  * @brief  Publish a tiling for key. Existing entries are never rewritten, so lock-free readers see
+  *         either an empty slot or a complete one.
+  * @retval true if the entry is in the cache afterwards.
+  */
+bool TilingCache::Store(const TilingCacheKey &key, const uint8_t *payload, uint32_t payloadSize)
+{
+    if (base_ == nullptr || payloadSize != payloadSize_ || std::strlen(key.socVersion) >= CACHE_SOC_LEN) {
+        return false;
+    }
+    const uint64_t hash = Hash(key);
+    std::lock_guard<std::mutex> threadLock(storeMutex_);
+    FileLock lock(fd_);
+    for (uint32_t probe = 0; probe < CACHE_MAX_PROBE; ++probe) {
+        Slot *slot = SlotAt(static_cast<uint32_t>(hash) + probe);
+        if (slot->state == SLOT_EMPTY) {
+            slot->hash = hash;
+            std::memcpy(slot->soc, key.socVersion, std::strlen(key.socVersion) + 1U);
+            slot->M = key.M;
+            slot->N = key.N;
+            slot->K = key.K;
+            slot->aDtype = key.aDtype;
+            slot->bDtype = key.bDtype;
+            slot->preferredCoreNum = key.preferredCoreNum;
+            std::memcpy(slot->payload, payload, payloadSize);
+            __atomic_store_n(&slot->state, SLOT_VALID, __ATOMIC_RELEASE);
+            return true;
+        }
+        if (Matches(*slot, hash, key)) {
+            return true;
+        }
+    }
+    return false; // probe window full, the caller just searches next time.
+}
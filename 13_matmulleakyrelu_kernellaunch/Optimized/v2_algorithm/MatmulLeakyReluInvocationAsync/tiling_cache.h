@@ -0,0 +1,75 @@
+/**
+ * @file tiling_cache.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef TILING_CACHE_H
+#define TILING_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Bump whenever GenerateTiling can produce a different tiling for the same key.
+constexpr uint32_t TILING_CODE_VERSION = 3U;
+
+struct TilingCacheKey {
+    const char *socVersion;
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t aDtype;
+    uint32_t bDtype;
+    uint32_t preferredCoreNum;
+};
+
+/**
+  * @brief  Versioned tiling cache in a memory-mapped file shared by all processes on the host.
+  *         The file is a fixed-size open-addressing hash table, so lookups never take a lock and
+  *         cost one probe in the common case. Inserts serialize on flock across processes and on a
+  *         mutex across threads of one process (flock does not exclude threads sharing the fd).
+  *         The format, code version and payload size are part of the file name; a damaged file is
+  *         replaced by a new one, never reset in place, since other processes read it without locks.
+  */
+class TilingCache {
+public:
+    /**
+      * @brief  Process-wide cache bound to MATMUL_TILING_CACHE (default ~/.cache/matmul_tiling.cache,
+      *         "off" disables it).
+      */
+    static TilingCache &Instance();
+
+    TilingCache(const std::string &path, uint32_t payloadSize);
+    ~TilingCache();
+    TilingCache(const TilingCache &) = delete;
+    TilingCache &operator=(const TilingCache &) = delete;
+
+    bool Enabled() const
+    {
+        return base_ != nullptr;
+    }
+    bool Lookup(const TilingCacheKey &key, uint8_t *payload, uint32_t payloadSize) const;
+    bool Store(const TilingCacheKey &key, const uint8_t *payload, uint32_t payloadSize);
+
+private:
+    struct Slot;
+    bool HeaderValid(const uint8_t *base) const;
+    bool MapExisting(const std::string &file);
+    void MapFresh(const std::string &file);
+    uint64_t Hash(const TilingCacheKey &key) const;
+    bool Matches(const Slot &slot, uint64_t hash, const TilingCacheKey &key) const;
+    Slot *SlotAt(uint32_t index) const;
+
+    int fd_ = -1;
+    uint8_t *base_ = nullptr;
+    size_t mapSize_ = 0;
+    uint32_t payloadSize_ = 0;
+    std::mutex storeMutex_;
+};
+
+#endif // TILING_CACHE_H
@@ -0,0 +1,165 @@
+/**
+ * @file tiling_emulator.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "kernel_tiling/kernel_tiling.h"
+#include "matmul_shape_bucket.h"
+#include "matmul_tiling_table.h"
+#include "tiling/platform/platform_ascendc.h"
+#include "tiling_emulator.h"
+
+extern bool GenerateTiling(const char *socVersion, uint8_t *tilingBuf, uint32_t M, uint32_t N, uint32_t K,
+                           uint32_t preferredCoreNum);
+
+namespace {
+
+uint32_t ParseU32(const char *value)
+{
+    return static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+}
+
+uint32_t ParseElemBytes(const char *dtype)
+{
+    if (std::strcmp(dtype, "fp32") == 0) {
+        return 4U;
+    }
+    return std::strcmp(dtype, "int8") == 0 ? 1U : 2U;
+}
+
+bool Report(const TilingEmuReport &report)
+{
+    report.Print();
+    return report.Ok();
+}
+
+/**
+  * @brief  Tiling of M as main.cpp builds it: searched for the bucket of M, rows past M masked.
+  */
+bool EmulateMatmulShape(uint32_t M, uint32_t N, uint32_t K, uint32_t coreNum, uint64_t ubBytes)
+{
+    MatmulLeakyLaunchTiling launch = {};
+    uint32_t bucketM = MatmulShapeBuckets::Global().Bucket(M);
+    bool ok = GenerateTiling(SOC_VERSION, reinterpret_cast<uint8_t *>(&launch), bucketM, N, K, coreNum);
+    if (!ok && bucketM != M) {
+        bucketM = M;
+        ok = GenerateTiling(SOC_VERSION, reinterpret_cast<uint8_t *>(&launch), bucketM, N, K, coreNum);
+    }
+    if (!ok) {
+        std::printf("[EMU] no tiling for M=%u N=%u K=%u\n", M, N, K);
+        return false;
+    }
+    std::printf("[EMU] M=%u N=%u K=%u bucketM=%u usedCore=%d singleCoreM=%d singleCoreN=%d baseM=%d baseN=%d "
+                "iterateOrder=%d\n",
+                M, N, K, bucketM, launch.cube.usedCoreNum, launch.cube.singleCoreM, launch.cube.singleCoreN,
+                launch.cube.baseM, launch.cube.baseN, launch.cube.iterateOrder);
+    return Report(EmulateMatmulLeakyRelu(launch.cube, MatmulEmuKernel::LAUNCH_13_V2, M, ubBytes));
+}
+
+/**
+  * @brief  Blob written by MATMUL_TILING_DUMP (MatmulLeakyLaunchTiling) or a bare TCubeTiling.
+  */
+bool EmulateMatmulBlob(const char *path, uint32_t validM, MatmulEmuKernel kernel, uint64_t ubBytes)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (bytes.size() < sizeof(TCubeTiling)) {
+        std::fprintf(stderr, "[ERROR] %s holds %zu bytes, a TCubeTiling needs %zu\n", path, bytes.size(),
+                     sizeof(TCubeTiling));
+        return false;
+    }
+    MatmulLeakyLaunchTiling launch = {};
+    std::memcpy(&launch, bytes.data(), std::min(bytes.size(), sizeof(launch)));
+    if (validM == 0U) {
+        validM = launch.validM;
+    }
+    return Report(EmulateMatmulLeakyRelu(launch.cube, kernel, validM, ubBytes));
+}
+
+} // namespace
+
+/**
+  * @brief  Host replay of the kernel copy loops, see tiling_emulator.h. Exit status is 0 when every check passes.
+  */
+int32_t main(int32_t argc, char *argv[])
+{
+    if (argc < 3) {
+        std::fprintf(stderr,
+                     "usage: %s matmul <M> <N> <K> [coreNum]\n"
+                     "       %s matmul-manifest <shape manifest>\n"
+                     "       %s matmul-blob <tiling.bin> [validM] [12]\n"
+                     "       %s reduce <totalLength> [fp32|fp16]\n"
+                     "       %s wholereduce <rows> <cols> [blockDim]\n"
+                     "       %s broadcast <d0[,d1]> <axis> <num> [fp16|fp32|int8] [blockDim] [tmpSize]\n",
+                     argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+    auto platform = platform_ascendc::PlatformAscendCManager::GetInstance(SOC_VERSION);
+    uint64_t ubBytes = 0;
+    platform->GetCoreMemSize(platform_ascendc::CoreMemType::UB, ubBytes);
+    const std::string mode = argv[1];
+    bool ok = false;
+    if (mode == "matmul" && argc >= 5) {
+        ok = EmulateMatmulShape(ParseU32(argv[2]), ParseU32(argv[3]), ParseU32(argv[4]),
+                                argc > 5 ? ParseU32(argv[5]) : 0U, ubBytes);
+    } else if (mode == "matmul-manifest") {
+        std::vector<MatmulTilingTableKey> keys = LoadMatmulShapeManifest(argv[2], ok);
+        if (!ok) {
+            std::fprintf(stderr, "[ERROR] cannot parse shape manifest %s\n", argv[2]);
+            return 1;
+        }
+        uint32_t failed = 0;
+        for (const auto &key : keys) {
+            failed += (key.abElemSize == 2U && !EmulateMatmulShape(key.M, key.N, key.K, 0U, ubBytes)) ? 1U : 0U;
+        }
+        std::printf("[EMU] %zu shapes, %u failed\n", keys.size(), failed);
+        ok = failed == 0U;
+    } else if (mode == "matmul-blob") {
+        const bool framework = argc > 4 && std::strcmp(argv[4], "12") == 0;
+        ok = EmulateMatmulBlob(argv[2], argc > 3 ? ParseU32(argv[3]) : 0U,
+                               framework ? MatmulEmuKernel::FRAMEWORK_12 : MatmulEmuKernel::LAUNCH_13_V2, ubBytes);
+    } else if (mode == "reduce") {
+        const uint32_t totalLength = ParseU32(argv[2]);
+        const uint32_t elemBytes = argc > 3 ? ParseElemBytes(argv[3]) : 4U;
+        // OUT_SHAPE of the 14 op_host.
+        ok = Report(EmulateReduce(totalLength, 32U, ReduceTilingKey(totalLength, elemBytes), elemBytes, ubBytes));
+    } else if (mode == "wholereduce" && argc >= 4) {
+        const uint32_t rows = ParseU32(argv[2]);
+        const uint32_t cols = ParseU32(argv[3]);
+        const char *force = std::getenv("WRS_FORCE_BLOCKDIM");
+        const uint32_t blockDim = argc > 4 ? ParseU32(argv[4]) :
+            WholeReduceSumBlockDim(rows, cols, platform->GetCoreNumAiv(), force == nullptr ? 0U : ParseU32(force));
+        ok = Report(EmulateWholeReduceSum(rows, cols, blockDim, 2U, ubBytes));
+    } else if (mode == "broadcast" && argc >= 5) {
+        char *next = nullptr;
+        const uint32_t d0 = static_cast<uint32_t>(std::strtoul(argv[2], &next, 10));
+        const uint32_t d1 = *next == ',' ? ParseU32(next + 1) : 0U;
+        BroadcastEmuTiling tiling = {};
+        tiling.dim = d1 == 0U ? 1U : 2U;
+        tiling.totalLength = d1 == 0U ? d0 : d0 * d1;
+        tiling.axis = ParseU32(argv[3]);
+        tiling.num = ParseU32(argv[4]);
+        tiling.bLength = d0;
+        tiling.tilenum = BroadcastTileNum(tiling.totalLength, tiling.dim, tiling.axis, d1);
+        tiling.tmpSize = argc > 7 ? ParseU32(argv[7]) : 0U;
+        ok = Report(EmulateBroadcast(tiling, argc > 6 ? ParseU32(argv[6]) : 1U,
+                                     argc > 5 ? ParseElemBytes(argv[5]) : 2U, ubBytes));
+    } else {
+        std::fprintf(stderr, "[ERROR] unknown mode or missing arguments: %s\n", mode.c_str());
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
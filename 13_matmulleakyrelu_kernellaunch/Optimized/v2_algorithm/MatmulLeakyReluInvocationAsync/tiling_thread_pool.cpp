@@ -0,0 +1,121 @@
+/**
+ * @file tiling_thread_pool.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "tiling_thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+struct TilingThreadPool::Job {
+    const std::function<void(size_t)> *fn;
+    size_t count;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+TilingThreadPool &TilingThreadPool::Instance()
+{
+    static TilingThreadPool pool([]() -> size_t {
+        const char *value = std::getenv("MATMUL_TILING_THREADS");
+        if (value != nullptr) {
+            const unsigned long parsed = std::strtoul(value, nullptr, 10);
+            if (parsed > 0UL) {
+                return static_cast<size_t>(parsed);
+            }
+        }
+        return std::max<size_t>(1U, std::thread::hardware_concurrency());
+    }());
+    return pool;
+}
+
+TilingThreadPool::TilingThreadPool(size_t threadNum)
+{
+    for (size_t i = 1; i < threadNum; ++i) {
+        workers_.emplace_back(&TilingThreadPool::WorkerLoop, this);
+    }
+}
+
+TilingThreadPool::~TilingThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void TilingThreadPool::RunItems(Job &job)
+{
+    for (size_t i = job.next.fetch_add(1U); i < job.count; i = job.next.fetch_add(1U)) {
+        (*job.fn)(i);
+        if (job.done.fetch_add(1U) + 1U == job.count) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.finished.notify_all();
+        }
+    }
+}
+
+void TilingThreadPool::WorkerLoop()
+{
+    for (;;) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty()) {
+                return;
+            }
+            job = jobs_.front();
+            if (job->next.load() >= job->count) {
+                // Every index is taken, drop the job so the next one becomes visible.
+                jobs_.pop_front();
+                continue;
+            }
+        }
+        RunItems(*job);
+    }
+}
+
+void TilingThreadPool::ParallelFor(size_t count, const std::function<void(size_t)> &fn)
+{
+    if (count == 0U) {
+        return;
+    }
+    if (workers_.empty() || count == 1U) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    auto job = std::make_shared<Job>();
+    job->fn = &fn;
+    job->count = count;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(job);
+    }
+    wake_.notify_all();
+
+    RunItems(*job);
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&job] { return job->done.load() == job->count; });
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(jobs_.begin(), jobs_.end(), job);
+    if (it != jobs_.end()) {
+        jobs_.erase(it);
+    }
+}
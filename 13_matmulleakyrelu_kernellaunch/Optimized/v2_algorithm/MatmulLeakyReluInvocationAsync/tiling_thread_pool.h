@@ -0,0 +1,64 @@
+/**
+ * @file tiling_thread_pool.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef TILING_THREAD_POOL_H
+#define TILING_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+  * @brief  Host worker pool for tiling generation. ParallelFor hands out indices through an atomic counter
+  *         and the calling thread works on its own job too, so a ParallelFor issued from inside a worker
+  *         (batch of shapes -> candidates of one shape) always completes even when every worker is busy.
+  */
+class TilingThreadPool {
+public:
+    /**
+      * @brief  Process-wide pool sized by MATMUL_TILING_THREADS (default: hardware threads, 1 runs inline).
+      */
+    static TilingThreadPool &Instance();
+
+    explicit TilingThreadPool(size_t threadNum);
+    ~TilingThreadPool();
+    TilingThreadPool(const TilingThreadPool &) = delete;
+    TilingThreadPool &operator=(const TilingThreadPool &) = delete;
+
+    /**
+      * @retval Threads taking part in a ParallelFor, the caller included.
+      */
+    size_t Concurrency() const
+    {
+        return workers_.size() + 1U;
+    }
+
+    /**
+      * @brief  Run fn(0) ... fn(count - 1) and return when all of them finished. Order of execution is unspecified.
+      */
+    void ParallelFor(size_t count, const std::function<void(size_t)> &fn);
+
+private:
+    struct Job;
+    void WorkerLoop();
+    static void RunItems(Job &job);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::shared_ptr<Job>> jobs_;
+    std::vector<std::thread> workers_;
+    bool stop_ = false;
+};
+
+#endif // TILING_THREAD_POOL_H
@@ -27,11 +27,22 @@ def gen_golden_data():
     M = _read_dim("MATMUL_M", 1024)
     N = _read_dim("MATMUL_N", 640)
     K = _read_dim("MATMUL_K", 256)
+    batch = _read_dim("MATMUL_BATCH", 0)
+    # MATMUL_AB_DTYPE=float32 feeds fp32 A/B directly (HF32 cube mode on 910B)
+    ab_dtype = np.float32 if os.getenv("MATMUL_AB_DTYPE") == "float32" else np.float16
 
-    input_a = np.random.randint(1, 10, [M, K]).astype(np.float16)
-    input_b = np.random.randint(1, 10, [K, N]).astype(np.float16)
+    if batch > 0:
+        # batch-reduce mode: sum of the per-batch products into a single [M, N] output
+        input_a = np.random.randint(1, 10, [batch, M, K]).astype(ab_dtype)
+        input_b = np.random.randint(1, 10, [batch, K, N]).astype(ab_dtype)
+    else:
+        input_a = np.random.randint(1, 10, [M, K]).astype(ab_dtype)
+        input_b = np.random.randint(1, 10, [K, N]).astype(ab_dtype)
     input_bias = np.random.randint(1, 10, [N]).astype(np.float32)
-    golden = (np.matmul(input_a.astype(np.float32), input_b.astype(np.float32)) + input_bias).astype(np.float32)
+    product = np.matmul(input_a.astype(np.float32), input_b.astype(np.float32))
+    if batch > 0:
+        product = product.sum(axis=0)
+    golden = (product + input_bias).astype(np.float32)
 
     if not os.path.exists("input"):
         os.mkdir("input")
@@ -13,10 +13,14 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include "acl/acl.h"
+#include "acl_mem_pool.h"
 #include "common.h"
+#include "host_timeline.h"
+#include "launch_mem_account.h"
 #include "op_runner.h"
 
 bool g_isDevice = false;
@@ -38,6 +42,12 @@ int64_t GetEnvI64(const char *name, int64_t defaultValue)
     return static_cast<int64_t>(parsed);
 }
 
+bool UseFp32Inputs()
+{
+    const char *value = std::getenv("MATMUL_AB_DTYPE");
+    return value != nullptr && std::strcmp(value, "float32") == 0;
+}
+
 } // namespace
 
 OperatorDesc CreateOpDesc()
@@ -45,13 +55,19 @@ OperatorDesc CreateOpDesc()
     const int64_t m = GetEnvI64("MATMUL_M", 1024);
     const int64_t n = GetEnvI64("MATMUL_N", 640);
     const int64_t k = GetEnvI64("MATMUL_K", 256);
+    // MATMUL_BATCH > 0 runs the batch-reduce mode: c = sum(a[i] * b[i]) + bias over 3-D a/b.
+    const int64_t batch = GetEnvI64("MATMUL_BATCH", 0);
 
     std::vector<int64_t> shapeA{m, k};
     std::vector<int64_t> shapeB{k, n};
+    if (batch > 0) {
+        shapeA.insert(shapeA.begin(), batch);
+        shapeB.insert(shapeB.begin(), batch);
+    }
     std::vector<int64_t> shapeBias{n};
     std::vector<int64_t> shapeC{m, n};
-    aclDataType dataTypeA = ACL_FLOAT16;
-    aclDataType dataTypeB = ACL_FLOAT16;
+    aclDataType dataTypeA = UseFp32Inputs() ? ACL_FLOAT : ACL_FLOAT16;
+    aclDataType dataTypeB = UseFp32Inputs() ? ACL_FLOAT : ACL_FLOAT16;
     aclDataType dataTypeBias = ACL_FLOAT;
     aclDataType dataTypeC = ACL_FLOAT;
     aclFormat format = ACL_FORMAT_ND;
@@ -61,12 +77,13 @@ OperatorDesc CreateOpDesc()
     opDesc.AddInputTensorDesc(dataTypeBias, shapeBias.size(), shapeBias.data(), format);
     opDesc.AddOutputTensorDesc(dataTypeC, shapeC.size(), shapeC.data(), format);
 
-    INFO_LOG("shape: M=%ld N=%ld K=%ld", m, n, k);
+    INFO_LOG("shape: M=%ld N=%ld K=%ld batch=%ld", m, n, k, batch);
     return opDesc;
 }
 
 bool SetInputData(OpRunner &runner)
 {
+    HostTimelineSpan span("read", "io");
     size_t fileSize = 0;
     ReadFile("../input/input_a.bin", fileSize, runner.GetInputBuffer<void>(0), runner.GetInputSize(0));
     ReadFile("../input/input_b.bin", fileSize, runner.GetInputBuffer<void>(1), runner.GetInputSize(1));
@@ -77,6 +94,7 @@ bool SetInputData(OpRunner &runner)
 
 bool ProcessOutputData(OpRunner &runner)
 {
+    HostTimelineSpan span("write", "io");
     WriteFile("../output/output_z.bin", runner.GetOutputBuffer<void>(0), runner.GetOutputSize(0));
     INFO_LOG("Write output success");
     return true;
@@ -85,6 +103,9 @@ bool ProcessOutputData(OpRunner &runner)
 void DestroyResource()
 {
     bool flag = false;
+    AclMemPool::Instance().Report();
+    LaunchMemAccount::Instance().Report();
+    AclMemPool::Instance().Trim();
     if (aclrtResetDevice(deviceId) != ACL_SUCCESS) {
         ERROR_LOG("Reset device %d failed", deviceId);
         flag = true;
@@ -114,6 +135,7 @@ bool InitResource()
         }
     }
 
+    HostTimelineSpan span("acl_init", "host");
     if (aclInit(nullptr) != ACL_SUCCESS) {
         ERROR_LOG("acl init failed");
         return false;
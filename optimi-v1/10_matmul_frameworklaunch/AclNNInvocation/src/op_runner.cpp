@@ -11,10 +11,15 @@
 
 #include <cassert>
 #include <limits>
+#include <vector>
 
 #include "acl/acl_op_compiler.h"
+#include "acl_mem_pool.h"
 #include "aclnn_matmul_custom.h"
 #include "common.h"
+#include "host_timeline.h"
+#include "kernel_trace_decoder.h"
+#include "launch_mem_account.h"
 
 using namespace std;
 
@@ -29,30 +34,21 @@ OpRunner::OpRunner(OperatorDesc *opDesc) : opDesc_(opDesc)
 
 OpRunner::~OpRunner()
 {
-    if (workspace_!= nullptr) {
-        (void)aclrtFree(workspace_);
-    }
+    // Buffers go back to the pool, main trims it before resetting the device.
+    (void)AclMemPool::Instance().Free(workspace_);
     
     for (size_t i = 0; i < numInputs_; ++i) {
         (void)aclDestroyTensor(inputTensor_[i]);
         (void)aclDestroyDataBuffer(inputBuffers_[i]);
-        (void)aclrtFree(devInputs_[i]);
-        if (g_isDevice) {
-            (void)aclrtFree(hostInputs_[i]);
-        } else {
-            (void)aclrtFreeHost(hostInputs_[i]);
-        }
+        (void)AclMemPool::Instance().Free(devInputs_[i]);
+        (void)AclMemPool::Instance().Free(hostInputs_[i]);
     }
 
     for (size_t i = 0; i < numOutputs_; ++i) {
         (void)aclDestroyTensor(outputTensor_[i]);
         (void)aclDestroyDataBuffer(outputBuffers_[i]);
-        (void)aclrtFree(devOutputs_[i]);
-        if (g_isDevice) {
-            (void)aclrtFree(hostOutputs_[i]);
-        } else {
-            (void)aclrtFreeHost(hostOutputs_[i]);
-        }
+        (void)AclMemPool::Instance().Free(devOutputs_[i]);
+        (void)AclMemPool::Instance().Free(hostOutputs_[i]);
     }
 }
 
@@ -61,7 +57,7 @@ bool OpRunner::Init()
     for (size_t i = 0; i < numInputs_; ++i) {
         auto size = GetInputSize(i);
         void *devMem = nullptr;
-        if (aclrtMalloc(&devMem, size, ACL_MEM_MALLOC_HUGE_FIRST) != ACL_SUCCESS) {
+        if (AclMemPool::Instance().Malloc(&devMem, size, AclMemKind::DEVICE) != ACL_SUCCESS) {
             ERROR_LOG("Malloc device memory for input[%zu] failed", i);
             return false;
         }
@@ -69,16 +65,11 @@ bool OpRunner::Init()
         inputBuffers_.emplace_back(aclCreateDataBuffer(devMem, size));
 
         void *hostInput = nullptr;
-        if (g_isDevice) {
-            if (aclrtMalloc(&hostInput, size, ACL_MEM_MALLOC_HUGE_FIRST) != ACL_SUCCESS) {
-                ERROR_LOG("Malloc device memory for input[%zu] failed", i);
-                return false;
-            }
-        } else {
-            if (aclrtMallocHost(&hostInput, size) != ACL_SUCCESS) {
-                ERROR_LOG("Malloc device memory for input[%zu] failed", i);
-                return false;
-            }
+        // In device run mode the host side of the runner is device memory as well.
+        const AclMemKind hostKind = g_isDevice ? AclMemKind::DEVICE : AclMemKind::HOST;
+        if (AclMemPool::Instance().Malloc(&hostInput, size, hostKind) != ACL_SUCCESS) {
+            ERROR_LOG("Malloc host memory for input[%zu] failed", i);
+            return false;
         }
         if (hostInput == nullptr) {
             ERROR_LOG("Malloc memory for input[%zu] failed", i);
@@ -99,7 +90,7 @@ bool OpRunner::Init()
     for (size_t i = 0; i < numOutputs_; ++i) {
         auto size = GetOutputSize(i);
         void *devMem = nullptr;
-        if (aclrtMalloc(&devMem, size, ACL_MEM_MALLOC_HUGE_FIRST) != ACL_SUCCESS) {
+        if (AclMemPool::Instance().Malloc(&devMem, size, AclMemKind::DEVICE) != ACL_SUCCESS) {
             ERROR_LOG("Malloc device memory for output[%zu] failed", i);
             return false;
         }
@@ -107,16 +98,11 @@ bool OpRunner::Init()
         outputBuffers_.emplace_back(aclCreateDataBuffer(devMem, size));
 
         void *hostOutput = nullptr;
-        if (g_isDevice) {
-            if (aclrtMalloc(&hostOutput, size, ACL_MEM_MALLOC_HUGE_FIRST) != ACL_SUCCESS) {
-                ERROR_LOG("Malloc device memory for output[%zu] failed", i);
-                return false;
-            }
-        } else {
-            if (aclrtMallocHost(&hostOutput, size) != ACL_SUCCESS) {
-                ERROR_LOG("Malloc device memory for output[%zu] failed", i);
-                return false;
-            }
+        // In device run mode the host side of the runner is device memory as well.
+        const AclMemKind hostKind = g_isDevice ? AclMemKind::DEVICE : AclMemKind::HOST;
+        if (AclMemPool::Instance().Malloc(&hostOutput, size, hostKind) != ACL_SUCCESS) {
+            ERROR_LOG("Malloc host memory for output[%zu] failed", i);
+            return false;
         }
         if (hostOutput == nullptr) {
             ERROR_LOG("Malloc host memory for output[%zu] failed", i);
@@ -292,6 +278,8 @@ size_t OpRunner::GetOutputElementCount(size_t index) const
 
 bool OpRunner::RunOp()
 {
+    HostTimeline &timeline = HostTimeline::Instance();
+    const double h2dBegin = timeline.NowUs();
     for (size_t i = 0; i < numInputs_; ++i) {
         auto size = GetInputSize(i);
         aclrtMemcpyKind kind = ACL_MEMCPY_HOST_TO_DEVICE;
@@ -304,6 +292,7 @@ bool OpRunner::RunOp()
         }
         INFO_LOG("Copy input[%zu] success", i);
     }
+    timeline.AddSpan("h2d", "copy", h2dBegin, timeline.NowUs());
 
     aclrtStream stream = nullptr;
     if (aclrtCreateStream(&stream) != ACL_SUCCESS) {
@@ -312,6 +301,9 @@ bool OpRunner::RunOp()
     }
     INFO_LOG("Create stream success");
 
+    // op_host tiling runs inside GetWorkspaceSize.
+    const double tilingBegin = timeline.NowUs();
+
     size_t workspaceSize = 0;
     aclOpExecutor *handle = nullptr;
     auto ret = aclnnMatmulCustomGetWorkspaceSize(inputTensor_[0], inputTensor_[1], inputTensor_[2], outputTensor_[0],
@@ -321,15 +313,43 @@ bool OpRunner::RunOp()
         ERROR_LOG("Get Operator Workspace failed. error code is %d", static_cast<int32_t>(ret));
         return false;
     }
+    timeline.AddSpan("tiling", "host", tilingBegin, timeline.NowUs());
     INFO_LOG("Execute aclnnMatmulCustomGetWorkspaceSize success, workspace size %lu", workspaceSize);
+    LaunchMemFootprint launchMem;
+    for (size_t i = 0; i < numInputs_; ++i) {
+        launchMem.input += GetInputSize(i);
+    }
+    for (size_t i = 0; i < numOutputs_; ++i) {
+        launchMem.output += GetOutputSize(i);
+    }
+    // User and system workspace (and the trace region) come back as one size.
+    launchMem.userWorkspace = workspaceSize;
+    LaunchMemAccount::Instance().Record("aclnnMatmulCustom", launchMem);
+    PrintLaunchMem("aclnnMatmulCustom", launchMem);
 
+    // A second RunOp on the same runner hands the previous workspace back before taking a new one.
+    (void)AclMemPool::Instance().Free(workspace_);
+    workspace_ = nullptr;
     if (workspaceSize != 0) {
-        if (aclrtMalloc(&workspace_, workspaceSize, ACL_MEM_MALLOC_HUGE_FIRST) != ACL_SUCCESS) {
+        if (AclMemPool::Instance().Malloc(&workspace_, workspaceSize, AclMemKind::DEVICE) != ACL_SUCCESS) {
             ERROR_LOG("Malloc device memory failed");
         }
     }
 
+    // op_host appends the kernel trace region at the tail of the workspace when built with KERNEL_TRACE
+    const char *traceFile = getenv("KERNEL_TRACE_FILE");
+    bool dumpTrace = (traceFile != nullptr) && (workspace_ != nullptr) && (workspaceSize >= KERNEL_TRACE_BYTES);
+    void *traceDevice = nullptr;
+    if (dumpTrace) {
+        traceDevice = static_cast<uint8_t *>(workspace_) + workspaceSize - KERNEL_TRACE_BYTES;
+        (void)aclrtMemset(traceDevice, KERNEL_TRACE_BYTES, 0, KERNEL_TRACE_BYTES);
+    }
+
+    const double launchBegin = timeline.NowUs();
+    const size_t kernelSpan = timeline.DeviceBegin("aclnnMatmulCustom", stream);
     ret = aclnnMatmulCustom(workspace_, workspaceSize, handle, stream);
+    timeline.DeviceEnd(kernelSpan, stream);
+    timeline.AddSpan("launch", "host", launchBegin, timeline.NowUs());
     if (ret != ACL_SUCCESS) {
         (void)aclrtDestroyStream(stream);
         ERROR_LOG("Execute Operator failed. error code is %d", static_cast<int32_t>(ret));
@@ -337,14 +357,28 @@ bool OpRunner::RunOp()
     }
     INFO_LOG("Execute aclnnMatmulCustom success");
 
+    const double syncBegin = timeline.NowUs();
     ret = aclrtSynchronizeStreamWithTimeout(stream, 5000);
     if (ret != SUCCESS) {
         ERROR_LOG("Synchronize stream failed. error code is %d", static_cast<int32_t>(ret));
         (void)aclrtDestroyStream(stream);
         return false;
     }
+    timeline.AddSpan("sync", "host", syncBegin, timeline.NowUs());
+    timeline.ResolveDevice();
     INFO_LOG("Synchronize stream success");
 
+    if (dumpTrace) {
+        std::vector<uint8_t> trace(KERNEL_TRACE_BYTES);
+        aclrtMemcpyKind kind = g_isDevice ? ACL_MEMCPY_DEVICE_TO_DEVICE : ACL_MEMCPY_DEVICE_TO_HOST;
+        if (aclrtMemcpy(trace.data(), trace.size(), traceDevice, KERNEL_TRACE_BYTES, kind) == ACL_SUCCESS) {
+            (void)DumpKernelTrace(trace.data(), trace.size(), traceFile, "aclnnMatmulCustom");
+        } else {
+            WARN_LOG("Copy kernel trace failed");
+        }
+    }
+
+    const double d2hBegin = timeline.NowUs();
     for (size_t i = 0; i < numOutputs_; ++i) {
         auto size = GetOutputSize(i);
         aclrtMemcpyKind kind = ACL_MEMCPY_DEVICE_TO_HOST;
@@ -358,6 +392,7 @@ bool OpRunner::RunOp()
         }
         INFO_LOG("Copy output[%zu] success", i);
     }
+    timeline.AddSpan("d2h", "copy", d2hBegin, timeline.NowUs());
 
     (void)aclrtDestroyStream(stream);
     return true;
@@ -8,13 +8,33 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "../op_kernel/matmul_custom_tiling.h"
+#include "kernel_trace.h"
+#include "matmul_memory_plan.h"
 #include <algorithm>
+#include <iostream>
 #include "register/op_def_registry.h"
 #include "tiling/platform/platform_ascendc.h"
 #include "tiling/tiling_api.h"
 using namespace matmul_tiling;
 
 namespace optiling {
+/**
+  * @brief  a [M, K] and b [K, N], or a [batch, M, K] and b [batch, K, N] with the same 1 <= batch <= 32.
+  */
+static bool MatmulShapesValid(const gert::Shape &shape_a, const gert::Shape &shape_b)
+{
+    const size_t rank = shape_a.GetDimNum();
+    if ((rank != 2 && rank != 3) || shape_b.GetDimNum() != rank) {
+        return false;
+    }
+    const size_t dimOffset = rank - 2;
+    if (rank == 3 && (shape_a.GetDim(0) != shape_b.GetDim(0) || shape_a.GetDim(0) <= 0 ||
+                      shape_a.GetDim(0) > MATMUL_BATCH_REDUCE_MAX)) {
+        return false;
+    }
+    return shape_a.GetDim(dimOffset + 1) == shape_b.GetDim(dimOffset);
+}
+
 /**
   * @brief  Generate matmul tiling.
   * @param  context: Tiling kernel context.
@@ -25,17 +45,30 @@ static ge::graphStatus TilingFunc(gert::TilingContext *context)
     auto ascendcPlatform = platform_ascendc::PlatformAscendC(context->GetPlatformInfo());
     auto shape_a = context->GetInputTensor(0)->GetOriginShape();
     auto shape_b = context->GetInputTensor(1)->GetOriginShape();
-    int32_t M = shape_a.GetDim(0);
-    int32_t N = shape_b.GetDim(1);
-    int32_t K = shape_a.GetDim(1);
+    // 3-D a [batch, M, K] and b [batch, K, N] select the batch-reduce mode: c = sum(a[i] * b[i]) + bias.
+    if (!MatmulShapesValid(shape_a, shape_b)) {
+        return ge::GRAPH_FAILED;
+    }
+    const bool batchReduce = (shape_a.GetDimNum() == 3);
+    const size_t dimOffset = batchReduce ? 1 : 0;
+    const uint32_t batchNum = batchReduce ? static_cast<uint32_t>(shape_a.GetDim(0)) : 0;
+    int32_t M = shape_a.GetDim(dimOffset);
+    int32_t N = shape_b.GetDim(dimOffset + 1);
+    int32_t K = shape_a.GetDim(dimOffset + 1);
     int32_t baseM = 128;
     int32_t baseN = 128;
     int32_t singleCoreM = 512;
     int32_t singleCoreN = 640;
+    // fp32 A/B run the cube in HF32 mode, which only exists on 910B. The tiling API sizes baseK for 4-byte operands.
+    const bool isFp32 = (context->GetInputTensor(0)->GetDataType() == ge::DT_FLOAT);
+    if (isFp32 && ascendcPlatform.GetSocVersion() == platform_ascendc::SocVersion::ASCEND310P) {
+        return ge::GRAPH_FAILED;
+    }
+    const auto abType = isFp32 ? matmul_tiling::DataType::DT_FLOAT : matmul_tiling::DataType::DT_FLOAT16;
     MultiCoreMatmulTiling cubeTiling(ascendcPlatform);
     cubeTiling.SetDim(ascendcPlatform.GetCoreNumAiv()); // Set the number of cores that participate in multi-core computaion is 48.
-    cubeTiling.SetAType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT16);
-    cubeTiling.SetBType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT16);
+    cubeTiling.SetAType(TPosition::GM, CubeFormat::ND, abType);
+    cubeTiling.SetBType(TPosition::GM, CubeFormat::ND, abType);
     cubeTiling.SetCType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT);
     cubeTiling.SetBiasType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT);
     cubeTiling.SetShape(M, N, K);
@@ -45,33 +78,74 @@ static ge::graphStatus TilingFunc(gert::TilingContext *context)
         cubeTiling.SetFixSplit(baseM, baseN, -1);  // Set the fixed baseM=128, baseN=128.
     }
     cubeTiling.SetBias(true);
-    cubeTiling.SetBufferSpace(-1, -1, -1);
+    // The kernel keeps no UB queues of its own, on 310P the whole UB is the API's format workspace (localMemSize).
+    const MatmulCoreMemory coreMem = MakeMatmulCoreMemory(ascendcPlatform);
+    if (!SetMatmulBufferBudget(cubeTiling, coreMem, 0U)) {
+        return ge::GRAPH_FAILED;
+    }
     MatmulCustomTilingData *tiling = context->GetTilingData<MatmulCustomTilingData>();
     if (cubeTiling.GetTiling(tiling->cubeTilingData) == -1) {
         return ge::GRAPH_FAILED;
     }
+    const char *overflow = nullptr;
+    if (!MatmulMemoryFits(MatmulTilingMemoryUse(tiling->cubeTilingData, isFp32 ? 4U : 2U, true, 0U), coreMem, &overflow)) {
+        std::cout << "reject tiling baseM=" << tiling->cubeTilingData.baseM << " baseN=" << tiling->cubeTilingData.baseN
+                  << ": " << overflow << " overflow" << std::endl;
+        return ge::GRAPH_FAILED;
+    }
 
     uint64_t localMemSize;
     ascendcPlatform.GetCoreMemSize(platform_ascendc::CoreMemType::UB, localMemSize);
     tiling->localMemSize = localMemSize;
+    tiling->batchNum = batchNum;
+    for (uint32_t i = 0; i < batchNum; ++i) {
+        tiling->batchOffsetA[i] = static_cast<uint64_t>(i) * M * K;
+        tiling->batchOffsetB[i] = static_cast<uint64_t>(i) * K * N;
+    }
 
+    // Tiling key 1/2: plain matmul, 3/4: batch-reduce. Even keys set the temp UB space on 310P.
+    const uint64_t batchKeyOffset = batchReduce ? 2 : 0;
     if (ascendcPlatform.GetSocVersion() == platform_ascendc::SocVersion::ASCEND310P) {
         context->SetBlockDim(std::max<uint32_t>(1U, tiling->cubeTilingData.usedCoreNum));
-        context->SetTilingKey(2);
+        context->SetTilingKey(2 + batchKeyOffset);
     } else {
         context->SetBlockDim(std::max<uint32_t>(1U, (tiling->cubeTilingData.usedCoreNum + 1U) / 2U));
-        context->SetTilingKey(1);
+        context->SetTilingKey(1 + batchKeyOffset);
     }
 
     size_t userWorkspaceSize = 0;
     size_t systemWorkspaceSize = static_cast<size_t>(ascendcPlatform.GetLibApiWorkSpaceSize());
     size_t *currentWorkspace = context->GetWorkspaceSizes(1);
     currentWorkspace[0] = userWorkspaceSize + systemWorkspaceSize;
+#ifdef KERNEL_TRACE
+    currentWorkspace[0] += KERNEL_TRACE_BYTES;
+#endif
 
     return ge::GRAPH_SUCCESS;
 }
 } // namespace optiling
 
+namespace ge {
+static graphStatus InferShape(gert::InferShapeContext *context)
+{
+    const gert::Shape *shape_a = context->GetInputShape(0);
+    const gert::Shape *shape_b = context->GetInputShape(1);
+    if (!optiling::MatmulShapesValid(*shape_a, *shape_b)) {
+        return GRAPH_FAILED;
+    }
+    const size_t dimOffset = shape_a->GetDimNum() - 2;
+    gert::Shape *shape_c = context->GetOutputShape(0);
+    *shape_c = {shape_a->GetDim(dimOffset), shape_b->GetDim(dimOffset + 1)};
+    return GRAPH_SUCCESS;
+}
+
+static graphStatus InferDataType(gert::InferDataTypeContext *context)
+{
+    context->SetOutputDataType(0, ge::DT_FLOAT);
+    return ge::GRAPH_SUCCESS;
+}
+} // namespace ge
+
 namespace ops {
 class MatmulCustom : public OpDef {
 public:
@@ -79,21 +153,22 @@ public:
     {
         this->Input("a")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT16})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT16, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
         this->Input("b")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT16})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT16, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
         this->Input("bias")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
         this->Output("c")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
 
+        this->SetInferShape(ge::InferShape).SetInferDataType(ge::InferDataType);
         this->AICore()
             .SetTiling(optiling::TilingFunc)
             .AddConfig("ascend310p")
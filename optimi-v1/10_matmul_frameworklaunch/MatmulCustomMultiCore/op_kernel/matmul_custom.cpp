@@ -10,6 +10,7 @@
 #include "kernel_operator.h"
 #include "lib/matmul_intf.h"
 #include "matmul_custom_tiling.h"
+#include "kernel_tracer.h"
 
 using namespace matmul;
 
@@ -22,8 +23,10 @@ template <typename aType, typename bType, typename cType, typename biasType> cla
 public:
     __aicore__ inline MatmulKernel(){};
     __aicore__ inline void Init(GM_ADDR a, GM_ADDR b, GM_ADDR bias, GM_ADDR c, GM_ADDR workspace,
-                                uint64_t memSize, const TCubeTiling &tiling);
+                                uint64_t memSize, const TCubeTiling &tiling, uint32_t batchNum = 1);
     template <bool setTmpSpace = false> __aicore__ inline void Process(AscendC::TPipe *pipe);
+    template <bool setTmpSpace = false>
+    __aicore__ inline void ProcessBatchReduce(AscendC::TPipe *pipe, const MatmulCustomTilingData &tilingData);
 
     __aicore__ inline void CalcOffset(int32_t blockIdx, const TCubeTiling &tiling, int32_t &offsetA, int32_t &offsetB,
                                       int32_t &offsetC, int32_t &offsetBias);
@@ -40,6 +43,7 @@ public:
     uint64_t localMemSize = 0;
     int32_t mIdx = 0;
     int32_t nIdx = 0;
+    KernelTracer tracer;
 };
 
 /**
@@ -50,16 +54,19 @@ public:
   * @param  c: C matrix gm addr.
   * @param  workspace: Temporary gm space addr required by matmul calc.
   * @param  tiling: matmul tiling data.
+  * @param  batchNum: Number of stacked A/B matrices, 1 outside the batch-reduce mode.
   * @retval None
   */
 template <typename aType, typename bType, typename cType, typename biasType>
 __aicore__ inline void MatmulKernel<aType, bType, cType, biasType>::Init(GM_ADDR a, GM_ADDR b, GM_ADDR bias, GM_ADDR c,
-                                                                         GM_ADDR workspace, uint64_t memSize, const TCubeTiling &tiling)
+                                                                         GM_ADDR workspace, uint64_t memSize, const TCubeTiling &tiling,
+                                                                         uint32_t batchNum)
 {
+    tracer.Init(GetKernelTraceGm(workspace, 0));
     this->tiling = tiling;
     this->localMemSize = memSize;
-    aGlobal.SetGlobalBuffer(reinterpret_cast<__gm__ aType *>(a), tiling.M * tiling.Ka);
-    bGlobal.SetGlobalBuffer(reinterpret_cast<__gm__ bType *>(b), tiling.Kb * tiling.N);
+    aGlobal.SetGlobalBuffer(reinterpret_cast<__gm__ aType *>(a), batchNum * tiling.M * tiling.Ka);
+    bGlobal.SetGlobalBuffer(reinterpret_cast<__gm__ bType *>(b), batchNum * tiling.Kb * tiling.N);
     cGlobal.SetGlobalBuffer(reinterpret_cast<__gm__ cType *>(c), tiling.M * tiling.N);
     biasGlobal.SetGlobalBuffer(reinterpret_cast<__gm__ biasType *>(bias), tiling.N);
 
@@ -106,8 +113,86 @@ __aicore__ inline void MatmulKernel<aType, bType, cType, biasType>::Process(Asce
     matmulObj.SetTensorA(aGlobal);
     matmulObj.SetTensorB(bGlobal);
     matmulObj.SetBias(biasGlobal);
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(true); // fp32 A/B use the reduced-precision cube mode instead of a cast pass.
+    }
+    const int64_t start = tracer.Begin();
     matmulObj.IterateAll(cGlobal);
+    tracer.End(TRACE_PHASE_ITERATE, 0, start);
     matmulObj.End();
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(false);
+    }
+    tracer.Flush();
+}
+
+/**
+  * @brief  Batch-reduce process: C = sum(A[i] * B[i]) + bias. Each baseM x baseN tile of the core accumulates
+  *         all batch products in L0C (Iterate with enPartialSum) and is written to GM once.
+  * @param  pipe: Global memory and sync management TPipe object.
+  * @param  tilingData: Tiling data carrying the batch count and the A/B offsets of each batch.
+  * @retval None
+  */
+template <typename aType, typename bType, typename cType, typename biasType>
+template <bool setTmpSpace>
+__aicore__ inline void
+MatmulKernel<aType, bType, cType, biasType>::ProcessBatchReduce(AscendC::TPipe *pipe,
+                                                                const MatmulCustomTilingData &tilingData)
+{
+    if (GetBlockIdx() >= tiling.usedCoreNum) {
+        return;
+    }
+    // Set temp UB space if the setTmpSpace is true.
+    if constexpr (setTmpSpace) {
+        AscendC::TBuf<> tmpMMFormatUb;
+        AscendC::LocalTensor<uint8_t> mmformatUb;
+        pipe->InitBuffer(tmpMMFormatUb, localMemSize);
+        mmformatUb = tmpMMFormatUb.Get<uint8_t>(localMemSize);
+        matmulObj.SetLocalWorkspace(mmformatUb);
+    }
+    auto tailM = tiling.M - mIdx * tiling.singleCoreM;
+    auto tailN = tiling.N - nIdx * tiling.singleCoreN;
+    int32_t mUse = tailM > tiling.singleCoreM ? tiling.singleCoreM : (tailM > 0 ? tailM : tiling.M);
+    int32_t nUse = tailN > tiling.singleCoreN ? tiling.singleCoreN : (tailN > 0 ? tailN : tiling.N);
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(true);
+    }
+    uint32_t tileIdx = 0;
+    // L0C partial sum requires singleCoreM == baseM and singleCoreN == baseN, so walk the base tiles here.
+    for (int32_t mOffset = 0; mOffset < mUse; mOffset += tiling.baseM) {
+        for (int32_t nOffset = 0; nOffset < nUse; nOffset += tiling.baseN) {
+            const int32_t curM = (mUse - mOffset) < tiling.baseM ? (mUse - mOffset) : tiling.baseM;
+            const int32_t curN = (nUse - nOffset) < tiling.baseN ? (nUse - nOffset) : tiling.baseN;
+            const int64_t start = tracer.Begin();
+            matmulObj.SetTail(curM, curN, tiling.Ka);
+            // The tail is exactly one base tile and SetTensorA restarts the iteration, so every Iterate computes
+            // this tile; enPartialSum adds the product onto the ones already in L0C. A false return means the
+            // object produced no tile, and then nothing is written.
+            bool computed = true;
+            for (uint32_t i = 0; i < tilingData.batchNum; ++i) {
+                matmulObj.SetTensorA(aGlobal[tilingData.batchOffsetA[i] + mOffset * tiling.Ka]);
+                matmulObj.SetTensorB(bGlobal[tilingData.batchOffsetB[i] + nOffset]);
+                if (i == 0) {
+                    matmulObj.SetBias(biasGlobal[nOffset]); // Bias is added by the first product only.
+                } else {
+                    matmulObj.DisableBias();
+                }
+                computed = matmulObj.Iterate(i != 0) && computed;
+            }
+            tracer.End(TRACE_PHASE_ITERATE, tileIdx, start);
+            if (computed) {
+                const int64_t copyStart = tracer.Begin();
+                matmulObj.GetTensorC(cGlobal[mOffset * tiling.N + nOffset]);
+                tracer.End(TRACE_PHASE_GET_TENSOR_C, tileIdx, copyStart);
+            }
+            ++tileIdx;
+        }
+    }
+    matmulObj.End();
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(false);
+    }
+    tracer.Flush();
 }
 
 /**
@@ -150,13 +235,18 @@ extern "C" __global__ __aicore__ void matmul_custom(GM_ADDR a, GM_ADDR b, GM_ADD
 {
     REGISTER_TILING_DEFAULT(MatmulCustomTilingData);
     GET_TILING_DATA(tilingData, tiling);
-    MatmulKernel<half, half, float, float> matmulKernel;
+    MatmulKernel<DTYPE_A, DTYPE_B, float, float> matmulKernel;
     AscendC::TPipe pipe;
     REGIST_MATMUL_OBJ(&pipe, GetSysWorkSpacePtr(), matmulKernel.matmulObj, &tilingData.cubeTilingData); // Initialize the matmul object.
-    matmulKernel.Init(a, b, bias, c, workspace, tilingData.localMemSize, tilingData.cubeTilingData);
+    matmulKernel.Init(a, b, bias, c, workspace, tilingData.localMemSize, tilingData.cubeTilingData,
+                      tilingData.batchNum > 0 ? tilingData.batchNum : 1);
     if (TILING_KEY_IS(1)) {
         matmulKernel.Process(&pipe);
     } else if (TILING_KEY_IS(2)) {
         matmulKernel.Process<true>(&pipe);
+    } else if (TILING_KEY_IS(3)) {
+        matmulKernel.ProcessBatchReduce(&pipe, tilingData);
+    } else if (TILING_KEY_IS(4)) {
+        matmulKernel.ProcessBatchReduce<true>(&pipe, tilingData);
     }
 }
\ No newline at end of file
@@ -13,9 +13,16 @@
 #include <cstdint>
 #include "kernel_tiling/kernel_tiling.h"
 
+// Upper bound of (A, B) pairs summed into one C by the batch-reduce mode.
+constexpr uint32_t MATMUL_BATCH_REDUCE_MAX = 32;
+
 struct MatmulCustomTilingData {
     uint64_t localMemSize;
     AscendC::tiling::TCubeTiling cubeTilingData;
+    uint32_t batchNum;  // 0: plain matmul, otherwise C = sum of A[i] * B[i] for i < batchNum.
+    uint32_t reserved;
+    uint64_t batchOffsetA[MATMUL_BATCH_REDUCE_MAX];  // Element offset of A[i] from the a tensor base.
+    uint64_t batchOffsetB[MATMUL_BATCH_REDUCE_MAX];  // Element offset of B[i] from the b tensor base.
 };
 
 #endif  // MATMUL_CUSTOM_TILING_H
\ No newline at end of file
@@ -8,8 +8,10 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "matmul_custom_tiling.h"
+#include "matmul_memory_plan.h"
 #include <algorithm>
 #include <cstdlib>
+#include <iostream>
 #include "register/op_def_registry.h"
 #include "tiling/platform/platform_ascendc.h"
 #include "tiling/tiling_api.h"
@@ -57,20 +59,35 @@ static ge::graphStatus TilingFunc(gert::TilingContext *context)
         baseM = static_cast<int32_t>(forceBaseM);
         baseN = static_cast<int32_t>(forceBaseN);
     }
+    // fp32 A/B run the cube in HF32 mode, which only exists on 910B. The tiling API sizes baseK for 4-byte operands.
+    const bool isFp32 = (context->GetInputTensor(0)->GetDataType() == ge::DT_FLOAT);
+    if (isFp32 && ascendcPlatform.GetSocVersion() == platform_ascendc::SocVersion::ASCEND310P) {
+        return ge::GRAPH_FAILED;
+    }
+    const auto abType = isFp32 ? matmul_tiling::DataType::DT_FLOAT : matmul_tiling::DataType::DT_FLOAT16;
     MatmulApiTiling cubeTiling(ascendcPlatform);
-    cubeTiling.SetAType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT16);
-    cubeTiling.SetBType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT16);
+    cubeTiling.SetAType(TPosition::GM, CubeFormat::ND, abType);
+    cubeTiling.SetBType(TPosition::GM, CubeFormat::ND, abType);
     cubeTiling.SetCType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT);
     cubeTiling.SetBiasType(TPosition::GM, CubeFormat::ND, matmul_tiling::DataType::DT_FLOAT);
     cubeTiling.SetShape(M, N, K);
     cubeTiling.SetOrgShape(M, N, K);
     cubeTiling.SetFixSplit(baseM, baseN, -1);
     cubeTiling.SetBias(true);
-    cubeTiling.SetBufferSpace(-1, -1, -1);
+    // The kernel keeps no UB queues of its own, on 310P the whole UB is the API's format workspace (localMemSize).
+    const MatmulCoreMemory coreMem = MakeMatmulCoreMemory(ascendcPlatform);
+    if (!SetMatmulBufferBudget(cubeTiling, coreMem, 0U)) {
+        return ge::GRAPH_FAILED;
+    }
     MatmulCustomTilingData tiling;
     if (cubeTiling.GetTiling(tiling.cubeTilingData) == -1) { // Get matmul tiling.
         return ge::GRAPH_FAILED;
     }
+    const char *overflow = nullptr;
+    if (!MatmulMemoryFits(MatmulTilingMemoryUse(tiling.cubeTilingData, isFp32 ? 4U : 2U, true, 0U), coreMem, &overflow)) {
+        std::cout << "reject tiling baseM=" << baseM << " baseN=" << baseN << ": " << overflow << " overflow" << std::endl;
+        return ge::GRAPH_FAILED;
+    }
 
     uint64_t localMemSize;
     ascendcPlatform.GetCoreMemSize(platform_ascendc::CoreMemType::UB, localMemSize);
@@ -101,20 +118,20 @@ public:
     {
         this->Input("a")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT16})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT16, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
         this->Input("b")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT16})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT16, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
         this->Input("bias")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
         this->Output("c")
             .ParamType(REQUIRED)
-            .DataType({ge::DT_FLOAT})
-            .Format({ge::FORMAT_ND});
+            .DataType({ge::DT_FLOAT, ge::DT_FLOAT})
+            .Format({ge::FORMAT_ND, ge::FORMAT_ND});
 
         this->AICore()
             .SetTiling(optiling::TilingFunc)
@@ -106,8 +106,14 @@ __aicore__ inline void MatmulKernel<aType, bType, cType, biasType>::Process(Asce
     matmulObj.SetTensorA(aGlobal);
     matmulObj.SetTensorB(bGlobal);
     matmulObj.SetBias(biasGlobal);
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(true); // fp32 A/B use the reduced-precision cube mode instead of a cast pass.
+    }
     matmulObj.IterateAll(cGlobal);
     matmulObj.End();
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(false);
+    }
 }
 
 /**
@@ -149,7 +155,7 @@ extern "C" __global__ __aicore__ void matmul_custom(GM_ADDR a, GM_ADDR b, GM_ADD
                                                     GM_ADDR tiling)
 {
     GET_TILING_DATA(tilingData, tiling);
-    MatmulKernel<half, half, float, float> matmulKernel;
+    MatmulKernel<DTYPE_A, DTYPE_B, float, float> matmulKernel;
     AscendC::TPipe pipe;
     REGIST_MATMUL_OBJ(&pipe, GetSysWorkSpacePtr(), matmulKernel.matmulObj, &tilingData.cubeTilingData); // Initialize the matmul object.
     matmulKernel.Init(a, b, bias, c, workspace, tilingData.localMemSize, tilingData.cubeTilingData);
@@ -1,6 +1,6 @@
 #!/bin/bash
-SHORT=v:,i:,
-LONG=soc-version:,install-path:,
+SHORT=v:,i:,t,s,
+LONG=soc-version:,install-path:,kernel-trace,single-core,
 OPTS=$(getopt -a --options $SHORT --longoptions $LONG -- "$@")
 eval set -- "$OPTS"
 
@@ -14,6 +14,14 @@ while :; do
         ASCEND_INSTALL_PATH="$2"
         shift 2
         ;;
+    -t | --kernel-trace)
+        KERNEL_TRACE=1
+        shift 1
+        ;;
+    -s | --single-core)
+        SINGLE_CORE=1
+        shift 1
+        ;;
     --)
         shift
         break
@@ -40,7 +48,18 @@ OP_NAME=MatmulCustom
 rm -rf CustomOp
 # Generate the op framework
 msopgen gen -i $OP_NAME.json -c ai_core-${SOC_VERSION} -lan cpp -out CustomOp
-# Copy op implementation files to CustomOp, select one of the following two options
-cp -rf MatmulCustomSingleCore/* CustomOp # cp -rf MatmulCustomMultiCore/* CustomOp
+# Copy op implementation files to CustomOp: MatmulCustomMultiCore (batch-reduce and fp32 a/b) unless -s is given
+if [ "${SINGLE_CORE:-0}" -eq 1 ]; then
+    cp -rf MatmulCustomSingleCore/* CustomOp
+else
+    cp -rf MatmulCustomMultiCore/* CustomOp
+fi
+# Trace layout is shared by op_host (workspace sizing) and op_kernel (recording)
+cp -f ../common/kernel_trace.h ../common/matmul_memory_plan.h CustomOp/op_host/
+cp -f ../common/kernel_trace.h ../common/kernel_tracer.h CustomOp/op_kernel/
+if [ "${KERNEL_TRACE:-0}" -eq 1 ]; then
+    sed -i '1i add_compile_definitions(KERNEL_TRACE)' CustomOp/op_host/CMakeLists.txt
+    sed -i '1i add_ops_compile_options(ALL OPTIONS -DKERNEL_TRACE)' CustomOp/op_kernel/CMakeLists.txt
+fi
 # Build CustomOp project
 (cd CustomOp && bash build.sh)
@@ -22,9 +22,11 @@ def gen_golden_data():
     m = get_env_int("MATMUL_M", 1024)
     n = get_env_int("MATMUL_N", 640)
     k = get_env_int("MATMUL_K", 256)
+    # MATMUL_AB_DTYPE=float32 feeds fp32 A/B directly (HF32 cube mode on 910B)
+    ab_dtype = np.float32 if os.getenv("MATMUL_AB_DTYPE") == "float32" else np.float16
 
-    input_a = np.random.randint(1, 10, [m, k]).astype(np.float16)
-    input_b = np.random.randint(1, 10, [k, n]).astype(np.float16)
+    input_a = np.random.randint(1, 10, [m, k]).astype(ab_dtype)
+    input_b = np.random.randint(1, 10, [k, n]).astype(ab_dtype)
     input_bias = np.random.randint(1, 10, [n]).astype(np.float32)
 
     alpha = 0.001
@@ -13,10 +13,14 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include "acl/acl.h"
+#include "acl_mem_pool.h"
 #include "common.h"
+#include "host_timeline.h"
+#include "launch_mem_account.h"
 #include "op_runner.h"
 
 bool g_isDevice = false;
@@ -38,6 +42,12 @@ int64_t GetEnvI64(const char *name, int64_t defaultValue)
     return static_cast<int64_t>(parsed);
 }
 
+bool UseFp32Inputs()
+{
+    const char *value = std::getenv("MATMUL_AB_DTYPE");
+    return value != nullptr && std::strcmp(value, "float32") == 0;
+}
+
 } // namespace
 
 OperatorDesc CreateOpDesc()
@@ -50,8 +60,8 @@ OperatorDesc CreateOpDesc()
     std::vector<int64_t> shapeB{k, n};
     std::vector<int64_t> shapeBias{n};
     std::vector<int64_t> shapeC{m, n};
-    aclDataType dataTypeA = ACL_FLOAT16;
-    aclDataType dataTypeB = ACL_FLOAT16;
+    aclDataType dataTypeA = UseFp32Inputs() ? ACL_FLOAT : ACL_FLOAT16;
+    aclDataType dataTypeB = UseFp32Inputs() ? ACL_FLOAT : ACL_FLOAT16;
     aclDataType dataTypeBias = ACL_FLOAT;
     aclDataType dataTypeC = ACL_FLOAT;
     aclFormat format = ACL_FORMAT_ND;
@@ -67,6 +77,7 @@ OperatorDesc CreateOpDesc()
 
 bool SetInputData(OpRunner &runner)
 {
+    HostTimelineSpan span("read", "io");
     size_t fileSize = 0;
     ReadFile("../input/input_a.bin", fileSize, runner.GetInputBuffer<void>(0), runner.GetInputSize(0));
     ReadFile("../input/input_b.bin", fileSize, runner.GetInputBuffer<void>(1), runner.GetInputSize(1));
@@ -77,6 +88,7 @@ bool SetInputData(OpRunner &runner)
 
 bool ProcessOutputData(OpRunner &runner)
 {
+    HostTimelineSpan span("write", "io");
     WriteFile("../output/output_z.bin", runner.GetOutputBuffer<void>(0), runner.GetOutputSize(0));
     INFO_LOG("Write output success");
     return true;
@@ -85,6 +97,9 @@ bool ProcessOutputData(OpRunner &runner)
 void DestroyResource()
 {
     bool flag = false;
+    AclMemPool::Instance().Report();
+    LaunchMemAccount::Instance().Report();
+    AclMemPool::Instance().Trim();
     if (aclrtResetDevice(deviceId) != ACL_SUCCESS) {
         ERROR_LOG("Reset device %d failed", deviceId);
         flag = true;
@@ -114,6 +129,7 @@ bool InitResource()
         }
     }
 
+    HostTimelineSpan span("acl_init", "host");
     if (aclInit(nullptr) != ACL_SUCCESS) {
         ERROR_LOG("acl init failed");
         return false;
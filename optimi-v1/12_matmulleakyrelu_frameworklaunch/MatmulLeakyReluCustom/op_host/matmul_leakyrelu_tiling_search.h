@@ -0,0 +1,170 @@
+/**
+ * @file matmul_leakyrelu_tiling_search.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_LEAKYRELU_TILING_SEARCH_H
+#define MATMUL_LEAKYRELU_TILING_SEARCH_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "matmul_cost_model.h"
+#include "matmul_memory_plan.h"
+#include "matmul_tiling_table.h"
+#include "matmul_tuning_db.h"
+#include "tiling/tiling_api.h"
+#ifdef MATMUL_TILING_TABLE_ENABLE
+#include "matmul_tiling_table_data.h"
+
+static_assert(IsMatmulTilingTableSorted(MATMUL_TILING_TABLE), "tiling table must be sorted by key");
+#endif
+
+/*
+ * Tiling selection of MatmulLeakyreluCustom, shared by TilingFunc and the build-time table generator
+ * (TilingTableGen/matmul_tiling_table_gen.cpp).
+ */
+
+inline uint32_t GetEnvU32(const char *name, uint32_t defaultValue)
+{
+    const char *value = std::getenv(name);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    char *end = nullptr;
+    unsigned long parsed = std::strtoul(value, &end, 10);
+    if (end == value || *end != '\0') {
+        return defaultValue;
+    }
+    return static_cast<uint32_t>(parsed);
+}
+
+inline bool TryGenerateOnce(const platform_ascendc::PlatformAscendC &platform, optiling::TCubeTiling &cubeTilingData,
+                            uint32_t M, uint32_t N, uint32_t K, const MatmulTuneConfig &config,
+                            matmul_tiling::DataType abType)
+{
+    using namespace matmul_tiling;
+    MultiCoreMatmulTiling tilingApi(platform);
+    tilingApi.SetDim(config.coreNum);
+    tilingApi.SetAType(TPosition::GM, CubeFormat::ND, abType, false);
+    tilingApi.SetBType(TPosition::GM, CubeFormat::ND, abType, false);
+    tilingApi.SetCType(TPosition::VECIN, CubeFormat::ND, DataType::DT_FLOAT);
+    tilingApi.SetBiasType(TPosition::GM, CubeFormat::ND, DataType::DT_FLOAT);
+    tilingApi.SetOrgShape(M, N, K);
+    tilingApi.SetShape(M, N, K);
+    tilingApi.SetBias(true);
+    tilingApi.SetTraverse(config.traverse == 1U ? MatrixTraverse::FIRSTN : MatrixTraverse::FIRSTM);
+    tilingApi.SetFixSplit(config.baseM, config.baseN, -1);
+    // reluInQueue/reluOutQueue live in UB next to the matmul API buffers. singleCoreM is a multiple of baseM
+    // for every accepted tiling, so the kernel's split only depends on baseM/baseN.
+    const uint32_t abElemSize = abType == DataType::DT_FLOAT ? 4U : 2U;
+    const uint32_t baseM = static_cast<uint32_t>(config.baseM);
+    const uint32_t baseN = static_cast<uint32_t>(config.baseN);
+    const MatmulCoreMemory coreMem = MakeMatmulCoreMemory(platform);
+    const uint64_t kernelUbBytes = LeakyReluKernelUbBytes(baseM, baseN, LeakyReluSplitRowNums(baseM, baseN, baseM));
+    if (!SetMatmulBufferBudget(tilingApi, coreMem, kernelUbBytes)) {
+        return false;
+    }
+
+    if (tilingApi.GetTiling(cubeTilingData) == -1) {
+        return false;
+    }
+    if (!ApplyMatmulTuneConfig(cubeTilingData, config, coreMem.l1, abElemSize)) {
+        return false;
+    }
+
+    const bool invalidTileShape = (cubeTilingData.singleCoreM < cubeTilingData.baseM) ||
+                                  (cubeTilingData.singleCoreN < cubeTilingData.baseN) ||
+                                  (cubeTilingData.singleCoreM % cubeTilingData.baseM != 0U) ||
+                                  (cubeTilingData.singleCoreN % cubeTilingData.baseN != 0U);
+    if (invalidTileShape) {
+        return false;
+    }
+    const char *overflow = nullptr;
+    if (!MatmulMemoryFits(MatmulTilingMemoryUse(cubeTilingData, abElemSize, true, kernelUbBytes), coreMem, &overflow)) {
+        std::cout << "reject tiling baseM=" << baseM << " baseN=" << baseN << " core=" << config.coreNum << ": "
+                  << overflow << " overflow" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+struct MatmulLeakyTilingChoice {
+    MatmulTuneConfig config;
+    const char *source = "model"; // "db", "table" or "model"
+    double estCycles = 0.0;
+};
+
+/**
+  * @brief  Pick the tiling of one shape: MATMUL_TUNING_DB (written by matmul_autotune), then the build-time
+  *         table, then the cost-model plans cheapest first.
+  * @param  forceCore: MATMUL_FORCE_CORE_NUM, 0 lets the model choose up to the platform AIV count.
+  */
+inline bool SelectMatmulLeakyTiling(const platform_ascendc::PlatformAscendC &platform, optiling::TCubeTiling &cubeTilingData,
+                                    uint32_t M, uint32_t N, uint32_t K, bool isFp32, uint32_t forceCore,
+                                    MatmulLeakyTilingChoice &choice)
+{
+    const matmul_tiling::DataType abType = isFp32 ? matmul_tiling::DataType::DT_FLOAT : matmul_tiling::DataType::DT_FLOAT16;
+    const MatmulCostPlatform costPlatform = MakeMatmulCostPlatform(platform);
+    const MatmulCostShape shape = {M, N, K, isFp32 ? 4U : 2U};
+    const uint32_t forceBaseM = GetEnvU32("MATMUL_FORCE_BASE_M", 0U);
+    const uint32_t forceBaseN = GetEnvU32("MATMUL_FORCE_BASE_N", 0U);
+
+    const MatmulTuneEntry *tuned = MatmulTuningDb::Global().Find(
+        {MatmulTuneSocName(costPlatform.is310p), costPlatform.aivCoreNum, M, N, K, shape.abElemSize});
+    if (tuned != nullptr && (forceCore == 0U || tuned->config.coreNum <= forceCore) &&
+        TryGenerateOnce(platform, cubeTilingData, M, N, K, tuned->config, abType)) {
+        choice.config = tuned->config;
+        choice.source = "db";
+        return true;
+    }
+#ifdef MATMUL_TILING_TABLE_ENABLE
+    // The table holds the model-chosen config (no core cap, no forced split) of the SoC it was built for.
+    if (forceCore == 0U && forceBaseM == 0U && forceBaseN == 0U &&
+        std::strcmp(MatmulTuneSocName(costPlatform.is310p), MATMUL_TILING_TABLE_SOC) == 0 &&
+        costPlatform.aivCoreNum == MATMUL_TILING_TABLE_AIV_CORES) {
+        const int32_t index = FindMatmulTilingEntry(MATMUL_TILING_TABLE, {M, N, K, shape.abElemSize});
+        if (index >= 0) {
+            const MatmulTilingConfigEntry &entry = MATMUL_TILING_TABLE[index];
+            MatmulTuneConfig config;
+            config.baseM = entry.baseM;
+            config.baseN = entry.baseN;
+            config.coreNum = entry.coreNum;
+            config.stepM = entry.stepM;
+            config.stepN = entry.stepN;
+            config.depthScale = entry.depthScale;
+            config.traverse = entry.traverse;
+            if (TryGenerateOnce(platform, cubeTilingData, M, N, K, config, abType)) {
+                choice.config = config;
+                choice.source = "table";
+                return true;
+            }
+        }
+    }
+#endif
+
+    const std::vector<MatmulPlan> plans = RankMatmulPlans(
+        costPlatform, shape, forceCore > 0U ? forceCore : costPlatform.aivCoreNum, forceBaseM, forceBaseN);
+    for (size_t i = 0; i < plans.size(); ++i) {
+        MatmulTuneConfig config;
+        config.baseM = plans[i].baseM;
+        config.baseN = plans[i].baseN;
+        config.coreNum = plans[i].coreNum;
+        if (TryGenerateOnce(platform, cubeTilingData, M, N, K, config, abType)) {
+            choice.config = config;
+            choice.source = "model";
+            choice.estCycles = plans[i].cycles;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // MATMUL_LEAKYRELU_TILING_SEARCH_H
@@ -9,6 +9,7 @@
  */
 #include "kernel_operator.h"
 #include "lib/matmul_intf.h"
+#include "kernel_tracer.h"
 
 using namespace matmul;
 
@@ -20,6 +21,7 @@ __aicore__ inline uint32_t Ceiling(uint32_t a, uint32_t b)
 __aicore__ inline uint32_t SelectSplitRowNums(const TCubeTiling &tiling)
 {
     // Keep splitRowNums power-of-two for cheap division and stable row slicing.
+    // Mirrored on the host by LeakyReluSplitRowNums (matmul_memory_plan.h) to budget UB.
     uint32_t split = 8;
     if (tiling.baseM < 256U) {
         split = 4U;
@@ -71,6 +73,7 @@ public:
     uint32_t splitRowSize = 0;
     uint32_t roundM = 0;
     AscendC::DataCopyParams copyParam = {0, 0, 0, 0};
+    KernelTracer tracer;
 };
 
 template <typename aType, typename bType, typename cType, typename biasType>
@@ -78,6 +81,7 @@ __aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::Init(GM
                                                                                GM_ADDR c, GM_ADDR workspace,
                                                                                const TCubeTiling &tiling, AscendC::TPipe *pipe)
 {
+    tracer.Init(GetKernelTraceGm(workspace, static_cast<uint64_t>(tiling.M) * tiling.N * sizeof(cType)));
     this->tiling = tiling;
     splitRowNums = SelectSplitRowNums(tiling);
     splitRowSize = tiling.baseM / splitRowNums;
@@ -116,17 +120,32 @@ __aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::Process
     matmulObj.SetTensorA(aGlobal);
     matmulObj.SetTensorB(bGlobal);
     matmulObj.SetBias(biasGlobal);
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(true); // fp32 A/B use the reduced-precision cube mode instead of a cast pass.
+    }
+    int64_t start = tracer.Begin();
     matmulObj.template Iterate<false>();
+    tracer.End(TRACE_PHASE_ITERATE, 0, start);
     for (int32_t i = 0; i < static_cast<int32_t>(tiling.singleCoreM * tiling.singleCoreN / (tiling.baseM * tiling.baseN)); ++i) {
+        start = tracer.Begin();
         MatmulCompute();
         reluInLocal = reluInQueue.DeQue<cType>();
+        tracer.End(TRACE_PHASE_GET_TENSOR_C, i, start);
         for (uint32_t j = 0; j < splitRowNums; ++j) {
+            start = tracer.Begin();
             LeakyReluCompute(j);
+            tracer.End(TRACE_PHASE_COMPUTE, i * splitRowNums + j, start);
+            start = tracer.Begin();
             CopyOut(i * splitRowNums + j);
+            tracer.End(TRACE_PHASE_COPY_OUT, i * splitRowNums + j, start);
         }
         reluInQueue.FreeTensor(reluInLocal);
     }
     matmulObj.End();
+    if constexpr (AscendC::IsSameType<aType, float>::value) {
+        matmulObj.SetHF32(false);
+    }
+    tracer.Flush();
 }
 
 template <typename aType, typename bType, typename cType, typename biasType>
@@ -150,6 +169,12 @@ __aicore__ inline void MatmulLeakyKernel<aType, bType, cType, biasType>::CopyOut
 {
     auto reluOutLocal = reluOutQueue.DeQue<cType>();
     uint32_t startOffset = (count % roundM * splitRowSize * tiling.N + count / roundM * tiling.baseN);
+    if (tiling.iterateOrder == 1) { // FIRSTN: Iterate walks the N tiles of one M row first.
+        const uint32_t roundN = tiling.singleCoreN / tiling.baseN;
+        const uint32_t tile = count / splitRowNums;
+        const uint32_t row = tile / roundN * splitRowNums + count % splitRowNums;
+        startOffset = row * splitRowSize * tiling.N + tile % roundN * tiling.baseN;
+    }
     DataCopy(cGlobal[startOffset], reluOutLocal, copyParam);
     reluOutQueue.FreeTensor(reluOutLocal);
 }
@@ -175,7 +200,7 @@ extern "C" __global__ __aicore__ void matmul_leakyrelu_custom(GM_ADDR a, GM_ADDR
 {
     GET_TILING_DATA(tilingData, tilingGm);
 
-    MatmulLeakyKernel<half, half, float, float> matmulLeakyKernel;
+    MatmulLeakyKernel<DTYPE_A, DTYPE_B, float, float> matmulLeakyKernel;
     AscendC::TPipe pipe;
     REGIST_MATMUL_OBJ(&pipe, GetSysWorkSpacePtr(), matmulLeakyKernel.matmulObj, &tilingData.cubeTilingData);
     matmulLeakyKernel.Init(a, b, bias, c, workspace, tilingData.cubeTilingData, &pipe);
@@ -0,0 +1,98 @@
+/**
+ * @file matmul_tiling_table_gen.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "matmul_leakyrelu_tiling_search.h"
+#include "tiling/platform/platform_ascendc.h"
+
+namespace {
+
+bool WriteTable(const std::string &path, const std::string &manifest, const MatmulCostPlatform &costPlatform,
+                const std::vector<MatmulTilingConfigEntry> &entries)
+{
+    std::ofstream out(path.c_str(), std::ios::trunc);
+    if (!out.is_open()) {
+        return false;
+    }
+    out << "// Generated by matmul_tiling_table_gen from " << manifest << ", do not edit.\n"
+        << "#ifndef MATMUL_TILING_TABLE_DATA_H\n#define MATMUL_TILING_TABLE_DATA_H\n\n"
+        << "#include <cstdint>\n\n#include \"matmul_tiling_table.h\"\n\n"
+        << "constexpr char MATMUL_TILING_TABLE_SOC[] = \"" << MatmulTuneSocName(costPlatform.is310p) << "\";\n"
+        << "constexpr uint32_t MATMUL_TILING_TABLE_AIV_CORES = " << costPlatform.aivCoreNum << "U;\n\n"
+        << "// key {M, N, K, abElemSize}, baseM, baseN, coreNum, stepM, stepN, depthScale, traverse\n"
+        << "constexpr MatmulTilingConfigEntry MATMUL_TILING_TABLE[] = {\n";
+    for (const auto &e : entries) {
+        out << "    {{" << e.key.M << "U, " << e.key.N << "U, " << e.key.K << "U, " << e.key.abElemSize << "U}, " << e.baseM
+            << ", " << e.baseN << ", " << e.coreNum << "U, " << e.stepM << "U, " << e.stepN << "U, " << e.depthScale
+            << "U, " << e.traverse << "U},\n";
+    }
+    out << "};\n\n#endif // MATMUL_TILING_TABLE_DATA_H\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+/**
+  * @brief  Build-time tiling table generator of the op package:
+  *         matmul_tiling_table_gen <soc version> <manifest> <output header>, run by install.sh.
+  */
+int32_t main(int32_t argc, char *argv[])
+{
+    if (argc != 4) {
+        std::fprintf(stderr, "usage: %s <soc version> <shape manifest> <output header>\n", argv[0]);
+        return 1;
+    }
+    auto platform = platform_ascendc::PlatformAscendCManager::GetInstance(argv[1]);
+    if (platform == nullptr) {
+        std::fprintf(stderr, "[ERROR] unknown soc version %s\n", argv[1]);
+        return 1;
+    }
+    bool ok = false;
+    std::vector<MatmulTilingTableKey> keys = LoadMatmulShapeManifest(argv[2], ok);
+    if (!ok || keys.empty()) {
+        std::fprintf(stderr, "[ERROR] cannot parse shape manifest %s\n", argv[2]);
+        return 1;
+    }
+    std::sort(keys.begin(), keys.end(), MatmulTilingKeyLess);
+    keys.erase(std::unique(keys.begin(), keys.end(), MatmulTilingKeyEqual), keys.end());
+
+    const MatmulCostPlatform costPlatform = MakeMatmulCostPlatform(*platform);
+    std::vector<MatmulTilingConfigEntry> entries;
+    for (const auto &key : keys) {
+        if (key.abElemSize == 4U && costPlatform.is310p) {
+            std::printf("[WARN] skip fp32 shape M=%u N=%u K=%u, 310P has no HF32\n", key.M, key.N, key.K);
+            continue;
+        }
+        optiling::TCubeTiling cubeTilingData;
+        MatmulLeakyTilingChoice choice;
+        if (!SelectMatmulLeakyTiling(*platform, cubeTilingData, key.M, key.N, key.K, key.abElemSize == 4U, 0U, choice)) {
+            std::fprintf(stderr, "[ERROR] no tiling for M=%u N=%u K=%u\n", key.M, key.N, key.K);
+            return 1;
+        }
+        const MatmulTilingConfigEntry entry = {key, choice.config.baseM, choice.config.baseN, choice.config.coreNum,
+                                               choice.config.stepM, choice.config.stepN, choice.config.depthScale,
+                                               choice.config.traverse};
+        entries.push_back(entry);
+    }
+    if (entries.empty()) {
+        std::fprintf(stderr, "[ERROR] no shape of %s applies to %s\n", argv[2], argv[1]);
+        return 1;
+    }
+    if (!WriteTable(argv[3], argv[2], costPlatform, entries)) {
+        std::fprintf(stderr, "[ERROR] cannot write %s\n", argv[3]);
+        return 1;
+    }
+    std::printf("[INFO] tiling table with %zu shapes written to %s\n", entries.size(), argv[3]);
+    return 0;
+}
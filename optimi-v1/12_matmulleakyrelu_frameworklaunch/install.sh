@@ -1,7 +1,7 @@
 #!/bin/bash
 set -e
-SHORT=v:,i:
-LONG=soc-version:,install-path:
+SHORT=v:,i:,t,m:
+LONG=soc-version:,install-path:,kernel-trace,tiling-manifest:
 OPTS=$(getopt -a --options $SHORT --longoptions $LONG -- "$@")
 eval set -- "$OPTS"
 
@@ -16,6 +16,14 @@ while :; do
         ASCEND_INSTALL_PATH="$2"
         shift 2
         ;;
+    -t | --kernel-trace)
+        KERNEL_TRACE=1
+        shift 1
+        ;;
+    -m | --tiling-manifest)
+        TILING_MANIFEST="$2"
+        shift 2
+        ;;
     --)
         shift
         break
@@ -37,6 +45,21 @@ rm -rf CustomOp
 
 msopgen gen -i ${OP_NAME}.json -c ai_core-${SOC_VERSION} -lan cpp -out CustomOp
 cp -rf ${OP_NAME}/* CustomOp
+# Shared headers: trace layout (op_host workspace sizing, op_kernel recording) and the tiling cost model
+cp -f ../common/kernel_trace.h ../common/matmul_cost_model.h ../common/matmul_memory_plan.h ../common/matmul_tiling_table.h \
+    ../common/matmul_tuning_db.h CustomOp/op_host/
+cp -f ../common/kernel_trace.h ../common/kernel_tracer.h CustomOp/op_kernel/
+if [ "${KERNEL_TRACE:-0}" -eq 1 ]; then
+    sed -i '1i add_compile_definitions(KERNEL_TRACE)' CustomOp/op_host/CMakeLists.txt
+    sed -i '1i add_ops_compile_options(ALL OPTIONS -DKERNEL_TRACE)' CustomOp/op_kernel/CMakeLists.txt
+fi
+# Build-time tiling table: run the tiling search for every manifest shape now, TilingFunc replays the result
+if [ -n "${TILING_MANIFEST:-}" ]; then
+    cmake -S TilingTableGen -B build_tiling_gen
+    cmake --build build_tiling_gen -j
+    ./build_tiling_gen/matmul_tiling_table_gen ${SOC_VERSION} ${TILING_MANIFEST} CustomOp/op_host/matmul_tiling_table_data.h
+    sed -i '1i add_compile_definitions(MATMUL_TILING_TABLE_ENABLE)' CustomOp/op_host/CMakeLists.txt
+fi
 (cd CustomOp && bash build.sh)
 
 echo "[INFO]: install build done. SOC_VERSION=${SOC_VERSION}, ASCEND_HOME_PATH=${_ASCEND_INSTALL_PATH}"
@@ -13,7 +13,9 @@
 #include <vector>
 
 #include "acl/acl.h"
+#include "acl_mem_pool.h"
 #include "aclnn_reduce_custom.h"
+#include "kernel_trace_decoder.h"
 
 #define SUCCESS 0
 #define FAILED 1
@@ -57,9 +59,9 @@ int CreateAclTensor(const std::vector<T> &hostData, const std::vector<int64_t> &
                     aclDataType dataType, aclTensor **tensor)
 {
     auto size = GetShapeSize(shape) * sizeof(T);
-    // Call aclrtMalloc to allocate device memory
-    auto ret = aclrtMalloc(deviceAddr, size, ACL_MEM_MALLOC_HUGE_FIRST);
-    CHECK_RET(ret == ACL_SUCCESS, LOG_PRINT("aclrtMalloc failed. ERROR: %d\n", ret); return FAILED);
+    // Device memory comes from the caching pool, DestroyResources trims it before the device is reset
+    auto ret = AclMemPool::Instance().Malloc(deviceAddr, size, AclMemKind::DEVICE);
+    CHECK_RET(ret == ACL_SUCCESS, LOG_PRINT("malloc device memory failed. ERROR: %d\n", ret); return FAILED);
 
     // Call aclrtMemcpy to copy host data to device memory
     ret = aclrtMemcpy(*deviceAddr, size, hostData.data(), size, ACL_MEMCPY_HOST_TO_DEVICE);
@@ -80,12 +82,14 @@ void DestroyResources(std::vector<void *> tensors, std::vector<void *> deviceAdd
             aclDestroyTensor(reinterpret_cast<aclTensor *>(tensors[i]));
         }
         if (deviceAddrs[i] != nullptr) {
-            aclrtFree(deviceAddrs[i]);
+            AclMemPool::Instance().Free(deviceAddrs[i]);
         }
     }
     if (workspaceAddr != nullptr) {
-        aclrtFree(workspaceAddr);
+        AclMemPool::Instance().Free(workspaceAddr);
     }
+    AclMemPool::Instance().Report();
+    AclMemPool::Instance().Trim();
     // Destroy stream and reset device
     aclrtDestroyStream(stream);
     aclrtResetDevice(deviceId);
@@ -137,10 +141,18 @@ int main(int argc, char **argv)
 
     void *workspaceAddr = nullptr;
     if (workspaceSize > 0) {
-        ret = aclrtMalloc(&workspaceAddr, workspaceSize, ACL_MEM_MALLOC_HUGE_FIRST);
+        ret = AclMemPool::Instance().Malloc(&workspaceAddr, workspaceSize, AclMemKind::DEVICE);
         CHECK_RET(ret == ACL_SUCCESS, LOG_PRINT("allocate workspace failed. ERROR: %d\n", ret);
                   DestroyResources(tensors, deviceAddrs, stream, deviceId, workspaceAddr); return FAILED);
     }
+    // With KERNEL_TRACE the op_host appends the trace region at the tail of the workspace
+    const char *traceFile = getenv("KERNEL_TRACE_FILE");
+    bool dumpTrace = (traceFile != nullptr) && (workspaceAddr != nullptr) && (workspaceSize >= KERNEL_TRACE_BYTES);
+    void *traceDevice = nullptr;
+    if (dumpTrace) {
+        traceDevice = static_cast<uint8_t *>(workspaceAddr) + workspaceSize - KERNEL_TRACE_BYTES;
+        (void)aclrtMemset(traceDevice, KERNEL_TRACE_BYTES, 0, KERNEL_TRACE_BYTES);
+    }
     // Execute the custom operator
     ret = aclnnReduceCustom(workspaceAddr, workspaceSize, executor, stream);
     CHECK_RET(ret == ACL_SUCCESS, LOG_PRINT("aclnnAdd failed. ERROR: %d\n", ret);
@@ -150,6 +162,15 @@ int main(int argc, char **argv)
     ret = aclrtSynchronizeStream(stream);
     CHECK_RET(ret == ACL_SUCCESS, LOG_PRINT("aclrtSynchronizeStream failed. ERROR: %d\n", ret);
               DestroyResources(tensors, deviceAddrs, stream, deviceId, workspaceAddr); return FAILED);
+    if (dumpTrace) {
+        std::vector<uint8_t> trace(KERNEL_TRACE_BYTES);
+        ret = aclrtMemcpy(trace.data(), trace.size(), traceDevice, KERNEL_TRACE_BYTES, ACL_MEMCPY_DEVICE_TO_HOST);
+        if (ret == ACL_SUCCESS) {
+            (void)DumpKernelTrace(trace.data(), trace.size(), traceFile, "aclnnReduceCustom");
+        } else {
+            LOG_PRINT("copy kernel trace failed. ERROR: %d\n", ret);
+        }
+    }
 
     // 5. Get the output value, copy the result from device memory to host memory, need to modify according to the
     // interface of the API
@@ -8,7 +8,9 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "reduce_custom_tiling.h"
+#include "kernel_trace.h"
 #include "register/op_def_registry.h"
+#include "tiling/platform/platform_ascendc.h"
 
 namespace optiling {
 constexpr uint32_t REDUCE_TILING_1 = 1;
@@ -71,7 +73,12 @@ static ge::graphStatus TilingFunc(gert::TilingContext *context)
     tiling.SaveToBuffer(context->GetRawTilingData()->GetData(), context->GetRawTilingData()->GetCapacity());
     context->GetRawTilingData()->SetDataSize(tiling.GetDataSize());
     size_t *currentWorkspace = context->GetWorkspaceSizes(1);
+#ifdef KERNEL_TRACE
+    auto ascendcPlatform = platform_ascendc::PlatformAscendC(context->GetPlatformInfo());
+    currentWorkspace[0] = static_cast<size_t>(ascendcPlatform.GetLibApiWorkSpaceSize()) + KERNEL_TRACE_BYTES;
+#else
     currentWorkspace[0] = 0;
+#endif
     return ge::GRAPH_SUCCESS;
 }
 } // namespace optiling
@@ -8,6 +8,7 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "kernel_operator.h"
+#include "kernel_tracer.h"
 #define REDUCE_TILING_1 1
 #define REDUCE_TILING_2 2
 #define REDUCE_TILING_3 3
@@ -27,8 +28,9 @@ static constexpr uint32_t ONE_REPEAT_FLOAT_SIZE = REP_LEN / 4;
 static constexpr uint32_t BINARY_BOUNDARY = DEFAULT_REP_STRIDE * 2;
 public:
     __aicore__ inline KernelReduce() {}
-    __aicore__ inline void Init(GM_ADDR x, GM_ADDR z, uint32_t totalLength, uint32_t outLength)
+    __aicore__ inline void Init(GM_ADDR x, GM_ADDR z, GM_ADDR traceGm, uint32_t totalLength, uint32_t outLength)
     {
+        tracer.Init(traceGm);
         this->totalLength = totalLength;
         this->outLength = outLength;
 
@@ -57,9 +59,16 @@ public:
     template<size_t ComputeKey = 0>
     __aicore__ inline void Process()
     {
+        int64_t start = tracer.Begin();
         CopyIn();
+        tracer.End(TRACE_PHASE_COPY_IN, 0, start);
+        start = tracer.Begin();
         Compute<ComputeKey>();
+        tracer.End(TRACE_PHASE_COMPUTE, ComputeKey, start);
+        start = tracer.Begin();
         CopyOut();
+        tracer.End(TRACE_PHASE_COPY_OUT, 0, start);
+        tracer.Flush();
     }
 
 private:
@@ -137,10 +146,7 @@ private:
         AscendC::LocalTensor<DTYPE> xLocal = inQueueX.DeQue<DTYPE>();
         AscendC::LocalTensor<DTYPE> zLocal = outQueueZ.AllocTensor<DTYPE>();
 
-        int64_t start = AscendC::GetSystemCycle();
         WholeReduceSumImpl(zLocal, xLocal, 1, totalLength);
-        int64_t runCycle = AscendC::GetSystemCycle() - start;
-        (void)runCycle;
 
         outQueueZ.EnQue<DTYPE>(zLocal);
         inQueueX.FreeTensor(xLocal);
@@ -151,10 +157,7 @@ private:
         AscendC::LocalTensor<DTYPE> xLocal = inQueueX.DeQue<DTYPE>();
         AscendC::LocalTensor<DTYPE> zLocal = outQueueZ.AllocTensor<DTYPE>();
 
-        int64_t start = AscendC::GetSystemCycle();
         BinaryReduceSumImpl(zLocal, xLocal, 1, totalLength);
-        int64_t runCycle = AscendC::GetSystemCycle() - start;
-        (void)runCycle;
 
         outQueueZ.EnQue<DTYPE>(zLocal);
         inQueueX.FreeTensor(xLocal);
@@ -222,6 +225,7 @@ private:
     AscendC::TBuf<AscendC::TPosition::VECCALC> calcBuf;
     AscendC::GlobalTensor<DTYPE> xGm;
     AscendC::GlobalTensor<DTYPE> zGm;
+    KernelTracer tracer;
     uint32_t totalLength;
     uint32_t outLength;
 };
@@ -229,37 +233,38 @@ private:
 extern "C" __global__ __aicore__ void reduce_custom(GM_ADDR x, GM_ADDR z, GM_ADDR workspace, GM_ADDR tiling)
 {
     GET_TILING_DATA(tiling_data, tiling);
+    GM_ADDR traceGm = GetKernelTraceGm(workspace, 0);
     if (TILING_KEY_IS(REDUCE_TILING_1)) {
         KernelReduce<float> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_1>();
     } else if (TILING_KEY_IS(REDUCE_TILING_2)) {
         KernelReduce<float> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_2>();
     } else if (TILING_KEY_IS(REDUCE_TILING_3)) {
         KernelReduce<float> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_3>();
     } else if (TILING_KEY_IS(REDUCE_TILING_4)) {
         KernelReduce<float> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_4>();
     } else if (TILING_KEY_IS(REDUCE_TILING_5)) {
         KernelReduce<float> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_5>();
     } else if (TILING_KEY_IS(REDUCE_TILING_F16_1)) {
         KernelReduce<half> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_1>();
     } else if (TILING_KEY_IS(REDUCE_TILING_F16_2)) {
         KernelReduce<half> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_2>();
     } else if (TILING_KEY_IS(REDUCE_TILING_F16_3)) {
         KernelReduce<half> op;
-        op.Init(x, z, tiling_data.totalLength, tiling_data.outLength);
+        op.Init(x, z, traceGm, tiling_data.totalLength, tiling_data.outLength);
         op.Process<REDUCE_TILING_3>();
     }
 }
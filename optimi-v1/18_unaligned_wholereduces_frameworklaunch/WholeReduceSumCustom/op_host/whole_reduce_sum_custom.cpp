@@ -8,6 +8,7 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "whole_reduce_sum_custom_tiling.h"
+#include "kernel_trace.h"
 #include <algorithm>
 #include <cstdlib>
 #include "register/op_def_registry.h"
@@ -66,7 +67,11 @@ static ge::graphStatus TilingFunc(gert::TilingContext *context)
     tiling.SaveToBuffer(context->GetRawTilingData()->GetData(), context->GetRawTilingData()->GetCapacity());
     context->GetRawTilingData()->SetDataSize(tiling.GetDataSize());
     size_t *currentWorkspace = context->GetWorkspaceSizes(1);
+#ifdef KERNEL_TRACE
+    currentWorkspace[0] = static_cast<size_t>(ascendcPlatform.GetLibApiWorkSpaceSize()) + KERNEL_TRACE_BYTES;
+#else
     currentWorkspace[0] = 0;
+#endif
     return ge::GRAPH_SUCCESS;
 }
 } // namespace optiling
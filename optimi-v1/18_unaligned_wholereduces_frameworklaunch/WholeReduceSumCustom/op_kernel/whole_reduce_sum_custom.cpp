@@ -8,6 +8,7 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "kernel_operator.h"
+#include "kernel_tracer.h"
 #include "whole_reduce_sum_custom_tiling.h"
 
 constexpr uint32_t byteAlign = 32;
@@ -21,8 +22,9 @@ __aicore__ inline uint32_t ceil_div(uint32_t a, uint32_t b)
 template <typename datatype> class KernelAdd {
 public:
     __aicore__ inline KernelAdd() {}
-    __aicore__ inline void Init(GM_ADDR x, GM_ADDR y, WholeReduceSumCustomTilingData tilingData)
+    __aicore__ inline void Init(GM_ADDR x, GM_ADDR y, GM_ADDR traceGm, WholeReduceSumCustomTilingData tilingData)
     {
+        tracer.Init(traceGm);
         this->rows = tilingData.rows;
         this->cols = tilingData.cols;
         this->totalLength = tilingData.totalLength;
@@ -50,9 +52,16 @@ public:
         if (!this->isActive) {
             return;
         }
+        int64_t start = tracer.Begin();
         CopyIn();
+        tracer.End(TRACE_PHASE_COPY_IN, this->rowCount, start);
+        start = tracer.Begin();
         Compute();
+        tracer.End(TRACE_PHASE_COMPUTE, this->rowCount, start);
+        start = tracer.Begin();
         CopyOut();
+        tracer.End(TRACE_PHASE_COPY_OUT, this->rowCount, start);
+        tracer.Flush();
     }
 
 private:
@@ -92,6 +101,7 @@ private:
     AscendC::TQue<AscendC::TPosition::VECOUT, 1> outQueueY;
     AscendC::GlobalTensor<datatype> xGm;
     AscendC::GlobalTensor<datatype> yGm;
+    KernelTracer tracer;
     uint32_t totalLength;
     uint32_t rows;
     uint32_t cols;
@@ -118,7 +128,7 @@ extern "C" __global__ __aicore__ void whole_reduce_sum_custom(GM_ADDR x, GM_ADDR
     KernelAdd<half> op;
     WholeReduceSumCustomTilingData tilingData;
     CopyTiling(&tilingData, tiling);
-    op.Init(x, y, tilingData);
+    op.Init(x, y, GetKernelTraceGm(workspace, 0), tilingData);
     op.Process();
 }
 
@@ -1,6 +1,6 @@
 #!/bin/bash
-SHORT=v:,i:,
-LONG=soc-version:,install-path:,
+SHORT=v:,i:,t,
+LONG=soc-version:,install-path:,kernel-trace,
 OPTS=$(getopt -a --options $SHORT --longoptions $LONG -- "$@")
 eval set -- "$OPTS"
 
@@ -14,6 +14,10 @@ while :; do
         ASCEND_INSTALL_PATH="$2"
         shift 2
         ;;
+    -t | --kernel-trace)
+        KERNEL_TRACE=1
+        shift 1
+        ;;
     --)
         shift
         break
@@ -41,5 +45,12 @@ rm -rf CustomOp
 msopgen gen -i $OP_NAME.json -c ai_core-${SOC_VERSION} -lan cpp -out CustomOp
 # Copy op implementation files to CustomOp
 cp -rf $OP_NAME/* CustomOp
+# Trace layout is shared by op_host (workspace sizing) and op_kernel (recording)
+cp -f ../common/kernel_trace.h CustomOp/op_host/
+cp -f ../common/kernel_trace.h ../common/kernel_tracer.h CustomOp/op_kernel/
+if [ "${KERNEL_TRACE:-0}" -eq 1 ]; then
+    sed -i '1i add_compile_definitions(KERNEL_TRACE)' CustomOp/op_host/CMakeLists.txt
+    sed -i '1i add_ops_compile_options(ALL OPTIONS -DKERNEL_TRACE)' CustomOp/op_kernel/CMakeLists.txt
+fi
 # Build CustomOp project
 (cd CustomOp && bash build.sh)
@@ -8,6 +8,7 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "broadcast_custom_tiling.h"
+#include "kernel_trace.h"
 #include "register/op_def_registry.h"
 #include "tiling/tiling_api.h"
 
@@ -111,7 +112,11 @@ static ge::graphStatus TilingFunc(gert::TilingContext *context)
     tiling.SaveToBuffer(context->GetRawTilingData()->GetData(), context->GetRawTilingData()->GetCapacity());
     context->GetRawTilingData()->SetDataSize(tiling.GetDataSize());
     size_t *currentWorkSpace = context->GetWorkspaceSizes(1);
+#ifdef KERNEL_TRACE
+    currentWorkSpace[0] = static_cast<size_t>(ascendcPlatform.GetLibApiWorkSpaceSize()) + KERNEL_TRACE_BYTES;
+#else
     currentWorkSpace[0] = 0;
+#endif
     return ge::GRAPH_SUCCESS;
 }
 } // namespace optiling
@@ -8,14 +8,16 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
  */
 #include "kernel_operator.h"
+#include "kernel_tracer.h"
 constexpr int32_t BUFFER_NUM = 1;
 
 class KernelBroadcastCustom {
 public:
     __aicore__ inline KernelBroadcastCustom() {}
-    __aicore__ inline void Init(GM_ADDR x, GM_ADDR y, uint32_t totalLength, uint32_t tilenum, uint32_t tmpSize,
-                                uint32_t dim, uint32_t axis, uint32_t num, uint32_t bLength)
+    __aicore__ inline void Init(GM_ADDR x, GM_ADDR y, GM_ADDR traceGm, uint32_t totalLength, uint32_t tilenum,
+                                uint32_t tmpSize, uint32_t dim, uint32_t axis, uint32_t num, uint32_t bLength)
     {
+        tracer.Init(traceGm);
         const uint32_t blockNum = AscendC::GetBlockNum();
         const uint32_t blockIdx = AscendC::GetBlockIdx();
         const uint32_t baseLen = totalLength / blockNum;
@@ -67,13 +69,20 @@ public:
         }
         int32_t loopCount = this->tilenum * BUFFER_NUM;
         for (int32_t i = 0; i < loopCount; i++) {
+            int64_t start = tracer.Begin();
             CopyIn(i);
+            tracer.End(TRACE_PHASE_COPY_IN, i, start);
+            start = tracer.Begin();
             Compute(i, hasTmp, tmpTensor);
+            tracer.End(TRACE_PHASE_COMPUTE, i, start);
+            start = tracer.Begin();
             CopyOut(i);
+            tracer.End(TRACE_PHASE_COPY_OUT, i, start);
         }
         if (hasTmp) {
             tmpQueue.FreeTensor(tmpTensor);
         }
+        tracer.Flush();
     }
 
 private:
@@ -137,6 +146,7 @@ private:
     AscendC::TBuf<AscendC::TPosition::VECCALC> tmpQueue;
     AscendC::GlobalTensor<DTYPE_X> xGm;
     AscendC::GlobalTensor<DTYPE_Y> yGm;
+    KernelTracer tracer;
     uint32_t blockLength;
     uint32_t tilenum;
     uint32_t tileLength;
@@ -153,8 +163,8 @@ extern "C" __global__ __aicore__ void broadcast_custom(GM_ADDR x, GM_ADDR y, GM_
 {
     GET_TILING_DATA(tilingData, tiling);
     KernelBroadcastCustom op;
-    op.Init(x, y, tilingData.totalLength, tilingData.tilenum, tilingData.tmpSize, tilingData.dim, tilingData.axis,
-            tilingData.num, tilingData.bLength);
+    op.Init(x, y, GetKernelTraceGm(workspace, 0), tilingData.totalLength, tilingData.tilenum, tilingData.tmpSize,
+            tilingData.dim, tilingData.axis, tilingData.num, tilingData.bLength);
     if (TILING_KEY_IS(1)) {
         op.Process();
     }
@@ -0,0 +1,403 @@
+/**
+ * @file main.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "acl_mem_pool.h"
+#include "bench_stats.h"
+#include "env_config.h"
+#include "op_bench.h"
+#include "tiling/platform/platform_ascendc.h"
+
+namespace {
+
+/**
+  * @brief  op_bench [spec] [op]: every case of the spec (default ./bench_cases.txt), or only those of op, gets
+  *         OP_BENCH_WARMUP untimed and OP_BENCH_ITERS timed iterations. Samples further than OP_BENCH_OUTLIER_MAD
+  *         scaled MADs from the median are dropped before the statistics (0 keeps all of them).
+  */
+struct OpBenchConfig {
+    const char *specPath;
+    const char *filter;
+    uint32_t warmup;
+    uint32_t iterations;
+    double outlierMad;
+    const char *jsonPath; // OP_BENCH_JSON, default ./output/op_bench.json
+    const char *csvPath;  // OP_BENCH_CSV, default ./output/op_bench.csv
+};
+
+OpBenchConfig GetOpBenchConfig(int32_t argc, char *argv[])
+{
+    OpBenchConfig config = {argc > 1 ? argv[1] : "./bench_cases.txt", argc > 2 ? argv[2] : nullptr,
+                            GetEnvU32("OP_BENCH_WARMUP", 5U, true), GetEnvU32("OP_BENCH_ITERS", 50U), 5.0,
+                            std::getenv("OP_BENCH_JSON"), std::getenv("OP_BENCH_CSV")};
+    config.iterations = config.iterations == 0U ? 1U : config.iterations;
+    const char *mad = std::getenv("OP_BENCH_OUTLIER_MAD");
+    if (mad != nullptr) {
+        config.outlierMad = std::strtod(mad, nullptr);
+    }
+    if (config.jsonPath == nullptr) {
+        config.jsonPath = "./output/op_bench.json";
+    }
+    if (config.csvPath == nullptr) {
+        config.csvPath = "./output/op_bench.csv";
+    }
+    return config;
+}
+
+/**
+  * @brief  Spec file, '#' starts a comment, one case per line: <op> <dims> [dtype], dims comma separated. The dims
+  *         each op takes are listed in op_bench_ops.cpp; dtype defaults to the dtype of the op sample.
+  */
+bool LoadOpBenchSpec(const char *path, const char *filter, std::vector<BenchCase> &cases, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::string text;
+    for (uint32_t lineNo = 1; std::getline(in, text); ++lineNo) {
+        const size_t hash = text.find('#');
+        std::istringstream line(hash == std::string::npos ? text : text.substr(0, hash));
+        std::string name;
+        std::string dims;
+        std::string dtypeName;
+        if (!(line >> name)) {
+            continue;
+        }
+        const BenchOp *op = FindBenchOp(name);
+        BenchCase bc;
+        bc.op = name;
+        line >> dims;
+        std::vector<int64_t> values;
+        std::istringstream fields(dims);
+        std::string field;
+        while (std::getline(fields, field, ',')) {
+            values.push_back(std::strtoll(field.c_str(), nullptr, 10));
+        }
+        std::string why;
+        if (op == nullptr) {
+            why = "unknown op " + name;
+        } else if (line >> dtypeName && !ParseBenchDtype(dtypeName, bc.dtype)) {
+            why = "unknown dtype " + dtypeName;
+        } else {
+            bc.dtype = dtypeName.empty() ? op->defaultDtype : bc.dtype;
+            (void)op->prepare(values, bc.dtype, bc, why);
+        }
+        if (!why.empty()) {
+            error = std::string(path) + ":" + std::to_string(lineNo) + ": " + name + " " + dims + ": " + why;
+            return false;
+        }
+        if (filter != nullptr && name != filter) {
+            continue;
+        }
+        bc.dims = dims;
+        for (const auto &tensor : bc.inputs) {
+            bc.bytes += static_cast<double>(tensor.Bytes());
+        }
+        for (const auto &tensor : bc.outputs) {
+            bc.bytes += static_cast<double>(tensor.Bytes());
+        }
+        cases.push_back(bc);
+    }
+    return true;
+}
+
+struct OpBenchResult {
+    BenchCase bc;
+    const char *status = "ok"; // ok, unavailable (op not installed), failed
+    uint64_t workspaceBytes = 0;
+    size_t rejected = 0;
+    LatencyStats kernel;
+    LatencyStats host; // GetWorkspaceSize + launch + synchronize
+    double gbps = 0.0;
+    double tflops = 0.0;
+};
+
+/**
+  * @brief  Integers 1..9, for the float types scaled by the power of two at or above the last dim: that is the
+  *         length reduce, whole_reduce_sum (per row) and the matmul A (over K) sum, so any of these sums stays
+  *         below 9 and finite in float16 whatever the case size. The kernels do not branch on the data, so the
+  *         values only have to be finite.
+  */
+std::vector<uint8_t> MakeInput(const BenchTensor &tensor)
+{
+    const size_t count = tensor.Bytes() / BenchDtypeSize(tensor.dtype);
+    const double length = tensor.shape.empty() ? 1.0 : static_cast<double>(tensor.shape.back());
+    float scale = 1.0f;
+    while (scale * length > 1.0) {
+        scale *= 0.5f;
+    }
+    std::vector<uint8_t> data(tensor.Bytes());
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t value = static_cast<uint32_t>(i % 9U) + 1U;
+        if (tensor.dtype == BenchDtype::FLOAT16) {
+            reinterpret_cast<aclFloat16 *>(data.data())[i] = aclFloatToFloat16(value * scale);
+        } else if (tensor.dtype == BenchDtype::FLOAT32) {
+            reinterpret_cast<float *>(data.data())[i] = value * scale;
+        } else {
+            data[i] = static_cast<uint8_t>(value);
+        }
+    }
+    return data;
+}
+
+/**
+  * @brief  One device and stream for the whole run. Every case uploads its inputs once, then each iteration calls
+  *         GetWorkspaceSize (aclnn executors run once) and the op, timing the op with an aclrtEvent pair.
+  *         Tensors and workspaces come from AclMemPool, so iterations after the first allocate nothing.
+  */
+class OpBenchRunner {
+public:
+    explicit OpBenchRunner(const OpBenchConfig &config) : config_(config)
+    {
+        ok_ = aclInit(nullptr) == ACL_SUCCESS && aclrtSetDevice(deviceId_) == ACL_SUCCESS &&
+              aclrtCreateStream(&stream_) == ACL_SUCCESS && aclrtCreateEvent(&start_) == ACL_SUCCESS &&
+              aclrtCreateEvent(&end_) == ACL_SUCCESS;
+        const char *soc = ok_ ? aclrtGetSocName() : nullptr;
+        soc_ = soc != nullptr ? soc : "unknown";
+    }
+
+    ~OpBenchRunner()
+    {
+        AclMemPool::Instance().Report();
+        AclMemPool::Instance().Trim();
+        (void)aclrtDestroyEvent(start_);
+        (void)aclrtDestroyEvent(end_);
+        (void)aclrtDestroyStream(stream_);
+        (void)aclrtResetDevice(deviceId_);
+        (void)aclFinalize();
+    }
+
+    bool Ok() const
+    {
+        return ok_;
+    }
+
+    const std::string &Soc() const
+    {
+        return soc_;
+    }
+
+    OpBenchResult Run(const BenchCase &bc)
+    {
+        OpBenchResult result;
+        result.bc = bc;
+        const BenchOp *op = FindBenchOp(bc.op);
+        BenchOpApi api;
+        if (!ResolveBenchOp(*op, api)) {
+            result.status = "unavailable";
+            std::printf("[OPBENCH] %s %s: %s not found in OP_BENCH_OPAPI_LIBS, skipped\n", bc.op.c_str(),
+                        bc.dims.c_str(), op->aclnnName);
+            return result;
+        }
+        std::vector<void *> buffers;
+        std::vector<aclTensor *> inputs;
+        std::vector<aclTensor *> outputs;
+        bool ok = true;
+        for (const auto &tensor : bc.inputs) {
+            const std::vector<uint8_t> host = MakeInput(tensor);
+            ok = ok && CreateTensor(tensor, host.data(), buffers, inputs);
+        }
+        for (const auto &tensor : bc.outputs) {
+            ok = ok && CreateTensor(tensor, nullptr, buffers, outputs);
+        }
+        std::vector<double> kernelUs;
+        std::vector<double> hostUs;
+        for (uint32_t i = 0; ok && i < config_.warmup + config_.iterations; ++i) {
+            const double begin = HostNowUs();
+            uint64_t workspaceSize = 0;
+            aclOpExecutor *executor = nullptr;
+            void *workspace = nullptr;
+            ok = op->getWorkspace(api, bc, inputs, outputs, &workspaceSize, &executor) == ACL_SUCCESS &&
+                 (workspaceSize == 0U ||
+                  AclMemPool::Instance().Malloc(&workspace, workspaceSize, AclMemKind::DEVICE) == ACL_SUCCESS) &&
+                 aclrtRecordEvent(start_, stream_) == ACL_SUCCESS &&
+                 reinterpret_cast<BenchExecuteFunc>(api.execute)(workspace, workspaceSize, executor, stream_) ==
+                     ACL_SUCCESS &&
+                 aclrtRecordEvent(end_, stream_) == ACL_SUCCESS && aclrtSynchronizeStream(stream_) == ACL_SUCCESS;
+            const double end = HostNowUs();
+            float ms = 0.0f;
+            ok = ok && aclrtEventElapsedTime(&ms, start_, end_) == ACL_SUCCESS;
+            (void)AclMemPool::Instance().Free(workspace);
+            result.workspaceBytes = workspaceSize;
+            if (ok && i >= config_.warmup) {
+                kernelUs.push_back(static_cast<double>(ms) * 1000.0);
+                hostUs.push_back(end - begin);
+            }
+        }
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            (void)AclMemPool::Instance().Free(buffers[i]);
+        }
+        for (aclTensor *tensor : inputs) {
+            (void)aclDestroyTensor(tensor);
+        }
+        for (aclTensor *tensor : outputs) {
+            (void)aclDestroyTensor(tensor);
+        }
+        if (!ok) {
+            result.status = "failed";
+            std::printf("[OPBENCH] %s %s %s: %s failed\n", bc.op.c_str(), bc.dims.c_str(), BenchDtypeName(bc.dtype),
+                        op->aclnnName);
+            return result;
+        }
+        result.rejected = RejectOutliers(kernelUs, config_.outlierMad);
+        result.kernel = SummarizeLatency(kernelUs);
+        result.host = SummarizeLatency(hostUs);
+        result.gbps = result.kernel.mean > 0.0 ? bc.bytes / (result.kernel.mean * 1e3) : 0.0;
+        result.tflops = result.kernel.mean > 0.0 ? bc.flops / (result.kernel.mean * 1e6) : 0.0;
+        std::printf("[OPBENCH] %s %s %s: kernel_us mean=%.3f p50=%.3f p99=%.3f gbps=%.2f tflops=%.3f rejected=%zu\n",
+                    bc.op.c_str(), bc.dims.c_str(), BenchDtypeName(bc.dtype), result.kernel.mean, result.kernel.p50,
+                    result.kernel.p99, result.gbps, result.tflops, result.rejected);
+        std::fflush(stdout);
+        return result;
+    }
+
+private:
+    bool CreateTensor(const BenchTensor &tensor, const void *host, std::vector<void *> &buffers,
+                      std::vector<aclTensor *> &tensors)
+    {
+        void *device = nullptr;
+        const size_t size = tensor.Bytes();
+        if (AclMemPool::Instance().Malloc(&device, size, AclMemKind::DEVICE) != ACL_SUCCESS) {
+            return false;
+        }
+        buffers.push_back(device);
+        const aclError ret = host != nullptr ? aclrtMemcpy(device, size, host, size, ACL_MEMCPY_HOST_TO_DEVICE) :
+                                               aclrtMemset(device, size, 0, size);
+        aclTensor *created = aclCreateTensor(tensor.shape.data(), tensor.shape.size(), BenchAclDtype(tensor.dtype),
+                                             nullptr, 0, ACL_FORMAT_ND, tensor.shape.data(), tensor.shape.size(),
+                                             device);
+        if (created != nullptr) {
+            tensors.push_back(created);
+        }
+        return ret == ACL_SUCCESS && created != nullptr;
+    }
+
+    OpBenchConfig config_;
+    bool ok_ = false;
+    std::string soc_;
+    int32_t deviceId_ = 0;
+    aclrtStream stream_ = nullptr;
+    aclrtEvent start_ = nullptr;
+    aclrtEvent end_ = nullptr;
+};
+
+/**
+  * @brief  Print the results table and write every case as JSON and CSV, in spec order.
+  */
+void ReportOpBench(const OpBenchConfig &config, const std::string &soc, const std::vector<OpBenchResult> &results)
+{
+    std::printf("[OPBENCH] %-16s %-14s %-7s | %10s %10s %10s %10s %9s %8s %4s %s\n", "op", "dims", "dtype", "mean_us",
+                "p50_us", "p90_us", "p99_us", "gbps", "tflops", "rej", "status");
+    for (const auto &r : results) {
+        std::printf("[OPBENCH] %-16s %-14s %-7s | %10.3f %10.3f %10.3f %10.3f %9.2f %8.3f %4zu %s\n", r.bc.op.c_str(),
+                    r.bc.dims.c_str(), BenchDtypeName(r.bc.dtype), r.kernel.mean, r.kernel.p50, r.kernel.p90,
+                    r.kernel.p99, r.gbps, r.tflops, r.rejected, r.status);
+    }
+
+    std::ofstream json(config.jsonPath, std::ios::out | std::ios::trunc);
+    if (!json.is_open()) {
+        std::printf("[ERROR] Open file failed. path = %s\n", config.jsonPath);
+    } else {
+        json << "{\"soc\":\"" << soc << "\",\"warmup\":" << config.warmup << ",\"iterations\":" << config.iterations
+             << ",\"outlier_mad\":" << config.outlierMad << ",\"cases\":[";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const OpBenchResult &r = results[i];
+            json << (i > 0U ? ",\n" : "\n") << "{\"op\":\"" << r.bc.op << "\",\"aclnn\":\""
+                 << FindBenchOp(r.bc.op)->aclnnName << "\",\"dims\":\"" << r.bc.dims << "\",\"dtype\":\""
+                 << BenchDtypeName(r.bc.dtype) << "\",\"status\":\"" << r.status
+                 << "\",\"flops\":" << static_cast<uint64_t>(r.bc.flops)
+                 << ",\"bytes\":" << static_cast<uint64_t>(r.bc.bytes) << ",\"workspace_bytes\":" << r.workspaceBytes
+                 << ",\"rejected\":" << r.rejected << ",\"gbps\":" << r.gbps << ",\"tflops\":" << r.tflops
+                 << ",\"kernel_us\":";
+            WriteLatencyJson(json, r.kernel);
+            json << ",\"host_us\":";
+            WriteLatencyJson(json, r.host);
+            json << "}";
+        }
+        json << "\n]}\n";
+        std::printf("[OPBENCH] json=%s\n", config.jsonPath);
+    }
+
+    std::ofstream csv(config.csvPath, std::ios::out | std::ios::trunc);
+    if (!csv.is_open()) {
+        std::printf("[ERROR] Open file failed. path = %s\n", config.csvPath);
+        return;
+    }
+    csv << "soc,op,dims,dtype,status,flops,bytes,workspace_bytes,samples,rejected,mean_us,stddev_us,min_us,p50_us,"
+           "p90_us,p99_us,max_us,host_mean_us,gbps,tflops\n";
+    for (const auto &r : results) {
+        csv << soc << ',' << r.bc.op << ",\"" << r.bc.dims << "\"," << BenchDtypeName(r.bc.dtype) << ',' << r.status
+            << ',' << static_cast<uint64_t>(r.bc.flops) << ',' << static_cast<uint64_t>(r.bc.bytes) << ','
+            << r.workspaceBytes << ',' << r.kernel.count << ',' << r.rejected << ',' << r.kernel.mean << ','
+            << r.kernel.stddev << ',' << r.kernel.min << ','
+            << r.kernel.p50 << ',' << r.kernel.p90 << ',' << r.kernel.p99 << ',' << r.kernel.max << ','
+            << r.host.mean << ',' << r.gbps << ',' << r.tflops << '\n';
+    }
+    std::printf("[OPBENCH] csv=%s\n", config.csvPath);
+}
+
+} // namespace
+
+int32_t main(int32_t argc, char *argv[])
+{
+    const OpBenchConfig config = GetOpBenchConfig(argc, argv);
+    std::vector<BenchCase> cases;
+    std::string error;
+    if (!LoadOpBenchSpec(config.specPath, config.filter, cases, error)) {
+        std::fprintf(stderr, "[ERROR] bench spec: %s\n", error.c_str());
+        return 1;
+    }
+    std::printf("[OPBENCH] %zu cases from %s, warmup=%u iterations=%u outlier_mad=%.1f\n", cases.size(),
+                config.specPath, config.warmup, config.iterations, config.outlierMad);
+    std::vector<OpBenchResult> results;
+    std::string soc;
+    {
+        OpBenchRunner runner(config);
+        if (!runner.Ok()) {
+            std::fprintf(stderr, "[ERROR] acl init failed\n");
+            return 1;
+        }
+        soc = runner.Soc();
+        // One case that cannot fit in UB refuses the whole spec before anything runs, like a malformed line.
+        auto platform = platform_ascendc::PlatformAscendCManager::GetInstance(soc.c_str());
+        if (platform == nullptr) {
+            std::fprintf(stderr, "[ERROR] no platform info for %s\n", soc.c_str());
+            return 1;
+        }
+        uint64_t ubBytes = 0;
+        platform->GetCoreMemSize(platform_ascendc::CoreMemType::UB, ubBytes);
+        for (const auto &bc : cases) {
+            if (!CheckBenchCaseUb(bc, ubBytes, platform->GetCoreNumAiv(), error)) {
+                std::fprintf(stderr, "[ERROR] bench spec: %s %s %s: %s\n", bc.op.c_str(), bc.dims.c_str(),
+                             BenchDtypeName(bc.dtype), error.c_str());
+                return 1;
+            }
+        }
+        for (const auto &bc : cases) {
+            results.push_back(runner.Run(bc));
+        }
+    }
+    ReportOpBench(config, soc, results);
+    for (const auto &r : results) {
+        if (std::strcmp(r.status, "failed") == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file op_bench.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef OP_BENCH_H
+#define OP_BENCH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "acl/acl.h"
+#include "aclnn/acl_meta.h"
+
+enum class BenchDtype : uint32_t {
+    FLOAT16 = 0,
+    FLOAT32,
+    INT8,
+    UINT8,
+};
+
+const char *BenchDtypeName(BenchDtype dtype);
+size_t BenchDtypeSize(BenchDtype dtype);
+aclDataType BenchAclDtype(BenchDtype dtype);
+bool ParseBenchDtype(const std::string &name, BenchDtype &dtype);
+
+struct BenchTensor {
+    std::vector<int64_t> shape;
+    BenchDtype dtype;
+
+    size_t Bytes() const
+    {
+        size_t count = 1;
+        for (int64_t dim : shape) {
+            count *= static_cast<size_t>(dim);
+        }
+        return count * BenchDtypeSize(dtype);
+    }
+};
+
+/**
+  * @brief  One case of a benchmark spec, as the op turned it into tensors. flops and bytes are the work the case
+  *         asks for: the multiply-adds (2 flops each) or adds of the op, and every input read once plus every
+  *         output written once. They give the TFLOPS and GB/s of the results and the arithmetic intensity of
+  *         the roofline report, so neither counts tile reloads or workspace traffic.
+  */
+struct BenchCase {
+    std::string op;
+    std::string dims; // as written in the spec, e.g. "1024,640,256"
+    BenchDtype dtype = BenchDtype::FLOAT16;
+    std::vector<BenchTensor> inputs;
+    std::vector<BenchTensor> outputs;
+    std::vector<int64_t> attrs; // op attributes in the order of the aclnn signature
+    double flops = 0.0;
+    double bytes = 0.0;
+};
+
+/**
+  * @brief  Entry points of one custom op package, resolved with dlsym because every package installs its own
+  *         libcust_opapi.so and only some of them may be present.
+  */
+struct BenchOpApi {
+    void *getWorkspaceSize = nullptr;
+    void *execute = nullptr;
+};
+
+/**
+  * @brief  One operator of the harness. prepare checks the dims/dtype of a spec line and fills in the case (error
+  *         says why it was refused), getWorkspace calls the op's aclnn<Op>GetWorkspaceSize with the case tensors.
+  */
+struct BenchOp {
+    const char *name;      // spec keyword
+    const char *aclnnName; // aclnn<Op>, the symbols are aclnn<Op> and aclnn<Op>GetWorkspaceSize
+    BenchDtype defaultDtype;
+    bool (*prepare)(const std::vector<int64_t> &dims, BenchDtype dtype, BenchCase &bc, std::string &error);
+    aclnnStatus (*getWorkspace)(const BenchOpApi &api, const BenchCase &bc, const std::vector<aclTensor *> &inputs,
+                                const std::vector<aclTensor *> &outputs, uint64_t *workspaceSize,
+                                aclOpExecutor **executor);
+};
+
+/**
+  * @brief  matmul, matmul_leakyrelu, reduce, whole_reduce_sum and broadcast, in that order.
+  */
+const std::vector<BenchOp> &BenchOps();
+
+const BenchOp *FindBenchOp(const std::string &name);
+
+/**
+  * @brief  Replay the buffers the kernel of bc allocates per core through common/tiling_emulator.h and check them
+  *         against ubBytes, with the blockDim the op_host would pick on aivCores vector cores. False, with the
+  *         footprint in error, when they do not fit. matmul cases always pass: their base sizes come from the
+  *         matmul tiling of the op_host, which already sizes them to the UB of the platform.
+  */
+bool CheckBenchCaseUb(const BenchCase &bc, uint64_t ubBytes, uint32_t aivCores, std::string &error);
+
+/**
+  * @brief  Resolve the aclnn entry points of op from the libraries of OP_BENCH_OPAPI_LIBS (':' separated, default
+  *         libcust_opapi.so from LD_LIBRARY_PATH), first match wins. False when none of them exports the op.
+  */
+bool ResolveBenchOp(const BenchOp &op, BenchOpApi &api);
+
+typedef aclnnStatus (*BenchExecuteFunc)(void *workspace, uint64_t workspaceSize, aclOpExecutor *executor,
+                                        aclrtStream stream);
+
+#endif // OP_BENCH_H
@@ -0,0 +1,307 @@
+/**
+ * @file op_bench_ops.cpp
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#include "op_bench.h"
+
+#include <dlfcn.h>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+
+#include "env_config.h"
+#include "tiling_emulator.h"
+
+namespace {
+
+// Output length of ReduceCustom, OUT_SHAPE in its op_host.
+constexpr int64_t REDUCE_OUT_LENGTH = 32;
+
+typedef aclnnStatus (*MatmulGetWorkspaceFunc)(const aclTensor *, const aclTensor *, const aclTensor *,
+                                              const aclTensor *, uint64_t *, aclOpExecutor **);
+typedef aclnnStatus (*UnaryGetWorkspaceFunc)(const aclTensor *, const aclTensor *, uint64_t *, aclOpExecutor **);
+// Int attributes of the op definition come out as int64_t in the generated aclnn signature.
+typedef aclnnStatus (*BroadcastGetWorkspaceFunc)(const aclTensor *, int64_t, int64_t, int64_t, int64_t, int64_t,
+                                                 const aclTensor *, uint64_t *, aclOpExecutor **);
+
+bool Positive(const std::vector<int64_t> &dims, size_t count)
+{
+    for (size_t i = 0; i < count && i < dims.size(); ++i) {
+        if (dims[i] <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+  * @brief  M,N,K: A [M, K] and B [K, N] in float16 or float (HF32, 910B only), fp32 bias [N] and C [M, N], as
+  *         both matmul samples take them.
+  */
+bool PrepareMatmul(const std::vector<int64_t> &dims, BenchDtype dtype, BenchCase &bc, std::string &error)
+{
+    if (dims.size() != 3U || !Positive(dims, dims.size())) {
+        error = "expects M,N,K";
+        return false;
+    }
+    if (dtype != BenchDtype::FLOAT16 && dtype != BenchDtype::FLOAT32) {
+        error = "A/B must be float16 or float";
+        return false;
+    }
+    const int64_t M = dims[0];
+    const int64_t N = dims[1];
+    const int64_t K = dims[2];
+    bc.inputs = {{{M, K}, dtype}, {{K, N}, dtype}, {{N}, BenchDtype::FLOAT32}};
+    bc.outputs = {{{M, N}, BenchDtype::FLOAT32}};
+    bc.flops = 2.0 * M * N * K;
+    return true;
+}
+
+bool PrepareReduce(const std::vector<int64_t> &dims, BenchDtype dtype, BenchCase &bc, std::string &error)
+{
+    if (dims.size() != 1U || !Positive(dims, dims.size())) {
+        error = "expects LENGTH";
+        return false;
+    }
+    if (dtype != BenchDtype::FLOAT16 && dtype != BenchDtype::FLOAT32) {
+        error = "x must be float16 or float";
+        return false;
+    }
+    bc.inputs = {{{dims[0]}, dtype}};
+    bc.outputs = {{{REDUCE_OUT_LENGTH}, dtype}};
+    bc.flops = static_cast<double>(dims[0]);
+    return true;
+}
+
+/**
+  * @brief  ROWS,COLS: float16 x [ROWS, COLS] summed per row into y [ROWS, 1].
+  */
+bool PrepareWholeReduceSum(const std::vector<int64_t> &dims, BenchDtype dtype, BenchCase &bc, std::string &error)
+{
+    if (dims.size() != 2U || !Positive(dims, dims.size())) {
+        error = "expects ROWS,COLS";
+        return false;
+    }
+    if (dtype != BenchDtype::FLOAT16) {
+        error = "x must be float16";
+        return false;
+    }
+    bc.inputs = {{{dims[0], dims[1]}, dtype}};
+    bc.outputs = {{{dims[0], 1}, dtype}};
+    bc.flops = static_cast<double>(dims[0]) * dims[1];
+    return true;
+}
+
+/**
+  * @brief  B,S,NUM[,AXIS]: x [B, S] repeated NUM times along AXIS (default 1, the 2-D form of the sample), with the
+  *         minimum temporary buffer (bufferMode 1) and without reusing the source.
+  */
+bool PrepareBroadcast(const std::vector<int64_t> &dims, BenchDtype dtype, BenchCase &bc, std::string &error)
+{
+    if ((dims.size() != 3U && dims.size() != 4U) || !Positive(dims, 3U)) {
+        error = "expects B,S,NUM[,AXIS]";
+        return false;
+    }
+    const int64_t axis = dims.size() == 4U ? dims[3] : 1;
+    if (axis != 0 && axis != 1) {
+        error = "AXIS must be 0 or 1";
+        return false;
+    }
+    const int64_t B = dims[0];
+    const int64_t S = dims[1];
+    const int64_t num = dims[2];
+    bc.inputs = {{{B, S}, dtype}};
+    bc.outputs = {{axis == 0 ? std::vector<int64_t>{B * num, S} : std::vector<int64_t>{B, S * num}, dtype}};
+    bc.attrs = {1, 2, 0, axis, num}; // bufferMode, dim, isReuseSource, axis, num
+    bc.flops = 0.0;
+    return true;
+}
+
+aclnnStatus MatmulGetWorkspace(const BenchOpApi &api, const BenchCase &bc, const std::vector<aclTensor *> &inputs,
+                               const std::vector<aclTensor *> &outputs, uint64_t *workspaceSize,
+                               aclOpExecutor **executor)
+{
+    (void)bc;
+    return reinterpret_cast<MatmulGetWorkspaceFunc>(api.getWorkspaceSize)(inputs[0], inputs[1], inputs[2], outputs[0],
+                                                                          workspaceSize, executor);
+}
+
+aclnnStatus UnaryGetWorkspace(const BenchOpApi &api, const BenchCase &bc, const std::vector<aclTensor *> &inputs,
+                              const std::vector<aclTensor *> &outputs, uint64_t *workspaceSize,
+                              aclOpExecutor **executor)
+{
+    (void)bc;
+    return reinterpret_cast<UnaryGetWorkspaceFunc>(api.getWorkspaceSize)(inputs[0], outputs[0], workspaceSize,
+                                                                         executor);
+}
+
+aclnnStatus BroadcastGetWorkspace(const BenchOpApi &api, const BenchCase &bc, const std::vector<aclTensor *> &inputs,
+                                  const std::vector<aclTensor *> &outputs, uint64_t *workspaceSize,
+                                  aclOpExecutor **executor)
+{
+    return reinterpret_cast<BroadcastGetWorkspaceFunc>(api.getWorkspaceSize)(
+        inputs[0], bc.attrs[0], bc.attrs[1], bc.attrs[2], bc.attrs[3], bc.attrs[4], outputs[0], workspaceSize,
+        executor);
+}
+
+/**
+  * @brief  dlopen handles of OP_BENCH_OPAPI_LIBS, opened once and kept for the life of the process.
+  */
+const std::vector<void *> &OpApiLibraries()
+{
+    static std::vector<void *> *handles = nullptr;
+    if (handles != nullptr) {
+        return *handles;
+    }
+    handles = new std::vector<void *>();
+    const char *env = std::getenv("OP_BENCH_OPAPI_LIBS");
+    std::stringstream paths(env != nullptr && env[0] != '\0' ? env : "libcust_opapi.so");
+    std::string path;
+    while (std::getline(paths, path, ':')) {
+        if (path.empty()) {
+            continue;
+        }
+        void *handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (handle == nullptr) {
+            std::printf("[WARN] cannot load %s: %s\n", path.c_str(), dlerror());
+            continue;
+        }
+        handles->push_back(handle);
+    }
+    return *handles;
+}
+
+} // namespace
+
+const char *BenchDtypeName(BenchDtype dtype)
+{
+    switch (dtype) {
+        case BenchDtype::FLOAT16:
+            return "float16";
+        case BenchDtype::FLOAT32:
+            return "float";
+        case BenchDtype::INT8:
+            return "int8";
+        default:
+            return "uint8";
+    }
+}
+
+size_t BenchDtypeSize(BenchDtype dtype)
+{
+    switch (dtype) {
+        case BenchDtype::FLOAT16:
+            return 2U;
+        case BenchDtype::FLOAT32:
+            return 4U;
+        default:
+            return 1U;
+    }
+}
+
+aclDataType BenchAclDtype(BenchDtype dtype)
+{
+    switch (dtype) {
+        case BenchDtype::FLOAT16:
+            return ACL_FLOAT16;
+        case BenchDtype::FLOAT32:
+            return ACL_FLOAT;
+        case BenchDtype::INT8:
+            return ACL_INT8;
+        default:
+            return ACL_UINT8;
+    }
+}
+
+bool ParseBenchDtype(const std::string &name, BenchDtype &dtype)
+{
+    static const std::map<std::string, BenchDtype> names = {
+        {"float16", BenchDtype::FLOAT16}, {"fp16", BenchDtype::FLOAT16}, {"float", BenchDtype::FLOAT32},
+        {"float32", BenchDtype::FLOAT32}, {"fp32", BenchDtype::FLOAT32}, {"int8", BenchDtype::INT8},
+        {"uint8", BenchDtype::UINT8},
+    };
+    auto it = names.find(name);
+    if (it == names.end()) {
+        return false;
+    }
+    dtype = it->second;
+    return true;
+}
+
+const std::vector<BenchOp> &BenchOps()
+{
+    static const std::vector<BenchOp> ops = {
+        {"matmul", "aclnnMatmulCustom", BenchDtype::FLOAT16, PrepareMatmul, MatmulGetWorkspace},
+        {"matmul_leakyrelu", "aclnnMatmulLeakyreluCustom", BenchDtype::FLOAT16, PrepareMatmul, MatmulGetWorkspace},
+        {"reduce", "aclnnReduceCustom", BenchDtype::FLOAT32, PrepareReduce, UnaryGetWorkspace},
+        {"whole_reduce_sum", "aclnnWholeReduceSumCustom", BenchDtype::FLOAT16, PrepareWholeReduceSum,
+         UnaryGetWorkspace},
+        {"broadcast", "aclnnBroadcastCustom", BenchDtype::FLOAT16, PrepareBroadcast, BroadcastGetWorkspace},
+    };
+    return ops;
+}
+
+const BenchOp *FindBenchOp(const std::string &name)
+{
+    for (const auto &op : BenchOps()) {
+        if (name == op.name) {
+            return &op;
+        }
+    }
+    return nullptr;
+}
+
+bool CheckBenchCaseUb(const BenchCase &bc, uint64_t ubBytes, uint32_t aivCores, std::string &error)
+{
+    const std::vector<int64_t> &x = bc.inputs[0].shape;
+    const uint32_t elemBytes = static_cast<uint32_t>(BenchDtypeSize(bc.dtype));
+    uint64_t peak = 0;
+    if (bc.op == "reduce") {
+        const uint32_t totalLength = static_cast<uint32_t>(x[0]);
+        peak = EmulateReduce(totalLength, static_cast<uint32_t>(REDUCE_OUT_LENGTH),
+                             ReduceTilingKey(totalLength, elemBytes), elemBytes, ubBytes).UbPeak();
+    } else if (bc.op == "whole_reduce_sum") {
+        const uint32_t rows = static_cast<uint32_t>(x[0]);
+        const uint32_t cols = static_cast<uint32_t>(x[1]);
+        const uint32_t blockDim = WholeReduceSumBlockDim(rows, cols, aivCores, GetEnvU32("WRS_FORCE_BLOCKDIM", 0U));
+        peak = EmulateWholeReduceSum(rows, cols, blockDim, elemBytes, ubBytes).UbPeak();
+    } else if (bc.op == "broadcast") {
+        // The 7 op_host launches one core. tmpSize stays 0: the minimum Broadcast scratch needs the tiling library,
+        // so this is a lower bound of the footprint.
+        BroadcastEmuTiling tiling = {};
+        tiling.dim = static_cast<uint32_t>(bc.attrs[1]);
+        tiling.axis = static_cast<uint32_t>(bc.attrs[3]);
+        tiling.num = static_cast<uint32_t>(bc.attrs[4]);
+        tiling.totalLength = static_cast<uint32_t>(x[0] * x[1]);
+        tiling.bLength = static_cast<uint32_t>(x[0]);
+        tiling.tilenum = BroadcastTileNum(tiling.totalLength, tiling.dim, tiling.axis, static_cast<uint32_t>(x[1]));
+        peak = EmulateBroadcast(tiling, 1U, elemBytes, ubBytes).UbPeak();
+    }
+    if (peak > ubBytes) {
+        error = "kernel buffers need " + std::to_string(peak) + " bytes of UB per core, UB has " +
+                std::to_string(ubBytes);
+        return false;
+    }
+    return true;
+}
+
+bool ResolveBenchOp(const BenchOp &op, BenchOpApi &api)
+{
+    const std::string execute = op.aclnnName;
+    const std::string getWorkspaceSize = execute + "GetWorkspaceSize";
+    for (void *handle : OpApiLibraries()) {
+        api.getWorkspaceSize = dlsym(handle, getWorkspaceSize.c_str());
+        api.execute = dlsym(handle, execute.c_str());
+        if (api.getWorkspaceSize != nullptr && api.execute != nullptr) {
+            return true;
+        }
+    }
+    api = BenchOpApi();
+    return false;
+}
@@ -0,0 +1,386 @@
+#!/usr/bin/env python3
+"""Roofline analysis and report generation from benchmark results.
+
+Reads op_bench JSON/CSV results, the [BENCH] json of the matmul + LeakyRelu
+kernel launch sample and its sweep csv, places every case on the roofline of
+its SoC, and writes the roofline section of the performance report as
+markdown plus a log-log roofline plot as SVG (no plotting package needed).
+
+Peaks come from a nominal SoC table (core counts as PlatformAscendC
+GetCoreNumAic/GetCoreNumAiv reports them, clock and HBM bandwidth from the
+product specs); --platform or --peak-* override them for the device at hand.
+"""
+
+from __future__ import annotations
+
+import argparse
+import csv
+import json
+import math
+import sys
+from dataclasses import dataclass, field
+from pathlib import Path
+
+# cube: 16x16x16 fp16 MACs per core per cycle, HF32 (float A/B) at half rate.
+CUBE_FP16_FLOPS_PER_CYCLE = 2 * 16 * 16 * 16
+# vector: 256 bytes per core per cycle, i.e. 64 fp32 or 128 fp16 lanes.
+VECTOR_BYTES_PER_CYCLE = 256
+
+DTYPE_SIZE = {"float16": 2, "float": 4, "int8": 1, "uint8": 1}
+
+# Nominal figures; hbm_gbps / clock_ghz of 910B matches hbmBytesPerCycle of matmul_cost_model.h.
+SOC_TABLE = {
+    "Ascend910B1": {"aic": 24, "aiv": 48, "clock_ghz": 1.85, "hbm_gbps": 1600.0},
+    "Ascend910B2": {"aic": 24, "aiv": 48, "clock_ghz": 1.80, "hbm_gbps": 1600.0},
+    "Ascend910B3": {"aic": 20, "aiv": 40, "clock_ghz": 1.80, "hbm_gbps": 1600.0},
+    "Ascend910B4": {"aic": 20, "aiv": 40, "clock_ghz": 1.65, "hbm_gbps": 800.0},
+    "Ascend310P1": {"aic": 10, "aiv": 10, "clock_ghz": 1.08, "hbm_gbps": 204.8},
+    "Ascend310P3": {"aic": 8, "aiv": 8, "clock_ghz": 1.08, "hbm_gbps": 204.8},
+}
+
+CUBE_OPS = ("matmul", "matmul_leakyrelu")
+
+
+@dataclass
+class Platform:
+    soc: str
+    aic: int
+    aiv: int
+    clock_ghz: float
+    hbm_gbps: float
+    peak_tflops: float | None = None  # overrides the cube fp16 peak
+
+    def compute_peak_tflops(self, op: str, dtype: str) -> tuple[float, str]:
+        """Peak of the unit the op runs on, with the name of that unit."""
+        if op in CUBE_OPS:
+            peak = self.peak_tflops
+            if peak is None:
+                peak = self.aic * CUBE_FP16_FLOPS_PER_CYCLE * self.clock_ghz / 1e3
+            if dtype == "float":
+                return peak / 2.0, "cube(HF32)"
+            return peak, "cube(fp16)"
+        lanes = VECTOR_BYTES_PER_CYCLE // DTYPE_SIZE.get(dtype, 4)
+        return self.aiv * lanes * self.clock_ghz / 1e3, f"vector({dtype})"
+
+
+@dataclass
+class Case:
+    op: str
+    dims: str
+    dtype: str
+    flops: float
+    bytes: float
+    kernel_us: dict[str, float] = field(default_factory=dict)
+    status: str = "ok"
+    source: str = ""
+
+
+@dataclass
+class Point:
+    case: Case
+    unit: str
+    peak_tflops: float
+    intensity: float  # FLOP per byte
+    tflops: float
+    gbps: float
+    ridge: float
+    bound: str
+    roof_tflops: float  # attainable at this intensity
+
+    @property
+    def pct_compute(self) -> float:
+        return 100.0 * self.tflops / self.peak_tflops if self.peak_tflops > 0 else 0.0
+
+    def pct_bandwidth(self, hbm_gbps: float) -> float:
+        return 100.0 * self.gbps / hbm_gbps if hbm_gbps > 0 else 0.0
+
+    def pct_roof(self, hbm_gbps: float) -> float:
+        if self.case.flops <= 0:
+            return self.pct_bandwidth(hbm_gbps)
+        return 100.0 * self.tflops / self.roof_tflops if self.roof_tflops > 0 else 0.0
+
+
+def _matmul_case(op: str, m: int, n: int, k: int, dtype: str, kernel_us: dict[str, float], source: str) -> Case:
+    ab = DTYPE_SIZE[dtype]
+    # A [M, K], B [K, N], fp32 bias [N] and C [M, N], as op_bench counts them.
+    size = (m * k + k * n) * ab + n * 4 + m * n * 4
+    return Case(op, f"{m},{n},{k}", dtype, 2.0 * m * n * k, float(size), kernel_us, "ok", source)
+
+
+def _load_op_bench_json(path: Path, doc: dict) -> tuple[str | None, list[Case]]:
+    cases = []
+    for item in doc.get("cases", []):
+        cases.append(Case(item["op"], item["dims"], item["dtype"], float(item["flops"]), float(item["bytes"]),
+                          item.get("kernel_us", {}), item.get("status", "ok"), path.name))
+    return doc.get("soc"), cases
+
+
+def _load_bench_json(path: Path, doc: dict) -> tuple[str | None, list[Case]]:
+    # [BENCH] json of the kernel launch sample: fp16 A/B, one shape per file.
+    case = _matmul_case("matmul_leakyrelu", int(doc["M"]), int(doc["N"]), int(doc["K"]), "float16",
+                        doc.get("kernel_us", {}), path.name)
+    return doc.get("soc"), [case]
+
+
+def _load_csv(path: Path) -> tuple[str | None, list[Case]]:
+    soc = None
+    cases = []
+    with path.open("r", encoding="utf-8", newline="") as f:
+        reader = csv.DictReader(f)
+        for row in reader:
+            kernel_us = {}
+            for key in ("mean", "p50", "p90", "p99", "min", "max", "stddev"):
+                if row.get(f"{key}_us") not in (None, ""):
+                    kernel_us[key] = float(row[f"{key}_us"])
+            if "op" in row:
+                # op_bench csv
+                soc = soc or row.get("soc")
+                cases.append(Case(row["op"], row["dims"], row["dtype"], float(row["flops"]), float(row["bytes"]),
+                                  kernel_us, row.get("status", "ok"), path.name))
+            elif "M" in row:
+                # kernel launch sweep csv, one row per shape x config
+                case = _matmul_case("matmul_leakyrelu", int(row["M"]), int(row["N"]), int(row["K"]), "float16",
+                                    kernel_us, path.name)
+                case.dims += f" core={row.get('core', '')} base={row.get('base_m', '')}x{row.get('base_n', '')}"
+                if row.get("result", "pass") not in ("pass", "skipped"):
+                    case.status = row["result"]
+                cases.append(case)
+            else:
+                raise ValueError(f"{path}: neither an op_bench nor a sweep csv")
+    return soc, cases
+
+
+def load_results(path: Path) -> tuple[str | None, list[Case]]:
+    if path.suffix.lower() == ".csv":
+        return _load_csv(path)
+    with path.open("r", encoding="utf-8") as f:
+        doc = json.load(f)
+    if "cases" in doc:
+        return _load_op_bench_json(path, doc)
+    if "M" in doc and "kernel_us" in doc:
+        return _load_bench_json(path, doc)
+    raise ValueError(f"{path}: neither an op_bench nor a [BENCH] json")
+
+
+def make_platform(args: argparse.Namespace, soc: str | None) -> Platform:
+    soc = args.soc or soc or "unknown"
+    spec = None
+    for name, value in SOC_TABLE.items():
+        # the runtime reports e.g. Ascend910B3, the build flags ascend910b3
+        if name.lower() == soc.lower():
+            spec = dict(value)
+            soc = name
+    if args.platform:
+        with open(args.platform, "r", encoding="utf-8") as f:
+            spec = {**(spec or {}), **json.load(f)}
+    if spec is None:
+        raise ValueError(f"no peaks for SoC {soc}: pass --platform or add it to SOC_TABLE")
+    platform = Platform(soc, int(spec["aic"]), int(spec["aiv"]), float(spec["clock_ghz"]),
+                        float(spec["hbm_gbps"]), spec.get("peak_tflops"))
+    if args.peak_tflops is not None:
+        platform.peak_tflops = args.peak_tflops
+    if args.peak_gbps is not None:
+        platform.hbm_gbps = args.peak_gbps
+    return platform
+
+
+def analyze(platform: Platform, case: Case, stat: str) -> Point | None:
+    us = case.kernel_us.get(stat, 0.0)
+    if case.status != "ok" or us <= 0 or case.bytes <= 0:
+        return None
+    peak, unit = platform.compute_peak_tflops(case.op, case.dtype)
+    intensity = case.flops / case.bytes
+    tflops = case.flops / (us * 1e6)
+    gbps = case.bytes / (us * 1e3)
+    ridge = peak * 1e3 / platform.hbm_gbps
+    roof = min(peak, intensity * platform.hbm_gbps / 1e3)
+    bound = "memory-bound" if intensity < ridge else "compute-bound"
+    return Point(case, unit, peak, intensity, tflops, gbps, ridge, bound, roof)
+
+
+def _fmt_pct(value: float | None) -> str:
+    return "-" if value is None else f"{value:.1f}%"
+
+
+def write_markdown(path: Path, platform: Platform, points: list[Point], skipped: list[Case], sources: list[str],
+                   stat: str, svg_name: str | None) -> None:
+    units = sorted({(p.unit, p.peak_tflops, p.ridge) for p in points})
+    lines = [
+        f"# Roofline分析报告（{platform.soc}）",
+        "",
+        f"- 数据来源：{', '.join(sources)}",
+        f"- kernel耗时口径：kernel_us.{stat}",
+        f"- 平台：{platform.soc}，AIC {platform.aic}，AIV {platform.aiv}，{platform.clock_ghz:.2f} GHz",
+        f"- 峰值带宽（理论）：{platform.hbm_gbps:.1f} GB/s",
+    ]
+    for unit, peak, ridge in units:
+        lines.append(f"- 峰值算力（理论）：{unit} {peak:.2f} TFLOPS，拐点算术强度 {ridge:.1f} FLOP/B")
+    lines += [
+        "",
+        "## 1. 结果汇总",
+        "",
+        "| 算子 | Shape | dtype | kernel(us) | AI(FLOP/B) | TFLOPS | GB/s | 算力占比 | 带宽占比 | roofline占比 | 瓶颈 |",
+        "|---|---|---|---:|---:|---:|---:|---:|---:|---:|---|",
+    ]
+    for p in points:
+        us = p.case.kernel_us[stat]
+        compute = p.pct_compute if p.case.flops > 0 else None
+        lines.append(f"| {p.case.op} | {p.case.dims} | {p.case.dtype} | {us:.3f} | {p.intensity:.2f} | "
+                     f"{p.tflops:.3f} | {p.gbps:.1f} | {_fmt_pct(compute)} | "
+                     f"{_fmt_pct(p.pct_bandwidth(platform.hbm_gbps))} | {_fmt_pct(p.pct_roof(platform.hbm_gbps))} | "
+                     f"{p.bound} |")
+    lines += ["", "## 2. Roofline分析", ""]
+    if svg_name:
+        lines += [f"![roofline]({svg_name})", ""]
+    for p in points:
+        if p.bound == "memory-bound":
+            reason = (f"AI {p.intensity:.2f} < 拐点 {p.ridge:.1f} FLOP/B，上限为带宽 "
+                      f"{platform.hbm_gbps:.0f} GB/s，实测 {p.gbps:.1f} GB/s")
+        else:
+            reason = (f"AI {p.intensity:.2f} >= 拐点 {p.ridge:.1f} FLOP/B，上限为{p.unit}算力 "
+                      f"{p.peak_tflops:.2f} TFLOPS，实测 {p.tflops:.3f} TFLOPS")
+        lines += [
+            f"- {p.case.op} {p.case.dims} {p.case.dtype}",
+            f"  - 当前更接近：{'带宽上限' if p.bound == 'memory-bound' else '算力上限'}",
+            f"  - 依据：{reason}，达到roofline的{_fmt_pct(p.pct_roof(platform.hbm_gbps))}",
+        ]
+    if skipped:
+        lines += ["", "## 3. 未参与分析的用例", "", "| 算子 | Shape | dtype | 状态 |", "|---|---|---|---|"]
+        for case in skipped:
+            lines.append(f"| {case.op} | {case.dims} | {case.dtype} | {case.status} |")
+    lines += [
+        "",
+        "注：flops/bytes为算子本身的工作量（输入读一次、输出写一次），不含workspace与tile重复搬运；"
+        "算力占比对比算子所用计算单元的峰值，roofline占比对比该算术强度下可达到的上限。",
+        "",
+    ]
+    path.write_text("\n".join(lines), encoding="utf-8")
+
+
+def write_svg(path: Path, platform: Platform, points: list[Point]) -> None:
+    width, height = 760, 500
+    left, right, top, bottom = 70, 190, 30, 50
+    plot_w, plot_h = width - left - right, height - top - bottom
+
+    ceilings = sorted({(p.unit, p.peak_tflops) for p in points}, key=lambda x: -x[1])
+    intensities = [p.intensity for p in points if p.intensity > 0]
+    ridges = [peak * 1e3 / platform.hbm_gbps for _, peak in ceilings]
+    x_min = 10 ** math.floor(math.log10(min(intensities + ridges + [1.0]) / 2))
+    x_max = 10 ** math.ceil(math.log10(max(intensities + ridges + [1.0]) * 2))
+    perf = [p.tflops for p in points if p.tflops > 0] + [peak for _, peak in ceilings]
+    y_min = 10 ** math.floor(math.log10(min(perf + [x_min * platform.hbm_gbps / 1e3]) / 2))
+    y_max = 10 ** math.ceil(math.log10(max(perf) * 2))
+
+    def sx(x: float) -> float:
+        return left + plot_w * (math.log10(x) - math.log10(x_min)) / (math.log10(x_max) - math.log10(x_min))
+
+    def sy(y: float) -> float:
+        return top + plot_h * (1 - (math.log10(y) - math.log10(y_min)) / (math.log10(y_max) - math.log10(y_min)))
+
+    out = [
+        f'<svg xmlns="http://www.w3.org/2000/svg" width="{width}" height="{height}" '
+        f'font-family="sans-serif" font-size="11">',
+        f'<rect width="{width}" height="{height}" fill="white"/>',
+        f'<text x="{left}" y="18" font-size="13">Roofline {platform.soc} '
+        f'(HBM {platform.hbm_gbps:.0f} GB/s)</text>',
+    ]
+    for exp in range(int(math.log10(x_min)), int(math.log10(x_max)) + 1):
+        x = sx(10.0 ** exp)
+        out.append(f'<line x1="{x:.1f}" y1="{top}" x2="{x:.1f}" y2="{top + plot_h}" stroke="#ddd"/>')
+        out.append(f'<text x="{x:.1f}" y="{top + plot_h + 15}" text-anchor="middle">1e{exp}</text>')
+    for exp in range(int(math.log10(y_min)), int(math.log10(y_max)) + 1):
+        y = sy(10.0 ** exp)
+        out.append(f'<line x1="{left}" y1="{y:.1f}" x2="{left + plot_w}" y2="{y:.1f}" stroke="#ddd"/>')
+        out.append(f'<text x="{left - 5}" y="{y + 4:.1f}" text-anchor="end">1e{exp}</text>')
+    out.append(f'<rect x="{left}" y="{top}" width="{plot_w}" height="{plot_h}" fill="none" stroke="black"/>')
+    out.append(f'<text x="{left + plot_w / 2}" y="{height - 10}" text-anchor="middle">'
+               f'arithmetic intensity (FLOP/byte)</text>')
+    out.append(f'<text x="15" y="{top + plot_h / 2}" text-anchor="middle" '
+               f'transform="rotate(-90 15 {top + plot_h / 2})">TFLOPS</text>')
+
+    for unit, peak in ceilings:
+        ridge = peak * 1e3 / platform.hbm_gbps
+        y0 = x_min * platform.hbm_gbps / 1e3
+        out.append(f'<polyline fill="none" stroke="#333" stroke-width="1.5" points="{sx(x_min):.1f},{sy(y0):.1f} '
+                   f'{sx(ridge):.1f},{sy(peak):.1f} {sx(x_max):.1f},{sy(peak):.1f}"/>')
+        out.append(f'<text x="{sx(x_max) - 4:.1f}" y="{sy(peak) - 4:.1f}" text-anchor="end">'
+                   f'{unit} {peak:.1f} TFLOPS</text>')
+
+    colors = ["#1f77b4", "#d62728", "#2ca02c", "#ff7f0e", "#9467bd", "#8c564b", "#e377c2", "#17becf"]
+    labels = []
+    for p in points:
+        label = f"{p.case.op} {p.case.dtype}"
+        if label not in labels:
+            labels.append(label)
+    for p in points:
+        color = colors[labels.index(f"{p.case.op} {p.case.dtype}") % len(colors)]
+        if p.intensity <= 0 or p.tflops <= 0:
+            continue  # no flops (broadcast): not on a log-log roofline, listed in the tables only
+        out.append(f'<circle cx="{sx(p.intensity):.1f}" cy="{sy(p.tflops):.1f}" r="4" fill="{color}">'
+                   f'<title>{p.case.op} {p.case.dims} {p.case.dtype}: {p.tflops:.3f} TFLOPS, '
+                   f'{p.gbps:.1f} GB/s, {p.bound}</title></circle>')
+    for i, label in enumerate(labels):
+        y = top + 10 + 16 * i
+        out.append(f'<circle cx="{left + plot_w + 15}" cy="{y}" r="4" fill="{colors[i % len(colors)]}"/>')
+        out.append(f'<text x="{left + plot_w + 24}" y="{y + 4}">{label}</text>')
+    out.append("</svg>")
+    path.write_text("\n".join(out) + "\n", encoding="utf-8")
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("results", nargs="+", help="op_bench json/csv, [BENCH] json or sweep csv")
+    parser.add_argument("--soc", help="SoC name when the results do not carry it, e.g. Ascend910B3")
+    parser.add_argument("--platform", help="json with aic, aiv, clock_ghz, hbm_gbps[, peak_tflops]")
+    parser.add_argument("--peak-tflops", type=float, help="cube fp16 peak, overrides the SoC table")
+    parser.add_argument("--peak-gbps", type=float, help="HBM bandwidth, overrides the SoC table")
+    parser.add_argument("--stat", default="mean", choices=("mean", "p50", "p90", "p99", "min"),
+                        help="kernel_us statistic the points use")
+    parser.add_argument("--output-dir", default="./output", help="where roofline_report.md/.svg go")
+    parser.add_argument("--no-plot", action="store_true", help="write the markdown only")
+    args = parser.parse_args()
+
+    soc = None
+    cases: list[Case] = []
+    sources = []
+    try:
+        for name in args.results:
+            path = Path(name)
+            file_soc, file_cases = load_results(path)
+            soc = soc or file_soc
+            cases += file_cases
+            sources.append(path.name)
+        platform = make_platform(args, soc)
+    except (OSError, ValueError, KeyError) as e:
+        print(f"[ROOFLINE] error: {e}", file=sys.stderr)
+        return 1
+
+    points = []
+    skipped = []
+    for case in cases:
+        point = analyze(platform, case, args.stat)
+        if point is None:
+            skipped.append(case)
+        else:
+            points.append(point)
+    if not points:
+        print("[ROOFLINE] error: no case with a kernel time to analyze", file=sys.stderr)
+        return 1
+
+    out_dir = Path(args.output_dir)
+    out_dir.mkdir(parents=True, exist_ok=True)
+    svg_name = None if args.no_plot else "roofline.svg"
+    if svg_name:
+        write_svg(out_dir / svg_name, platform, points)
+    write_markdown(out_dir / "roofline_report.md", platform, points, skipped, sources, args.stat, svg_name)
+
+    for p in points:
+        print(f"[ROOFLINE] {p.case.op} {p.case.dims} {p.case.dtype} ai={p.intensity:.2f} tflops={p.tflops:.3f} "
+              f"gbps={p.gbps:.1f} roof={p.pct_roof(platform.hbm_gbps):.1f}% {p.bound}")
+    print(f"[ROOFLINE] soc={platform.soc} cases={len(points)} skipped={len(skipped)} "
+          f"report={out_dir / 'roofline_report.md'}")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
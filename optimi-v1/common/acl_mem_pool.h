@@ -0,0 +1,207 @@
+/**
+ * @file acl_mem_pool.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef ACL_MEM_POOL_H
+#define ACL_MEM_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "acl/acl.h"
+
+enum class AclMemKind : uint32_t {
+    DEVICE = 0, // aclrtMalloc
+    HOST = 1,   // aclrtMallocHost, page-locked
+};
+
+struct AclMemPoolStats {
+    size_t liveBytes = 0;   // handed out and not yet freed
+    size_t cachedBytes = 0; // freed by the caller, kept for reuse
+    size_t peakLiveBytes = 0;
+    size_t peakReservedBytes = 0; // live + cached, what the runtime actually holds
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+/**
+ * @brief Size-class caching allocator for device and pinned host memory. Freed blocks stay cached by rounded
+ *        size and serve later requests of the same class, so repeated launches, shapes or runner instances
+ *        stop paying aclrtMalloc/aclrtFree. Requests below 1 MiB round up to 512 B, larger ones to 2 MiB (the
+ *        huge page size of ACL_MEM_MALLOC_HUGE_FIRST). A cached block is reused for a request up to twice
+ *        smaller, and the whole cache of a kind is released once when the runtime is out of memory.
+ *
+ *        The pool never frees on its own: call Trim() before aclrtResetDevice. MATMUL_MEM_POOL=off turns the
+ *        pool into a pass-through that still keeps the byte counters.
+ */
+class AclMemPool {
+public:
+    static AclMemPool &Instance()
+    {
+        // Leaked on purpose: a static destructor would run after aclFinalize.
+        static AclMemPool *pool = new AclMemPool();
+        return *pool;
+    }
+
+    aclError Malloc(void **ptr, size_t size, AclMemKind kind)
+    {
+        const size_t rounded = RoundSize(size);
+        std::lock_guard<std::mutex> lock(mutex_);
+        KindState &state = states_[static_cast<uint32_t>(kind)];
+        if (enabled_) {
+            auto it = state.cached.lower_bound(rounded);
+            if (it != state.cached.end() && it->first <= rounded * 2U) {
+                *ptr = it->second;
+                state.live[*ptr] = it->first;
+                state.stats.cachedBytes -= it->first;
+                state.stats.liveBytes += it->first;
+                state.cached.erase(it);
+                ++state.stats.hits;
+                UpdatePeak(state.stats);
+                return ACL_SUCCESS;
+            }
+        }
+        aclError ret = RawMalloc(ptr, rounded, kind);
+        if (ret != ACL_SUCCESS && !state.cached.empty()) {
+            ReleaseCached(state, kind);
+            ret = RawMalloc(ptr, rounded, kind);
+        }
+        if (ret != ACL_SUCCESS) {
+            *ptr = nullptr;
+            return ret;
+        }
+        state.live[*ptr] = rounded;
+        state.stats.liveBytes += rounded;
+        ++state.stats.misses;
+        UpdatePeak(state.stats);
+        return ACL_SUCCESS;
+    }
+
+    /**
+     * @brief Return a block from Malloc to the cache. nullptr is ignored, unknown pointers are rejected.
+     */
+    aclError Free(void *ptr)
+    {
+        if (ptr == nullptr) {
+            return ACL_SUCCESS;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (uint32_t kind = 0; kind < KIND_NUM; ++kind) {
+            KindState &state = states_[kind];
+            auto it = state.live.find(ptr);
+            if (it == state.live.end()) {
+                continue;
+            }
+            const size_t size = it->second;
+            state.live.erase(it);
+            state.stats.liveBytes -= size;
+            if (!enabled_) {
+                return RawFree(ptr, static_cast<AclMemKind>(kind));
+            }
+            state.cached.emplace(size, ptr);
+            state.stats.cachedBytes += size;
+            return ACL_SUCCESS;
+        }
+        fprintf(stderr, "[ERROR]  mem pool: free of unknown pointer %p\n", ptr);
+        return ACL_ERROR_INVALID_PARAM;
+    }
+
+    /**
+     * @brief Release every cached block back to the runtime. Live blocks are untouched.
+     */
+    void Trim()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (uint32_t kind = 0; kind < KIND_NUM; ++kind) {
+            ReleaseCached(states_[kind], static_cast<AclMemKind>(kind));
+        }
+    }
+
+    AclMemPoolStats Stats(AclMemKind kind)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return states_[static_cast<uint32_t>(kind)].stats;
+    }
+
+    void Report(FILE *out = stdout)
+    {
+        static const char *names[KIND_NUM] = {"device", "host"};
+        for (uint32_t kind = 0; kind < KIND_NUM; ++kind) {
+            const AclMemPoolStats stats = Stats(static_cast<AclMemKind>(kind));
+            fprintf(out, "[MEMPOOL] %s live=%zu cached=%zu peak_live=%zu peak_reserved=%zu hits=%llu misses=%llu\n",
+                    names[kind], stats.liveBytes, stats.cachedBytes, stats.peakLiveBytes, stats.peakReservedBytes,
+                    static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses));
+        }
+    }
+
+    static size_t RoundSize(size_t size)
+    {
+        size_t granule = LARGE_GRANULE;
+        if (size < SMALL_LIMIT) {
+            granule = SMALL_GRANULE;
+        }
+        size = size == 0U ? 1U : size;
+        return (size + granule - 1U) / granule * granule;
+    }
+
+private:
+    static constexpr uint32_t KIND_NUM = 2U;
+    static constexpr size_t SMALL_LIMIT = 1U << 20;
+    static constexpr size_t SMALL_GRANULE = 512U;
+    static constexpr size_t LARGE_GRANULE = 2U << 20;
+
+    struct KindState {
+        std::multimap<size_t, void *> cached;
+        std::unordered_map<void *, size_t> live;
+        AclMemPoolStats stats;
+    };
+
+    AclMemPool()
+    {
+        const char *value = std::getenv("MATMUL_MEM_POOL");
+        enabled_ = value == nullptr || std::strcmp(value, "off") != 0;
+    }
+
+    static aclError RawMalloc(void **ptr, size_t size, AclMemKind kind)
+    {
+        return kind == AclMemKind::DEVICE ? aclrtMalloc(ptr, size, ACL_MEM_MALLOC_HUGE_FIRST) : aclrtMallocHost(ptr, size);
+    }
+
+    static aclError RawFree(void *ptr, AclMemKind kind)
+    {
+        return kind == AclMemKind::DEVICE ? aclrtFree(ptr) : aclrtFreeHost(ptr);
+    }
+
+    static void ReleaseCached(KindState &state, AclMemKind kind)
+    {
+        for (const auto &block : state.cached) {
+            (void)RawFree(block.second, kind);
+        }
+        state.cached.clear();
+        state.stats.cachedBytes = 0;
+    }
+
+    static void UpdatePeak(AclMemPoolStats &stats)
+    {
+        stats.peakLiveBytes = stats.liveBytes > stats.peakLiveBytes ? stats.liveBytes : stats.peakLiveBytes;
+        const size_t reserved = stats.liveBytes + stats.cachedBytes;
+        stats.peakReservedBytes = reserved > stats.peakReservedBytes ? reserved : stats.peakReservedBytes;
+    }
+
+    std::mutex mutex_;
+    KindState states_[KIND_NUM];
+    bool enabled_ = true;
+};
+
+#endif // ACL_MEM_POOL_H
@@ -0,0 +1,124 @@
+/**
+ * @file bench_stats.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Distribution of the per-iteration latencies of one benchmark, in microseconds.
+ */
+struct LatencyStats {
+    size_t count = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+/**
+ * @brief Percentile of an ascending sample with linear interpolation, the same rule run.sh used for P50/P90.
+ */
+inline double SortedPercentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    const double rank = static_cast<double>(sorted.size() - 1U) * p;
+    const size_t lo = static_cast<size_t>(std::floor(rank));
+    const size_t hi = static_cast<size_t>(std::ceil(rank));
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (rank - static_cast<double>(lo));
+}
+
+inline LatencyStats SummarizeLatency(std::vector<double> samples)
+{
+    LatencyStats stats;
+    stats.count = samples.size();
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double v : samples) {
+        sum += v;
+    }
+    stats.mean = sum / static_cast<double>(samples.size());
+    double var = 0.0;
+    for (double v : samples) {
+        var += (v - stats.mean) * (v - stats.mean);
+    }
+    stats.stddev = samples.size() > 1U ? std::sqrt(var / static_cast<double>(samples.size() - 1U)) : 0.0;
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.p50 = SortedPercentile(samples, 0.50);
+    stats.p90 = SortedPercentile(samples, 0.90);
+    stats.p99 = SortedPercentile(samples, 0.99);
+    return stats;
+}
+
+/**
+ * @brief Drop the samples further than madScale scaled median absolute deviations from the median (1.4826 * MAD
+ *        estimates the stddev of a normal sample), so a preempted or throttled iteration does not move the
+ *        mean. madScale <= 0 keeps everything, and so does a sample whose MAD is 0. Returns how many were dropped.
+ */
+inline size_t RejectOutliers(std::vector<double> &samples, double madScale)
+{
+    if (madScale <= 0.0 || samples.size() < 3U) {
+        return 0;
+    }
+    std::vector<double> sorted(samples);
+    std::sort(sorted.begin(), sorted.end());
+    const double median = SortedPercentile(sorted, 0.50);
+    for (double &v : sorted) {
+        v = std::fabs(v - median);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    const double limit = madScale * 1.4826 * SortedPercentile(sorted, 0.50);
+    if (limit <= 0.0) {
+        return 0;
+    }
+    const size_t before = samples.size();
+    samples.erase(std::remove_if(samples.begin(), samples.end(),
+                                 [median, limit](double v) { return std::fabs(v - median) > limit; }),
+                  samples.end());
+    return before - samples.size();
+}
+
+/**
+ * @brief Write stats as a JSON object {"count":..,"mean":..,...} without a trailing newline.
+ */
+inline void WriteLatencyJson(std::ostream &out, const LatencyStats &stats)
+{
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "{\"count\":%zu,\"mean\":%.3f,\"stddev\":%.3f,\"min\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+                  "\"max\":%.3f}",
+                  stats.count, stats.mean, stats.stddev, stats.min, stats.p50, stats.p90, stats.p99, stats.max);
+    out << buf;
+}
+
+/**
+ * @brief Host wall clock in microseconds, for the CPU-mode kernel and end-to-end spans.
+ */
+inline double HostNowUs()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // BENCH_STATS_H
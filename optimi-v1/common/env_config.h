@@ -0,0 +1,35 @@
+/**
+ * @file env_config.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef ENV_CONFIG_H
+#define ENV_CONFIG_H
+
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * @brief Unsigned decimal from the environment. Unset, non-numeric, out of range and 0 give defaultValue, so
+ *        a 0 cannot turn a size, count or divisor into an invalid value.
+ * @param allowZero: pass true where 0 is a meaningful setting (no warmup, no limit, seed 0).
+ */
+inline uint32_t GetEnvU32(const char *name, uint32_t defaultValue, bool allowZero = false)
+{
+    const char *value = std::getenv(name);
+    if (value == nullptr) {
+        return defaultValue;
+    }
+    char *end = nullptr;
+    const unsigned long parsed = std::strtoul(value, &end, 10);
+    if (end == value || *end != '\0' || value[0] == '-' || parsed > UINT32_MAX || (parsed == 0UL && !allowZero)) {
+        return defaultValue;
+    }
+    return static_cast<uint32_t>(parsed);
+}
+
+#endif // ENV_CONFIG_H
@@ -0,0 +1,291 @@
+/**
+ * @file host_timeline.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef HOST_TIMELINE_H
+#define HOST_TIMELINE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef ASCENDC_CPU_DEBUG
+#include "acl/acl.h"
+#endif
+
+/**
+ * @brief Host launch timeline: HOST_TIMELINE_FILE=<path> records the host phases of a run (file read, tiling,
+ *        H2D, launch, sync, D2H, write) as steady_clock spans, plus the device time of each launch measured with
+ *        a pair of aclrtEvents, and writes them as Chrome trace JSON (chrome://tracing, ui.perfetto.dev) when
+ *        the process exits. Host spans go on one track per host thread, device spans on one track per stream.
+ *
+ *        Unset, every call returns after one load of a bool: no clock reads, no events, no allocation. In cpu
+ *        mode (ASCENDC_CPU_DEBUG) the kernel runs synchronously inside ICPU_RUN_KF, so a device span is the
+ *        host time between DeviceBegin and DeviceEnd.
+ *
+ *        Device spans are placed on the host clock when resolved: the last end event of each stream is taken to
+ *        have completed when ResolveDevice was called (right after the synchronize that waited for it), and
+ *        every span of the stream is placed by its event distance to that one. The offset is an upper bound of
+ *        the real completion time, the durations are exact.
+ */
+class HostTimeline {
+public:
+    static HostTimeline &Instance()
+    {
+        // Leaked on purpose like AclMemPool; the trace is written by atexit, after main has returned.
+        static HostTimeline *timeline = new HostTimeline();
+        return *timeline;
+    }
+
+    bool Enabled() const
+    {
+        return enabled_;
+    }
+
+    /**
+      * @brief  Microseconds since the timeline was created, 0 when disabled so the call sites that only feed
+      *         AddSpan read no clock either.
+      */
+    double NowUs() const
+    {
+        if (!enabled_) {
+            return 0.0;
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin_).count();
+    }
+
+    void AddSpan(const char *name, const char *category, double beginUs, double endUs)
+    {
+        if (!enabled_) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        spans_.push_back({name, category, beginUs, endUs - beginUs, HostTrack()});
+    }
+
+    /**
+      * @brief  Mark the start of device work queued on stream; pass the handle to DeviceEnd after queuing it.
+      */
+    size_t DeviceBegin(const char *name, void *stream)
+    {
+        if (!enabled_) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        DeviceSpan span = {name, stream, NowUs(), nullptr, nullptr};
+#ifndef ASCENDC_CPU_DEBUG
+        if (aclrtCreateEvent(&span.start) != ACL_SUCCESS ||
+            aclrtRecordEvent(span.start, static_cast<aclrtStream>(stream)) != ACL_SUCCESS) {
+            ReleaseEvents(span);
+            return 0;
+        }
+#endif
+        pending_.push_back(span);
+        return pending_.size();
+    }
+
+    void DeviceEnd(size_t handle, void *stream)
+    {
+        if (!enabled_ || handle == 0U) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (handle > pending_.size()) {
+            return;
+        }
+        DeviceSpan &span = pending_[handle - 1U];
+#ifndef ASCENDC_CPU_DEBUG
+        if (span.start == nullptr || span.end != nullptr || aclrtCreateEvent(&span.end) != ACL_SUCCESS ||
+            aclrtRecordEvent(span.end, static_cast<aclrtStream>(stream)) != ACL_SUCCESS) {
+            ReleaseEvents(span);
+        }
+#else
+        (void)stream;
+        // The cpu model has finished the kernel by now.
+        spans_.push_back({span.name, "device", span.hostUs, NowUs() - span.hostUs, DeviceTrack(span.stream)});
+#endif
+    }
+
+    /**
+      * @brief  Turn the pending device spans into trace spans and release their events. Call right after the
+      *         streams they were recorded on have been synchronized, before aclrtResetDevice.
+      */
+    void ResolveDevice()
+    {
+        if (!enabled_) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+#ifndef ASCENDC_CPU_DEBUG
+        const double syncUs = NowUs();
+        for (auto &span : pending_) {
+            // The last span that ended on the same stream anchors this one.
+            const DeviceSpan *last = nullptr;
+            for (const auto &other : pending_) {
+                last = other.end != nullptr && other.stream == span.stream ? &other : last;
+            }
+            float durationMs = 0.0f;
+            float toLastMs = 0.0f;
+            if (span.end != nullptr && aclrtEventElapsedTime(&durationMs, span.start, span.end) == ACL_SUCCESS &&
+                aclrtEventElapsedTime(&toLastMs, span.end, last->end) == ACL_SUCCESS) {
+                const double endUs = syncUs - static_cast<double>(toLastMs) * 1000.0;
+                const double durationUs = static_cast<double>(durationMs) * 1000.0;
+                spans_.push_back({span.name, "device", endUs - durationUs, durationUs, DeviceTrack(span.stream)});
+            }
+        }
+        for (auto &span : pending_) {
+            ReleaseEvents(span);
+        }
+#endif
+        pending_.clear();
+    }
+
+    /**
+      * @brief  Write the trace. Called once at exit when enabled, may be called earlier to get a partial trace.
+      */
+    bool Write()
+    {
+        if (!enabled_) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ofstream out(path_, std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            std::printf("[ERROR] Open file failed. path = %s\n", path_);
+            return false;
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"host\"}}";
+        for (const auto &entry : hostTracks_) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << entry.second
+                << ",\"args\":{\"name\":\"host thread " << entry.second << "\"}}";
+        }
+        for (const auto &entry : deviceTracks_) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << entry.second
+                << ",\"args\":{\"name\":\"device stream " << entry.second - DEVICE_TRACK_BASE << "\"}}";
+        }
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        for (const auto &span : spans_) {
+            out << ",\n{\"name\":\"" << span.name << "\",\"cat\":\"" << span.category
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.track << ",\"ts\":" << span.beginUs
+                << ",\"dur\":" << span.durationUs << "}";
+        }
+        out << "\n]}\n";
+        std::printf("[TIMELINE] %zu spans written to %s\n", spans_.size(), path_);
+        return true;
+    }
+
+private:
+    static constexpr uint32_t DEVICE_TRACK_BASE = 1000U;
+
+    struct Span {
+        const char *name; // string literals only, nothing is copied while recording
+        const char *category;
+        double beginUs;
+        double durationUs;
+        uint32_t track;
+    };
+
+    struct DeviceSpan {
+        const char *name;
+        void *stream;
+        double hostUs; // DeviceBegin, used in cpu mode
+        // end is created by DeviceEnd, so a span without it was never closed and is dropped.
+#ifndef ASCENDC_CPU_DEBUG
+        aclrtEvent start;
+        aclrtEvent end;
+#else
+        void *start;
+        void *end;
+#endif
+    };
+
+    HostTimeline() : origin_(std::chrono::steady_clock::now())
+    {
+        path_ = std::getenv("HOST_TIMELINE_FILE");
+        enabled_ = path_ != nullptr && path_[0] != '\0';
+        if (enabled_) {
+            (void)std::atexit([]() { (void)Instance().Write(); });
+        }
+    }
+
+    static void ReleaseEvents(DeviceSpan &span)
+    {
+#ifndef ASCENDC_CPU_DEBUG
+        if (span.start != nullptr) {
+            (void)aclrtDestroyEvent(span.start);
+        }
+        if (span.end != nullptr) {
+            (void)aclrtDestroyEvent(span.end);
+        }
+#endif
+        span.start = nullptr;
+        span.end = nullptr;
+    }
+
+    // Both called with mutex_ held.
+    uint32_t HostTrack()
+    {
+        auto it = hostTracks_.emplace(std::this_thread::get_id(), static_cast<uint32_t>(hostTracks_.size()) + 1U);
+        return it.first->second;
+    }
+
+    uint32_t DeviceTrack(void *stream)
+    {
+        auto it = deviceTracks_.emplace(stream, DEVICE_TRACK_BASE + static_cast<uint32_t>(deviceTracks_.size()));
+        return it.first->second;
+    }
+
+    bool enabled_ = false;
+    const char *path_ = nullptr;
+    std::chrono::steady_clock::time_point origin_;
+    std::mutex mutex_;
+    std::vector<Span> spans_;
+    std::vector<DeviceSpan> pending_;
+    std::map<std::thread::id, uint32_t> hostTracks_;
+    std::map<void *, uint32_t> deviceTracks_;
+};
+
+/**
+ * @brief Scoped host span: records [construction, destruction) on the track of the calling thread.
+ */
+class HostTimelineSpan {
+public:
+    explicit HostTimelineSpan(const char *name, const char *category = "host")
+        : name_(name), category_(category)
+    {
+        HostTimeline &timeline = HostTimeline::Instance();
+        beginUs_ = timeline.NowUs();
+    }
+
+    ~HostTimelineSpan()
+    {
+        HostTimeline &timeline = HostTimeline::Instance();
+        if (timeline.Enabled()) {
+            timeline.AddSpan(name_, category_, beginUs_, timeline.NowUs());
+        }
+    }
+
+    HostTimelineSpan(const HostTimelineSpan &) = delete;
+    HostTimelineSpan &operator=(const HostTimelineSpan &) = delete;
+
+private:
+    const char *name_;
+    const char *category_;
+    double beginUs_;
+};
+
+#endif // HOST_TIMELINE_H
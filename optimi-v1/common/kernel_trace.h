@@ -0,0 +1,44 @@
+/**
+ * @file kernel_trace.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef KERNEL_TRACE_H
+#define KERNEL_TRACE_H
+
+#include <cstdint>
+
+/*
+ * GM layout of the in-kernel phase trace, shared by kernel and host.
+ *
+ * The trace region is appended to the user workspace. Every core owns a fixed slot of
+ * KERNEL_TRACE_CORE_BYTES, addressed by its block index, so cores never contend:
+ *   word 0      : magic (low 32 bits) | block index (high 32 bits)
+ *   word 1      : recorded events (low 32 bits) | dropped events (high 32 bits)
+ *   word 2..3   : reserved
+ *   word 4 + 3i : phase id (low 32 bits) | phase argument (high 32 bits)
+ *   word 5 + 3i : begin cycle (GetSystemCycle)
+ *   word 6 + 3i : end cycle (GetSystemCycle)
+ */
+constexpr uint32_t KERNEL_TRACE_MAGIC = 0x4B545243U; // "KTRC"
+constexpr uint32_t KERNEL_TRACE_MAX_CORES = 64U;
+constexpr uint32_t KERNEL_TRACE_CORE_BYTES = 8192U;
+constexpr uint32_t KERNEL_TRACE_HEADER_WORDS = 4U;
+constexpr uint32_t KERNEL_TRACE_EVENT_WORDS = 3U;
+constexpr uint32_t KERNEL_TRACE_CORE_WORDS = KERNEL_TRACE_CORE_BYTES / sizeof(uint64_t);
+constexpr uint32_t KERNEL_TRACE_MAX_EVENTS = (KERNEL_TRACE_CORE_WORDS - KERNEL_TRACE_HEADER_WORDS) / KERNEL_TRACE_EVENT_WORDS;
+constexpr uint32_t KERNEL_TRACE_BYTES = KERNEL_TRACE_MAX_CORES * KERNEL_TRACE_CORE_BYTES;
+
+enum KernelTracePhase : uint32_t {
+    TRACE_PHASE_COPY_IN = 1,
+    TRACE_PHASE_COMPUTE = 2,
+    TRACE_PHASE_COPY_OUT = 3,
+    TRACE_PHASE_ITERATE = 4,
+    TRACE_PHASE_GET_TENSOR_C = 5,
+};
+
+#endif // KERNEL_TRACE_H
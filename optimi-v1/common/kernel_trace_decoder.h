@@ -0,0 +1,156 @@
+/**
+ * @file kernel_trace_decoder.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef KERNEL_TRACE_DECODER_H
+#define KERNEL_TRACE_DECODER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "kernel_trace.h"
+
+inline const char *KernelTracePhaseName(uint32_t phase)
+{
+    switch (phase) {
+        case TRACE_PHASE_COPY_IN:
+            return "CopyIn";
+        case TRACE_PHASE_COMPUTE:
+            return "Compute";
+        case TRACE_PHASE_COPY_OUT:
+            return "CopyOut";
+        case TRACE_PHASE_ITERATE:
+            return "Iterate";
+        case TRACE_PHASE_GET_TENSOR_C:
+            return "GetTensorC";
+        default:
+            return "Unknown";
+    }
+}
+
+/**
+ * @brief System counter frequency used to convert cycle stamps, KERNEL_TRACE_FREQ_MHZ overrides the 50MHz default.
+ */
+inline double KernelTraceFreqMhz()
+{
+    const char *value = std::getenv("KERNEL_TRACE_FREQ_MHZ");
+    if (value != nullptr) {
+        const double parsed = std::strtod(value, nullptr);
+        if (parsed > 0.0) {
+            return parsed;
+        }
+    }
+    return 50.0;
+}
+
+/**
+ * @brief Decode a trace region copied back from the workspace and write it as Chrome trace JSON
+ *        (load with chrome://tracing or ui.perfetto.dev). A per-core summary is printed to stdout.
+ * @param [in] trace: host copy of the trace region
+ * @param [in] size: size of the host copy, at least KERNEL_TRACE_BYTES
+ * @param [in] jsonPath: output json path
+ * @param [in] launchName: label of this launch, shown as the process name
+ * @return false if the region holds no valid core slot or the file cannot be written
+ */
+inline bool DumpKernelTrace(const void *trace, size_t size, const std::string &jsonPath, const std::string &launchName)
+{
+    if (trace == nullptr || size < KERNEL_TRACE_BYTES) {
+        fprintf(stdout, "[WARN]  kernel trace buffer is missing or too small\n");
+        return false;
+    }
+    const uint64_t *words = static_cast<const uint64_t *>(trace);
+    const double cyclesPerUs = KernelTraceFreqMhz();
+
+    // Align all cores on the earliest stamp so the timeline starts at zero.
+    int64_t origin = INT64_MAX;
+    uint32_t validCores = 0;
+    for (uint32_t core = 0; core < KERNEL_TRACE_MAX_CORES; ++core) {
+        const uint64_t *slot = words + core * KERNEL_TRACE_CORE_WORDS;
+        const uint32_t count = static_cast<uint32_t>(slot[1] & 0xFFFFFFFFU);
+        if (static_cast<uint32_t>(slot[0] & 0xFFFFFFFFU) != KERNEL_TRACE_MAGIC || count == 0 ||
+            count > KERNEL_TRACE_MAX_EVENTS) {
+            continue;
+        }
+        ++validCores;
+        const int64_t begin = static_cast<int64_t>(slot[KERNEL_TRACE_HEADER_WORDS + 1]);
+        origin = begin < origin ? begin : origin;
+    }
+    if (validCores == 0) {
+        fprintf(stdout, "[WARN]  kernel trace holds no core record, was the kernel built with KERNEL_TRACE?\n");
+        return false;
+    }
+
+    std::ofstream out(jsonPath.c_str(), std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        fprintf(stdout, "[ERROR]  Open file failed. path = %s\n", jsonPath.c_str());
+        return false;
+    }
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" << launchName << "\"}}";
+
+    int64_t minSpan = INT64_MAX;
+    int64_t maxSpan = 0;
+    int64_t sumSpan = 0;
+    for (uint32_t core = 0; core < KERNEL_TRACE_MAX_CORES; ++core) {
+        const uint64_t *slot = words + core * KERNEL_TRACE_CORE_WORDS;
+        const uint32_t count = static_cast<uint32_t>(slot[1] & 0xFFFFFFFFU);
+        const uint32_t dropped = static_cast<uint32_t>(slot[1] >> 32);
+        if (static_cast<uint32_t>(slot[0] & 0xFFFFFFFFU) != KERNEL_TRACE_MAGIC || count == 0 ||
+            count > KERNEL_TRACE_MAX_EVENTS) {
+            continue;
+        }
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << core << ",\"args\":{\"name\":\"core "
+            << core << "\"}}";
+
+        int64_t phaseCycles[TRACE_PHASE_GET_TENSOR_C + 1] = {0};
+        int64_t first = INT64_MAX;
+        int64_t last = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint64_t *event = slot + KERNEL_TRACE_HEADER_WORDS + i * KERNEL_TRACE_EVENT_WORDS;
+            const uint32_t phase = static_cast<uint32_t>(event[0] & 0xFFFFFFFFU);
+            const uint32_t arg = static_cast<uint32_t>(event[0] >> 32);
+            const int64_t begin = static_cast<int64_t>(event[1]);
+            const int64_t end = static_cast<int64_t>(event[2]);
+            const int64_t cycles = end > begin ? end - begin : 0;
+            if (phase <= TRACE_PHASE_GET_TENSOR_C) {
+                phaseCycles[phase] += cycles;
+            }
+            first = begin < first ? begin : first;
+            last = end > last ? end : last;
+            out << ",\n{\"name\":\"" << KernelTracePhaseName(phase) << "\",\"cat\":\"kernel\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << core << ",\"ts\":" << static_cast<double>(begin - origin) / cyclesPerUs
+                << ",\"dur\":" << static_cast<double>(cycles) / cyclesPerUs << ",\"args\":{\"arg\":" << arg
+                << ",\"cycles\":" << cycles << "}}";
+        }
+        const int64_t span = last - first;
+        minSpan = span < minSpan ? span : minSpan;
+        maxSpan = span > maxSpan ? span : maxSpan;
+        sumSpan += span;
+        fprintf(stdout,
+                "[TRACE] core=%u events=%u dropped=%u span_cycles=%lld copyin=%lld compute=%lld copyout=%lld "
+                "iterate=%lld get_tensor_c=%lld\n",
+                core, count, dropped, static_cast<long long>(span), static_cast<long long>(phaseCycles[TRACE_PHASE_COPY_IN]),
+                static_cast<long long>(phaseCycles[TRACE_PHASE_COMPUTE]),
+                static_cast<long long>(phaseCycles[TRACE_PHASE_COPY_OUT]),
+                static_cast<long long>(phaseCycles[TRACE_PHASE_ITERATE]),
+                static_cast<long long>(phaseCycles[TRACE_PHASE_GET_TENSOR_C]));
+    }
+    out << "\n]}\n";
+    out.close();
+
+    const double meanSpan = static_cast<double>(sumSpan) / validCores;
+    fprintf(stdout, "[TRACE] %s cores=%u min_span=%lld max_span=%lld imbalance=%.3f freq_mhz=%.1f json=%s\n",
+            launchName.c_str(), validCores, static_cast<long long>(minSpan), static_cast<long long>(maxSpan),
+            meanSpan > 0.0 ? static_cast<double>(maxSpan) / meanSpan : 1.0, cyclesPerUs, jsonPath.c_str());
+    return true;
+}
+
+#endif // KERNEL_TRACE_DECODER_H
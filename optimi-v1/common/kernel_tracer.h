@@ -0,0 +1,132 @@
+/**
+ * @file kernel_tracer.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef KERNEL_TRACER_H
+#define KERNEL_TRACER_H
+
+#include "kernel_operator.h"
+#include "kernel_trace.h"
+
+/**
+  * @brief  Per-core phase recorder. Stamps are taken with GetSystemCycle on the scalar pipe, so
+  *         asynchronous MTE/vector/cube work is attributed to the phase that waits on it (DeQue/GetTensorC).
+  *         Without KERNEL_TRACE every member is an empty inline function and the tracer compiles out.
+  */
+class KernelTracer {
+public:
+    __aicore__ inline KernelTracer() {}
+
+#ifdef KERNEL_TRACE
+    /**
+      * @brief  Bind the tracer to the trace region of the current core.
+      * @param  traceGm: Start of the trace region (KERNEL_TRACE_BYTES), nullptr disables tracing.
+      * @retval None
+      */
+    __aicore__ inline void Init(GM_ADDR traceGm)
+    {
+        if ASCEND_IS_AIC {
+            return; // cube side of a mix kernel shares block indices with the vector side.
+        }
+        const uint32_t blockIdx = AscendC::GetBlockIdx();
+        if (traceGm == nullptr || blockIdx >= KERNEL_TRACE_MAX_CORES) {
+            return;
+        }
+        slotGm.SetGlobalBuffer(reinterpret_cast<__gm__ uint64_t *>(traceGm + blockIdx * KERNEL_TRACE_CORE_BYTES),
+                               KERNEL_TRACE_CORE_WORDS);
+        this->blockIdx = blockIdx;
+        enabled = true;
+    }
+
+    __aicore__ inline int64_t Begin() const
+    {
+        return enabled ? static_cast<int64_t>(AscendC::GetSystemCycle()) : 0;
+    }
+
+    /**
+      * @brief  Record one phase that started at begin and ends now.
+      * @param  phase: KernelTracePhase id.
+      * @param  arg: Phase argument, usually the tile or loop index.
+      * @param  begin: Cycle returned by Begin().
+      * @retval None
+      */
+    __aicore__ inline void End(uint32_t phase, uint32_t arg, int64_t begin)
+    {
+        if (!enabled) {
+            return;
+        }
+        const int64_t end = static_cast<int64_t>(AscendC::GetSystemCycle());
+        if (count >= KERNEL_TRACE_MAX_EVENTS) {
+            ++dropped;
+            return;
+        }
+        const uint32_t base = KERNEL_TRACE_HEADER_WORDS + count * KERNEL_TRACE_EVENT_WORDS;
+        slotGm.SetValue(base, (static_cast<uint64_t>(arg) << 32) | phase);
+        slotGm.SetValue(base + 1, static_cast<uint64_t>(begin));
+        slotGm.SetValue(base + 2, static_cast<uint64_t>(end));
+        ++count;
+    }
+
+    /**
+      * @brief  Publish the slot header and write the scalar cache back to GM. Call once at kernel exit.
+      * @retval None
+      */
+    __aicore__ inline void Flush()
+    {
+        if (!enabled) {
+            return;
+        }
+        slotGm.SetValue(0, (static_cast<uint64_t>(blockIdx) << 32) | KERNEL_TRACE_MAGIC);
+        slotGm.SetValue(1, (static_cast<uint64_t>(dropped) << 32) | count);
+        AscendC::DataCacheCleanAndInvalid<uint64_t, AscendC::CacheLine::ENTIRE_DATA_CACHE>(slotGm);
+    }
+
+private:
+    AscendC::GlobalTensor<uint64_t> slotGm;
+    uint32_t blockIdx = 0;
+    uint32_t count = 0;
+    uint32_t dropped = 0;
+    bool enabled = false;
+#else
+    __aicore__ inline void Init(GM_ADDR traceGm)
+    {
+        (void)traceGm;
+    }
+    __aicore__ inline int64_t Begin() const
+    {
+        return 0;
+    }
+    __aicore__ inline void End(uint32_t phase, uint32_t arg, int64_t begin)
+    {
+        (void)phase;
+        (void)arg;
+        (void)begin;
+    }
+    __aicore__ inline void Flush() {}
+#endif
+};
+
+/**
+  * @brief  Locate the trace region of a framework-launched kernel: it follows the user workspace.
+  * @param  workspace: Workspace gm addr passed to the kernel entry.
+  * @param  userWorkspaceBytes: Size of the op's own user workspace that precedes the trace region.
+  * @retval Trace region gm addr, nullptr when tracing is compiled out.
+  */
+__aicore__ inline GM_ADDR GetKernelTraceGm(GM_ADDR workspace, uint64_t userWorkspaceBytes)
+{
+#ifdef KERNEL_TRACE
+    GM_ADDR userWorkspace = AscendC::GetUserWorkspace(workspace);
+    return userWorkspace == nullptr ? nullptr : userWorkspace + userWorkspaceBytes;
+#else
+    (void)workspace;
+    (void)userWorkspaceBytes;
+    return nullptr;
+#endif
+}
+
+#endif // KERNEL_TRACER_H
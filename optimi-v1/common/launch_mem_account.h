@@ -0,0 +1,144 @@
+/**
+ * @file launch_mem_account.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef LAUNCH_MEM_ACCOUNT_H
+#define LAUNCH_MEM_ACCOUNT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+
+/**
+ * @brief Device memory one kernel launch needs, by role, in the bytes the launcher asks for (AclMemPool rounds
+ *        each block up to its granule on top of this).
+ *
+ *        userWorkspace is what the op asks for beyond the matmul API: M*N fp32 for the matmul + LeakyRelu
+ *        kernels. An aclnn op returns user and system workspace as one size from GetWorkspaceSize, so the
+ *        framework runners book all of it as userWorkspace and leave systemWorkspace 0; its tiling lives in
+ *        the op executor and is not visible to them either.
+ */
+struct LaunchMemFootprint {
+    size_t input = 0;
+    size_t output = 0;
+    size_t userWorkspace = 0;
+    size_t systemWorkspace = 0; // GetLibApiWorkSpaceSize
+    size_t tiling = 0;
+    size_t trace = 0; // kernel trace region of KERNEL_TRACE builds
+
+    size_t Workspace() const
+    {
+        return userWorkspace + systemWorkspace + trace;
+    }
+
+    size_t Total() const
+    {
+        return input + output + Workspace() + tiling;
+    }
+};
+
+inline double LaunchMemMiB(size_t bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+inline void PrintLaunchMem(const char *op, const LaunchMemFootprint &mem, FILE *out = stdout)
+{
+    std::fprintf(out, "[MEMACCT] %s input=%zu output=%zu user_ws=%zu sys_ws=%zu tiling=%zu trace=%zu total=%zu "
+                 "(%.2f MiB)\n", op, mem.input, mem.output, mem.userWorkspace, mem.systemWorkspace, mem.tiling,
+                 mem.trace, mem.Total(), LaunchMemMiB(mem.Total()));
+}
+
+inline void WriteLaunchMemJson(std::ostream &out, const LaunchMemFootprint &mem)
+{
+    out << "{\"input\":" << mem.input << ",\"output\":" << mem.output << ",\"user_workspace\":" << mem.userWorkspace
+        << ",\"system_workspace\":" << mem.systemWorkspace << ",\"tiling\":" << mem.tiling << ",\"trace\":"
+        << mem.trace << ",\"total\":" << mem.Total() << "}";
+}
+
+/**
+ * @brief Session view of the launches a process made: how many, the footprint of the largest one, and the
+ *        largest value every role reached over all of them. The roles may peak in different launches:
+ *        peak.Total() is what the largest single launch needs, roleMax.Total() what a process that keeps one
+ *        grow-only buffer per role (sweep, service) ends up holding after serving all of them.
+ */
+struct LaunchMemSession {
+    uint64_t launches = 0;
+    const char *peakOp = nullptr;
+    LaunchMemFootprint peak;
+    LaunchMemFootprint roleMax;
+};
+
+class LaunchMemAccount {
+public:
+    static LaunchMemAccount &Instance()
+    {
+        // Leaked on purpose like AclMemPool, so reports made from atexit still see it.
+        static LaunchMemAccount *account = new LaunchMemAccount();
+        return *account;
+    }
+
+    /**
+      * @brief  Book one launch. op must outlive the account (a string literal).
+      */
+    void Record(const char *op, const LaunchMemFootprint &mem)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++session_.launches;
+        if (session_.peakOp == nullptr || mem.Total() > session_.peak.Total()) {
+            session_.peakOp = op;
+            session_.peak = mem;
+        }
+        LaunchMemFootprint &max = session_.roleMax;
+        max.input = mem.input > max.input ? mem.input : max.input;
+        max.output = mem.output > max.output ? mem.output : max.output;
+        max.userWorkspace = mem.userWorkspace > max.userWorkspace ? mem.userWorkspace : max.userWorkspace;
+        max.systemWorkspace = mem.systemWorkspace > max.systemWorkspace ? mem.systemWorkspace : max.systemWorkspace;
+        max.tiling = mem.tiling > max.tiling ? mem.tiling : max.tiling;
+        max.trace = mem.trace > max.trace ? mem.trace : max.trace;
+    }
+
+    LaunchMemSession Session()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return session_;
+    }
+
+    void Report(FILE *out = stdout)
+    {
+        const LaunchMemSession session = Session();
+        if (session.launches == 0U) {
+            return;
+        }
+        std::fprintf(out, "[MEMACCT] session launches=%llu peak_launch=%zu (%.2f MiB, %s) role_max=%zu (%.2f MiB) "
+                     "peak_user_ws=%zu peak_sys_ws=%zu\n", static_cast<unsigned long long>(session.launches),
+                     session.peak.Total(), LaunchMemMiB(session.peak.Total()), session.peakOp,
+                     session.roleMax.Total(), LaunchMemMiB(session.roleMax.Total()), session.roleMax.userWorkspace,
+                     session.roleMax.systemWorkspace);
+    }
+
+    void WriteJson(std::ostream &out)
+    {
+        const LaunchMemSession session = Session();
+        out << "{\"launches\":" << session.launches << ",\"peak_launch\":";
+        WriteLaunchMemJson(out, session.peak);
+        out << ",\"role_max\":";
+        WriteLaunchMemJson(out, session.roleMax);
+        out << "}";
+    }
+
+private:
+    LaunchMemAccount() = default;
+
+    std::mutex mutex_;
+    LaunchMemSession session_;
+};
+
+#endif // LAUNCH_MEM_ACCOUNT_H
@@ -0,0 +1,193 @@
+/**
+ * @file matmul_cost_model.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_COST_MODEL_H
+#define MATMUL_COST_MODEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "matmul_memory_plan.h"
+#include "tiling/platform/platform_ascendc.h"
+
+/*
+ * Analytical cost model for the matmul + vector epilogue kernels (MatmulLeakyKernel).
+ *
+ * A plan is (baseM, baseN, coreNum), where coreNum counts vector blocks as in TCubeTiling::usedCoreNum.
+ * Every vector block owns ceil(tiles / coreNum) base tiles (wave quantization). On 910B one cube core
+ * serves two vector blocks. The estimate in cycles is
+ *   max(cube cycles, vector cycles) per block + per-tile scalar/sync overhead
+ * bounded below by GM traffic:
+ *   unique A/B bytes from HBM + re-read A/B bytes from L2 (or HBM when A+B do not fit L2)
+ *   + C write-out (and the workspace round trip from cube to vector on 910B).
+ * The constants are throughput figures, not latencies. Only the ranking between plans matters.
+ */
+struct MatmulCostPlatform {
+    uint32_t aivCoreNum = 1;
+    bool is310p = false;
+    uint64_t l0cSize = 128 * 1024;
+    uint64_t ubSize = 192 * 1024;
+    uint64_t l1Size = 512 * 1024;
+    uint64_t l2Size = 192 * 1024 * 1024;
+    double hbmBytesPerCycle = 860.0; // chip-wide
+    double l2BytesPerCycle = 1900.0; // chip-wide
+};
+
+struct MatmulCostShape {
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t abElemSize; // 2 for fp16, 4 for fp32 (HF32 cube at half rate)
+};
+
+struct MatmulPlan {
+    int32_t baseM;
+    int32_t baseN;
+    uint32_t coreNum;
+    double cycles;
+};
+
+inline MatmulCostPlatform MakeMatmulCostPlatform(const platform_ascendc::PlatformAscendC &platform)
+{
+    MatmulCostPlatform cost;
+    cost.aivCoreNum = std::max<uint32_t>(1U, platform.GetCoreNumAiv());
+    cost.is310p = (platform.GetSocVersion() == platform_ascendc::SocVersion::ASCEND310P);
+    uint64_t size = 0;
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::L0_C, size);
+    cost.l0cSize = size > 0 ? size : cost.l0cSize;
+    size = 0;
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::UB, size);
+    cost.ubSize = size > 0 ? size : cost.ubSize;
+    size = 0;
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::L1, size);
+    cost.l1Size = size > 0 ? size : cost.l1Size;
+    size = 0;
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::L2, size);
+    cost.l2Size = size > 0 ? size : cost.l2Size;
+    if (cost.is310p) {
+        cost.hbmBytesPerCycle = 200.0;
+        cost.l2BytesPerCycle = 400.0;
+    }
+    return cost;
+}
+
+inline uint64_t CostCeilDiv(uint64_t a, uint64_t b)
+{
+    return (a + b - 1U) / b;
+}
+
+/**
+  * @brief  Whether a (baseM, baseN) tile fits L0C and the vector epilogue buffers in UB.
+  */
+inline bool MatmulPlanFits(const MatmulCostPlatform &platform, int32_t baseM, int32_t baseN)
+{
+    const uint64_t cTileBytes = static_cast<uint64_t>(baseM) * static_cast<uint64_t>(baseN) * sizeof(float);
+    // reluOut holds at least a quarter of the tile (splitRowNums >= 4 for baseM >= 128), the exact split is
+    // checked against the final tiling by MatmulMemoryFits.
+    return (baseM % 16 == 0) && (baseN % 16 == 0) && cTileBytes <= platform.l0cSize &&
+           LeakyReluKernelUbBytes(static_cast<uint32_t>(baseM), static_cast<uint32_t>(baseN), 4U) <= platform.ubSize;
+}
+
+/**
+  * @brief  Estimated kernel cycles of one plan, see the file comment for the model.
+  */
+inline double EstimateMatmulCycles(const MatmulCostPlatform &platform, const MatmulCostShape &shape, int32_t baseM,
+                                   int32_t baseN, uint32_t coreNum)
+{
+    const uint64_t tilesM = CostCeilDiv(shape.M, static_cast<uint64_t>(baseM));
+    const uint64_t tilesN = CostCeilDiv(shape.N, static_cast<uint64_t>(baseN));
+    const uint64_t tiles = tilesM * tilesN;
+    const uint64_t tilesPerCore = CostCeilDiv(tiles, coreNum);
+    const double blocksPerCube = platform.is310p ? 1.0 : 2.0;
+
+    // Cube: 16x16x16 fp16 MACs per cycle, HF32 at half rate. Padding to 16 is wasted work.
+    const double cubeTile = static_cast<double>(CostCeilDiv(baseM, 16U) * CostCeilDiv(baseN, 16U) * CostCeilDiv(shape.K, 16U)) *
+                            (shape.abElemSize == 4U ? 2.0 : 1.0);
+    const double cubeCycles = cubeTile * static_cast<double>(tilesPerCore) * blocksPerCube;
+
+    // Vector epilogue: 64 fp32 lanes per cycle plus the copy-out issue cost of each split row.
+    const double vecTile = static_cast<double>(baseM) * baseN / 64.0 + 4.0 * 64.0;
+    const double vecCycles = vecTile * static_cast<double>(tilesPerCore);
+
+    const double overhead = 300.0 * static_cast<double>(tilesPerCore) + 2000.0;
+    const double computeCycles = std::max(cubeCycles, vecCycles) + overhead;
+
+    // GM traffic: every tile streams its A row panel and B column panel.
+    const double uniqueBytes = (static_cast<double>(shape.M) * shape.K + static_cast<double>(shape.K) * shape.N) * shape.abElemSize;
+    const double streamedBytes = static_cast<double>(tiles) * (static_cast<double>(baseM) + baseN) * shape.K * shape.abElemSize;
+    const double rereadBytes = std::max(0.0, streamedBytes - uniqueBytes);
+    const double cBytes = static_cast<double>(shape.M) * shape.N * sizeof(float) * (platform.is310p ? 1.0 : 3.0);
+    const bool abFitsL2 = uniqueBytes <= static_cast<double>(platform.l2Size) / 2.0;
+    // Only the active cores pull bandwidth; fewer cores cannot saturate HBM.
+    const double activeShare = std::min(1.0, static_cast<double>(std::min<uint64_t>(tiles, coreNum)) / platform.aivCoreNum);
+    const double bwScale = std::max(0.25, activeShare);
+    const double memCycles = (uniqueBytes + cBytes) / (platform.hbmBytesPerCycle * bwScale) +
+                             rereadBytes / ((abFitsL2 ? platform.l2BytesPerCycle : platform.hbmBytesPerCycle) * bwScale);
+
+    return std::max(computeCycles, memCycles);
+}
+
+inline void AppendMatmulPlans(const MatmulCostPlatform &platform, const MatmulCostShape &shape, int32_t baseM,
+                              int32_t baseN, uint32_t coreCap, std::vector<MatmulPlan> &plans)
+{
+    const uint64_t tiles = CostCeilDiv(shape.M, static_cast<uint64_t>(baseM)) *
+                           CostCeilDiv(shape.N, static_cast<uint64_t>(baseN));
+    const uint32_t maxUseful = static_cast<uint32_t>(std::min<uint64_t>(tiles, coreCap));
+    for (uint32_t core = 1U; core <= maxUseful; ++core) {
+        // 910B: blockDim = usedCoreNum / 2 cube cores, so keep even plans (and no single-core plan).
+        if (!platform.is310p && (core < 2U || (core & 1U) != 0U)) {
+            continue;
+        }
+        plans.push_back({baseM, baseN, core, EstimateMatmulCycles(platform, shape, baseM, baseN, core)});
+    }
+}
+
+/**
+  * @brief  Rank every legal plan for a shape by estimated cost (cheapest first).
+  * @param  maxCoreNum: Upper bound of vector blocks, e.g. MATMUL_FORCE_CORE_NUM or the platform AIV count.
+  * @param  forceBaseM/forceBaseN: When both are non-zero, plans of that split are ranked ahead of all others.
+  * @retval Plans sorted by cycles, larger tiles first on equal cost, to be tried in order until GetTiling
+  *         accepts one.
+  */
+inline std::vector<MatmulPlan> RankMatmulPlans(const MatmulCostPlatform &platform, const MatmulCostShape &shape,
+                                               uint32_t maxCoreNum, uint32_t forceBaseM = 0U, uint32_t forceBaseN = 0U)
+{
+    static const int32_t bases[] = {64, 128, 256};
+    const uint32_t coreCap = std::max<uint32_t>(1U, std::min<uint32_t>(maxCoreNum, platform.aivCoreNum));
+    auto byCost = [](const MatmulPlan &a, const MatmulPlan &b) {
+        if (a.cycles != b.cycles) {
+            return a.cycles < b.cycles;
+        }
+        return static_cast<int64_t>(a.baseM) * a.baseN > static_cast<int64_t>(b.baseM) * b.baseN;
+    };
+
+    std::vector<MatmulPlan> plans;
+    const bool forced = forceBaseM > 0U && forceBaseN > 0U;
+    if (forced) {
+        AppendMatmulPlans(platform, shape, static_cast<int32_t>(forceBaseM), static_cast<int32_t>(forceBaseN), coreCap,
+                          plans);
+        std::stable_sort(plans.begin(), plans.end(), byCost);
+    }
+    const size_t rankedFrom = plans.size();
+    for (int32_t baseM : bases) {
+        for (int32_t baseN : bases) {
+            const bool isForced = forced && static_cast<uint32_t>(baseM) == forceBaseM &&
+                                  static_cast<uint32_t>(baseN) == forceBaseN;
+            if (!isForced && MatmulPlanFits(platform, baseM, baseN)) {
+                AppendMatmulPlans(platform, shape, baseM, baseN, coreCap, plans);
+            }
+        }
+    }
+    std::stable_sort(plans.begin() + static_cast<std::ptrdiff_t>(rankedFrom), plans.end(), byCost);
+    return plans;
+}
+
+#endif // MATMUL_COST_MODEL_H
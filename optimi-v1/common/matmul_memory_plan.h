@@ -0,0 +1,140 @@
+/**
+ * @file matmul_memory_plan.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_MEMORY_PLAN_H
+#define MATMUL_MEMORY_PLAN_H
+
+#include <cstdint>
+
+#include "tiling/platform/platform_ascendc.h"
+
+/*
+ * On-chip memory budget of one matmul tiling: the matmul API buffers (A/B/bias in L1, A in L0A, B in L0B,
+ * C in L0C, each with its double-buffer factor) plus the UB the kernel allocates itself (relu queues,
+ * 310P format buffer). Used before GetTiling to hand the API only the UB the kernel leaves over, and after
+ * it to reject a tiling that would overflow at runtime.
+ */
+struct MatmulCoreMemory {
+    uint64_t l1 = 0;
+    uint64_t l0a = 0;
+    uint64_t l0b = 0;
+    uint64_t l0c = 0;
+    uint64_t ub = 0;
+};
+
+struct MatmulMemoryUse {
+    uint64_t l1 = 0;
+    uint64_t l0a = 0;
+    uint64_t l0b = 0;
+    uint64_t l0c = 0;
+    uint64_t ub = 0;
+};
+
+inline MatmulCoreMemory MakeMatmulCoreMemory(const platform_ascendc::PlatformAscendC &platform)
+{
+    MatmulCoreMemory mem;
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::L1, mem.l1);
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::L0_A, mem.l0a);
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::L0_B, mem.l0b);
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::L0_C, mem.l0c);
+    platform.GetCoreMemSize(platform_ascendc::CoreMemType::UB, mem.ub);
+    return mem;
+}
+
+/**
+  * @brief  UB held by the matmul + LeakyRelu kernels: reluInQueue (one fp32 base tile) and reluOutQueue
+  *         (one split of splitRowNums rows).
+  */
+inline uint64_t LeakyReluKernelUbBytes(uint32_t baseM, uint32_t baseN, uint32_t splitRowNums)
+{
+    const uint64_t tile = static_cast<uint64_t>(baseM) * baseN * sizeof(float);
+    return tile + tile / (splitRowNums == 0U ? 1U : splitRowNums);
+}
+
+/**
+  * @brief  Host mirror of SelectSplitRowNums in the 12 op_kernel, keep the two in sync.
+  */
+inline uint32_t LeakyReluSplitRowNums(uint32_t baseM, uint32_t baseN, uint32_t singleCoreM)
+{
+    uint32_t split = baseM >= 256U ? 8U : (baseM >= 128U ? 4U : 2U);
+    while (split > 1U) {
+        const uint32_t splitRow = baseM / split;
+        if ((baseM % split == 0U) && (splitRow > 0U) && (singleCoreM % splitRow == 0U) && (splitRow * baseN >= 1024U)) {
+            return split;
+        }
+        split >>= 1U;
+    }
+    return 1U;
+}
+
+/**
+  * @brief  Hand the tiling API the whole L1/L0C and the UB the kernel does not hold itself.
+  * @retval false if the kernel buffers alone overflow UB.
+  */
+template <typename TilingApi>
+inline bool SetMatmulBufferBudget(TilingApi &tilingApi, const MatmulCoreMemory &mem, uint64_t kernelUbBytes)
+{
+    if (kernelUbBytes > mem.ub) {
+        return false;
+    }
+    tilingApi.SetBufferSpace(static_cast<int32_t>(mem.l1), static_cast<int32_t>(mem.l0c),
+                             static_cast<int32_t>(mem.ub - kernelUbBytes));
+    return true;
+}
+
+/**
+  * @brief  Footprint of a tiling from MultiCoreMatmulTiling::GetTiling (optiling::TCubeTiling or TCubeTiling).
+  * @param  kernelUbBytes: UB the kernel allocates outside the matmul API.
+  */
+template <typename Tiling>
+inline MatmulMemoryUse MatmulTilingMemoryUse(const Tiling &tiling, uint32_t abElemSize, bool hasBias,
+                                             uint64_t kernelUbBytes)
+{
+    const uint64_t baseM = static_cast<uint64_t>(tiling.baseM);
+    const uint64_t baseN = static_cast<uint64_t>(tiling.baseN);
+    const uint64_t baseK = static_cast<uint64_t>(tiling.baseK);
+    auto db = [](int32_t factor) { return static_cast<uint64_t>(factor > 1 ? factor : 1); };
+    MatmulMemoryUse use;
+    use.l1 = (static_cast<uint64_t>(tiling.depthA1) * baseM + static_cast<uint64_t>(tiling.depthB1) * baseN) * baseK *
+             abElemSize;
+    if (hasBias) {
+        use.l1 += baseN * static_cast<uint64_t>(tiling.stepN > 0 ? tiling.stepN : 1) * sizeof(float);
+    }
+    use.l0a = baseM * baseK * abElemSize * db(tiling.dbL0A);
+    use.l0b = baseN * baseK * abElemSize * db(tiling.dbL0B);
+    use.l0c = baseM * baseN * sizeof(float) * db(tiling.dbL0C);
+    use.ub = kernelUbBytes;
+    return use;
+}
+
+/**
+  * @brief  Check a footprint against the core.
+  * @param  overflow: Set to the first buffer that does not fit.
+  */
+inline bool MatmulMemoryFits(const MatmulMemoryUse &use, const MatmulCoreMemory &mem, const char **overflow)
+{
+    const char *name = nullptr;
+    if (use.l1 > mem.l1) {
+        name = "L1";
+    } else if (use.l0a > mem.l0a) {
+        name = "L0A";
+    } else if (use.l0b > mem.l0b) {
+        name = "L0B";
+    } else if (use.l0c > mem.l0c) {
+        name = "L0C";
+    } else if (use.ub > mem.ub) {
+        name = "UB";
+    }
+    if (overflow != nullptr) {
+        *overflow = name;
+    }
+    return name == nullptr;
+}
+
+#endif // MATMUL_MEMORY_PLAN_H
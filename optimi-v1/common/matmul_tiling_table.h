@@ -0,0 +1,138 @@
+/**
+ * @file matmul_tiling_table.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_TILING_TABLE_H
+#define MATMUL_TILING_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Build-time tiling table. A generator runs the tiling search for every shape of a manifest and writes
+ * matmul_tiling_table_data.h with a constexpr array MATMUL_TILING_TABLE sorted by key. Each entry has a
+ * member `key` (a TCubeTiling blob in the kernel launch sample, a MatmulTilingConfigEntry in the op package)
+ * and is looked up by FindMatmulTilingEntry, before any runtime search.
+ *
+ * Manifest: one shape per line, "M,N,K" or "M,N,K,fp32" (default fp16); '#' starts a comment.
+ */
+struct MatmulTilingTableKey {
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t abElemSize;
+};
+
+/**
+  * @brief  Entry of a table that stores the chosen config instead of the tiling blob, for op packages whose
+  *         tiling data cannot be loaded from raw bytes; TilingFunc replays it with a single GetTiling call.
+  */
+struct MatmulTilingConfigEntry {
+    MatmulTilingTableKey key;
+    int32_t baseM;
+    int32_t baseN;
+    uint32_t coreNum;
+    uint32_t stepM;
+    uint32_t stepN;
+    uint32_t depthScale;
+    uint32_t traverse;
+};
+
+constexpr bool MatmulTilingKeyLess(const MatmulTilingTableKey &a, const MatmulTilingTableKey &b)
+{
+    return a.M != b.M ? a.M < b.M :
+           a.N != b.N ? a.N < b.N :
+           a.K != b.K ? a.K < b.K : a.abElemSize < b.abElemSize;
+}
+
+constexpr bool MatmulTilingKeyEqual(const MatmulTilingTableKey &a, const MatmulTilingTableKey &b)
+{
+    return a.M == b.M && a.N == b.N && a.K == b.K && a.abElemSize == b.abElemSize;
+}
+
+template <typename Entry>
+constexpr size_t MatmulTilingLowerBound(const Entry *table, size_t lo, size_t hi, const MatmulTilingTableKey &key)
+{
+    return lo >= hi ? lo :
+           MatmulTilingKeyLess(table[lo + (hi - lo) / 2U].key, key) ?
+               MatmulTilingLowerBound(table, lo + (hi - lo) / 2U + 1U, hi, key) :
+               MatmulTilingLowerBound(table, lo, lo + (hi - lo) / 2U, key);
+}
+
+/**
+  * @brief  Binary search of a generated table, usable in constant expressions.
+  * @retval Index of the entry for key, -1 when the shape was not in the manifest.
+  */
+template <typename Entry, size_t Count>
+constexpr int32_t FindMatmulTilingEntry(const Entry (&table)[Count], const MatmulTilingTableKey &key)
+{
+    return MatmulTilingLowerBound(table, 0U, Count, key) < Count &&
+                   MatmulTilingKeyEqual(table[MatmulTilingLowerBound(table, 0U, Count, key)].key, key) ?
+               static_cast<int32_t>(MatmulTilingLowerBound(table, 0U, Count, key)) :
+               -1;
+}
+
+// Halving recursion keeps the constexpr depth at log2(Count) for large tables.
+template <typename Entry>
+constexpr bool MatmulTilingRangeSorted(const Entry *table, size_t lo, size_t hi)
+{
+    return hi - lo <= 1U ||
+           (MatmulTilingRangeSorted(table, lo, lo + (hi - lo) / 2U) && MatmulTilingRangeSorted(table, lo + (hi - lo) / 2U, hi) &&
+            MatmulTilingKeyLess(table[lo + (hi - lo) / 2U - 1U].key, table[lo + (hi - lo) / 2U].key));
+}
+
+template <typename Entry, size_t Count>
+constexpr bool IsMatmulTilingTableSorted(const Entry (&table)[Count])
+{
+    return MatmulTilingRangeSorted(table, 0U, Count);
+}
+
+/**
+  * @brief  Read a shape manifest, see the file comment for the format.
+  * @param  ok: Set to false if the file cannot be opened or a line does not parse.
+  */
+inline std::vector<MatmulTilingTableKey> LoadMatmulShapeManifest(const std::string &path, bool &ok)
+{
+    std::vector<MatmulTilingTableKey> shapes;
+    std::ifstream in(path);
+    ok = in.is_open();
+    std::string line;
+    while (ok && std::getline(in, line)) {
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.resize(comment);
+        }
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        MatmulTilingTableKey key = {0U, 0U, 0U, 2U};
+        char sep1 = 0;
+        char sep2 = 0;
+        std::istringstream fields(line);
+        ok = (fields >> key.M >> sep1 >> key.N >> sep2 >> key.K) && sep1 == ',' && sep2 == ',' && key.M > 0U &&
+             key.N > 0U && key.K > 0U;
+        std::string dtype;
+        if (ok && std::getline(fields, dtype)) {
+            const size_t begin = dtype.find_first_not_of(" \t\r,");
+            const size_t end = dtype.find_last_not_of(" \t\r");
+            dtype = begin == std::string::npos ? std::string() : dtype.substr(begin, end - begin + 1U);
+            ok = dtype.empty() || dtype == "fp16" || dtype == "fp32";
+            key.abElemSize = dtype == "fp32" ? 4U : 2U;
+        }
+        if (ok) {
+            shapes.push_back(key);
+        }
+    }
+    return shapes;
+}
+
+#endif // MATMUL_TILING_TABLE_H
@@ -0,0 +1,195 @@
+/**
+ * @file matmul_tuning_db.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef MATMUL_TUNING_DB_H
+#define MATMUL_TUNING_DB_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Tuning database written by matmul_autotune and read by GenerateTiling / the op_host TilingFunc.
+ *
+ * Plain text, one entry per line, '#' starts a comment:
+ *   <soc> <aivCoreNum> <M> <N> <K> <abElemSize> <baseM> <baseN> <coreNum> <stepM> <stepN> <depthScale> <traverse> <timeUs>
+ * soc is "ascend910b" or "ascend310p", traverse is 0 for FIRSTM and 1 for FIRSTN. depthScale sets the L1
+ * depth of A/B to step * stepK * depthScale (1 single buffer, 2 double buffer), 0 takes the deepest of double
+ * buffer and the GetTiling depth that fits L1.
+ * Later lines override earlier ones.
+ */
+struct MatmulTuneConfig {
+    int32_t baseM = 0;
+    int32_t baseN = 0;
+    uint32_t coreNum = 0;
+    uint32_t stepM = 1;
+    uint32_t stepN = 1;
+    uint32_t depthScale = 0;
+    uint32_t traverse = 0;
+};
+
+struct MatmulTuneKey {
+    std::string soc;
+    uint32_t aivCoreNum;
+    uint32_t M;
+    uint32_t N;
+    uint32_t K;
+    uint32_t abElemSize;
+};
+
+struct MatmulTuneEntry {
+    MatmulTuneKey key;
+    MatmulTuneConfig config;
+    double timeUs;
+};
+
+inline const char *MatmulTuneSocName(bool is310p)
+{
+    return is310p ? "ascend310p" : "ascend910b";
+}
+
+/**
+  * @brief  Write the tuned step/depth/traversal into a tiling returned by MultiCoreMatmulTiling::GetTiling.
+  *         Works on optiling::TCubeTiling (host) whose fields are readable and set through set_xxx.
+  * @param  l1Size: L1 bytes of one AI core, the A/B/bias L1 footprint must fit.
+  * @retval false if the config does not fit L1.
+  */
+template <typename Tiling>
+inline bool ApplyMatmulTuneConfig(Tiling &tiling, const MatmulTuneConfig &config, uint64_t l1Size, uint32_t abElemSize)
+{
+    const uint32_t stepKa = static_cast<uint32_t>(tiling.stepKa) > 0U ? static_cast<uint32_t>(tiling.stepKa) : 1U;
+    const uint32_t stepKb = static_cast<uint32_t>(tiling.stepKb) > 0U ? static_cast<uint32_t>(tiling.stepKb) : 1U;
+    uint32_t depthA1 = config.stepM * stepKa * config.depthScale;
+    uint32_t depthB1 = config.stepN * stepKb * config.depthScale;
+    const uint64_t baseK = static_cast<uint64_t>(tiling.baseK);
+    auto l1Bytes = [&](uint32_t a1, uint32_t b1) {
+        return (static_cast<uint64_t>(a1) * tiling.baseM + static_cast<uint64_t>(b1) * tiling.baseN) * baseK * abElemSize +
+               static_cast<uint64_t>(tiling.baseN) * config.stepN * sizeof(float);
+    };
+    if (config.depthScale == 0U) {
+        depthA1 = std::max<uint32_t>(static_cast<uint32_t>(tiling.depthA1), config.stepM * stepKa);
+        depthB1 = std::max<uint32_t>(static_cast<uint32_t>(tiling.depthB1), config.stepN * stepKb);
+        const uint32_t deepA1 = std::max<uint32_t>(depthA1, config.stepM * stepKa * 2U);
+        const uint32_t deepB1 = std::max<uint32_t>(depthB1, config.stepN * stepKb * 2U);
+        if (l1Bytes(deepA1, deepB1) <= l1Size) {
+            depthA1 = deepA1;
+            depthB1 = deepB1;
+        }
+    }
+    if (l1Bytes(depthA1, depthB1) > l1Size) {
+        return false;
+    }
+    tiling.set_stepM(config.stepM);
+    tiling.set_stepN(config.stepN);
+    tiling.set_depthA1(depthA1);
+    tiling.set_depthB1(depthB1);
+    return true;
+}
+
+class MatmulTuningDb {
+public:
+    /**
+      * @brief  Process-wide database loaded once from MATMUL_TUNING_DB; empty when the variable is unset.
+      */
+    static const MatmulTuningDb &Global()
+    {
+        static const MatmulTuningDb db(std::getenv("MATMUL_TUNING_DB") == nullptr ? std::string() :
+                                                                                     std::string(std::getenv("MATMUL_TUNING_DB")));
+        return db;
+    }
+
+    MatmulTuningDb() = default;
+    explicit MatmulTuningDb(const std::string &path)
+    {
+        if (!path.empty()) {
+            (void)Load(path);
+        }
+    }
+
+    bool Load(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in.is_open()) {
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            const size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.resize(comment);
+            }
+            std::istringstream fields(line);
+            MatmulTuneEntry entry;
+            if (fields >> entry.key.soc >> entry.key.aivCoreNum >> entry.key.M >> entry.key.N >> entry.key.K >>
+                entry.key.abElemSize >> entry.config.baseM >> entry.config.baseN >> entry.config.coreNum >>
+                entry.config.stepM >> entry.config.stepN >> entry.config.depthScale >> entry.config.traverse >>
+                entry.timeUs) {
+                Upsert(entry);
+            }
+        }
+        return true;
+    }
+
+    bool Save(const std::string &path) const
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << "# soc aivCoreNum M N K abElemSize baseM baseN coreNum stepM stepN depthScale traverse timeUs\n";
+        for (const auto &e : entries_) {
+            out << e.key.soc << ' ' << e.key.aivCoreNum << ' ' << e.key.M << ' ' << e.key.N << ' ' << e.key.K << ' '
+                << e.key.abElemSize << ' ' << e.config.baseM << ' ' << e.config.baseN << ' ' << e.config.coreNum << ' '
+                << e.config.stepM << ' ' << e.config.stepN << ' ' << e.config.depthScale << ' ' << e.config.traverse
+                << ' ' << e.timeUs << '\n';
+        }
+        return static_cast<bool>(out);
+    }
+
+    void Upsert(const MatmulTuneEntry &entry)
+    {
+        for (auto &e : entries_) {
+            if (SameKey(e.key, entry.key)) {
+                e = entry;
+                return;
+            }
+        }
+        entries_.push_back(entry);
+    }
+
+    const MatmulTuneEntry *Find(const MatmulTuneKey &key) const
+    {
+        for (const auto &e : entries_) {
+            if (SameKey(e.key, key)) {
+                return &e;
+            }
+        }
+        return nullptr;
+    }
+
+    size_t Size() const
+    {
+        return entries_.size();
+    }
+
+private:
+    static bool SameKey(const MatmulTuneKey &a, const MatmulTuneKey &b)
+    {
+        return a.soc == b.soc && a.aivCoreNum == b.aivCoreNum && a.M == b.M && a.N == b.N && a.K == b.K &&
+               a.abElemSize == b.abElemSize;
+    }
+
+    std::vector<MatmulTuneEntry> entries_;
+};
+
+#endif // MATMUL_TUNING_DB_H
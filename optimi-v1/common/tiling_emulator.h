@@ -0,0 +1,558 @@
+/**
+ * @file tiling_emulator.h
+ *
+ * Copyright (C) 2024. Huawei Technologies Co., Ltd. All rights reserved.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ */
+#ifndef TILING_EMULATOR_H
+#define TILING_EMULATOR_H
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "matmul_memory_plan.h"
+
+/*
+ * Host replay of the per-core GM traffic of the matmul, reduce, whole-reduce and broadcast kernels. The offset
+ * arithmetic of each kernel (CalcOffset, CopyOut startOffset, row and element splits) is mirrored here in plain
+ * integer code and every DataCopy is recorded as a run of strided rows. Finish() then checks that the output is
+ * written exactly once, that no access leaves its tensor and that copy parameters fit their fields, which takes
+ * milliseconds instead of a cpu-mode kernel run. The mirrors must be kept in sync with the kernels.
+ */
+
+/**
+  * @brief  One DataCopy in elements: rows of rowElems starting at offset, rowStride apart.
+  */
+struct EmuAccess {
+    uint64_t offset;
+    uint32_t rows;
+    uint64_t rowElems;
+    uint64_t rowStride;
+};
+
+/**
+  * @brief  GM tensor as the kernel sees it. cols > 0 marks a row-major matrix: a copied row must not cross into
+  *         the next matrix row.
+  */
+struct EmuTensor {
+    const char *name;
+    uint64_t elems;
+    uint64_t cols;
+};
+
+class TilingEmuReport {
+public:
+    static constexpr uint32_t MAX_MESSAGES = 16U;
+
+    TilingEmuReport(const char *op, const EmuTensor &output) : op_(op), output_(output) {}
+
+    void Fail(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        ++errors_;
+        if (messages_.size() >= MAX_MESSAGES) {
+            return;
+        }
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        std::vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        messages_.emplace_back(buf);
+    }
+
+    void Read(uint32_t core, const EmuTensor &tensor, const EmuAccess &access)
+    {
+        ++reads_;
+        CheckBounds(core, "read", tensor, access);
+    }
+
+    void Write(uint32_t core, const EmuAccess &access)
+    {
+        ++writes_;
+        if (!CheckBounds(core, "write", output_, access)) {
+            return;
+        }
+        for (uint32_t r = 0; r < access.rows; ++r) {
+            const uint64_t begin = access.offset + r * access.rowStride;
+            runs_.push_back({begin, begin + access.rowElems, core});
+        }
+        written_ += static_cast<uint64_t>(access.rows) * access.rowElems;
+    }
+
+    /**
+      * @brief  Check a copy or instruction parameter against the width of the field it is stored in.
+      */
+    void CheckField(const char *name, uint64_t value, uint64_t max)
+    {
+        if (value > max) {
+            Fail("%s=%llu does not fit its field (max %llu)", name, static_cast<unsigned long long>(value),
+                 static_cast<unsigned long long>(max));
+        }
+    }
+
+    void CheckAligned(const char *name, uint64_t bytes, uint64_t align)
+    {
+        if (bytes % align != 0U) {
+            Fail("%s=%llu bytes is not a multiple of %llu", name, static_cast<unsigned long long>(bytes),
+                 static_cast<unsigned long long>(align));
+        }
+    }
+
+    /**
+      * @brief  Check the UB buffers of one core against ubBytes (0 skips the check), the largest is kept in UbPeak.
+      */
+    void CheckUb(uint32_t core, uint64_t bytes, uint64_t ubBytes)
+    {
+        ubPeak_ = std::max(ubPeak_, bytes);
+        if (ubBytes > 0U && bytes > ubBytes) {
+            Fail("core %u: UB buffers need %llu bytes, UB has %llu", core, static_cast<unsigned long long>(bytes),
+                 static_cast<unsigned long long>(ubBytes));
+        }
+    }
+
+    void SetCores(uint32_t cores)
+    {
+        cores_ = cores;
+    }
+
+    /**
+      * @brief  Coverage pass: sorts the written runs and reports gaps and overlaps of the output.
+      */
+    void Finish()
+    {
+        std::sort(runs_.begin(), runs_.end(), [](const Run &a, const Run &b) { return a.begin < b.begin; });
+        uint64_t covered = 0;
+        uint32_t lastCore = 0;
+        for (const auto &run : runs_) {
+            if (run.begin < covered) {
+                ++overlaps_;
+                Fail("[%llu, %llu) written by core %u and core %u", static_cast<unsigned long long>(run.begin),
+                     static_cast<unsigned long long>(std::min(covered, run.end)), lastCore, run.core);
+            } else if (run.begin > covered) {
+                uncovered_ += run.begin - covered;
+                Fail("[%llu, %llu) never written", static_cast<unsigned long long>(covered),
+                     static_cast<unsigned long long>(run.begin));
+            }
+            if (run.end > covered) {
+                covered = run.end;
+                lastCore = run.core;
+            }
+        }
+        if (covered < output_.elems) {
+            uncovered_ += output_.elems - covered;
+            Fail("[%llu, %llu) never written", static_cast<unsigned long long>(covered),
+                 static_cast<unsigned long long>(output_.elems));
+        }
+    }
+
+    bool Ok() const
+    {
+        return errors_ == 0U;
+    }
+
+    uint64_t UbPeak() const
+    {
+        return ubPeak_;
+    }
+
+    void Print() const
+    {
+        std::printf("[EMU] %s cores=%u reads=%llu writes=%llu written=%llu/%llu uncovered=%llu overlaps=%llu "
+                    "errors=%llu %s\n",
+                    op_.c_str(), cores_, static_cast<unsigned long long>(reads_),
+                    static_cast<unsigned long long>(writes_), static_cast<unsigned long long>(written_),
+                    static_cast<unsigned long long>(output_.elems), static_cast<unsigned long long>(uncovered_),
+                    static_cast<unsigned long long>(overlaps_), static_cast<unsigned long long>(errors_),
+                    Ok() ? "PASS" : "FAIL");
+        for (const auto &message : messages_) {
+            std::printf("[EMU]   %s\n", message.c_str());
+        }
+        if (errors_ > messages_.size()) {
+            std::printf("[EMU]   ... %llu more\n", static_cast<unsigned long long>(errors_ - messages_.size()));
+        }
+    }
+
+private:
+    struct Run {
+        uint64_t begin;
+        uint64_t end;
+        uint32_t core;
+    };
+
+    bool CheckBounds(uint32_t core, const char *kind, const EmuTensor &tensor, const EmuAccess &access)
+    {
+        if (access.rows == 0U || access.rowElems == 0U) {
+            return true;
+        }
+        const uint64_t last = access.offset + (access.rows - 1U) * access.rowStride + access.rowElems;
+        if (last > tensor.elems) {
+            Fail("core %u: %s of %s [%llu, %llu) past its %llu elements", core, kind, tensor.name,
+                 static_cast<unsigned long long>(access.offset), static_cast<unsigned long long>(last),
+                 static_cast<unsigned long long>(tensor.elems));
+            return false;
+        }
+        if (tensor.cols > 0U && access.offset % tensor.cols + access.rowElems > tensor.cols) {
+            Fail("core %u: %s of %s at row %llu col %llu runs %llu past the row end", core, kind, tensor.name,
+                 static_cast<unsigned long long>(access.offset / tensor.cols),
+                 static_cast<unsigned long long>(access.offset % tensor.cols),
+                 static_cast<unsigned long long>(access.offset % tensor.cols + access.rowElems - tensor.cols));
+            return false;
+        }
+        return true;
+    }
+
+    std::string op_;
+    EmuTensor output_;
+    std::vector<Run> runs_;
+    std::vector<std::string> messages_;
+    uint32_t cores_ = 0;
+    uint64_t reads_ = 0;
+    uint64_t writes_ = 0;
+    uint64_t written_ = 0;
+    uint64_t uncovered_ = 0;
+    uint64_t overlaps_ = 0;
+    uint64_t errors_ = 0;
+    uint64_t ubPeak_ = 0;
+};
+
+constexpr uint64_t EMU_BLOCK_BYTES = 32U;  // DataCopy unit
+constexpr uint64_t EMU_U16_MAX = 0xFFFFU;
+
+/**
+  * @brief  Which matmul + LeakyRelu kernel to replay.
+  *         12 op_kernel: splitRowNums from SelectSplitRowNums, full base tiles, no tail masking.
+  *         13 v2 kernel: splitRowNums 4, rows past validM masked through SetTail.
+  */
+enum class MatmulEmuKernel : uint32_t {
+    FRAMEWORK_12 = 0,
+    LAUNCH_13_V2 = 1,
+};
+
+/**
+  * @brief  Replay CalcOffset and the Process/CopyOut loop of every core. Each CopyOut is also compared with the
+  *         base tile Iterate hands out at that step (FIRSTM or FIRSTN order), so a startOffset formula that writes
+  *         a correct-looking pattern to the wrong place is caught too.
+  * @param  tiling: TCubeTiling (or optiling::TCubeTiling) of the launch.
+  * @param  validM: Rows of C, tiling.M is the bucket for LAUNCH_13_V2; ignored by FRAMEWORK_12.
+  * @param  ubBytes: UB of one core, 0 skips the UB check.
+  */
+template <typename Tiling>
+inline TilingEmuReport EmulateMatmulLeakyRelu(const Tiling &tiling, MatmulEmuKernel kernel, uint32_t validM,
+                                              uint64_t ubBytes)
+{
+    const uint64_t M = static_cast<uint64_t>(tiling.M);
+    const uint64_t N = static_cast<uint64_t>(tiling.N);
+    const uint64_t Ka = static_cast<uint64_t>(tiling.Ka);
+    const uint32_t singleCoreM = static_cast<uint32_t>(tiling.singleCoreM);
+    const uint32_t singleCoreN = static_cast<uint32_t>(tiling.singleCoreN);
+    const uint32_t baseM = static_cast<uint32_t>(tiling.baseM);
+    const uint32_t baseN = static_cast<uint32_t>(tiling.baseN);
+    const uint32_t cores = static_cast<uint32_t>(tiling.usedCoreNum);
+    const bool v2 = kernel == MatmulEmuKernel::LAUNCH_13_V2;
+    const uint64_t rowsC = (v2 && validM > 0U && validM < M) ? validM : M;
+
+    TilingEmuReport report(v2 ? "matmul_leakyrelu(13 v2)" : "matmul_leakyrelu(12)", {"C", rowsC * N, N});
+    report.SetCores(cores);
+    if (M == 0U || N == 0U || Ka == 0U || cores == 0U || singleCoreM == 0U || singleCoreN == 0U || baseM == 0U ||
+        baseN == 0U) {
+        report.Fail("zero field in tiling");
+        return report;
+    }
+    const uint32_t splitRowNums = v2 ? 4U : LeakyReluSplitRowNums(baseM, baseN, singleCoreM);
+    const uint32_t splitRowSize = baseM / splitRowNums;
+    if (splitRowSize == 0U || baseM % splitRowNums != 0U) {
+        report.Fail("baseM=%u does not split into %u row slices", baseM, splitRowNums);
+        return report;
+    }
+    // DataCopyParams of CopyOut: blockLen and dstStride are in 32 B units and uint16 wide.
+    report.CheckAligned("CopyOut blockLen", baseN * sizeof(float), EMU_BLOCK_BYTES);
+    report.CheckAligned("CopyOut dstStride", (N - baseN) * sizeof(float), EMU_BLOCK_BYTES);
+    report.CheckField("CopyOut blockLen", baseN * sizeof(float) / EMU_BLOCK_BYTES, EMU_U16_MAX);
+    report.CheckField("CopyOut dstStride", (N - baseN) * sizeof(float) / EMU_BLOCK_BYTES, EMU_U16_MAX);
+    report.CheckField("CopyOut blockCount", splitRowSize, EMU_U16_MAX);
+    if (singleCoreN % baseN != 0U) {
+        report.Fail("singleCoreN=%u is not a multiple of baseN=%u", singleCoreN, baseN);
+    }
+
+    const EmuTensor a = {"A", rowsC * Ka, Ka};
+    const EmuTensor b = {"B", static_cast<uint64_t>(tiling.Kb) * N, N};
+    const EmuTensor bias = {"bias", N, 0U};
+    const uint32_t mSingleBlocks = static_cast<uint32_t>((M + singleCoreM - 1U) / singleCoreM);
+    const uint32_t roundN = singleCoreN / baseN;
+    for (uint32_t core = 0; core < cores; ++core) {
+        const uint32_t mCoreIndx = core % mSingleBlocks;
+        const uint32_t nCoreIndx = core / mSingleBlocks;
+        // CalcOffset keeps offsets in int32_t.
+        const uint64_t offsetC = static_cast<uint64_t>(mCoreIndx) * N * singleCoreM +
+                                 static_cast<uint64_t>(nCoreIndx) * singleCoreN;
+        const uint64_t offsetA = static_cast<uint64_t>(mCoreIndx) * Ka * singleCoreM;
+        if (offsetC > INT32_MAX || offsetA > INT32_MAX) {
+            report.Fail("core %u: CalcOffset overflows int32 (offsetA=%llu offsetC=%llu)", core,
+                        static_cast<unsigned long long>(offsetA), static_cast<unsigned long long>(offsetC));
+        }
+
+        uint32_t coreM = singleCoreM;
+        uint32_t mTiles = singleCoreM / baseM;
+        uint32_t tiles = singleCoreM * singleCoreN / (baseM * baseN);
+        uint32_t roundM = singleCoreM / splitRowSize;
+        if (v2) {
+            const uint64_t rowStart = static_cast<uint64_t>(mCoreIndx) * singleCoreM;
+            coreM = rowStart >= rowsC ? 0U : static_cast<uint32_t>(std::min<uint64_t>(rowsC - rowStart, singleCoreM));
+            if (coreM == 0U) {
+                continue;
+            }
+            mTiles = (coreM + baseM - 1U) / baseM;
+            tiles = mTiles * roundN;
+            roundM = mTiles * splitRowNums;
+        }
+        report.CheckUb(core, LeakyReluKernelUbBytes(baseM, baseN, splitRowNums), ubBytes);
+        report.Read(core, a, {offsetA, coreM, Ka, Ka});
+        report.Read(core, b, {static_cast<uint64_t>(nCoreIndx) * singleCoreN, static_cast<uint32_t>(tiling.Kb),
+                              singleCoreN, N});
+        report.Read(core, bias, {static_cast<uint64_t>(nCoreIndx) * singleCoreN, 1U, singleCoreN, 0U});
+
+        for (uint32_t i = 0; i < tiles; ++i) {
+            // Base tile Iterate produced at step i.
+            const uint32_t mIdx = tiling.iterateOrder == 1 ? i / roundN : i % mTiles;
+            const uint32_t nIdx = tiling.iterateOrder == 1 ? i % roundN : i / mTiles;
+            const uint32_t tileRows = v2 ? coreM - mIdx * baseM : baseM;
+            for (uint32_t j = 0; j < splitRowNums && j * splitRowSize < tileRows; ++j) {
+                const uint32_t count = i * splitRowNums + j;
+                uint32_t startOffset = count % roundM * splitRowSize * static_cast<uint32_t>(N) +
+                                       count / roundM * baseN;
+                if (tiling.iterateOrder == 1) {
+                    const uint32_t tile = count / splitRowNums;
+                    const uint32_t row = tile / roundN * splitRowNums + count % splitRowNums;
+                    startOffset = row * splitRowSize * static_cast<uint32_t>(N) + tile % roundN * baseN;
+                }
+                const uint64_t expected = (static_cast<uint64_t>(mIdx) * baseM + j * splitRowSize) * N +
+                                          static_cast<uint64_t>(nIdx) * baseN;
+                if (startOffset != expected) {
+                    report.Fail("core %u step %u split %u: CopyOut writes offset %u, tile (%u, %u) belongs at %llu",
+                                core, i, j, startOffset, mIdx, nIdx, static_cast<unsigned long long>(expected));
+                }
+                const uint32_t rows = std::min(splitRowSize, tileRows - j * splitRowSize);
+                report.Write(core, {offsetC + startOffset, rows, baseN, N});
+            }
+        }
+    }
+    report.Finish();
+    return report;
+}
+
+/**
+  * @brief  Host mirror of TilingFunc in the 14 op_host (tiling key by dtype and length), keep the two in sync.
+  */
+inline uint32_t ReduceTilingKey(uint32_t totalLength, uint32_t elemBytes)
+{
+    if (elemBytes == 2U) {
+        return totalLength <= 128U ? 11U : (totalLength <= 2048U ? 12U : 13U);
+    }
+    if (totalLength <= 64U) {
+        return 1U;
+    }
+    if (totalLength <= 512U) {
+        return 2U;
+    }
+    if (totalLength <= 4096U) {
+        return 3U;
+    }
+    return totalLength == 10000U ? 4U : (totalLength == 20000U ? 5U : 3U);
+}
+
+/**
+  * @brief  Replay the single-core reduce kernel: CopyIn/CopyOut plus the UB scratch each Compute variant writes.
+  * @param  outLength: tiling outLength, the z tensor has outLength elements.
+  */
+inline TilingEmuReport EmulateReduce(uint32_t totalLength, uint32_t outLength, uint32_t tilingKey, uint32_t elemBytes,
+                                     uint64_t ubBytes)
+{
+    TilingEmuReport report("reduce", {"z", outLength, 0U});
+    report.SetCores(1U);
+    const uint32_t repeatElems = 256U / elemBytes;
+    const uint32_t blockElems = static_cast<uint32_t>(EMU_BLOCK_BYTES) / elemBytes;
+    report.CheckAligned("CopyIn DataCopy", static_cast<uint64_t>(totalLength) * elemBytes, EMU_BLOCK_BYTES);
+    report.CheckAligned("CopyOut DataCopy", static_cast<uint64_t>(outLength) * elemBytes, EMU_BLOCK_BYTES);
+    report.Read(0U, {"x", totalLength, 0U}, {0U, 1U, totalLength, 0U});
+
+    // Elements the first pass stores into zLocal or calcBuf, and the size of that buffer.
+    uint64_t calcElems = 0;
+    uint64_t scratchWritten = 1;
+    uint64_t scratchElems = outLength;
+    const char *scratch = "zLocal";
+    switch (tilingKey % 10U) {
+        case 2U:
+            calcElems = (totalLength + blockElems - 1U) / blockElems;
+            scratchWritten = calcElems;
+            scratchElems = calcElems;
+            scratch = "calcBuf";
+            break;
+        case 3U:
+            calcElems = (static_cast<uint64_t>(totalLength) * elemBytes + 255U) / 256U;
+            scratchWritten = calcElems;
+            scratchElems = calcElems;
+            scratch = "calcBuf";
+            break;
+        case 4U: // WholeReduceSumImpl reduces in place in zLocal.
+            scratchWritten = (totalLength + repeatElems - 1U) / repeatElems;
+            break;
+        case 5U: { // BinaryReduceSumImpl folds the upper half onto zLocal.
+            const uint64_t half = (totalLength + 15U) / 16U * 8U;
+            scratchWritten = totalLength > repeatElems ? std::max<uint64_t>(totalLength - half, 1U) : 1U;
+            break;
+        }
+        default:
+            break;
+    }
+    if (scratchWritten > scratchElems) {
+        report.Fail("tiling key %u: Compute stores %llu elements into %s of %llu", tilingKey,
+                    static_cast<unsigned long long>(scratchWritten), scratch,
+                    static_cast<unsigned long long>(scratchElems));
+    }
+    report.CheckUb(0U, (static_cast<uint64_t>(totalLength) + outLength + calcElems) * elemBytes, ubBytes);
+    report.Write(0U, {0U, 1U, outLength, 0U});
+    report.Finish();
+    return report;
+}
+
+/**
+  * @brief  Host mirror of the blockDim choice of TilingFunc in the 18 op_host, keep the two in sync.
+  * @param  forceBlockDim: WRS_FORCE_BLOCKDIM, 0 when unset.
+  */
+inline uint32_t WholeReduceSumBlockDim(uint32_t rows, uint32_t cols, uint32_t coreNum, uint32_t forceBlockDim)
+{
+    coreNum = std::max<uint32_t>(1U, coreNum);
+    const uint32_t targetElemsPerCore = 4096U;
+    const uint32_t suggested = std::max<uint32_t>(1U, (rows * cols + targetElemsPerCore - 1U) / targetElemsPerCore);
+    uint32_t blockDim = std::max<uint32_t>(1U, std::min<uint32_t>(rows, std::min<uint32_t>(coreNum, suggested)));
+    const uint32_t minBlockByRowBound = std::max<uint32_t>(1U, (rows + 65534U) / 65535U);
+    blockDim = std::max<uint32_t>(blockDim, minBlockByRowBound);
+    if (forceBlockDim > 0U) {
+        blockDim = std::max<uint32_t>(minBlockByRowBound, forceBlockDim);
+    }
+    return std::min<uint32_t>(rows, std::min<uint32_t>(coreNum, blockDim));
+}
+
+/**
+  * @brief  Replay the row split of the whole-reduce kernel: DataCopyPad of rowCount rows in, rowCount sums out.
+  */
+inline TilingEmuReport EmulateWholeReduceSum(uint32_t rows, uint32_t cols, uint32_t blockDim, uint32_t elemBytes,
+                                             uint64_t ubBytes)
+{
+    TilingEmuReport report("whole_reduce_sum", {"y", rows, 0U});
+    report.SetCores(blockDim);
+    if (blockDim == 0U || cols == 0U) {
+        report.Fail("zero blockDim or cols");
+        return report;
+    }
+    const EmuTensor x = {"x", static_cast<uint64_t>(rows) * cols, cols};
+    const uint32_t rowsPerCore = rows / blockDim;
+    const uint32_t remainRows = rows % blockDim;
+    const uint64_t colAligned = (static_cast<uint64_t>(cols) * elemBytes + EMU_BLOCK_BYTES - 1U) / EMU_BLOCK_BYTES *
+                                EMU_BLOCK_BYTES;
+    for (uint32_t core = 0; core < blockDim; ++core) {
+        const uint32_t rowCount = rowsPerCore + (core < remainRows ? 1U : 0U);
+        const uint32_t rowOffset = rowsPerCore * core + (core < remainRows ? core : remainRows);
+        if (rowCount == 0U) {
+            continue;
+        }
+        // DataCopyExtParams.blockCount and the CopyOut byte count are uint16.
+        report.CheckField("CopyIn blockCount", rowCount, EMU_U16_MAX);
+        report.CheckField("CopyOut blockLen", static_cast<uint64_t>(rowCount) * elemBytes, EMU_U16_MAX);
+        const uint64_t reducedAligned = (static_cast<uint64_t>(rowCount) * elemBytes + EMU_BLOCK_BYTES - 1U) /
+                                        EMU_BLOCK_BYTES * EMU_BLOCK_BYTES;
+        report.CheckUb(core, colAligned * rowCount + reducedAligned, ubBytes);
+        report.Read(core, x, {static_cast<uint64_t>(rowOffset) * cols, rowCount, cols, cols});
+        report.Write(core, {rowOffset, 1U, rowCount, 0U});
+    }
+    report.Finish();
+    return report;
+}
+
+/**
+  * @brief  Fields of BroadcastTilingData the kernel reads.
+  */
+struct BroadcastEmuTiling {
+    uint32_t totalLength;
+    uint32_t tilenum;
+    uint32_t tmpSize;
+    uint32_t dim;
+    uint32_t axis;
+    uint32_t num;
+    uint32_t bLength;
+};
+
+/**
+  * @brief  Host mirror of the tilenum choice of TilingFunc in the 7 op_host, keep the two in sync.
+  * @param  sLength: second dim of a 2-d input, ignored for dim 1.
+  */
+inline uint32_t BroadcastTileNum(uint32_t totalLength, uint32_t dim, uint32_t axis, uint32_t sLength)
+{
+    if (dim == 2U && axis == 0U) {
+        return 1U;
+    }
+    const uint32_t length = dim == 1U ? totalLength : sLength;
+    uint32_t tilenum = length >= 4U ? 4U : length;
+    while (tilenum > 1U && length % tilenum != 0U) {
+        --tilenum;
+    }
+    return tilenum;
+}
+
+/**
+  * @brief  Replay Init/Process of the broadcast kernel: element split over cores, tile loop, CopyIn/CopyOut.
+  */
+inline TilingEmuReport EmulateBroadcast(const BroadcastEmuTiling &tiling, uint32_t blockDim, uint32_t elemBytes,
+                                        uint64_t ubBytes)
+{
+    const uint64_t outElems = static_cast<uint64_t>(tiling.totalLength) * tiling.num;
+    TilingEmuReport report("broadcast", {"y", outElems, 0U});
+    report.SetCores(blockDim);
+    if (blockDim == 0U || tiling.num == 0U) {
+        report.Fail("zero blockDim or num");
+        return report;
+    }
+    const EmuTensor x = {"x", tiling.totalLength, 0U};
+    const uint32_t baseLen = tiling.totalLength / blockDim;
+    const uint32_t remainLen = tiling.totalLength % blockDim;
+    for (uint32_t core = 0; core < blockDim; ++core) {
+        const uint32_t blockLength = baseLen + (core < remainLen ? 1U : 0U);
+        const uint32_t blockOffset = baseLen * core + (core < remainLen ? core : remainLen);
+        if (blockLength == 0U) {
+            continue;
+        }
+        uint32_t tilenum = tiling.tilenum == 0U ? 1U : tiling.tilenum;
+        if (blockLength % tilenum != 0U) {
+            tilenum = 1U;
+        }
+        uint32_t tileLength = blockLength / tilenum;
+        if (tileLength == 0U) {
+            tilenum = 1U;
+            tileLength = blockLength;
+        }
+        if (tiling.dim == 2U && tiling.bLength > 0U && tileLength % tiling.bLength != 0U) {
+            tilenum = 1U;
+            tileLength = blockLength;
+        }
+        const uint64_t tileLength2 = tiling.dim == 1U ? tiling.num : static_cast<uint64_t>(tileLength) * tiling.num;
+        report.CheckAligned("CopyIn DataCopy", static_cast<uint64_t>(tileLength) * elemBytes, EMU_BLOCK_BYTES);
+        report.CheckAligned("CopyOut DataCopy", tileLength2 * elemBytes, EMU_BLOCK_BYTES);
+        report.CheckUb(core, (tileLength + tileLength2) * elemBytes + tiling.tmpSize, ubBytes);
+        const uint64_t yBase = static_cast<uint64_t>(blockOffset) * tiling.num;
+        for (uint32_t progress = 0; progress < tilenum; ++progress) {
+            report.Read(core, x, {blockOffset + static_cast<uint64_t>(progress) * tileLength, 1U, tileLength, 0U});
+            report.Write(core, {yBase + progress * tileLength2, 1U, tileLength2, 0U});
+        }
+    }
+    report.Finish();
+    return report;
+}
+
+#endif // TILING_EMULATOR_H